@@ -100,7 +100,6 @@ void BlockMatching::execute() {
             cl::NullRange
         );
     }
-    queue.finish();
 
     m_frameBuffer.pop_front();
 }
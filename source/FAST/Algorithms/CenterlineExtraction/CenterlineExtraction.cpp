@@ -2,8 +2,9 @@
 #include "FAST/Data/Segmentation.hpp"
 #include "FAST/Data/Mesh.hpp"
 #include "FAST/Utility.hpp"
-#include <unordered_set>
-#include <stack>
+#include "FAST/Algorithms/OpenCLIterativeSolver.hpp"
+#include "FastMarching.hpp"
+#include <algorithm>
 #include "FAST/Exporters/MetaImageExporter.hpp"
 
 
@@ -14,6 +15,7 @@ CenterlineExtraction::CenterlineExtraction() {
 	createOutputPort<Mesh>(0);
 
 	createOpenCLProgram(Config::getKernelSourcePath() + "Algorithms/CenterlineExtraction/CenterlineExtraction.cl");
+	createBooleanAttribute("parallel-seeds", "Parallel seeds", "Extract the centerline of each connected part of the segmentation in parallel", m_parallelSeeds);
 }
 
 Image::pointer CenterlineExtraction::calculateDistanceTransform(Image::pointer input) {
@@ -54,14 +56,9 @@ Image::pointer CenterlineExtraction::calculateDistanceTransform(Image::pointer i
 	Image::pointer distance2 = Image::New();
 	distance2->create(input->getSize(), TYPE_INT16, 1);
 
-	cl::Buffer changedBuffer(
-			device->getContext(),
-			CL_MEM_READ_WRITE,
-			sizeof(char)
-    );
-
+	// Iterate without waiting for the device after each step
+	OpenCLIterativeSolver solver(device);
 	cl::Kernel distanceKernel(program, "calculateDistance");
-	distanceKernel.setArg(2, changedBuffer);
 	int counter = 0;
 	if(device->isWritingTo3DTexturesSupported()) {
 		OpenCLImageAccess::pointer distanceAccess = distance->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
@@ -77,31 +74,22 @@ Image::pointer CenterlineExtraction::calculateDistanceTransform(Image::pointer i
 				createRegion(input->getSize())
 		);
 
-		while(true) {
-			// Write 0 to changedBuffer
-			char zero = 0;
-			queue.enqueueWriteBuffer(changedBuffer,CL_FALSE,0,sizeof(char),&zero);
-
-			if(counter % 2 == 0) {
+		counter = solver.run([&](int iteration, cl::Buffer& changed) {
+			if(iteration % 2 == 0) {
 				distanceKernel.setArg(0, *clDistance);
 				distanceKernel.setArg(1, *clDistance2);
 			} else {
 				distanceKernel.setArg(1, *clDistance);
 				distanceKernel.setArg(0, *clDistance2);
 			}
-			counter++;
+			distanceKernel.setArg(2, changed);
 			queue.enqueueNDRangeKernel(
 				distanceKernel,
 				cl::NullRange,
 				cl::NDRange(width, height, depth),
 				cl::NullRange
 			);
-
-			queue.enqueueReadBuffer(changedBuffer,CL_TRUE,0,sizeof(char),&zero);
-			if(zero == 0) {
-				break;
-			}
-		}
+		});
 	} else {
 
 		OpenCLBufferAccess::pointer distanceAccess = distance->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
@@ -117,34 +105,26 @@ Image::pointer CenterlineExtraction::calculateDistanceTransform(Image::pointer i
 				input->getSize().x()*input->getSize().y()*input->getSize().z()*sizeof(short)
 		);
 
-		while(true) {
-			// Write 0 to changedBuffer
-			char zero = 0;
-			queue.enqueueWriteBuffer(changedBuffer,CL_FALSE,0,sizeof(char),&zero);
-
-			if(counter % 2 == 0) {
+		counter = solver.run([&](int iteration, cl::Buffer& changed) {
+			if(iteration % 2 == 0) {
 				distanceKernel.setArg(0, *clDistance);
 				distanceKernel.setArg(1, *clDistance2);
 			} else {
 				distanceKernel.setArg(1, *clDistance);
 				distanceKernel.setArg(0, *clDistance2);
 			}
-			counter++;
+			distanceKernel.setArg(2, changed);
 			queue.enqueueNDRangeKernel(
 				distanceKernel,
 				cl::NullRange,
 				cl::NDRange(width, height, depth),
 				cl::NullRange
 			);
-
-			queue.enqueueReadBuffer(changedBuffer,CL_TRUE,0,sizeof(char),&zero);
-			if(zero == 0) {
-				break;
-			}
-		}
+		});
 	}
-	reportInfo() << "Calculated distance in " << counter << " steps" << reportEnd();
+	reportInfo() << "Calculated distance in " << counter << " steps with " << solver.getNrOfFlagReads() << " reads" << reportEnd();
 
+	// The last iteration didn't change anything, thus both images contain the result
 
 	if(counter % 2 == 0) {
 		return distance;
@@ -167,87 +147,198 @@ inline Vector3i position3D(int pos, Vector3i size) {
 	return Vector3i(x,y,z);
 }
 
-inline double solveQuadratic(const std::vector<double>& G, const std::unique_ptr<double[]>& speed, Vector3i pos, Vector3i size) {
+inline bool inBounds(Vector3i pos, Vector3i size) {
+	return pos.x() >= 0 && pos.y() >= 0 && pos.z() >= 0 && pos.x() < size.x() && pos.y() < size.y() && pos.z() < size.z();
+}
 
-	std::vector<double> abc = {
-            std::min(G[linearPosition(pos + Vector3i(1,0,0), size)], G[linearPosition(pos - Vector3i(1,0,0), size)]),
-            std::min(G[linearPosition(pos + Vector3i(0,1,0), size)], G[linearPosition(pos - Vector3i(0,1,0), size)]),
-            std::min(G[linearPosition(pos + Vector3i(0,0,1), size)], G[linearPosition(pos - Vector3i(0,0,1), size)])
-	};
+/**
+ * Flags of each voxel used when extracting the centerline of a part
+ */
+enum CenterlineVoxelFlag : uchar {
+	CANDIDATE = 1, // Candidate centerpoint not yet removed
+	CENTERLINE = 2, // Part of the extracted centerline
+	GROWN = 4 // Visited by growFromPointsAdded
+};
+
+/**
+ * Connected part of the segmentation
+ */
+struct CenterlinePart {
+	int seed = -1;
+	short maxDistance = 0;
+	std::vector<int> candidates;
+};
+
+/**
+ * Voxels of one part of the segmentation, with arrival times from the fast marching. Voxels outside the part are
+ * treated as not reached, since they may belong to a part which is processed in parallel.
+ */
+class CenterlinePartVoxels {
+	public:
+		CenterlinePartVoxels(int label, const int* labels, const uchar* inputArray, const FastMarching& marching, Vector3i size) :
+			m_label(label), m_labels(labels), m_inputArray(inputArray), m_marching(marching), m_size(size) {
+		}
+		bool contains(int linearPosition) const {
+			// Labels are only set for voxels in the segmentation
+			return m_inputArray[linearPosition] == 1 && m_labels[linearPosition] == m_label;
+		}
+		bool contains(Vector3i pos) const {
+			return inBounds(pos, m_size) && contains(linearPosition(pos, m_size));
+		}
+		double getArrivalTime(int linearPosition) const {
+			if(!contains(linearPosition))
+				return std::numeric_limits<double>::infinity();
+			return m_marching.getArrivalTime(linearPosition);
+		}
+		double getArrivalTime(Vector3i pos) const {
+			if(!inBounds(pos, m_size))
+				return std::numeric_limits<double>::infinity();
+			return getArrivalTime(linearPosition(pos, m_size));
+		}
+	private:
+		const int m_label;
+		const int* m_labels;
+		const uchar* m_inputArray;
+		const FastMarching& m_marching;
+		const Vector3i m_size;
+};
 
-	std::sort(abc.begin(), abc.end());
-	double a = abc[2];
-	double b = abc[1];
-	double c = abc[0];
+static const Vector3i neighbors26[26] = {
+	{-1,-1,-1}, {-1,-1,0}, {-1,-1,1}, {-1,0,-1}, {-1,0,0}, {-1,0,1}, {-1,1,-1}, {-1,1,0}, {-1,1,1},
+	{0,-1,-1}, {0,-1,0}, {0,-1,1}, {0,0,-1}, {0,0,1}, {0,1,-1}, {0,1,0}, {0,1,1},
+	{1,-1,-1}, {1,-1,0}, {1,-1,1}, {1,0,-1}, {1,0,0}, {1,0,1}, {1,1,-1}, {1,1,0}, {1,1,1}
+};
 
-	double f = speed[linearPosition(pos, size)];
+inline void growFromPointsAdded(const std::vector<Vector3i>& points, const CenterlinePartVoxels& part, std::vector<uchar>& flags, Vector3i size) {
 
-	if(f == 0) {
-		std::cout << "speed is zero!" << std::endl;
-		exit(0);
-	}
+	std::vector<Vector3i> stack;
+	stack.push_back(points[0]);
 
-	double u = c + 1.0 / f;
-	if(u <= b) {
-	    return u;
-	} else {
-		double sqrted = -b*b - c*c + 2.0*b*c + (2.0/(f*f));
-		if(sqrted < 0) {
-			sqrted = 0;
-		} else {
-			sqrted = sqrt(sqrted);
-		}
+	while(!stack.empty()) {
+		Vector3i current = stack.back();
+		stack.pop_back();
+		flags[linearPosition(current, size)] &= ~CANDIDATE;
 
-	    u = (b + c + sqrted)/2.0;
-	    if(u <= a) {
-	        return u;
-	    } else {
-	    	sqrted = 4.0*(a + b + c)*(a + b + c) - 12.0*(a*a + b*b + c*c - 1/(f*f));
-            if(sqrted < 0) {
-            	sqrted = 0;
-            } else {
-                sqrted = sqrt(sqrted);
-            }
-	        return (2.0*(a + b + c) + sqrted)/6.0;
-	    }
+		// Add neighbors
+		const double currentG = part.getArrivalTime(current);
+		for(const Vector3i& neighbor : neighbors26) {
+			Vector3i xn = current + neighbor;
+			if(part.getArrivalTime(xn) < currentG) {
+				uchar& flag = flags[linearPosition(xn, size)];
+				if((flag & GROWN) == 0) {
+					stack.push_back(xn);
+					flag |= GROWN;
+				}
+			}
+		}
 	}
 }
 
-inline void growFromPointsAdded(const std::vector<Vector3i>& points, const std::vector<double>& G, std::unordered_set<int>& Sc, std::unordered_set<int>& processed, Vector3i size) {
+/**
+ * Backtrace from the candidate centerpoints of a part, starting with the one furthest away from the seed
+ */
+static void extractCenterline(const CenterlinePart& part, const CenterlinePartVoxels& voxels, const short* distanceArray,
+		std::vector<uchar>& flags, Vector3i size, Vector3f spacing, std::vector<MeshVertex>& vertices, std::vector<MeshLine>& lines) {
+	// The arrival times don't change while backtracing, thus the candidates can be visited in order of decreasing G.
+	// The sort is stable, so that the first of several candidates with the same G is selected.
+	std::vector<std::pair<double, int>> candidatesByG;
+	for(int candidate : part.candidates) {
+		flags[candidate] |= CANDIDATE;
+		const double G = voxels.getArrivalTime(candidate);
+		if(G > 0.0 && !std::isinf(G))
+			candidatesByG.push_back(std::make_pair(G, candidate));
+	}
+	std::stable_sort(candidatesByG.begin(), candidatesByG.end(), [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+		return a.first > b.first;
+	});
+	std::size_t nextCandidate = 0;
 
-	std::stack<Vector3i> stack;
-	stack.push(points[0]);
+	while(true) {
+		// Find candidate centerline point with highest G, which has not been removed
+		while(nextCandidate < candidatesByG.size() && (flags[candidatesByG[nextCandidate].second] & CANDIDATE) == 0)
+			++nextCandidate;
 
-	std::vector<Vector3i> neighbors2;
-    for(int a = -1; a <= 1;  ++a) {
-    for(int b = -1; b <= 1;  ++b) {
-    for(int c = -1; c <= 1;  ++c) {
-    	if(a == 0 && b == 0 && c == 0)
-    		continue;
-    	neighbors2.push_back(Vector3i(a,b,c));
-    }}}
+		if(nextCandidate == candidatesByG.size())
+			break;
+		const int maxLinearPosition = candidatesByG[nextCandidate].second;
 
-	while(!stack.empty()) {
-		Vector3i current = stack.top();
-		stack.pop();
-        std::unordered_set<int>::iterator it = Sc.find(linearPosition(current, size));
-        if(it != Sc.end()) {
-            Sc.erase(it);
-        }
+		// Convert maxPosition to 3D
+		Vector3i maxPosition = position3D(maxLinearPosition, size);
 
-		// Add neighbors
-        for(Vector3i neighbor : neighbors2) {
-            Vector3i xn = current + neighbor;
-            if(G[linearPosition(xn, size)] < G[linearPosition(current, size)]) {
-            	if(processed.count(linearPosition(xn, size)) == 0) {
-                    stack.push(xn);
-                    processed.insert(linearPosition(xn, size));
-            	}
-            }
-        }
+		std::vector<Vector3i> pointsToAdd;
+		Vector3i current = maxPosition;
+		Vector3i previous = Vector3i::Zero();
+		Vector3i previous2 = Vector3i::Zero();
+		while(true) {
+			flags[linearPosition(current, size)] &= ~CANDIDATE;
+
+			// Find neighbor point with min G
+			double minG = std::numeric_limits<double>::infinity();
+			Vector3i bestPos = current;
+			Vector3i bestDPos;
+			double maxD = -1;
+			for(const Vector3i& n : neighbors26) {
+				Vector3i xn = current + n;
+				if(voxels.contains(xn) && (flags[linearPosition(xn, size)] & CENTERLINE)) {
+					if(distanceArray[linearPosition(xn, size)] > maxD) {
+						maxD = distanceArray[linearPosition(xn, size)];
+						bestDPos = xn;
+					}
+				}
+				const double G = voxels.getArrivalTime(xn);
+				if(G < minG) {
+					minG = G;
+					bestPos = xn;
+				}
+			}
+
+			if(maxD > -1) {
+				current = bestDPos;
+			} else {
+				current = bestPos;
+			}
+			pointsToAdd.push_back(current);
+
+			// A failsafe (why is this needed?)
+			if(previous2 == current) {
+				break;
+			}
+			previous2 = previous;
+			previous = current;
+
+			// Stop conditions
+			if(minG == 0) {
+				break;
+			}
+			if(flags[linearPosition(current, size)] & CENTERLINE) {
+				// Bifurcation
+				break;
+			}
+		}
+
+		if(pointsToAdd.size() > 10) { // minimum length
+			growFromPointsAdded(pointsToAdd, voxels, flags, size);
+			int counter = vertices.size();
+			vertices.push_back(MeshVertex(pointsToAdd[0].cast<float>().cwiseProduct(spacing)));
+			flags[linearPosition(pointsToAdd[0], size)] |= CENTERLINE;
+			for(int i = 1; i < pointsToAdd.size(); ++i) {
+				flags[linearPosition(pointsToAdd[i], size)] |= CENTERLINE;
+				vertices.push_back(MeshVertex(pointsToAdd[i].cast<float>().cwiseProduct(spacing)));
+				lines.push_back(MeshLine(counter, counter + 1));
+				counter += 1;
+			}
+		}
 	}
 }
 
+void CenterlineExtraction::setParallelSeeds(bool parallel) {
+	m_parallelSeeds = parallel;
+}
+
+void CenterlineExtraction::loadAttributes() {
+	setParallelSeeds(getBooleanAttribute("parallel-seeds"));
+}
+
 void CenterlineExtraction::execute() {
 	Image::pointer input = getInputData<Image>();
 	Vector3f spacing = input->getSpacing();
@@ -311,193 +402,103 @@ void CenterlineExtraction::execute() {
 	short* distanceArray = (short*)distanceAccess->get();
 	uchar* inputArray = (uchar*)inputAccess->get();
 	uchar* candidateArray = (uchar*)candidateAccess->get();
-	int iteration = 0;
-	std::vector<MeshVertex> vertices;
-	std::vector<MeshLine> lines;
-	std::vector<bool> processedVoxels(totalSize, false);
-	while(true) {
-		reportInfo() << "Iteration:" << iteration++ << reportEnd();
-		int maxDistance = 0;
-		int maxIndex = -1;
-		std::vector<bool> isInL(totalSize, true);
-		std::unordered_set<int> Sc;
-		for(int i = 0; i < totalSize; ++i) {
-			if(inputArray[i] == 1 && !processedVoxels[i]) {
-				// Inside object
-				isInL[i] = false;
-
-				// Get max distance
-				if(candidateArray[i] == 1) {
-					short distance = distanceArray[i];
-					if(distance > maxDistance) {
-						maxDistance = distance;
-						maxIndex = i;
-					}
-					Sc.insert(i);
-				}
-			}
-		}
-		if(maxIndex < 0) // Check if finished processing all segmentation parts
-			break;
-		if(maxDistance < 2)
-			break;
-		Vector3i maxPosition = position3D(maxIndex, size);
-		reportInfo() << "Max position found at " << maxPosition.transpose() << " with value " << maxDistance
-					 << reportEnd();
-
-		// Calculate speed term
-		double beta = 1.0 / (0.02 * maxDistance);
-		auto speed = std::make_unique<double[]>(totalSize);
-		std::vector<double> G(totalSize, std::numeric_limits<double>::infinity());
-		for(int i = 0; i < totalSize; ++i) {
-			speed[i] = exp(beta * distanceArray[i]);
-		}
-
-		G[linearPosition(maxPosition, size)] = 0;
-		Vector3i neigbhors[6] = {
-				{1,  0,  0},
-				{-1, 0,  0},
-				{0,  1,  0},
-				{0,  -1, 0},
-				{0,  0,  1},
-				{0,  0,  -1}
-		};
-		processedVoxels[maxIndex] = true; // Mark this voxel as processed
-		std::vector<Vector3i> L;
-		for(int i = 0; i < 6; ++i) {
-			Vector3i nPos = maxPosition + neigbhors[i];
-			L.push_back(nPos);
-			isInL[linearPosition(nPos, size)] = true;
-		}
+	const Vector3i neighbors6[6] = {
+			{1,  0,  0},
+			{-1, 0,  0},
+			{0,  1,  0},
+			{0,  -1, 0},
+			{0,  0,  1},
+			{0,  0,  -1}
+	};
 
-		// Do fast marching
-		const double threshold = 0;
-		while(L.size() > 0) {
-			std::vector<Vector3i> L2;
-			for(Vector3i x : L) {
-				processedVoxels[linearPosition(x, size)] = true; // Mark this voxel as processed
-				double p = G[linearPosition(x, size)];
-				double q = solveQuadratic(G, speed, x, size);
-				G[linearPosition(x, size)] = q;
-				if(fabs(p - q) <= threshold) {
-					for(int i = 0; i < 6; ++i) {
-						Vector3i xn = x + neigbhors[i];
-						if(!isInL[linearPosition(xn, size)]) {
-							double p = G[linearPosition(xn, size)];
-							double q = solveQuadratic(G, speed, xn, size);
-							if(p > q) {
-								G[linearPosition(x, size)] = q;
-								L2.push_back(xn);
-								isInL[linearPosition(xn, size)] = true;
-							}
-						}
-					}// For all neighbors
-				} else {
-					L2.push_back(x);
-				} // fabs(p-q)
-			} // for all x in L
-			L = L2;
-		} // while L.size() > 0
-		reportInfo() << "Finished fast marching" << reportEnd();
-
-		std::vector<Vector3i> neighbors2;
-		for(int a = -1; a <= 1; ++a) {
-			for(int b = -1; b <= 1; ++b) {
-				for(int c = -1; c <= 1; ++c) {
-					if(a == 0 && b == 0 && c == 0)
-						continue;
-					neighbors2.push_back(Vector3i(a, b, c));
+	// Find the connected parts of the segmentation. The seed of each part is the candidate centerpoint with the
+	// largest distance.
+	// Labels are only initialized for voxels in the segmentation, to avoid touching memory of the background
+	std::unique_ptr<int[]> labels(new int[totalSize]);
+	for(int i = 0; i < totalSize; ++i) {
+		if(inputArray[i] == 1)
+			labels[i] = -1;
+	}
+	std::vector<CenterlinePart> parts;
+	std::vector<int> queue;
+	for(int i = 0; i < totalSize; ++i) {
+		if(inputArray[i] != 1 || labels[i] >= 0)
+			continue;
+		const int label = parts.size();
+		CenterlinePart part;
+		queue.clear();
+		queue.push_back(i);
+		labels[i] = label;
+		for(std::size_t j = 0; j < queue.size(); ++j) {
+			const int current = queue[j];
+			if(candidateArray[current] == 1) {
+				part.candidates.push_back(current);
+				const short distance = distanceArray[current];
+				if(distance > part.maxDistance || (distance == part.maxDistance && part.seed >= 0 && current < part.seed)) {
+					part.maxDistance = distance;
+					part.seed = current;
 				}
 			}
-		}
-
-		std::unordered_set<int> refinedCenterline;
-		std::unordered_set<int> processed;
-		// Do backtrace
-		while(Sc.size() > 0) {
-			// Find candidate centerline point with highest G
-			double maxG = 0.0;
-			int maxLinearPosition = -1;
-			for(int linearPosition : Sc) {
-				if(G[linearPosition] > maxG && !std::isinf(G[linearPosition])) {
-					maxG = G[linearPosition];
-					maxLinearPosition = linearPosition;
+			const Vector3i position = position3D(current, size);
+			for(const Vector3i& neighbor : neighbors6) {
+				const Vector3i xn = position + neighbor;
+				if(!inBounds(xn, size))
+					continue;
+				const int neighborLinearPosition = linearPosition(xn, size);
+				if(inputArray[neighborLinearPosition] == 1 && labels[neighborLinearPosition] < 0) {
+					labels[neighborLinearPosition] = label;
+					queue.push_back(neighborLinearPosition);
 				}
 			}
+		}
+		parts.push_back(std::move(part));
+	}
 
-			// Convert maxPosition to 3D
-			Vector3i maxPosition = position3D(maxLinearPosition, size);
-			reportInfo() << "Max position found at " << maxPosition.transpose() << " with G: " << maxG << reportEnd();
-
-			if(maxLinearPosition == -1)
-				break;
-
-			std::vector<Vector3i> pointsToAdd;
-			Vector3i current = maxPosition;
-			Vector3i previous = Vector3i::Zero();
-			Vector3i previous2 = Vector3i::Zero();
-			while(true) {
-				std::unordered_set<int>::iterator it = Sc.find(linearPosition(current, size));
-				if(it != Sc.end()) {
-					Sc.erase(it);
-				}
-
-				// Find neighbor point with min G
-				double minG = std::numeric_limits<double>::infinity();
-				Vector3i bestPos;
-				Vector3i bestDPos;
-				double maxD = -1;
-				for(Vector3i n : neighbors2) {
-					Vector3i xn = current + n;
-					if(refinedCenterline.count(linearPosition(xn, size)) > 0) {
-						if(distanceArray[linearPosition(xn, size)] > maxD) {
-							maxD = distanceArray[linearPosition(xn, size)];
-							bestDPos = xn;
-						}
-					}
-					if(G[linearPosition(xn, size)] < minG) {
-						minG = G[linearPosition(xn, size)];
-						bestPos = xn;
-					}
-				}
-
-				if(maxD > -1) {
-					current = bestDPos;
-				} else {
-					current = bestPos;
-				}
-				pointsToAdd.push_back(current);
+	// Parts with largest distance first, and skip parts which are too thin
+	std::vector<int> order;
+	for(int label = 0; label < parts.size(); ++label) {
+		if(parts[label].seed >= 0 && parts[label].maxDistance >= 2)
+			order.push_back(label);
+	}
+	std::sort(order.begin(), order.end(), [&parts](int a, int b) {
+		if(parts[a].maxDistance != parts[b].maxDistance)
+			return parts[a].maxDistance > parts[b].maxDistance;
+		return parts[a].seed < parts[b].seed;
+	});
+	std::vector<double> beta(parts.size(), 0.0);
+	for(int label : order) {
+		reportInfo() << "Max position found at " << position3D(parts[label].seed, size).transpose() << " with value "
+					 << parts[label].maxDistance << reportEnd();
+		beta[label] = 1.0 / (0.02 * parts[label].maxDistance);
+	}
 
-				// A failsafe (why is this needed?)
-				if(previous2 == current) {
-					break;
-				}
-				previous2 = previous;
-				previous = current;
+	// Do fast marching through the selected parts, with speed term
+	FastMarching marching(size);
+	for(int i = 0; i < totalSize; ++i) {
+		if(inputArray[i] == 1 && beta[labels[i]] > 0)
+			marching.addToDomain(i, exp(beta[labels[i]] * distanceArray[i]));
+	}
 
-				// Stop conditions
-				if(minG == 0) {
-					break;
-				}
-				if(refinedCenterline.count(linearPosition(current, size)) > 0) {
-					// Bifurcation
-					break;
-				}
-			}
+	// Each part only touches the state of its own voxels, thus they can be processed in parallel
+	std::vector<uchar> flags(totalSize, 0);
+	std::vector<std::vector<MeshVertex>> partVertices(order.size());
+	std::vector<std::vector<MeshLine>> partLines(order.size());
+	#pragma omp parallel for schedule(dynamic) if(m_parallelSeeds)
+	for(int i = 0; i < (int)order.size(); ++i) {
+		const int label = order[i];
+		marching.run(parts[label].seed);
+		CenterlinePartVoxels voxels(label, labels.get(), inputArray, marching, size);
+		extractCenterline(parts[label], voxels, distanceArray, flags, size, spacing, partVertices[i], partLines[i]);
+	}
+	reportInfo() << "Finished fast marching and backtracing of " << order.size() << " parts" << reportEnd();
 
-			if(pointsToAdd.size() > 10) { // minimum length
-				growFromPointsAdded(pointsToAdd, G, Sc, processed, size);
-				int counter = vertices.size();
-				vertices.push_back(MeshVertex(pointsToAdd[0].cast<float>().cwiseProduct(spacing)));
-				refinedCenterline.insert(linearPosition(pointsToAdd[0], size));
-				for(int i = 1; i < pointsToAdd.size(); ++i) {
-					refinedCenterline.insert(linearPosition(pointsToAdd[i], size));
-					vertices.push_back(MeshVertex(pointsToAdd[i].cast<float>().cwiseProduct(spacing)));
-					lines.push_back(MeshLine(counter, counter + 1));
-					counter += 1;
-				}
-			}
-		}
+	std::vector<MeshVertex> vertices;
+	std::vector<MeshLine> lines;
+	for(int i = 0; i < (int)order.size(); ++i) {
+		const int offset = vertices.size();
+		vertices.insert(vertices.end(), partVertices[i].begin(), partVertices[i].end());
+		for(MeshLine line : partLines[i])
+			lines.push_back(MeshLine(line.getEndpoint1() + offset, line.getEndpoint2() + offset));
 	}
 
 	Mesh::pointer output = getOutputData<Mesh>();
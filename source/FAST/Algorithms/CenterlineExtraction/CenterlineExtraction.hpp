@@ -10,10 +10,19 @@ class Image;
 class FAST_EXPORT  CenterlineExtraction : public ProcessObject {
 	FAST_OBJECT(CenterlineExtraction)
     public:
+		/**
+		 * Extract the centerline of each connected part of the segmentation in parallel. The result is the same
+		 * as when processing them one at a time. Default is false.
+		 * @param parallel
+		 */
+		void setParallelSeeds(bool parallel);
+		void loadAttributes() override;
     private:
 		CenterlineExtraction();
 		void execute();
         SharedPointer<Image> calculateDistanceTransform(SharedPointer<Image> input);
+
+		bool m_parallelSeeds = false;
 };
 
 }
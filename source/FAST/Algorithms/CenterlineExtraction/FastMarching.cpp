@@ -0,0 +1,163 @@
+#include "FastMarching.hpp"
+#include "FAST/Exception.hpp"
+#include <limits>
+#include <cmath>
+
+namespace fast {
+
+enum FastMarchingStatus : uchar {
+    OUTSIDE = 0,
+    FAR,
+    TRIAL,
+    KNOWN
+};
+
+FastMarching::FastMarching(Vector3i size) {
+    m_size = size;
+    const std::size_t totalSize = (std::size_t)size.x()*size.y()*size.z();
+    m_status.resize(totalSize, OUTSIDE);
+    // Left uninitialized, so that memory is only touched for voxels in the domain
+    m_speed = std::unique_ptr<double[]>(new double[totalSize]);
+    m_arrivalTime = std::unique_ptr<double[]>(new double[totalSize]);
+    m_heapIndex = std::unique_ptr<int[]>(new int[totalSize]);
+}
+
+void FastMarching::addToDomain(int linearPosition, double speed) {
+    if(speed <= 0)
+        throw Exception("Speed must be larger than zero in FastMarching");
+    m_status[linearPosition] = FAR;
+    m_speed[linearPosition] = speed;
+}
+
+double FastMarching::getArrivalTime(int linearPosition) const {
+    if(m_status[linearPosition] != KNOWN && m_status[linearPosition] != TRIAL)
+        return std::numeric_limits<double>::infinity();
+    return m_arrivalTime[linearPosition];
+}
+
+double FastMarching::solveQuadratic(int linearPosition, Vector3i position) const {
+    // Smallest known arrival time of the two neighbors along each axis
+    const int strides[3] = {1, m_size.x(), m_size.x()*m_size.y()};
+    double values[3];
+    for(int axis = 0; axis < 3; ++axis) {
+        double value = std::numeric_limits<double>::infinity();
+        if(position[axis] > 0 && m_status[linearPosition - strides[axis]] == KNOWN)
+            value = m_arrivalTime[linearPosition - strides[axis]];
+        if(position[axis] < m_size[axis] - 1 && m_status[linearPosition + strides[axis]] == KNOWN)
+            value = std::min(value, m_arrivalTime[linearPosition + strides[axis]]);
+        values[axis] = value;
+    }
+
+    // Sort so that c <= b <= a
+    double a = values[0];
+    double b = values[1];
+    double c = values[2];
+    if(a < b)
+        std::swap(a, b);
+    if(b < c)
+        std::swap(b, c);
+    if(a < b)
+        std::swap(a, b);
+
+    const double f = m_speed[linearPosition];
+
+    double u = c + 1.0 / f;
+    if(u <= b)
+        return u;
+
+    double sqrted = -b*b - c*c + 2.0*b*c + (2.0/(f*f));
+    sqrted = sqrted < 0 ? 0 : std::sqrt(sqrted);
+    u = (b + c + sqrted)/2.0;
+    if(u <= a)
+        return u;
+
+    sqrted = 4.0*(a + b + c)*(a + b + c) - 12.0*(a*a + b*b + c*c - 1/(f*f));
+    sqrted = sqrted < 0 ? 0 : std::sqrt(sqrted);
+    return (2.0*(a + b + c) + sqrted)/6.0;
+}
+
+void FastMarching::siftUp(std::vector<HeapEntry>& heap, int index) {
+    const HeapEntry entry = heap[index];
+    while(index > 0) {
+        const int parent = (index - 1) / 2;
+        if(heap[parent].time <= entry.time)
+            break;
+        heap[index] = heap[parent];
+        m_heapIndex[heap[index].voxel] = index;
+        index = parent;
+    }
+    heap[index] = entry;
+    m_heapIndex[entry.voxel] = index;
+}
+
+void FastMarching::siftDown(std::vector<HeapEntry>& heap, int index) {
+    const int size = heap.size();
+    const HeapEntry entry = heap[index];
+    while(true) {
+        int child = 2*index + 1;
+        if(child >= size)
+            break;
+        if(child + 1 < size && heap[child + 1].time < heap[child].time)
+            ++child;
+        if(entry.time <= heap[child].time)
+            break;
+        heap[index] = heap[child];
+        m_heapIndex[heap[index].voxel] = index;
+        index = child;
+    }
+    heap[index] = entry;
+    m_heapIndex[entry.voxel] = index;
+}
+
+void FastMarching::run(int seed) {
+    if(m_status[seed] != FAR)
+        throw Exception("Seed given to FastMarching must be in the domain and not reached before");
+
+    const int width = m_size.x();
+    const int height = m_size.y();
+    const int strides[3] = {1, width, width*height};
+
+    std::vector<HeapEntry> heap;
+    m_arrivalTime[seed] = 0;
+    m_status[seed] = TRIAL;
+    heap.push_back({0, seed});
+    m_heapIndex[seed] = 0;
+
+    while(!heap.empty()) {
+        // Accept the trial voxel with smallest arrival time
+        const int current = heap[0].voxel;
+        heap[0] = heap.back();
+        heap.pop_back();
+        if(!heap.empty())
+            siftDown(heap, 0);
+        m_status[current] = KNOWN;
+
+        // Update its neighbors
+        const Vector3i position(current % width, (current / width) % height, current / (width*height));
+        for(int axis = 0; axis < 3; ++axis) {
+            for(int direction = -1; direction <= 1; direction += 2) {
+                Vector3i neighborPosition = position;
+                neighborPosition[axis] += direction;
+                if(neighborPosition[axis] < 0 || neighborPosition[axis] >= m_size[axis])
+                    continue;
+                const int neighbor = current + direction*strides[axis];
+                const uchar status = m_status[neighbor];
+                if(status != FAR && status != TRIAL)
+                    continue;
+                const double time = solveQuadratic(neighbor, neighborPosition);
+                if(status == FAR) {
+                    m_arrivalTime[neighbor] = time;
+                    m_status[neighbor] = TRIAL;
+                    heap.push_back({time, neighbor});
+                    siftUp(heap, heap.size() - 1);
+                } else if(time < m_arrivalTime[neighbor]) {
+                    m_arrivalTime[neighbor] = time;
+                    heap[m_heapIndex[neighbor]].time = time;
+                    siftUp(heap, m_heapIndex[neighbor]);
+                }
+            }
+        }
+    }
+}
+
+}
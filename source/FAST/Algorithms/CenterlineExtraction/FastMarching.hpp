@@ -0,0 +1,56 @@
+#pragma once
+
+#include "FAST/Data/DataTypes.hpp"
+
+namespace fast {
+
+/**
+ * Fast marching solver of the eikonal equation |grad T| = 1/speed on a 3D grid with 6-connectivity.
+ *
+ * The front only moves through voxels added to the domain. All state is kept in flat arrays covering the entire
+ * volume, and trial voxels are kept in an indexed binary heap, thus nothing is allocated per voxel. Only the status
+ * array is initialized, so memory is only touched for voxels in the domain. Since the state of each voxel is only
+ * touched by the run which reaches it, runs from seeds in disjoint parts of the domain can be executed in parallel.
+ */
+class FAST_EXPORT FastMarching {
+    public:
+        /**
+         * @param size Size of volume
+         */
+        explicit FastMarching(Vector3i size);
+        /**
+         * Add a voxel to the domain the front can move through. Initially the domain is empty.
+         * @param linearPosition
+         * @param speed Speed of the front in this voxel, must be larger than 0
+         */
+        void addToDomain(int linearPosition, double speed);
+        /**
+         * March from a seed until all voxels in the domain which are connected to it have been reached.
+         * @param seed
+         */
+        void run(int seed);
+        /**
+         * @param linearPosition
+         * @return arrival time of the front, or infinity if the voxel hasn't been reached
+         */
+        double getArrivalTime(int linearPosition) const;
+    private:
+        struct HeapEntry {
+            double time;
+            int voxel;
+        };
+        double solveQuadratic(int linearPosition, Vector3i position) const;
+        void siftUp(std::vector<HeapEntry>& heap, int index);
+        void siftDown(std::vector<HeapEntry>& heap, int index);
+
+        Vector3i m_size;
+        std::vector<uchar> m_status;
+        // Only valid for voxels in the domain
+        std::unique_ptr<double[]> m_speed;
+        // Only valid for trial and known voxels
+        std::unique_ptr<double[]> m_arrivalTime;
+        // Position of each trial voxel in the heap
+        std::unique_ptr<int[]> m_heapIndex;
+};
+
+}
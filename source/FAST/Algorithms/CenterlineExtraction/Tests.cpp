@@ -1,5 +1,9 @@
 #include <FAST/Testing.hpp>
 #include "CenterlineExtraction.hpp"
+#include "FastMarching.hpp"
+#include <FAST/Algorithms/AirwaySegmentation/AirwaySegmentation.hpp>
+#include <FAST/Data/Image.hpp>
+#include <FAST/Data/Mesh.hpp>
 #include <FAST/Importers/ImageFileImporter.hpp>
 #include <FAST/Visualization/SimpleWindow.hpp>
 #include <FAST/Visualization/LineRenderer/LineRenderer.hpp>
@@ -30,3 +34,137 @@ TEST_CASE("Centerline extraction 2D", "[fast][CenterlineExtraction][2D]") {
     centerline->getRuntime()->print();
 }
  */
+
+TEST_CASE("Fast marching with constant speed", "[fast][FastMarching]") {
+    const Vector3i size(21, 21, 21);
+    FastMarching marching(size);
+    // Domain is the entire volume, except one plane which blocks the front
+    for(int z = 0; z < size.z(); ++z) {
+        for(int y = 0; y < size.y(); ++y) {
+            for(int x = 0; x < size.x(); ++x) {
+                if(x != 15)
+                    marching.addToDomain(x + y*size.x() + z*size.x()*size.y(), 2.0);
+            }
+        }
+    }
+    auto position = [&size](int x, int y, int z) {
+        return x + y*size.x() + z*size.x()*size.y();
+    };
+    auto countReached = [&marching, &size]() {
+        int reached = 0;
+        for(int i = 0; i < size.x()*size.y()*size.z(); ++i) {
+            if(!std::isinf(marching.getArrivalTime(i)))
+                ++reached;
+        }
+        return reached;
+    };
+    marching.run(position(10, 10, 10));
+    CHECK(countReached() == 15*21*21);
+    CHECK(marching.getArrivalTime(position(10, 10, 10)) == 0);
+    // Exact along the axes
+    CHECK(marching.getArrivalTime(position(0, 10, 10)) == Approx(5.0));
+    CHECK(marching.getArrivalTime(position(10, 20, 10)) == Approx(5.0));
+    CHECK(marching.getArrivalTime(position(10, 10, 3)) == Approx(3.5));
+    // Overestimated slightly along the diagonal
+    const double diagonal = marching.getArrivalTime(position(5, 5, 5));
+    CHECK(diagonal >= std::sqrt(75.0)/2.0);
+    CHECK(diagonal <= 1.2*std::sqrt(75.0)/2.0);
+    // Increasing away from the seed
+    CHECK(marching.getArrivalTime(position(4, 4, 4)) > diagonal);
+    // Not reached
+    CHECK(std::isinf(marching.getArrivalTime(position(15, 10, 10))));
+    CHECK(std::isinf(marching.getArrivalTime(position(16, 10, 10))));
+
+    // The other side of the plane can be reached from another seed
+    marching.run(position(20, 10, 10));
+    CHECK(countReached() == 20*21*21);
+    CHECK(marching.getArrivalTime(position(16, 10, 10)) == Approx(2.0));
+    CHECK_THROWS(marching.run(position(20, 10, 10)));
+    CHECK_THROWS(marching.run(position(15, 10, 10)));
+}
+
+// Closed cylinder along the z axis
+static void addCylinder(std::vector<uchar>& data, Vector3i size, int centerX, int centerY, int radius, int startZ, int endZ) {
+    for(int z = startZ; z <= endZ; ++z) {
+        for(int y = 0; y < size.y(); ++y) {
+            for(int x = 0; x < size.x(); ++x) {
+                if((x - centerX)*(x - centerX) + (y - centerY)*(y - centerY) <= radius*radius)
+                    data[x + y*size.x() + z*size.x()*size.y()] = 1;
+            }
+        }
+    }
+}
+
+TEST_CASE("Centerline extraction of cylinders", "[fast][CenterlineExtraction]") {
+    const Vector3i size(48, 24, 64);
+    std::vector<uchar> data(size.x()*size.y()*size.z(), 0);
+    addCylinder(data, size, 12, 12, 6, 4, 59);
+    addCylinder(data, size, 36, 12, 5, 10, 53);
+    auto image = Image::New();
+    image->create(size.x(), size.y(), size.z(), TYPE_UINT8, 1, data.data());
+
+    std::vector<MeshVertex> sequentialVertices;
+    for(bool parallel : {false, true}) {
+        auto centerline = CenterlineExtraction::New();
+        centerline->setInputData(image);
+        centerline->setParallelSeeds(parallel);
+        auto mesh = centerline->updateAndGetOutputData<Mesh>();
+        auto access = mesh->getMeshAccess(ACCESS_READ);
+        auto vertices = access->getVertices();
+        REQUIRE(access->getLines().size() > 0);
+
+        // Each vertex is close to the axis of one of the cylinders, and the centerlines cover most of both cylinders
+        float minZ[2] = {(float)size.z(), (float)size.z()};
+        float maxZ[2] = {0, 0};
+        for(const MeshVertex& vertex : vertices) {
+            const Vector3f position = vertex.getPosition();
+            const int cylinder = position.x() < size.x()/2 ? 0 : 1;
+            CHECK(std::abs(position.x() - (cylinder == 0 ? 12 : 36)) <= 1.5f);
+            CHECK(std::abs(position.y() - 12) <= 1.5f);
+            minZ[cylinder] = std::min(minZ[cylinder], position.z());
+            maxZ[cylinder] = std::max(maxZ[cylinder], position.z());
+        }
+        CHECK(maxZ[0] - minZ[0] >= 0.6f*(59 - 4));
+        CHECK(maxZ[1] - minZ[1] >= 0.6f*(53 - 10));
+
+        if(parallel) {
+            REQUIRE(vertices.size() == sequentialVertices.size());
+            for(int i = 0; i < vertices.size(); ++i)
+                CHECK(vertices[i].getPosition() == sequentialVertices[i].getPosition());
+        } else {
+            sequentialVertices = vertices;
+        }
+    }
+}
+
+TEST_CASE("Centerline extraction of airways benchmark", "[fast][CenterlineExtraction][benchmark][.]") {
+    const std::string filename = Config::getTestDataPath() + "CT/CT-Thorax.mhd";
+    if(!fileExists(filename)) {
+        WARN("Skipping benchmark, test data " + filename + " is missing");
+        return;
+    }
+    auto importer = ImageFileImporter::New();
+    importer->setFilename(filename);
+
+    auto segmentation = AirwaySegmentation::New();
+    segmentation->setInputConnection(importer->getOutputPort());
+    segmentation->update();
+
+    std::size_t nrOfVertices = 0;
+    for(bool parallel : {false, true}) {
+        auto centerline = CenterlineExtraction::New();
+        centerline->setInputConnection(segmentation->getOutputPort());
+        centerline->setParallelSeeds(parallel);
+        centerline->enableRuntimeMeasurements();
+        auto mesh = centerline->updateAndGetOutputData<Mesh>();
+        auto access = mesh->getMeshAccess(ACCESS_READ);
+        CHECK(access->getLines().size() > 0);
+        if(parallel) {
+            CHECK(access->getVertices().size() == nrOfVertices);
+        } else {
+            nrOfVertices = access->getVertices().size();
+        }
+        std::cout << "Centerline extraction " << (parallel ? "with" : "without") << " parallel seeds:" << std::endl;
+        centerline->getRuntime()->print();
+    }
+}
@@ -1,6 +1,10 @@
 #include "ImageToBatchGenerator.hpp"
 #include <FAST/Data/Image.hpp>
+#include <FAST/Data/Tensor.hpp>
+#include <FAST/Streamers/Streamer.hpp>
 #include <FAST/Algorithms/NeuralNetwork/NeuralNetwork.hpp>
+#include <algorithm>
+#include <thread>
 
 namespace fast {
 
@@ -9,66 +13,247 @@ ImageToBatchGenerator::ImageToBatchGenerator() {
     createOutputPort<Batch>(0);
 
     m_maxBatchSize = -1;
+    createIntegerAttribute("max-batch-size", "Max batch size", "Maximum number of images in each batch", m_maxBatchSize);
+    createIntegerAttribute("max-latency", "Max latency", "Maximum time in milliseconds to wait for a batch to be filled", m_maxLatency);
+    createBooleanAttribute("tensor-output", "Tensor output", "Convert the images of each batch to a tensor", m_tensorOutput);
+    createFloatAttribute("scale-factor", "Scale factor", "Factor image intensities are multiplied with when converted to a tensor", m_scaleFactor);
 }
 
-void ImageToBatchGenerator::generateStream() {
-    std::vector<Image::pointer> imageList;
-    imageList.reserve(m_maxBatchSize);
-    int i = 0;
-    bool lastFrame = false;
-    // Update will eventually block, therefore we need to call this in a separate thread
-    auto po = mParent->getProcessObject();
-    bool firstTime = true;
-    while(!lastFrame) {
-        {
-            std::unique_lock<std::mutex> lock(m_stopMutex);
-            if(m_stop) {
-                m_streamIsStarted = false;
-                m_firstFrameIsInserted = false;
+void ImageToBatchGenerator::loadAttributes() {
+    // Max batch size has no default, execute throws if it is not given
+    const int maxBatchSize = getIntegerAttribute("max-batch-size");
+    if(maxBatchSize > 0)
+        setMaxBatchSize(maxBatchSize);
+    setMaxLatency(getIntegerAttribute("max-latency"));
+    setTensorOutput(getBooleanAttribute("tensor-output"));
+    setScaleFactor(getFloatAttribute("scale-factor"));
+}
+
+uint ImageToBatchGenerator::addInputConnection(DataChannel::pointer port) {
+    uint nr = getNrOfInputConnections();
+    if(nr > 0)
+        createInputPort<Image>(nr);
+    setInputConnection(nr, port);
+    return nr;
+}
+
+Image::pointer ImageToBatchGenerator::getNextImage(uint portID, std::chrono::microseconds timeout) {
+    auto port = mInputConnections.at(portID);
+    DataObject::pointer data;
+    if(timeout.count() < 0) {
+        data = port->getNextFrame();
+    } else {
+        data = port->getNextFrame(timeout);
+        if(!data)
+            return nullptr;
+    }
+    auto image = std::dynamic_pointer_cast<Image>(data);
+    if(!image)
+        throw BadCastException(data->getNameOfClass(), Image::getStaticNameOfClass());
+
+    // Same bookkeeping as getInputData, since several images are taken from each port in one execute.
+    // Last frame is only passed on when all streams have ended, see execute.
+    mLastProcessed[portID] = std::make_pair(data, data->getTimestamp());
+    for(auto&& lastFrame : data->getLastFrame())
+        m_endedStreams.insert(lastFrame);
+    for(auto&& frameData : data->getFrameData())
+        m_frameData[frameData.first] = frameData.second;
+
+    return image;
+}
+
+static bool hasStreamerUpstream(ProcessObject::pointer po) {
+    if(dynamic_cast<Streamer*>(po.get()) != nullptr)
+        return true;
+    for(int i = 0; i < po->getNrOfInputConnections(); ++i) {
+        if(hasStreamerUpstream(po->getInputPort(i)->getProcessObject()))
+            return true;
+    }
+    return false;
+}
+
+bool ImageToBatchGenerator::isStreaming(uint portID) {
+    return hasStreamerUpstream(mInputConnections.at(portID)->getProcessObject());
+}
+
+bool ImageToBatchGenerator::hasUnprocessedImage(uint portID) {
+    auto port = mInputConnections.at(portID);
+    if(!port->hasCurrentData())
+        return false;
+    if(mLastProcessed.count(portID) == 0)
+        return true;
+    // Static and newest frame channels keep the last frame after it has been retrieved
+    auto data = port->getFrame();
+    return data != mLastProcessed[portID].first || data->getTimestamp() > mLastProcessed[portID].second;
+}
+
+bool ImageToBatchGenerator::waitForUnprocessedImage(uint portID, std::chrono::microseconds timeout) {
+    const auto start = std::chrono::steady_clock::now();
+    while(!hasUnprocessedImage(portID)) {
+        if(timeout.count() >= 0 && std::chrono::steady_clock::now() - start >= timeout)
+            return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+void ImageToBatchGenerator::execute() {
+    if(m_maxBatchSize == -1)
+        throw Exception("Max batch size must be given to the ImageToBatchGenerator");
+
+    // Ports which may give more images. Ports which are not fed by a streamer only give one image per execute.
+    std::vector<uint> ports;
+    for(auto&& connection : mInputConnections) {
+        if(m_endedPorts.count(connection.first) == 0)
+            ports.push_back(connection.first);
+    }
+    if(ports.empty())
+        throw Exception("All input streams of the ImageToBatchGenerator have ended");
+    std::sort(ports.begin(), ports.end());
+    std::set<uint> streamingPorts;
+    for(auto&& portID : ports) {
+        if(isStreaming(portID))
+            streamingPorts.insert(portID);
+    }
+
+    // With several ports, wait for each port in short slices, so that a slow stream doesn't block the others
+    const auto slice = std::chrono::microseconds(1000);
+    const auto latency = std::chrono::milliseconds(m_maxLatency);
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<Image::pointer> images;
+    images.reserve(m_maxBatchSize);
+    while(images.size() < m_maxBatchSize && !ports.empty()) {
+        m_nextPort = m_nextPort % ports.size();
+        const uint portID = ports[m_nextPort];
+        auto timeout = ports.size() == 1 ? std::chrono::microseconds(-1) : slice;
+        if(!images.empty() && m_maxLatency >= 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+            if(remaining.count() <= 0)
                 break;
+            if(timeout.count() < 0 || remaining < timeout)
+                timeout = remaining;
+        }
+
+        // A parent which is not a streamer, but is fed by one, only produces the next image when it executes
+        if(streamingPorts.count(portID) > 0 && dynamic_cast<Streamer*>(mInputConnections[portID]->getProcessObject().get()) == nullptr) {
+            if(!m_executedByPipelineExecutor) {
+                // Execute the parent on this thread, which blocks until the streamer upstream gives the next frame
+                if(!hasUnprocessedImage(portID))
+                    mInputConnections[portID]->getProcessObject()->update();
+                if(!hasUnprocessedImage(portID)) {
+                    // The parent had nothing more to produce
+                    ports.erase(ports.begin() + m_nextPort);
+                    continue;
+                }
+            } else if(!waitForUnprocessedImage(portID, timeout)) {
+                // The parent is executed by another worker of the executor
+                m_nextPort++;
+                continue;
             }
         }
-        if(!firstTime) // parent is execute the first time, thus drop it here
-            po->update(); // Make sure execute is called on previous
-        firstTime = false;
-        Image::pointer image;
-        try {
-            image = mParent->getNextFrame<Image>();
-        } catch(ThreadStopped &e) {
-            break;
+
+        auto image = getNextImage(portID, timeout);
+        if(!image) {
+            m_nextPort++;
+            continue;
         }
-        lastFrame = image->isLastFrame();
-        imageList.push_back(image);
-        if(imageList.size() == m_maxBatchSize || lastFrame) {
-            auto batch = Batch::New();
-            batch->create(imageList);
-            if(lastFrame)
-                batch->setLastFrame(getNameOfClass());
-            try {
-                addOutputData(0, batch);
-            } catch(ThreadStopped &e) {
-                break;
-            }
-            frameAdded();
-            imageList.clear();
-            i++;
+        if(images.empty())
+            deadline = std::chrono::steady_clock::now() + latency;
+        images.push_back(image);
+
+        if(image->isLastFrame())
+            m_endedPorts.insert(portID);
+        if(image->isLastFrame() || streamingPorts.count(portID) == 0) {
+            ports.erase(ports.begin() + m_nextPort);
+        } else {
+            m_nextPort++;
         }
     }
-    //updateThread.join();
+
+    // The batch is only the last frame when every stream has ended, otherwise the streams still running would
+    // be stopped by the processing after this
+    bool lastFrame = !m_endedPorts.empty();
+    for(auto&& connection : mInputConnections) {
+        if(m_endedPorts.count(connection.first) == 0 && isStreaming(connection.first))
+            lastFrame = false;
+    }
+    if(lastFrame)
+        m_lastFrame.insert(m_endedStreams.begin(), m_endedStreams.end());
+
+    auto batch = Batch::New();
+    if(m_tensorOutput) {
+        batch->create(images, convertToTensor(images));
+    } else {
+        batch->create(images);
+    }
+    if(lastFrame)
+        batch->setLastFrame(getNameOfClass());
+    addOutputData(0, batch);
 }
 
-void ImageToBatchGenerator::execute() {
-    if(m_maxBatchSize == 1)
-        throw Exception("Max batch size must be given to the ImageToBatchGenerator");
+template <class T>
+static void writeImageToTensor(const T* input, float* output, int voxels, int channels, float scaleFactor, bool channelFirst) {
+    if(channelFirst) {
+        for(int c = 0; c < channels; ++c) {
+            for(int i = 0; i < voxels; ++i)
+                output[c*voxels + i] = (float)input[i*channels + c]*scaleFactor;
+        }
+    } else {
+        for(int i = 0; i < voxels*channels; ++i)
+            output[i] = (float)input[i]*scaleFactor;
+    }
+}
+
+Tensor::pointer ImageToBatchGenerator::convertToTensor(const std::vector<Image::pointer>& images) {
+    auto first = images.front();
+    const int channels = first->getNrOfChannels();
+    const bool channelFirst = m_imageOrdering == ImageOrdering::ChannelFirst;
+    std::vector<int> dimensions = {(int)images.size()};
+    if(channelFirst)
+        dimensions.push_back(channels);
+    if(first->getDimensions() == 3)
+        dimensions.push_back(first->getDepth());
+    dimensions.push_back(first->getHeight());
+    dimensions.push_back(first->getWidth());
+    if(!channelFirst)
+        dimensions.push_back(channels);
+    const TensorShape shape(dimensions);
+
+    for(auto&& image : images) {
+        if(image->getSize() != first->getSize() || image->getNrOfChannels() != channels)
+            throw Exception("All images given to the ImageToBatchGenerator must have the same size and nr of channels when converting to a tensor");
+    }
+
+    // Reuse a tensor if no batch is using it anymore
+    Tensor::pointer tensor;
+    const std::string key = shape.toString();
+    for(auto&& previous : m_tensors) {
+        if(previous.use_count() == 1 && previous->getShape().toString() == key) {
+            tensor = previous;
+            break;
+        }
+    }
+    if(!tensor) {
+        tensor = Tensor::New();
+        tensor->create(make_uninitialized_unique<float[]>(shape.getTotalSize()), shape);
+        m_tensors.push_back(tensor);
+        reportInfo() << "Created tensor nr " << m_tensors.size() << " for batches of shape " << key << reportEnd();
+    }
 
-    if(!m_streamIsStarted) {
-        m_streamIsStarted = true;
-        mParent = mInputConnections[0];
-        mInputConnections.clear(); // Severe the connection
-        m_thread = std::make_unique<std::thread>(std::bind(&ImageToBatchGenerator::generateStream, this));
+    auto access = tensor->getAccess(ACCESS_READ_WRITE);
+    float* output = access->getRawData();
+    const int voxels = first->getNrOfVoxels();
+    const std::size_t size = (std::size_t)voxels*channels; // nr of elements per image
+    #pragma omp parallel for
+    for(int i = 0; i < (int)images.size(); ++i) {
+        auto imageAccess = images[i]->getImageAccess(ACCESS_READ);
+        void* input = imageAccess->get();
+        switch(images[i]->getDataType()) {
+            fastSwitchTypeMacro(writeImageToTensor<FAST_TYPE>((FAST_TYPE*)input, &output[i*size], voxels, channels, m_scaleFactor, channelFirst));
+        }
     }
 
-    waitForFirstFrame();
+    return tensor;
 }
 
 void ImageToBatchGenerator::setMaxBatchSize(int size) {
@@ -78,8 +263,24 @@ void ImageToBatchGenerator::setMaxBatchSize(int size) {
     mIsModified = true;
 }
 
-ImageToBatchGenerator::~ImageToBatchGenerator() {
-    stop();
+void ImageToBatchGenerator::setMaxLatency(int milliseconds) {
+    m_maxLatency = milliseconds < 0 ? -1 : milliseconds;
+    mIsModified = true;
+}
+
+void ImageToBatchGenerator::setTensorOutput(bool tensorOutput) {
+    m_tensorOutput = tensorOutput;
+    mIsModified = true;
 }
 
-}
\ No newline at end of file
+void ImageToBatchGenerator::setScaleFactor(float scaleFactor) {
+    m_scaleFactor = scaleFactor;
+    mIsModified = true;
+}
+
+void ImageToBatchGenerator::setImageOrdering(ImageOrdering ordering) {
+    m_imageOrdering = ordering;
+    mIsModified = true;
+}
+
+}
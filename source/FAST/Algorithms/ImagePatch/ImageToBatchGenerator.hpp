@@ -1,25 +1,101 @@
 #pragma once
 
-#include <FAST/Streamers/Streamer.hpp>
-#include <thread>
+#include <FAST/ProcessObject.hpp>
+#include <FAST/Algorithms/NeuralNetwork/InferenceEngine.hpp>
+#include <chrono>
+#include <set>
 
 namespace fast {
 
 class Image;
+class Tensor;
 
-class FAST_EXPORT ImageToBatchGenerator : public Streamer {
+/**
+ * Collects images from one or more streams into batches.
+ *
+ * A batch is sent as soon as it has max batch size images, when the max latency has passed since its first image
+ * arrived, or when all streams have sent their last frame. Thus a stream which is slower than the batch size allows
+ * still gets a steady output rate. Images are pulled directly from the input data channels when execute is called,
+ * without any extra threads. A parent which is not a streamer itself, such as a filter between a streamer and this
+ * object, is updated for every image until the batch is full. With several input connections, such as several ultrasound probes, images are taken
+ * from the streams in turn. A stream which ends early doesn't stop the others, since only the batch with the last
+ * image of the last stream to end is marked as last frame.
+ *
+ * The images are kept in the batch, thus the frame data and last frame flags of each image are preserved.
+ * With tensor output enabled, the images are also written directly into a preallocated tensor with the batch as
+ * first dimension, which NeuralNetwork gives to the inference engine as it is.
+ */
+class FAST_EXPORT ImageToBatchGenerator : public ProcessObject {
     FAST_OBJECT(ImageToBatchGenerator)
     public:
+        /**
+         * Set maximum number of images in each batch. Must be given.
+         * @param size
+         */
         void setMaxBatchSize(int size);
-        ~ImageToBatchGenerator() override;
+        /**
+         * Set maximum time to wait for a batch to be filled, measured from when its first image arrived.
+         * Default is -1, which means waiting until the batch is full or the stream has ended.
+         * @param milliseconds
+         */
+        void setMaxLatency(int milliseconds);
+        /**
+         * Convert the images of each batch to a tensor with the batch as first dimension. Default is false.
+         * @param tensorOutput
+         */
+        void setTensorOutput(bool tensorOutput);
+        /**
+         * Factor image intensities are multiplied with when converted to a tensor. Default is 1.
+         * @param scaleFactor
+         */
+        void setScaleFactor(float scaleFactor);
+        /**
+         * Channel ordering of the tensor. Should match the inference engine. Default is channel last.
+         * @param ordering
+         */
+        void setImageOrdering(ImageOrdering ordering);
+        /**
+         * Add a stream of images to batch. Images are taken from each stream in turn.
+         * @param port
+         * @return port id
+         */
+        uint addInputConnection(DataChannel::pointer port);
+        void loadAttributes() override;
     protected:
         void execute() override;
-        void generateStream() override;
         int m_maxBatchSize;
-
-        DataChannel::pointer mParent;
+        int m_maxLatency = -1;
+        bool m_tensorOutput = false;
+        float m_scaleFactor = 1.0f;
+        ImageOrdering m_imageOrdering = ImageOrdering::ChannelLast;
     private:
         ImageToBatchGenerator();
+        SharedPointer<Image> getNextImage(uint portID, std::chrono::microseconds timeout);
+        /**
+         * @return true if the given port is fed by a streamer, directly or through other process objects,
+         *      thus it may give more images
+         */
+        bool isStreaming(uint portID);
+        /**
+         * @return true if the given port has an image which has not been taken yet
+         */
+        bool hasUnprocessedImage(uint portID);
+        /**
+         * Wait until the given port has an image which has not been taken yet.
+         * @param timeout negative value means no timeout
+         * @return false if the timeout passed first
+         */
+        bool waitForUnprocessedImage(uint portID, std::chrono::microseconds timeout);
+        SharedPointer<Tensor> convertToTensor(const std::vector<SharedPointer<Image>>& images);
+
+        // Port to take the next image from
+        uint m_nextPort = 0;
+        // Ports which have sent their last frame
+        std::set<uint> m_endedPorts;
+        // Last frame names of the ended ports, which are passed on when all streams have ended
+        std::unordered_set<std::string> m_endedStreams;
+        // Tensors previously created, which can be reused when the batch using them is gone
+        std::vector<SharedPointer<Tensor>> m_tensors;
 };
 
-}
\ No newline at end of file
+}
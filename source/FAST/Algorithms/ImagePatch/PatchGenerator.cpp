@@ -1,9 +1,19 @@
 #include <FAST/Data/ImagePyramid.hpp>
 #include <FAST/Data/Image.hpp>
 #include "PatchGenerator.hpp"
+#include <atomic>
 
 namespace fast {
 
+/**
+ * Unique id of each input the patches are made from, so that PatchStitcher knows when patches of a new input start.
+ * A counter is used instead of the address of the input, as the address may be reused by the next input.
+ */
+static std::string createOriginalID() {
+    static std::atomic<uint64_t> counter(0);
+    return std::to_string(++counter);
+}
+
 PatchGenerator::PatchGenerator() {
     createInputPort<SpatialDataObject>(0); // Either ImagePyramid or Image/Volume
     createInputPort<Image>(1, false); // Optional mask
@@ -17,10 +27,14 @@ PatchGenerator::PatchGenerator() {
     m_streamIsStarted = false;
     m_firstFrameIsInserted = false;
     m_level = 0;
+    m_stalls = 0;
     mIsModified = true;
 
     createIntegerAttribute("patch-size", "Patch size", "", 0);
     createIntegerAttribute("patch-level", "Patch level", "Patch level used for image pyramid inputs", m_level);
+    createIntegerAttribute("patch-overlap", "Patch overlap", "Number of pixels neighbouring patches overlap", m_overlap);
+    createIntegerAttribute("reader-threads", "Reader threads", "Number of threads reading image pyramid patches", m_readerThreadCount);
+    createIntegerAttribute("prefetch", "Prefetched patches", "Maximum number of patches read ahead of the output", m_maxPrefetchedPatches);
 }
 
 void PatchGenerator::loadAttributes() {
@@ -34,56 +48,138 @@ void PatchGenerator::loadAttributes() {
     }
 
     setPatchLevel(getIntegerAttribute("patch-level"));
+    setOverlap(getIntegerAttribute("patch-overlap"));
+    setNumberOfReaderThreads(getIntegerAttribute("reader-threads"));
+    setMaximumNumberOfPrefetchedPatches(getIntegerAttribute("prefetch"));
 }
 
 PatchGenerator::~PatchGenerator() {
     stop();
 }
 
-void PatchGenerator::generateStream() {
-    Image::pointer previousPatch;
+void PatchGenerator::startReaderThreads() {
+    m_stopReaders = false;
+    for(int i = 0; i < m_readerThreadCount; ++i)
+        m_readerThreads.push_back(std::thread(std::bind(&PatchGenerator::readerLoop, this)));
+}
 
-    if(m_inputImagePyramid) {
-        const int levelWidth = m_inputImagePyramid->getLevelWidth(m_level);
-        const int levelHeight = m_inputImagePyramid->getLevelHeight(m_level);
-        const int patchesX = std::ceil((float) levelWidth / m_width);
-        const int patchesY = std::ceil((float) levelHeight / m_height);
-
-        for(int patchY = 0; patchY < patchesY; ++patchY) {
-            for(int patchX = 0; patchX < patchesX; ++patchX) {
-                mRuntimeManager->startRegularTimer("create patch");
-                int patchWidth = m_width;
-                if(patchX == patchesX - 1)
-                    patchWidth = levelWidth - patchX * m_width - 1;
-                int patchHeight = m_height;
-                if(patchY == patchesY - 1)
-                    patchHeight = levelHeight - patchY * m_height - 1;
-
-                if(m_inputMask) {
-                    // If a mask exist, check if this patch should be included or not
-                    // At least half of the patch should be clasified as foreground
-                    auto access = m_inputMask->getImageAccess(ACCESS_READ);
-                    auto croppedMask = m_inputMask->crop(
-                        Vector2i(
-                            round(m_inputMask->getWidth() * ((float)patchX / patchesX)),
-                            round(m_inputMask->getHeight() * ((float)patchY / patchesY))
-                        ),
-                        Vector2i(
-                            round(m_inputMask->getWidth() * (1.0f/patchesX)),
-                            round(m_inputMask->getHeight() * (1.0f/patchesY))
-                        )
-                    );
-                    float average = croppedMask->calculateAverageIntensity();
-                    if(average < 0.5) // At least half of the mask has to be foreground
-                        continue;
-                }
-                reportInfo() << "Generating patch " << patchX << " " << patchY << reportEnd();
+void PatchGenerator::stopReaderThreads() {
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_stopReaders = true;
+        m_readerTasks.clear();
+    }
+    m_readerCondition.notify_all();
+    for(auto&& thread : m_readerThreads)
+        thread.join();
+    m_readerThreads.clear();
+}
+
+void PatchGenerator::readerLoop() {
+    while(true) {
+        std::packaged_task<Image::pointer()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_readerMutex);
+            while(!m_stopReaders && m_readerTasks.empty())
+                m_readerCondition.wait(lock);
+            if(m_stopReaders)
+                break;
+            task = std::move(m_readerTasks.front());
+            m_readerTasks.pop_front();
+        }
+        // Any exception is stored in the future, and rethrown on the streamer thread
+        task();
+    }
+}
+
+std::future<Image::pointer> PatchGenerator::readPatchAsync(std::function<Image::pointer()> read) {
+    std::packaged_task<Image::pointer()> task(read);
+    auto future = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        m_readerTasks.push_back(std::move(task));
+    }
+    m_readerCondition.notify_one();
+    return future;
+}
+
+bool PatchGenerator::outputNextPatch(std::deque<std::future<Image::pointer>>& patches, Image::pointer& previousPatch) {
+    auto& future = patches.front();
+    if(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        // The reader threads have not finished the next patch yet
+        ++m_stalls;
+        mRuntimeManager->startRegularTimer("patch stall");
+        future.wait();
+        mRuntimeManager->stopRegularTimer("patch stall");
+    }
+    auto patch = future.get();
+    patches.pop_front();
+
+    try {
+        if(previousPatch) {
+            addOutputData(0, previousPatch);
+            frameAdded();
+        }
+    } catch(ThreadStopped &e) {
+        std::unique_lock<std::mutex> lock(m_stopMutex);
+        m_stop = true;
+        return false;
+    }
+    previousPatch = patch;
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    return !m_stop;
+}
+
+void PatchGenerator::generateImagePyramidPatches(Image::pointer& previousPatch) {
+    const int levelWidth = m_inputImagePyramid->getLevelWidth(m_level);
+    const int levelHeight = m_inputImagePyramid->getLevelHeight(m_level);
+    const int strideX = m_width - m_overlap;
+    const int strideY = m_height - m_overlap;
+    const int patchesX = std::max(1, (int)std::ceil((float) (levelWidth - m_overlap) / strideX));
+    const int patchesY = std::max(1, (int)std::ceil((float) (levelHeight - m_overlap) / strideY));
+    const std::string originalID = createOriginalID();
+
+    // Patches are read on the reader threads, and output here in the order they were requested
+    std::deque<std::future<Image::pointer>> patches;
+    bool stopped = false;
+    for(int patchY = 0; patchY < patchesY && !stopped; ++patchY) {
+        for(int patchX = 0; patchX < patchesX; ++patchX) {
+            const int offsetX = patchX * strideX;
+            const int offsetY = patchY * strideY;
+            int patchWidth = m_width;
+            if(patchX == patchesX - 1)
+                patchWidth = levelWidth - offsetX - 1;
+            int patchHeight = m_height;
+            if(patchY == patchesY - 1)
+                patchHeight = levelHeight - offsetY - 1;
+
+            if(m_inputMask) {
+                // If a mask exist, check if this patch should be included or not
+                // At least half of the patch should be clasified as foreground
+                auto access = m_inputMask->getImageAccess(ACCESS_READ);
+                auto croppedMask = m_inputMask->crop(
+                    Vector2i(
+                        round(m_inputMask->getWidth() * ((float)offsetX / levelWidth)),
+                        round(m_inputMask->getHeight() * ((float)offsetY / levelHeight))
+                    ),
+                    Vector2i(
+                        std::max(1, (int)round(m_inputMask->getWidth() * ((float)patchWidth / levelWidth))),
+                        std::max(1, (int)round(m_inputMask->getHeight() * ((float)patchHeight / levelHeight)))
+                    )
+                );
+                float average = croppedMask->calculateAverageIntensity();
+                if(average < 0.5) // At least half of the mask has to be foreground
+                    continue;
+            }
+
+            patches.push_back(readPatchAsync([=]() {
                 auto access = m_inputImagePyramid->getAccess(ACCESS_READ);
-                auto patch = access->getPatchAsImage(m_level, patchX * m_width, patchY * m_height,
-                                                                  patchWidth,
-                                                                  patchHeight);
+                auto patch = access->getPatchAsImage(m_level, offsetX, offsetY,
+                                                     patchWidth,
+                                                     patchHeight);
 
                 // Store some frame data useful for patch stitching
+                patch->setFrameData("original-id", originalID);
                 patch->setFrameData("original-width", std::to_string(levelWidth));
                 patch->setFrameData("original-height", std::to_string(levelHeight));
                 patch->setFrameData("patchid-x", std::to_string(patchX));
@@ -91,32 +187,47 @@ void PatchGenerator::generateStream() {
                 // Target width/height of patches
                 patch->setFrameData("patch-width", std::to_string(m_width));
                 patch->setFrameData("patch-height", std::to_string(m_height));
+                patch->setFrameData("patch-offset-x", std::to_string(offsetX));
+                patch->setFrameData("patch-offset-y", std::to_string(offsetY));
+                patch->setFrameData("patch-overlap-x", std::to_string(m_overlap));
+                patch->setFrameData("patch-overlap-y", std::to_string(m_overlap));
                 patch->setFrameData("patch-spacing-x", std::to_string(patch->getSpacing().x()));
                 patch->setFrameData("patch-spacing-y", std::to_string(patch->getSpacing().y()));
+                return patch;
+            }));
 
-                mRuntimeManager->stopRegularTimer("create patch");
-                try {
-                    if(previousPatch) {
-                        addOutputData(0, previousPatch);
-                        frameAdded();
-                    }
-                } catch(ThreadStopped &e) {
-                    std::unique_lock<std::mutex> lock(m_stopMutex);
-                    m_stop = true;
+            if(patches.size() >= (std::size_t)m_maxPrefetchedPatches) {
+                if(!outputNextPatch(patches, previousPatch)) {
+                    stopped = true;
                     break;
                 }
-                previousPatch = patch;
-                std::unique_lock<std::mutex> lock(m_stopMutex);
-                if(m_stop)
-                    break;
-            }
-            std::unique_lock<std::mutex> lock(m_stopMutex);
-            if(m_stop) {
-                //m_streamIsStarted = false;
-                m_firstFrameIsInserted = false;
-                break;
             }
         }
+    }
+    while(!stopped && !patches.empty()) {
+        if(!outputNextPatch(patches, previousPatch))
+            stopped = true;
+    }
+    if(stopped) {
+        std::unique_lock<std::mutex> lock(m_stopMutex);
+        m_firstFrameIsInserted = false;
+    }
+}
+
+void PatchGenerator::generateStream() {
+    Image::pointer previousPatch;
+
+    if(m_inputImagePyramid) {
+        reportInfo() << "Generating patches with " << m_readerThreadCount << " reader threads" << reportEnd();
+        m_stalls = 0;
+        startReaderThreads();
+        try {
+            generateImagePyramidPatches(previousPatch);
+        } catch(...) {
+            stopReaderThreads();
+            throw;
+        }
+        stopReaderThreads();
     } else if(m_inputVolume) {
         // TODO Support patching in x and y direction as well for volumes. For now, only depth
         const int width = m_inputVolume->getWidth();
@@ -127,9 +238,14 @@ void PatchGenerator::generateStream() {
         for(int i = 0; i < 16; ++i)
             transformString += std::to_string(transformData[i]) + " ";
 
-        for(int z = 0; z < depth; z += m_depth) {
+        const int strideZ = m_depth - m_overlap;
+        const int patchesZ = std::max(1, (int)std::ceil((float) (depth - m_overlap) / strideZ));
+        const std::string originalID = createOriginalID();
+        for(int patchZ = 0; patchZ < patchesZ; ++patchZ) {
+            const int z = patchZ * strideZ;
             mRuntimeManager->startRegularTimer("create patch");
             auto patch = m_inputVolume->crop(Vector3i(0, 0, z), Vector3i(width, height, m_depth), true);
+            patch->setFrameData("original-id", originalID);
             patch->setFrameData("original-width", std::to_string(width));
             patch->setFrameData("original-height", std::to_string(height));
             patch->setFrameData("original-depth", std::to_string(depth));
@@ -137,6 +253,7 @@ void PatchGenerator::generateStream() {
             patch->setFrameData("patch-offset-x", std::to_string(0));
             patch->setFrameData("patch-offset-y", std::to_string(0));
             patch->setFrameData("patch-offset-z", std::to_string(z));
+            patch->setFrameData("patch-overlap-z", std::to_string(m_overlap));
             Vector3f spacing = m_inputVolume->getSpacing();
             patch->setFrameData("patch-spacing-x", std::to_string(spacing.x()));
             patch->setFrameData("patch-spacing-y", std::to_string(spacing.y()));
@@ -178,6 +295,10 @@ void PatchGenerator::execute() {
     auto input = getInputData<SpatialDataObject>();
     m_inputImagePyramid = std::dynamic_pointer_cast<ImagePyramid>(input);
     m_inputVolume = std::dynamic_pointer_cast<Image>(input);
+    if(m_inputImagePyramid && (m_overlap >= m_width || m_overlap >= m_height))
+        throw Exception("Patch overlap must be smaller than the patch width and height");
+    if(m_inputVolume && m_overlap >= m_depth)
+        throw Exception("Patch overlap must be smaller than the patch depth");
 
     if(mInputConnections.count(1) > 0) {
         // If a mask was given store it
@@ -200,4 +321,27 @@ void PatchGenerator::setPatchLevel(int level) {
     mIsModified = true;
 }
 
+void PatchGenerator::setOverlap(int overlap) {
+    if(overlap < 0)
+        throw Exception("Patch overlap must be >= 0");
+    m_overlap = overlap;
+    mIsModified = true;
+}
+
+void PatchGenerator::setNumberOfReaderThreads(int threads) {
+    if(threads <= 0)
+        throw Exception("Number of reader threads in PatchGenerator must be > 0");
+    m_readerThreadCount = threads;
+}
+
+void PatchGenerator::setMaximumNumberOfPrefetchedPatches(int patches) {
+    if(patches <= 0)
+        throw Exception("Maximum number of prefetched patches in PatchGenerator must be > 0");
+    m_maxPrefetchedPatches = patches;
+}
+
+uint64_t PatchGenerator::getNumberOfStalls() const {
+    return m_stalls;
+}
+
 }
\ No newline at end of file
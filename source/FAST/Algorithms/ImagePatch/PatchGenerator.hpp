@@ -3,6 +3,9 @@
 #include <FAST/ProcessObject.hpp>
 #include <FAST/Streamers/Streamer.hpp>
 #include <thread>
+#include <future>
+#include <deque>
+#include <atomic>
 
 namespace fast {
 
@@ -14,6 +17,34 @@ class FAST_EXPORT PatchGenerator : public Streamer {
     public:
         void setPatchSize(int width, int height, int depth = 1);
         void setPatchLevel(int level);
+        /**
+         * Set the number of pixels neighbouring patches overlap. The stride between patches is thus the
+         * patch size minus the overlap. For volumes, the overlap is only applied in the z direction.
+         * Use PatchStitcher::setBlending to control how the overlapping regions are stitched.
+         * Default is 0.
+         * @param overlap
+         */
+        void setOverlap(int overlap);
+        /**
+         * Set the number of threads which read and decode image pyramid patches ahead of the output.
+         * Patches are still output in the same order as with a single thread.
+         * Default is 1.
+         * @param threads
+         */
+        void setNumberOfReaderThreads(int threads);
+        /**
+         * Set the maximum number of patches which are read ahead of the patch currently being output.
+         * Default is 8.
+         * @param patches
+         */
+        void setMaximumNumberOfPrefetchedPatches(int patches);
+        /**
+         * Number of times the output had to wait for a patch to be read, since the stream was started.
+         * If this is high, increase the number of reader threads.
+         * The time spent waiting is measured by the "patch stall" runtime measurement.
+         * @return number of stalls
+         */
+        uint64_t getNumberOfStalls() const;
         ~PatchGenerator();
         void loadAttributes() override;
     protected:
@@ -23,10 +54,26 @@ class FAST_EXPORT PatchGenerator : public Streamer {
         SharedPointer<Image> m_inputVolume;
         SharedPointer<Image> m_inputMask;
         int m_level;
+        int m_overlap = 0;
 
         void execute() override;
         void generateStream() override;
     private:
         PatchGenerator();
+        void generateImagePyramidPatches(SharedPointer<Image>& previousPatch);
+        std::future<SharedPointer<Image>> readPatchAsync(std::function<SharedPointer<Image>()> read);
+        bool outputNextPatch(std::deque<std::future<SharedPointer<Image>>>& patches, SharedPointer<Image>& previousPatch);
+        void startReaderThreads();
+        void stopReaderThreads();
+        void readerLoop();
+
+        int m_readerThreadCount = 1;
+        int m_maxPrefetchedPatches = 8;
+        std::atomic<uint64_t> m_stalls;
+        std::vector<std::thread> m_readerThreads;
+        std::deque<std::packaged_task<SharedPointer<Image>()>> m_readerTasks;
+        std::mutex m_readerMutex;
+        std::condition_variable m_readerCondition;
+        bool m_stopReaders = false;
 };
 }
\ No newline at end of file
@@ -6,12 +6,65 @@
 
 namespace fast {
 
+static int getFrameDataInt(DataObject::pointer patch, std::string name, int defaultValue) {
+    try {
+        return std::stoi(patch->getFrameData(name));
+    } catch(Exception &e) {
+        return defaultValue;
+    }
+}
+
+/**
+ * Number of pixels to remove from the start and end of a patch along one axis, so that neighbouring
+ * patches meet at the middle of their overlap.
+ */
+static void getCropMargins(int start, int size, int fullSize, int overlap, int& cropStart, int& cropEnd) {
+    cropStart = start > 0 ? overlap / 2 : 0;
+    cropEnd = start + size < fullSize - 1 ? overlap - overlap / 2 : 0;
+}
+
+bool PatchStitcher::isFirstPatchOfInput(DataObject::pointer patch) {
+    std::string originalID;
+    try {
+        originalID = patch->getFrameData("original-id");
+    } catch(Exception &e) {
+        // Patches which are not from PatchGenerator, assume that the first patch is at the origin
+        return getFrameDataInt(patch, "patch-offset-x", getFrameDataInt(patch, "patchid-x", 0)) == 0 &&
+               getFrameDataInt(patch, "patch-offset-y", getFrameDataInt(patch, "patchid-y", 0)) == 0 &&
+               getFrameDataInt(patch, "patch-offset-z", 0) == 0;
+    }
+    // Patches of an input may be skipped, e.g. by a tissue mask, thus any patch of a new input starts a new output
+    const bool first = originalID != m_originalID;
+    m_originalID = originalID;
+    return first;
+}
+
 PatchStitcher::PatchStitcher() {
     createInputPort<DataObject>(0); // Can be Image, Batch or Tensor
     createOutputPort<DataObject>(0); // Can be Image or Tensor
 
     createOpenCLProgram(Config::getKernelSourcePath() + "/Algorithms/ImagePatch/PatchStitcher2D.cl", "2D");
     createOpenCLProgram(Config::getKernelSourcePath() + "/Algorithms/ImagePatch/PatchStitcher3D.cl", "3D");
+
+    createStringAttribute("blending", "Blending", "How overlapping patches are stitched: crop, linear or gaussian", "crop");
+}
+
+void PatchStitcher::loadAttributes() {
+    auto blending = getStringAttribute("blending");
+    if(blending == "crop") {
+        setBlending(PatchBlending::CROP);
+    } else if(blending == "linear") {
+        setBlending(PatchBlending::LINEAR);
+    } else if(blending == "gaussian") {
+        setBlending(PatchBlending::GAUSSIAN);
+    } else {
+        throw Exception("Unknown blending " + blending + " in PatchStitcher. Expected crop, linear or gaussian");
+    }
+}
+
+void PatchStitcher::setBlending(PatchBlending blending) {
+    m_blending = blending;
+    mIsModified = true;
 }
 
 void PatchStitcher::execute() {
@@ -67,14 +120,25 @@ void PatchStitcher::processTensor(SharedPointer<Tensor> patch) {
         throw Exception("Can only handle 1D tensors atm");
     }
     const int channels = shape[0];
+    // With overlapping patches, there is one value per stride
+    const int overlapX = getFrameDataInt(patch, "patch-overlap-x", 0);
+    const int overlapY = getFrameDataInt(patch, "patch-overlap-y", 0);
+    const int strideX = patchWidth - overlapX;
+    const int strideY = patchHeight - overlapY;
 
+    if(isFirstPatchOfInput(patch))
+        m_outputTensor.reset();
     if(!m_outputTensor) {
         // Create output tensor
         m_outputTensor = Tensor::New();
-        TensorShape fullShape({(int)std::ceil((float)fullHeight / patchHeight), (int)std::ceil((float)fullWidth / patchWidth), channels});
+        TensorShape fullShape({
+            std::max(1, (int)std::ceil((float)(fullHeight - overlapY) / strideY)),
+            std::max(1, (int)std::ceil((float)(fullWidth - overlapX) / strideX)),
+            channels
+        });
         auto initializedData = std::make_unique<float[]>(fullShape.getTotalSize());
         m_outputTensor->create(std::move(initializedData), fullShape);
-        m_outputTensor->setSpacing(Vector3f(patchHeight*patchSpacingY, patchWidth*patchSpacingX, 1.0f));
+        m_outputTensor->setSpacing(Vector3f(strideY*patchSpacingY, strideX*patchSpacingX, 1.0f));
     }
     reportInfo() << "Stitching " << patch->getFrameData("patchid-x") << " " << patch->getFrameData("patchid-y") << reportEnd();
     reportInfo() << "Stitching data" << patch->getFrameData("patch-spacing-x") << " " << patch->getFrameData("patch-spacing-y") << reportEnd();
@@ -110,7 +174,16 @@ void PatchStitcher::processImage(SharedPointer<Image> patch) {
         is3D = false;
     }
 
+    // The first patch of an input is stitched into new output data
+    if(isFirstPatchOfInput(patch)) {
+        m_outputImage.reset();
+        m_outputImagePyramid.reset();
+    }
+
     if(!m_outputImage && !m_outputImagePyramid) {
+        // Sums and weights of blending belong to the previous output image, thus reallocate them on the next patch
+        m_accumulationBuffer = cl::Buffer();
+        m_weightBuffer = cl::Buffer();
         // Create output image
         if(is3D) {
 			m_outputImage = Image::New();
@@ -152,12 +225,23 @@ void PatchStitcher::processImage(SharedPointer<Image> patch) {
     auto device = std::dynamic_pointer_cast<OpenCLDevice>(getMainDevice());
 
     if(fullDepth == 1) {
-		const int startX = std::stoi(patch->getFrameData("patchid-x")) * std::stoi(patch->getFrameData("patch-width"));
-		const int startY = std::stoi(patch->getFrameData("patchid-y")) * std::stoi(patch->getFrameData("patch-height"));
-		const int endX = startX + patch->getWidth();
-		const int endY = startY + patch->getHeight();
+        const int startX = getFrameDataInt(patch, "patch-offset-x", std::stoi(patch->getFrameData("patchid-x")) * std::stoi(patch->getFrameData("patch-width")));
+        const int startY = getFrameDataInt(patch, "patch-offset-y", std::stoi(patch->getFrameData("patchid-y")) * std::stoi(patch->getFrameData("patch-height")));
+        const int overlapX = getFrameDataInt(patch, "patch-overlap-x", 0);
+        const int overlapY = getFrameDataInt(patch, "patch-overlap-y", 0);
+        // Clamp patch to output image
+        const int width = std::min((int)patch->getWidth(), fullWidth - startX);
+        const int height = std::min((int)patch->getHeight(), fullHeight - startY);
 		reportInfo() << "Stitching 2D data" << patch->getFrameData("patchid-x") << " " << patch->getFrameData("patchid-y")
 			<< reportEnd();
+        if(m_outputImage && m_blending != PatchBlending::CROP) {
+            accumulatePatch(patch, startX, startY, 0, overlapX, overlapY, 0);
+            return;
+        }
+
+        int cropLeft, cropRight, cropTop, cropBottom;
+        getCropMargins(startX, width, fullWidth, overlapX, cropLeft, cropRight);
+        getCropMargins(startY, height, fullHeight, overlapY, cropTop, cropBottom);
         if(m_outputImage) {
             cl::Program program = getOpenCLProgram(device, "2D");
 
@@ -171,34 +255,48 @@ void PatchStitcher::processImage(SharedPointer<Image> patch) {
             kernel.setArg(3, startY);
             device->getCommandQueue().enqueueNDRangeKernel(
                 kernel,
-                cl::NullRange,
-                cl::NDRange(patch->getWidth(), patch->getHeight()),
+                cl::NDRange(cropLeft, cropTop),
+                cl::NDRange(width - cropLeft - cropRight, height - cropTop - cropBottom),
                 cl::NullRange
             );
         } else {
-            //enableRuntimeMeasurements();
-            // Image pyramid, do it on CPU TODO: optimize somehow?
+            if(m_blending != PatchBlending::CROP)
+                reportWarning() << "Blending is not supported for image pyramid output in PatchStitcher, cropping instead" << reportEnd();
+            // Image pyramid, copy the cropped patch on CPU
+            if(patch->getDataType() != TYPE_UINT8)
+                throw Exception("PatchStitcher only supports image pyramids of type TYPE_UINT8");
             auto outputAccess = m_outputImagePyramid->getAccess(ACCESS_READ_WRITE);
             auto patchAccess = patch->getImageAccess(ACCESS_READ);
-            //mRuntimeManager->startRegularTimer("copy patch");
-            const int maxY = std::min(endY, fullHeight);
-            const int maxX = std::min(endX, fullWidth);
-            for(int y = startY; y < maxY; ++y) {
-                for(int x = startX; x < maxX; ++x) {
-                    outputAccess->setScalarFast(x, y, 0, patchAccess->getScalarFast<uchar>(Vector2i(x - startX, y - startY)));
-                }
+            const uchar* patchData = (const uchar*)patchAccess->get();
+            const int channels = patch->getNrOfChannels();
+            const int cropWidth = width - cropLeft - cropRight;
+            const int cropHeight = height - cropTop - cropBottom;
+            auto croppedData = make_uninitialized_unique<uchar[]>(cropWidth*cropHeight*channels);
+            for(int y = 0; y < cropHeight; ++y) {
+                std::memcpy(&croppedData[y*cropWidth*channels],
+                            &patchData[(cropLeft + (y + cropTop)*patch->getWidth())*channels],
+                            cropWidth*channels);
             }
-            //mRuntimeManager->stopRegularTimer("copy patch");
-            //mRuntimeManager->getTiming("copy patch")->print();
+            outputAccess->setPatch(0, startX + cropLeft, startY + cropTop, cropWidth, cropHeight, croppedData.get());
         }
     } else {
         // 3D
         const int startX = 0;
         const int startY = 0;
         const int startZ = std::stoi(patch->getFrameData("patch-offset-z"));
-        const int endX = startX + patch->getWidth();
-        const int endY = startY + patch->getHeight();
+        const int overlapZ = getFrameDataInt(patch, "patch-overlap-z", 0);
+        // The last patch may extend beyond the volume
+        const int depth = std::min((int)patch->getDepth(), fullDepth - startZ);
         reportInfo() << "Stitching " << startZ << reportEnd();
+        if(m_blending != PatchBlending::CROP) {
+            accumulatePatch(patch, startX, startY, startZ, 0, 0, overlapZ);
+            return;
+        }
+
+        int cropFront, cropBack;
+        getCropMargins(startZ, depth, fullDepth, overlapZ, cropFront, cropBack);
+        const cl::NDRange offset(0, 0, cropFront);
+        const cl::NDRange size(patch->getWidth(), patch->getHeight(), depth - cropFront - cropBack);
 		auto patchAccess = patch->getOpenCLImageAccess(ACCESS_READ, device);
 
         if(device->isWritingTo3DTexturesSupported()) {
@@ -213,8 +311,8 @@ void PatchStitcher::processImage(SharedPointer<Image> patch) {
 
             device->getCommandQueue().enqueueNDRangeKernel(
                 kernel,
-                cl::NullRange,
-                cl::NDRange(patch->getWidth(), patch->getHeight(), patch->getDepth()),
+                offset,
+                size,
                 cl::NullRange
             );
         } else {
@@ -232,14 +330,91 @@ void PatchStitcher::processImage(SharedPointer<Image> patch) {
 
             device->getCommandQueue().enqueueNDRangeKernel(
                 kernel,
-                cl::NullRange,
-                cl::NDRange(patch->getWidth(), patch->getHeight(), patch->getDepth()),
+                offset,
+                size,
                 cl::NullRange
             );
         }
+    }
+}
+
+void PatchStitcher::accumulatePatch(SharedPointer<Image> patch, int startX, int startY, int startZ, int overlapX, int overlapY, int overlapZ) {
+    auto device = std::dynamic_pointer_cast<OpenCLDevice>(getMainDevice());
+    auto queue = device->getCommandQueue();
+    const int fullWidth = m_outputImage->getWidth();
+    const int fullHeight = m_outputImage->getHeight();
+    const int fullDepth = m_outputImage->getDepth();
+    const int channels = m_outputImage->getNrOfChannels();
+    const bool is3D = m_outputImage->getDimensions() == 3;
+    const std::size_t voxels = (std::size_t)fullWidth*fullHeight*fullDepth;
+    if(m_accumulationBuffer() == nullptr) {
+        m_accumulationBuffer = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, voxels*channels*sizeof(float));
+        m_weightBuffer = cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, voxels*sizeof(float));
+        queue.enqueueFillBuffer(m_accumulationBuffer, 0.0f, 0, voxels*channels*sizeof(float));
+        queue.enqueueFillBuffer(m_weightBuffer, 0.0f, 0, voxels*sizeof(float));
+    }
+    const int width = std::min((int)patch->getWidth(), fullWidth - startX);
+    const int height = std::min((int)patch->getHeight(), fullHeight - startY);
+    const int depth = std::min((int)patch->getDepth(), fullDepth - startZ);
 
+    std::string buildOptions = "-DTYPE=" + getCTypeAsString(m_outputImage->getDataType());
+    if(m_outputImage->getDataType() != TYPE_FLOAT)
+        buildOptions += " -DINTEGER_TYPE";
+    cl::Program program = getOpenCLProgram(device, is3D ? "3D" : "2D", buildOptions);
+    auto patchAccess = patch->getOpenCLImageAccess(ACCESS_READ, device);
+    auto outputAccess = m_outputImage->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+    const int blending = m_blending == PatchBlending::LINEAR ? 1 : 2;
 
+    // Add the weighted patch to the accumulation buffer, and then update the output in the region of the patch
+    if(is3D) {
+        cl::Kernel accumulateKernel(program, "accumulatePatch3D");
+        accumulateKernel.setArg(0, *patchAccess->get3DImage());
+        accumulateKernel.setArg(1, m_accumulationBuffer);
+        accumulateKernel.setArg(2, m_weightBuffer);
+        accumulateKernel.setArg(3, startX);
+        accumulateKernel.setArg(4, startY);
+        accumulateKernel.setArg(5, startZ);
+        accumulateKernel.setArg(6, fullWidth);
+        accumulateKernel.setArg(7, fullHeight);
+        accumulateKernel.setArg(8, channels);
+        accumulateKernel.setArg(9, overlapZ);
+        accumulateKernel.setArg(10, blending);
+        queue.enqueueNDRangeKernel(accumulateKernel, cl::NullRange, cl::NDRange(width, height, depth), cl::NullRange);
+
+        cl::Kernel normalizeKernel(program, "normalizeAccumulation3D");
+        normalizeKernel.setArg(0, m_accumulationBuffer);
+        normalizeKernel.setArg(1, m_weightBuffer);
+        normalizeKernel.setArg(2, *outputAccess->get());
+        normalizeKernel.setArg(3, startX);
+        normalizeKernel.setArg(4, startY);
+        normalizeKernel.setArg(5, startZ);
+        normalizeKernel.setArg(6, fullWidth);
+        normalizeKernel.setArg(7, fullHeight);
+        normalizeKernel.setArg(8, channels);
+        queue.enqueueNDRangeKernel(normalizeKernel, cl::NullRange, cl::NDRange(width, height, depth), cl::NullRange);
+    } else {
+        cl::Kernel accumulateKernel(program, "accumulatePatch2D");
+        accumulateKernel.setArg(0, *patchAccess->get2DImage());
+        accumulateKernel.setArg(1, m_accumulationBuffer);
+        accumulateKernel.setArg(2, m_weightBuffer);
+        accumulateKernel.setArg(3, startX);
+        accumulateKernel.setArg(4, startY);
+        accumulateKernel.setArg(5, fullWidth);
+        accumulateKernel.setArg(6, channels);
+        accumulateKernel.setArg(7, overlapX);
+        accumulateKernel.setArg(8, overlapY);
+        accumulateKernel.setArg(9, blending);
+        queue.enqueueNDRangeKernel(accumulateKernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
 
+        cl::Kernel normalizeKernel(program, "normalizeAccumulation2D");
+        normalizeKernel.setArg(0, m_accumulationBuffer);
+        normalizeKernel.setArg(1, m_weightBuffer);
+        normalizeKernel.setArg(2, *outputAccess->get());
+        normalizeKernel.setArg(3, startX);
+        normalizeKernel.setArg(4, startY);
+        normalizeKernel.setArg(5, fullWidth);
+        normalizeKernel.setArg(6, channels);
+        queue.enqueueNDRangeKernel(normalizeKernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
     }
 }
 
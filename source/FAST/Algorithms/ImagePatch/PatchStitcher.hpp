@@ -8,18 +8,48 @@ class Image;
 class ImagePyramid;
 class Tensor;
 
+/**
+ * How overlapping regions of neighbouring patches are stitched
+ */
+enum class PatchBlending {
+    CROP,       // Only use the center of each patch, i.e. half of the overlap is removed on each side
+    LINEAR,     // Weighted average of all patches, with weights linearly decreasing across the overlap
+    GAUSSIAN    // Weighted average of all patches, with gaussian weights centered in each patch
+};
+
 class FAST_EXPORT PatchStitcher : public ProcessObject {
     FAST_OBJECT(PatchStitcher)
     public:
+        /**
+         * Set how overlapping patches are stitched. Default is PatchBlending::CROP.
+         * Blending is done on the device by accumulating weighted patches in a float buffer, and
+         * is only supported for image output, not image pyramids. Note that blending of integer images
+         * will average the values, thus blend probability maps rather than segmentation labels.
+         * @param blending
+         */
+        void setBlending(PatchBlending blending);
+        void loadAttributes() override;
     protected:
         void execute() override;
 
         SharedPointer<Image> m_outputImage;
         SharedPointer<Tensor> m_outputTensor;
         SharedPointer<ImagePyramid> m_outputImagePyramid;
+        PatchBlending m_blending = PatchBlending::CROP;
+        // Weighted sum of patches and sum of weights, used for blending
+        cl::Buffer m_accumulationBuffer;
+        cl::Buffer m_weightBuffer;
+        // The original-id frame data of the last patch, which identifies the input it was made from
+        std::string m_originalID;
 
         void processTensor(SharedPointer<Tensor> tensor);
         void processImage(SharedPointer<Image> tensor);
+        /**
+         * Whether the patch is the first one of its input, and should be stitched into new output data.
+         * Also remembers the input of the patch.
+         */
+        bool isFirstPatchOfInput(SharedPointer<DataObject> patch);
+        void accumulatePatch(SharedPointer<Image> patch, int startX, int startY, int startZ, int overlapX, int overlapY, int overlapZ);
     private:
         PatchStitcher();
 
@@ -16,3 +16,76 @@ __kernel void applyPatch2D(
 		write_imagei(image, pos, read_imagei(patch, sampler, pos - (int2)(startX, startY)));
     }
 }
+
+#ifdef TYPE
+// Weight of a pixel at position i in a patch of the given size, along one axis
+float getBlendingWeight(int i, int size, int overlap, int blending) {
+    if(blending == 1) {
+        // Linear ramp across the overlap
+        if(overlap <= 0)
+            return 1.0f;
+        return min(1.0f, (float)(min(i, size - 1 - i) + 1) / (overlap + 1));
+    } else {
+        // Gaussian centered in the patch
+        const float sigma = size / 8.0f;
+        const float d = i - (size - 1) * 0.5f;
+        return max(exp(-d * d / (2.0f * sigma * sigma)), 1e-4f);
+    }
+}
+
+__kernel void accumulatePatch2D(
+        __read_only image2d_t patch,
+        __global float* accumulation,
+        __global float* weights,
+        __private int startX,
+        __private int startY,
+        __private int width,
+        __private int channels,
+        __private int overlapX,
+        __private int overlapY,
+        __private int blending
+    ) {
+    const int2 patchPos = {get_global_id(0), get_global_id(1)};
+    const int2 size = get_image_dim(patch);
+    const float weight = getBlendingWeight(patchPos.x, size.x, overlapX, blending)*
+                         getBlendingWeight(patchPos.y, size.y, overlapY, blending);
+    int dataType = get_image_channel_data_type(patch);
+    float4 value;
+    if(dataType == CLK_FLOAT) {
+        value = read_imagef(patch, sampler, patchPos);
+    } else if(dataType == CLK_UNSIGNED_INT8 || dataType == CLK_UNSIGNED_INT16) {
+        value = convert_float4(read_imageui(patch, sampler, patchPos));
+    } else {
+        value = convert_float4(read_imagei(patch, sampler, patchPos));
+    }
+    const int index = patchPos.x + startX + (patchPos.y + startY)*width;
+    weights[index] += weight;
+    accumulation[index*channels] += value.x*weight;
+    if(channels > 1)
+        accumulation[index*channels + 1] += value.y*weight;
+    if(channels > 2)
+        accumulation[index*channels + 2] += value.z*weight;
+    if(channels > 3)
+        accumulation[index*channels + 3] += value.w*weight;
+}
+
+__kernel void normalizeAccumulation2D(
+        __global float* accumulation,
+        __global float* weights,
+        __global TYPE* image,
+        __private int startX,
+        __private int startY,
+        __private int width,
+        __private int channels
+    ) {
+    const int index = get_global_id(0) + startX + (get_global_id(1) + startY)*width;
+    const float weight = weights[index];
+    for(int c = 0; c < channels; ++c) {
+#ifdef INTEGER_TYPE
+        image[index*channels + c] = (TYPE)round(accumulation[index*channels + c] / weight);
+#else
+        image[index*channels + c] = (TYPE)(accumulation[index*channels + c] / weight);
+#endif
+    }
+}
+#endif
@@ -48,3 +48,78 @@ __kernel void applyPatch3D(
         image[(pos.x + pos.y*width + pos.z*width*height)*channels + 3] = value.w;
 }
 #endif
+
+#ifdef TYPE
+// Weight of a pixel at position i in a patch of the given size, along one axis
+float getBlendingWeight(int i, int size, int overlap, int blending) {
+    if(blending == 1) {
+        // Linear ramp across the overlap
+        if(overlap <= 0)
+            return 1.0f;
+        return min(1.0f, (float)(min(i, size - 1 - i) + 1) / (overlap + 1));
+    } else {
+        // Gaussian centered in the patch
+        const float sigma = size / 8.0f;
+        const float d = i - (size - 1) * 0.5f;
+        return max(exp(-d * d / (2.0f * sigma * sigma)), 1e-4f);
+    }
+}
+
+__kernel void accumulatePatch3D(
+        __read_only image3d_t patch,
+        __global float* accumulation,
+        __global float* weights,
+        __private int startX,
+        __private int startY,
+        __private int startZ,
+        __private int width,
+        __private int height,
+        __private int channels,
+        __private int overlapZ,
+        __private int blending
+    ) {
+    const int4 patchPos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    // Volumes are only patched in the z direction
+    const float weight = getBlendingWeight(patchPos.z, get_image_depth(patch), overlapZ, blending);
+    int dataType = get_image_channel_data_type(patch);
+    float4 value;
+    if(dataType == CLK_FLOAT) {
+        value = read_imagef(patch, sampler, patchPos);
+    } else if(dataType == CLK_UNSIGNED_INT8 || dataType == CLK_UNSIGNED_INT16) {
+        value = convert_float4(read_imageui(patch, sampler, patchPos));
+    } else {
+        value = convert_float4(read_imagei(patch, sampler, patchPos));
+    }
+    const int index = patchPos.x + startX + (patchPos.y + startY)*width + (patchPos.z + startZ)*width*height;
+    weights[index] += weight;
+    accumulation[index*channels] += value.x*weight;
+    if(channels > 1)
+        accumulation[index*channels + 1] += value.y*weight;
+    if(channels > 2)
+        accumulation[index*channels + 2] += value.z*weight;
+    if(channels > 3)
+        accumulation[index*channels + 3] += value.w*weight;
+}
+
+__kernel void normalizeAccumulation3D(
+        __global float* accumulation,
+        __global float* weights,
+        __global TYPE* image,
+        __private int startX,
+        __private int startY,
+        __private int startZ,
+        __private int width,
+        __private int height,
+        __private int channels
+    ) {
+    const int index = get_global_id(0) + startX + (get_global_id(1) + startY)*width + (get_global_id(2) + startZ)*width*height;
+    const float weight = weights[index];
+    for(int c = 0; c < channels; ++c) {
+#ifdef INTEGER_TYPE
+        image[index*channels + c] = (TYPE)round(accumulation[index*channels + c] / weight);
+#else
+        image[index*channels + c] = (TYPE)(accumulation[index*channels + c] / weight);
+#endif
+    }
+}
+#endif
@@ -9,7 +9,10 @@
 #include <FAST/Algorithms/ImagePatch/PatchStitcher.hpp>
 #include <FAST/Algorithms/ImagePatch/ImageToBatchGenerator.hpp>
 #include <FAST/Algorithms/NeuralNetwork/NeuralNetwork.hpp>
+#include <FAST/Algorithms/ImageResizer/ImageResizer.hpp>
 #include <FAST/Importers/ImageFileImporter.hpp>
+#include <FAST/Streamers/ManualImageStreamer.hpp>
+#include <FAST/Data/Tensor.hpp>
 #include <FAST/Visualization/VolumeRenderer/AlphaBlendingVolumeRenderer.hpp>
 
 using namespace fast;
@@ -32,6 +35,39 @@ TEST_CASE("Patch generator for WSI", "[fast][wsi][PatchGenerator][visual]") {
     window->start();
 }
 
+TEST_CASE("Patch generator with multiple reader threads outputs patches in order", "[fast][wsi][PatchGenerator]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    auto importer = WholeSlideImageImporter::New();
+    importer->setFilename(Config::getTestDataPath() + "/WSI/A05.svs");
+
+    auto generator = PatchGenerator::New();
+    generator->setPatchSize(512, 512);
+    generator->setPatchLevel(2);
+    generator->setNumberOfReaderThreads(4);
+    generator->setMaximumNumberOfPrefetchedPatches(16);
+    generator->setInputConnection(importer->getOutputPort());
+    auto port = generator->getOutputPort();
+
+    int expectedX = 0;
+    int expectedY = 0;
+    int patchesX = -1;
+    Image::pointer patch;
+    do {
+        generator->update();
+        patch = port->getNextFrame<Image>();
+        if(patchesX < 0)
+            patchesX = std::ceil(std::stof(patch->getFrameData("original-width")) / 512);
+        CHECK(std::stoi(patch->getFrameData("patchid-x")) == expectedX);
+        CHECK(std::stoi(patch->getFrameData("patchid-y")) == expectedY);
+        ++expectedX;
+        if(expectedX == patchesX) {
+            expectedX = 0;
+            ++expectedY;
+        }
+    } while(!patch->isLastFrame());
+    CHECK(expectedX == 0);
+}
+
 TEST_CASE("Patch generator for volumes", "[fast][volume][PatchGenerator][visual]") {
     auto importer = ImageFileImporter::New();
     importer->setFilename(Config::getTestDataPath() + "/CT/CT-Thorax.mhd");
@@ -112,4 +148,318 @@ TEST_CASE("Patch generator, sticher and image to batch generator for WSI", "[fas
         std::cout << "Got a batch" << std::endl;
     } while(!batch->isLastFrame());
     std::cout << "Done" << std::endl;
-}
\ No newline at end of file
+}
+
+TEST_CASE("Image to batch generator sends partial batches after max latency", "[fast][ImageToBatchGenerator]") {
+    const int nrOfImages = 7;
+    auto streamer = ManualImageStreamer::New();
+    for(int i = 0; i < nrOfImages; ++i) {
+        auto data = make_uninitialized_unique<uchar[]>(8*4);
+        for(int j = 0; j < 8*4; ++j)
+            data[j] = (uchar)(i*10 + j);
+        auto image = Image::New();
+        image->create(8, 4, TYPE_UINT8, 1, std::move(data));
+        image->setFrameData("nr", std::to_string(i));
+        if(i == nrOfImages - 1)
+            image->setLastFrame("test");
+        streamer->addImage(image);
+    }
+    // Images arrive slower than the max latency, thus batches are never full
+    streamer->setSleepTime(50);
+
+    auto batchGenerator = ImageToBatchGenerator::New();
+    batchGenerator->setInputConnection(streamer->getOutputPort());
+    batchGenerator->setMaxBatchSize(4);
+    batchGenerator->setMaxLatency(10);
+    batchGenerator->setTensorOutput(true);
+    batchGenerator->setScaleFactor(0.5f);
+    auto port = batchGenerator->getOutputPort();
+
+    int imageNr = 0;
+    Batch::pointer batch;
+    do {
+        batchGenerator->update();
+        batch = port->getNextFrame<Batch>();
+        auto access = batch->getAccess(ACCESS_READ);
+        auto dataList = access->getData();
+        auto images = dataList.getImages();
+        CHECK(images.size() < 4);
+        REQUIRE(dataList.hasBatchTensor());
+        auto tensor = dataList.getBatchTensor();
+        auto shape = tensor->getShape();
+        REQUIRE(shape.getDimensions() == 4);
+        CHECK(shape[0] == images.size());
+        CHECK(shape[1] == 4);
+        CHECK(shape[2] == 8);
+        CHECK(shape[3] == 1);
+        auto tensorAccess = tensor->getAccess(ACCESS_READ);
+        const float* values = tensorAccess->getRawData();
+        for(int i = 0; i < images.size(); ++i) {
+            // Frame data stays on each image
+            CHECK(images[i]->getFrameData("nr") == std::to_string(imageNr));
+            CHECK(values[i*8*4] == Approx(imageNr*10*0.5f));
+            CHECK(values[i*8*4 + 31] == Approx((imageNr*10 + 31)*0.5f));
+            ++imageNr;
+        }
+        CHECK(images.back()->isLastFrame() == batch->isLastFrame());
+    } while(!batch->isLastFrame());
+    CHECK(imageNr == nrOfImages);
+}
+TEST_CASE("Image to batch generator only sends last frame when all streams have ended", "[fast][ImageToBatchGenerator]") {
+    // Two streams of different length, the first ends long before the second
+    const std::vector<int> nrOfImages = {2, 7};
+    auto batchGenerator = ImageToBatchGenerator::New();
+    for(int stream = 0; stream < 2; ++stream) {
+        auto streamer = ManualImageStreamer::New();
+        for(int i = 0; i < nrOfImages[stream]; ++i) {
+            auto image = Image::New();
+            image->create(8, 4, TYPE_UINT8, 1);
+            image->setFrameData("stream", std::to_string(stream));
+            if(i == nrOfImages[stream] - 1)
+                image->setLastFrame("stream " + std::to_string(stream));
+            streamer->addImage(image);
+        }
+        batchGenerator->addInputConnection(streamer->getOutputPort());
+    }
+    batchGenerator->setMaxBatchSize(3);
+    auto port = batchGenerator->getOutputPort();
+
+    std::vector<int> imagesReceived = {0, 0};
+    Batch::pointer batch;
+    do {
+        batchGenerator->update();
+        batch = port->getNextFrame<Batch>();
+        auto access = batch->getAccess(ACCESS_READ);
+        for(auto&& image : access->getData().getImages())
+            imagesReceived[std::stoi(image->getFrameData("stream"))]++;
+        if(imagesReceived[1] < nrOfImages[1])
+            CHECK_FALSE(batch->isLastFrame());
+    } while(!batch->isLastFrame());
+    CHECK(imagesReceived[0] == nrOfImages[0]);
+    CHECK(imagesReceived[1] == nrOfImages[1]);
+    CHECK(batch->isLastFrame("stream 0"));
+    CHECK(batch->isLastFrame("stream 1"));
+}
+
+TEST_CASE("Image to batch generator fills batches through a filter between the streamer and it", "[fast][ImageToBatchGenerator]") {
+    const int nrOfImages = 7;
+    auto streamer = ManualImageStreamer::New();
+    for(int i = 0; i < nrOfImages; ++i) {
+        auto image = Image::New();
+        image->create(8, 4, TYPE_UINT8, 1);
+        image->setFrameData("nr", std::to_string(i));
+        if(i == nrOfImages - 1)
+            image->setLastFrame("test");
+        streamer->addImage(image);
+    }
+
+    auto resizer = ImageResizer::New();
+    resizer->setInputConnection(streamer->getOutputPort());
+    resizer->setWidth(4);
+    resizer->setHeight(2);
+
+    auto batchGenerator = ImageToBatchGenerator::New();
+    batchGenerator->setInputConnection(resizer->getOutputPort());
+    batchGenerator->setMaxBatchSize(4);
+    auto port = batchGenerator->getOutputPort();
+
+    std::vector<int> batchSizes;
+    int imageNr = 0;
+    Batch::pointer batch;
+    do {
+        batchGenerator->update();
+        batch = port->getNextFrame<Batch>();
+        auto access = batch->getAccess(ACCESS_READ);
+        auto images = access->getData().getImages();
+        for(auto&& image : images) {
+            CHECK(image->getWidth() == 4);
+            CHECK(image->getHeight() == 2);
+            CHECK(image->getFrameData("nr") == std::to_string(imageNr));
+            ++imageNr;
+        }
+        batchSizes.push_back(images.size());
+    } while(!batch->isLastFrame());
+    CHECK(imageNr == nrOfImages);
+    CHECK(batchSizes == std::vector<int>({4, 3}));
+}
+
+static Image::pointer stitchVolumePatches(Image::pointer volume, int overlap, PatchBlending blending, double& runtime) {
+    auto generator = PatchGenerator::New();
+    generator->setPatchSize(volume->getWidth(), volume->getHeight(), 32);
+    generator->setOverlap(overlap);
+    generator->setInputData(volume);
+
+    auto stitcher = PatchStitcher::New();
+    stitcher->setBlending(blending);
+    stitcher->setInputConnection(generator->getOutputPort());
+    stitcher->enableRuntimeMeasurements();
+    auto port = stitcher->getOutputPort();
+
+    Image::pointer result;
+    do {
+        stitcher->update();
+        result = port->getNextFrame<Image>();
+    } while(!result->isLastFrame());
+    runtime = stitcher->getRuntime("stitch patch")->getSum();
+    return result;
+}
+
+TEST_CASE("Patch generator and stitcher with overlap reconstructs volume", "[fast][volume][PatchGenerator][PatchStitcher]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    auto importer = ImageFileImporter::New();
+    importer->setFilename(Config::getTestDataPath() + "/CT/CT-Thorax.mhd");
+    auto volume = importer->updateAndGetOutputData<Image>();
+
+    for(auto blending : {PatchBlending::CROP, PatchBlending::LINEAR, PatchBlending::GAUSSIAN}) {
+        double runtime;
+        auto result = stitchVolumePatches(volume, 8, blending, runtime);
+        REQUIRE(result->getSize() == volume->getSize());
+
+        // Patches of the same volume are identical in the overlap, thus blending should not change any values
+        auto access = volume->getImageAccess(ACCESS_READ);
+        auto resultAccess = result->getImageAccess(ACCESS_READ);
+        const uint size = volume->getNrOfVoxels();
+        for(uint i = 0; i < size; i += 101) {
+            CHECK(resultAccess->getScalar(i) == Approx(access->getScalar(i)));
+        }
+    }
+}
+
+TEST_CASE("Patch stitcher with blending doesn't mix in the previous stream", "[fast][volume][PatchGenerator][PatchStitcher]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    auto stitcher = PatchStitcher::New();
+    stitcher->setBlending(PatchBlending::GAUSSIAN);
+    auto port = stitcher->getOutputPort();
+
+    // Each volume is a single patch, thus each stream has one frame
+    for(float value : {100.0f, 0.0f}) {
+        auto volume = Image::New();
+        volume->create(16, 16, 32, TYPE_FLOAT, 1);
+        volume->fill(value);
+
+        auto generator = PatchGenerator::New();
+        generator->setPatchSize(16, 16, 32);
+        generator->setOverlap(8);
+        generator->setInputData(volume);
+        stitcher->setInputConnection(generator->getOutputPort());
+        stitcher->update();
+        auto result = port->getNextFrame<Image>();
+        REQUIRE(result->getSize() == volume->getSize());
+
+        auto access = result->getImageAccess(ACCESS_READ);
+        for(uint i = 0; i < result->getNrOfVoxels(); i += 97)
+            CHECK(access->getScalar(i) == Approx(value));
+    }
+}
+
+/**
+ * Create a 2D float patch with a constant value, and the frame data PatchGenerator gives patches of an image pyramid
+ */
+static Image::pointer create2DPatch(std::string originalID, int fullWidth, int fullHeight, int patchIdX, int offsetX, int size, int overlap, float value) {
+    auto patch = Image::New();
+    patch->create(size, size, TYPE_FLOAT, 1);
+    patch->fill(value);
+    patch->setFrameData("original-id", originalID);
+    patch->setFrameData("original-width", std::to_string(fullWidth));
+    patch->setFrameData("original-height", std::to_string(fullHeight));
+    patch->setFrameData("patchid-x", std::to_string(patchIdX));
+    patch->setFrameData("patchid-y", "0");
+    patch->setFrameData("patch-width", std::to_string(size));
+    patch->setFrameData("patch-height", std::to_string(size));
+    patch->setFrameData("patch-offset-x", std::to_string(offsetX));
+    patch->setFrameData("patch-offset-y", "0");
+    patch->setFrameData("patch-overlap-x", std::to_string(overlap));
+    patch->setFrameData("patch-overlap-y", std::to_string(overlap));
+    patch->setFrameData("patch-spacing-x", "1");
+    patch->setFrameData("patch-spacing-y", "1");
+    return patch;
+}
+
+TEST_CASE("Patch stitcher starts new output when the first patch of an input is skipped", "[fast][PatchStitcher]") {
+    auto stitcher = PatchStitcher::New();
+    stitcher->setBlending(PatchBlending::LINEAR);
+    auto port = stitcher->getOutputPort();
+
+    // Two overlapping patches of the first input
+    for(int patchX = 0; patchX < 2; ++patchX) {
+        stitcher->setInputData(create2DPatch("first", 24, 16, patchX, patchX*8, 16, 8, 100.0f));
+        stitcher->update();
+        port->getNextFrame<Image>();
+    }
+
+    // The first patch of the second input is missing, as if it was removed by a tissue mask
+    stitcher->setInputData(create2DPatch("second", 24, 16, 1, 8, 16, 8, 0.0f));
+    stitcher->update();
+    auto result = port->getNextFrame<Image>();
+    auto access = result->getImageAccess(ACCESS_READ);
+    for(int y = 0; y < 16; ++y) {
+        for(int x = 0; x < 24; ++x)
+            REQUIRE(access->getScalar(Vector2i(x, y)) == Approx(0.0f));
+    }
+}
+
+TEST_CASE("Patch stitcher blends overlapping 2D patches with different values", "[fast][PatchStitcher]") {
+    const std::map<std::string, PatchBlending> modes = {
+            {"linear", PatchBlending::LINEAR},
+            {"gaussian", PatchBlending::GAUSSIAN},
+    };
+    for(auto&& mode : modes) {
+        auto stitcher = PatchStitcher::New();
+        stitcher->setBlending(mode.second);
+        auto port = stitcher->getOutputPort();
+
+        // Two 16x16 patches overlapping in x = 8 to 15
+        Image::pointer result;
+        for(int patchX = 0; patchX < 2; ++patchX) {
+            stitcher->setInputData(create2DPatch("input", 24, 16, patchX, patchX*8, 16, 8, patchX == 0 ? 100.0f : 0.0f));
+            stitcher->update();
+            result = port->getNextFrame<Image>();
+        }
+
+        INFO("Blending " << mode.first);
+        auto access = result->getImageAccess(ACCESS_READ);
+        for(int y = 0; y < 16; ++y) {
+            // Outside the overlap there is only one patch
+            for(int x = 0; x < 8; ++x)
+                REQUIRE(access->getScalar(Vector2i(x, y)) == Approx(100.0f));
+            for(int x = 16; x < 24; ++x)
+                REQUIRE(access->getScalar(Vector2i(x, y)) == Approx(0.0f));
+            // Inside the overlap, the value goes from the value of the first patch towards the second.
+            // Weights in y are equal for both patches, thus the result is the same in each row.
+            float previous = 100.0f;
+            for(int x = 8; x < 16; ++x) {
+                const float value = access->getScalar(Vector2i(x, y));
+                REQUIRE(value < previous);
+                REQUIRE(value > 0.0f);
+                if(mode.second == PatchBlending::LINEAR) {
+                    // Linear weights are (16 - x)/9 for the first and (x - 7)/9 for the second patch
+                    REQUIRE(value == Approx(100.0f*(16 - x)/9.0f));
+                }
+                REQUIRE(value == Approx(access->getScalar(Vector2i(x, 0))));
+                previous = value;
+            }
+        }
+        // The overlap is symmetric, thus the middle of it is the average of the two patches
+        CHECK(access->getScalar(Vector2i(11, 5)) + access->getScalar(Vector2i(12, 5)) == Approx(100.0f));
+    }
+}
+
+TEST_CASE("Benchmark patch stitcher crop and blend", "[fast][volume][PatchStitcher][benchmark][.]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    auto importer = ImageFileImporter::New();
+    importer->setFilename(Config::getTestDataPath() + "/CT/CT-Thorax.mhd");
+    auto volume = importer->updateAndGetOutputData<Image>();
+
+    std::map<std::string, PatchBlending> modes = {
+            {"crop", PatchBlending::CROP},
+            {"linear", PatchBlending::LINEAR},
+            {"gaussian", PatchBlending::GAUSSIAN},
+    };
+    for(int overlap : {0, 8, 16}) {
+        for(auto&& mode : modes) {
+            double runtime;
+            stitchVolumePatches(volume, overlap, mode.second, runtime);
+            std::cout << "Stitching with overlap " << overlap << " and " << mode.first << " blending: " << runtime << " ms" << std::endl;
+        }
+    }
+}
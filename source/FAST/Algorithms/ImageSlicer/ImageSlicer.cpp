@@ -317,7 +317,6 @@ void ImageSlicer::arbitrarySlicing(Image::pointer input, Image::pointer output)
             cl::NDRange(longestEdgePixels, longestEdgePixels),
             cl::NullRange
     );
-    device->getCommandQueue().finish();
 
 
     AffineTransformation::pointer T = AffineTransformation::New();
@@ -108,7 +108,6 @@ void MeshToSegmentation::execute() {
 				cl::NullRange
 		);
 	}
-    queue.finish();
 }
 
 }
@@ -1,4 +1,6 @@
 #include "InferenceEngine.hpp"
+#include "InferenceEngineCache.hpp"
+#include <map>
 
 namespace fast {
 
@@ -85,4 +87,28 @@ int InferenceEngine::getMaxBatchSize() {
     return m_maxBatchSize;
 }
 
+std::vector<std::string> InferenceEngine::getModelFilenames() const {
+    return {getFilename()};
+}
+
+std::string InferenceEngine::getModelHash() const {
+    if(getFilename().empty())
+        return InferenceEngineCache::getHash(m_model) + InferenceEngineCache::getHash(m_weights);
+
+    std::string hash;
+    for(auto&& filename : getModelFilenames())
+        hash += InferenceEngineCache::getFileHash(filename);
+    return hash;
+}
+
+std::string InferenceEngine::getCacheKey(std::string device) const {
+    std::string key = getName() + ";" + getModelHash() + ";" + device + ";";
+    // Sort nodes by name, so that the key doesn't depend on the order of the hash map
+    std::map<std::string, NetworkNode> inputNodes(mInputNodes.begin(), mInputNodes.end());
+    for(auto&& node : inputNodes)
+        key += node.first + node.second.shape.toString() + ";";
+    key += std::to_string(m_maxBatchSize);
+    return key;
+}
+
 }
\ No newline at end of file
@@ -95,6 +95,20 @@ class FAST_EXPORT InferenceEngine : public Object {
         virtual void setMaxBatchSize(int size);
     protected:
         virtual void setIsLoaded(bool loaded);
+        /**
+         * Files the model consists of. Default is the filename given to the engine.
+         */
+        virtual std::vector<std::string> getModelFilenames() const;
+        /**
+         * Hash of the contents of the model files, or of the model and weights given with setModelAndWeights.
+         */
+        virtual std::string getModelHash() const;
+        /**
+         * Key identifying the network this engine loads in the InferenceEngineCache. It contains the engine name,
+         * model hash, device, input node shapes and max batch size.
+         * @param device Name of the device the network is loaded for
+         */
+        virtual std::string getCacheKey(std::string device) const;
 
         std::unordered_map<std::string, NetworkNode> mInputNodes;
         std::unordered_map<std::string, NetworkNode> mOutputNodes;
@@ -0,0 +1,102 @@
+#include "InferenceEngineCache.hpp"
+#include <FAST/Config.hpp>
+#include <FAST/Utility.hpp>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace fast {
+
+// The cache is never deleted, since networks may depend on libraries, such as CUDA, which may already be shut down
+// when static objects are deleted at exit.
+static std::mutex& getCacheMutex() {
+    static auto mutex = new std::mutex();
+    return *mutex;
+}
+
+static std::unordered_map<std::string, std::shared_ptr<void>>& getCache() {
+    static auto cache = new std::unordered_map<std::string, std::shared_ptr<void>>();
+    return *cache;
+}
+
+// FNV-1a
+static uint64_t hashBytes(const char* data, std::size_t size, uint64_t hash = 14695981039346656037ULL) {
+    for(std::size_t i = 0; i < size; ++i) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string toHexString(uint64_t hash) {
+    std::stringstream stream;
+    stream << std::hex << std::setfill('0') << std::setw(16) << hash;
+    return stream.str();
+}
+
+std::shared_ptr<InferenceEngineCache::Entry> InferenceEngineCache::getEntry(const std::string& key) {
+    std::lock_guard<std::mutex> lock(getCacheMutex());
+    auto& cache = getCache();
+    if(cache.count(key) == 0)
+        cache[key] = std::make_shared<Entry>();
+    return std::static_pointer_cast<Entry>(cache[key]);
+}
+
+bool InferenceEngineCache::contains(const std::string& key) {
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(getCacheMutex());
+        auto& cache = getCache();
+        if(cache.count(key) == 0)
+            return false;
+        entry = std::static_pointer_cast<Entry>(cache[key]);
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    return (bool)entry->network;
+}
+
+void InferenceEngineCache::clear() {
+    std::lock_guard<std::mutex> lock(getCacheMutex());
+    getCache().clear();
+}
+
+std::string InferenceEngineCache::getFileHash(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+        throw FileNotFoundException(filename);
+    const std::size_t fileSize = file.tellg();
+    const std::string version = getModifiedDate(filename) + std::to_string(fileSize);
+
+    // Remember hashes, since models can be large
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::pair<std::string, std::string>> hashes;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(hashes.count(filename) > 0 && hashes[filename].first == version)
+            return hashes[filename].second;
+    }
+
+    file.seekg(0);
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<char> buffer(1024*1024);
+    while(file) {
+        file.read(buffer.data(), buffer.size());
+        hash = hashBytes(buffer.data(), file.gcount(), hash);
+    }
+    const std::string result = toHexString(hash);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hashes[filename] = std::make_pair(version, result);
+    }
+    return result;
+}
+
+std::string InferenceEngineCache::getHash(const std::vector<uint8_t>& data) {
+    return toHexString(hashBytes((const char*)data.data(), data.size()));
+}
+
+std::string InferenceEngineCache::getDiskCacheFilename(const std::string& key, const std::string& extension) {
+    return join(Config::getKernelBinaryPath(), "network_" + toHexString(hashBytes(key.c_str(), key.size())) + extension);
+}
+
+}
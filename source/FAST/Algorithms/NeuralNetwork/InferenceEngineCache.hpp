@@ -0,0 +1,87 @@
+#pragma once
+
+#include <FAST/Object.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fast {
+
+/**
+ * A purely static class which keeps loaded networks for the entire process, so that inference engines loading
+ * the same network don't have to load and compile it again. This makes restarting a pipeline, or running several
+ * pipelines with the same network, cheap.
+ *
+ * What a cached network is depends on the engine, e.g. a compiled TensorRT engine or an OpenVINO executable network.
+ * It must be possible to share it between engine instances, thus per instance state, such as TensorRT execution
+ * contexts and OpenVINO infer requests, should not be cached.
+ *
+ * Keys should contain everything the loaded network depends on, see InferenceEngine::getCacheKey.
+ * Engines can also store compiled networks on disk, see getDiskCacheFilename.
+ */
+class FAST_EXPORT InferenceEngineCache {
+    public:
+        /**
+         * Get a network from the cache, or create it with the given function if it isn't cached.
+         * If several threads ask for the same key at the same time, the network is only created once.
+         * If create throws, nothing is cached, and the exception is passed on.
+         * @tparam T type of network
+         * @param key
+         * @param create function which loads the network
+         * @return network
+         */
+        template <class T>
+        static std::shared_ptr<T> getOrCreate(const std::string& key, std::function<std::shared_ptr<T>()> create);
+        /**
+         * Check if a network with the given key is cached
+         * @param key
+         */
+        static bool contains(const std::string& key);
+        /**
+         * Remove all networks from the cache. Networks still used by engines are kept alive until those engines
+         * are deleted.
+         */
+        static void clear();
+        /**
+         * Hash of the contents of a file. Hashes are remembered until the modified date of the file changes.
+         * @param filename
+         * @return hash as a hexadecimal string
+         */
+        static std::string getFileHash(const std::string& filename);
+        /**
+         * @param data
+         * @return hash as a hexadecimal string
+         */
+        static std::string getHash(const std::vector<uint8_t>& data);
+        /**
+         * Filename to use for storing a compiled network on disk. The file is placed in the kernel binary path.
+         * Since the key identifies the network and model contents, a file which exists is always up to date.
+         * @param key
+         * @param extension
+         */
+        static std::string getDiskCacheFilename(const std::string& key, const std::string& extension);
+    private:
+        struct Entry {
+            std::mutex mutex;
+            std::shared_ptr<void> network;
+        };
+        static std::shared_ptr<Entry> getEntry(const std::string& key);
+};
+
+template <class T>
+std::shared_ptr<T> InferenceEngineCache::getOrCreate(const std::string& key, std::function<std::shared_ptr<T>()> create) {
+    auto entry = getEntry(key);
+    // Only this entry is locked while creating, so that different networks can be loaded at the same time
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if(entry->network) {
+        Reporter::info() << "Using cached network " << key << Reporter::end();
+        return std::static_pointer_cast<T>(entry->network);
+    }
+    auto network = create();
+    entry->network = network;
+    return network;
+}
+
+}
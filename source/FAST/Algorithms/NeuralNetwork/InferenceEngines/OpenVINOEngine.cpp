@@ -1,11 +1,27 @@
 #include "OpenVINOEngine.hpp"
 #include <inference_engine.hpp>
 #include <FAST/Utility.hpp>
+#include <FAST/Algorithms/NeuralNetwork/InferenceEngineCache.hpp>
+#include <cstdio>
 
 namespace fast {
 
 using namespace InferenceEngine;
 
+/**
+ * An executable network with its nodes, which can be shared by several engines
+ */
+struct OpenVINONetwork {
+    struct Node {
+        std::string name;
+        NodeType type;
+        TensorShape shape;
+    };
+    ExecutableNetwork executableNetwork;
+    std::vector<Node> inputNodes;
+    std::vector<Node> outputNodes;
+};
+
 void OpenVINOEngine::run() {
 	try {
 		// Copy input data
@@ -48,9 +64,42 @@ void OpenVINOEngine::run() {
 	}
 }
 
-void OpenVINOEngine::loadPlugin(std::string deviceName) {
+std::shared_ptr<OpenVINONetwork> OpenVINOEngine::compileNetwork(std::string deviceName, std::string key) {
+    auto result = std::make_shared<OpenVINONetwork>();
+    std::map<std::string, std::string> config;
+    if(m_maxBatchSize > 1)
+        config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
 
-    reportInfo() << "OpenVINO: Inference plugin setup complete for device type " << deviceName << reportEnd();
+    // Compiled networks are stored with the model hash in the name, thus an existing file is always up to date
+    const std::string blobFilename = InferenceEngineCache::getDiskCacheFilename(key, ".blob");
+    if(fileExists(blobFilename)) {
+        try {
+            result->executableNetwork = m_inferenceCore->ImportNetwork(blobFilename, deviceName, config);
+            for(auto& input : result->executableNetwork.GetInputsInfo()) {
+                TensorShape shape;
+                for(auto dim : input.second->getTensorDesc().getDims())
+                    shape.addDimension(dim);
+                // The network was compiled for the max batch size, while the nodes have the batch size of the model
+                if(m_maxBatchSize > 1 && shape.getDimensions() > 0)
+                    shape[0] = 1;
+                auto layout = input.second->getLayout();
+                result->inputNodes.push_back({input.first, layout == Layout::NCHW || layout == Layout::NCDHW ? NodeType::IMAGE : NodeType::TENSOR, shape});
+            }
+            for(auto& output : result->executableNetwork.GetOutputsInfo()) {
+                TensorShape shape;
+                for(auto dim : output.second->getDims())
+                    shape.addDimension(dim);
+                if(m_maxBatchSize > 1 && shape.getDimensions() > 0)
+                    shape[0] = 1;
+                result->outputNodes.push_back({output.first, NodeType::TENSOR, shape});
+            }
+            reportInfo() << "OpenVINO: Imported compiled network " << blobFilename << reportEnd();
+            return result;
+        } catch(::InferenceEngine::details::InferenceEngineException &e) {
+            reportWarning() << "OpenVINO: Failed to import compiled network " << blobFilename << ", compiling it again: " << e.what() << reportEnd();
+            result = std::make_shared<OpenVINONetwork>();
+        }
+    }
 
     // --------------------------- 2. Read IR Generated by ModelOptimizer (.xml and .bin files) ------------
     auto input_model = getFilename();
@@ -70,7 +119,6 @@ void OpenVINOEngine::loadPlugin(std::string deviceName) {
     reportInfo() << "OpenVINO: Network loaded." << reportEnd();
 
     // --------------------------- Prepare input blobs -----------------------------------------------------
-    int counter = 0;
     for(auto& input : network.getInputsInfo()) {
         auto input_info = input.second;
         auto input_name = input.first;
@@ -84,16 +132,13 @@ void OpenVINOEngine::loadPlugin(std::string deviceName) {
         }
 
         if(input_info->getLayout() == Layout::NCHW || input_info->getLayout() == Layout::NCDHW) {
-            addInputNode(counter, input_name, NodeType::IMAGE, shape);
+            result->inputNodes.push_back({input_name, NodeType::IMAGE, shape});
         } else {
-            addInputNode(counter, input_name, NodeType::TENSOR, shape);
+            result->inputNodes.push_back({input_name, NodeType::TENSOR, shape});
         }
-        reportInfo() << "Found input node: " << input_name << " with shape " << shape.toString() << reportEnd();
-        counter++;
     }
 
     // --------------------------- Prepare output blobs ----------------------------------------------------
-    counter = 0;
     for(auto& output : network.getOutputsInfo()) {
         auto info = output.second;
         auto name = output.first;
@@ -101,31 +146,68 @@ void OpenVINOEngine::loadPlugin(std::string deviceName) {
         TensorShape shape;
         for(auto dim : info->getDims())
             shape.addDimension(dim);
-        addOutputNode(counter, name, NodeType::TENSOR, shape);
-        reportInfo() << "Found output node: " << name << " with shape " << shape.toString() << reportEnd();
-        counter++;
+        result->outputNodes.push_back({name, NodeType::TENSOR, shape});
     }
-    reportInfo() << "OpenVINO: Node setup complete." << reportEnd();
 
-    std::map<std::string, std::string> config;
-    if(m_maxBatchSize > 1) {
-        config[PluginConfigParams::KEY_DYN_BATCH_ENABLED] = PluginConfigParams::YES;
+    if(m_maxBatchSize > 1)
         network.setBatchSize(m_maxBatchSize);
+
+    result->executableNetwork = m_inferenceCore->LoadNetwork(network, deviceName, config);
+
+    // Store the compiled network on disk. Not all devices support this. Write to a temporary file first, so that
+    // other processes never read a partially written file.
+    try {
+        const std::string temporaryFilename = blobFilename + ".tmp";
+        result->executableNetwork.Export(temporaryFilename);
+        std::remove(blobFilename.c_str());
+        if(std::rename(temporaryFilename.c_str(), blobFilename.c_str()) != 0)
+            reportWarning() << "OpenVINO: Failed to store compiled network " << blobFilename << reportEnd();
+    } catch(::InferenceEngine::details::InferenceEngineException &e) {
+        reportInfo() << "OpenVINO: Device " << deviceName << " doesn't support storing compiled networks: " << e.what() << reportEnd();
     }
 
-    ExecutableNetwork executable_network = m_inferenceCore->LoadNetwork(network, deviceName, config);
+    return result;
+}
+
+void OpenVINOEngine::loadPlugin(std::string deviceName) {
+
+    reportInfo() << "OpenVINO: Inference plugin setup complete for device type " << deviceName << reportEnd();
+
+    const std::string key = getCacheKey(deviceName);
+    m_network = InferenceEngineCache::getOrCreate<OpenVINONetwork>(key, [&]() {
+        return compileNetwork(deviceName, key);
+    });
+
+    int counter = 0;
+    for(auto&& node : m_network->inputNodes) {
+        addInputNode(counter, node.name, node.type, node.shape);
+        reportInfo() << "Found input node: " << node.name << " with shape " << node.shape.toString() << reportEnd();
+        counter++;
+    }
+    counter = 0;
+    for(auto&& node : m_network->outputNodes) {
+        addOutputNode(counter, node.name, node.type, node.shape);
+        reportInfo() << "Found output node: " << node.name << " with shape " << node.shape.toString() << reportEnd();
+        counter++;
+    }
+    reportInfo() << "OpenVINO: Node setup complete." << reportEnd();
 
-    m_inferRequest = executable_network.CreateInferRequestPtr();
+    // Each engine needs its own infer request, since the request holds the state of an inference
+    m_inferRequest = m_network->executableNetwork.CreateInferRequestPtr();
     setIsLoaded(true);
     reportInfo() << "OpenVINO: Network fully loaded." << reportEnd();
 }
 
 void OpenVINOEngine::load() {
-    m_inferenceCore = std::make_shared<Core>();
-    auto devices = m_inferenceCore->GetAvailableDevices();
-    reportInfo() << "Available OpenVINO devices:" << reportEnd();
-    for(auto&& device : devices)
-        reportInfo() << device << reportEnd();
+    // One core for the process, since creating it finds and initializes all devices
+    m_inferenceCore = InferenceEngineCache::getOrCreate<Core>("OpenVINO core", [this]() {
+        auto core = std::make_shared<Core>();
+        auto devices = core->GetAvailableDevices();
+        reportInfo() << "Available OpenVINO devices:" << reportEnd();
+        for(auto&& device : devices)
+            reportInfo() << device << reportEnd();
+        return core;
+    });
     if(m_deviceType == InferenceDeviceType::ANY) {
         try {
             loadPlugin("GPU");
@@ -173,6 +255,12 @@ std::string OpenVINOEngine::getDefaultFileExtension() const {
     return "xml";
 }
 
+std::vector<std::string> OpenVINOEngine::getModelFilenames() const {
+    // The weights are stored in a .bin file next to the .xml file
+    auto filename = getFilename();
+    return {filename, filename.substr(0, filename.rfind('.')) + ".bin"};
+}
+
 OpenVINOEngine::~OpenVINOEngine() {
     //if(m_inferState != nullptr)
     //    delete m_inferState;
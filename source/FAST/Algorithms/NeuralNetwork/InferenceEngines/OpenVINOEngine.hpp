@@ -10,6 +10,8 @@ class Core;
 
 namespace fast {
 
+struct OpenVINONetwork;
+
 class INFERENCEENGINEOPENVINO_EXPORT OpenVINOEngine : public InferenceEngine {
     FAST_OBJECT(OpenVINOEngine)
     public:
@@ -24,12 +26,17 @@ class INFERENCEENGINEOPENVINO_EXPORT OpenVINOEngine : public InferenceEngine {
 		std::string getDefaultFileExtension() const override;
 
         ~OpenVINOEngine();
+    protected:
+        std::vector<std::string> getModelFilenames() const override;
     private:
         std::shared_ptr<::InferenceEngine::Core> m_inferenceCore;
+        // Shared with other engines loading the same network, see InferenceEngineCache
+        std::shared_ptr<OpenVINONetwork> m_network;
         // This has to be last, because then inferRequest will be deleted before the plugin, which is necessary to avoid a crash on delete
         std::shared_ptr<::InferenceEngine::InferRequest> m_inferRequest;
 		
         void loadPlugin(std::string deviceType);
+        std::shared_ptr<OpenVINONetwork> compileNetwork(std::string deviceType, std::string key);
 };
 
 DEFINE_INFERENCE_ENGINE(OpenVINOEngine, INFERENCEENGINEOPENVINO_EXPORT)
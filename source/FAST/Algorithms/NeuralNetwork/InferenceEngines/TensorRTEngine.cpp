@@ -6,6 +6,8 @@
 #include <FAST/Utility.hpp>
 #include <fstream>
 #include <FAST/Config.hpp>
+#include <FAST/Algorithms/NeuralNetwork/InferenceEngineCache.hpp>
+#include <cstdio>
 
 #define CUDA_CHECK(status)                             \
     do                                            \
@@ -185,31 +187,26 @@ void TensorRTEngine::load() {
         throw Exception("Input and output nodes must be defined before loading Uff files using the TensorRT engine");
 
     const auto filename = getFilename();
-    std::size_t hash = std::hash<std::string>{}(filename + std::to_string(m_maxBatchSize)); // Hash the full filename any other parameters
-    std::string serializedBinaryFilename = join(Config::getKernelBinaryPath(), filename.substr(filename.rfind('/')) + "_" + std::to_string(hash) + ".bin");
-    std::string serializedCacheFilename = join(Config::getKernelBinaryPath(), filename.substr(filename.rfind('/')) + "_" + std::to_string(hash) + ".cache");
-    bool loadSerializedFile = false;
-    if(fileExists(serializedCacheFilename) && fileExists(serializedBinaryFilename)) {
-        // Check if date is modified or not
-        std::ifstream file(serializedCacheFilename.c_str());
-        if(file.fail())
-            throw Exception("Failed to read " + serializedCacheFilename);
-        std::string line = "";
-        std::getline(file, line);
-        trim(line);
-        std::string modifiedDate = getModifiedDate(filename);
-        trim(modifiedDate);
-        if(line == modifiedDate) {
-            reportInfo() << "Serialized file " << serializedBinaryFilename << " is up to date." << reportEnd();
-            loadSerializedFile = true;
-        } else {
-            reportInfo() << "Serialized file " << serializedBinaryFilename << " was not up to date." << reportEnd();
+    if(!fileExists(filename))
+        throw FileNotFoundException(filename);
+    const std::string key = getCacheKey("CUDA" + std::to_string(m_deviceIndex));
+    m_engine = InferenceEngineCache::getOrCreate<nvinfer1::ICudaEngine>(key, [&]() {
+        // Serialized plans are stored with the model hash in the name, thus an existing plan is always up to date
+        const std::string serializedBinaryFilename = InferenceEngineCache::getDiskCacheFilename(key, ".plan");
+        if(fileExists(serializedBinaryFilename)) {
+            reportInfo() << "Loading serialized TensorRT plan " << serializedBinaryFilename << reportEnd();
+            std::unique_ptr<nvinfer1::IRuntime, decltype(Destroy())> runtime(nvinfer1::createInferRuntime(gLogger), Destroy());
+            // Read serialized model from disk
+            std::ifstream ifile(serializedBinaryFilename.c_str(), std::ios::binary);
+            std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(ifile), {});
+            ifile.close();
+            // Deserialize the model data
+            auto engine = runtime->deserializeCudaEngine(buffer.data(), buffer.size(), nullptr);
+            if(engine)
+                return std::shared_ptr<nvinfer1::ICudaEngine>(engine, Destroy());
+            reportWarning() << "Failed to deserialize TensorRT plan " << serializedBinaryFilename << ", building it again" << reportEnd();
         }
-    }
-    if(!loadSerializedFile) {
-        // File is not serialized: Create it
-        if(!fileExists(filename))
-            throw FileNotFoundException(filename);
+
         reportInfo() << "Loading file " << filename << " using TensorRT" << reportEnd();
         std::unique_ptr<nvinfer1::IBuilder, decltype(Destroy())> builder(nvinfer1::createInferBuilder(gLogger),
                                                                          Destroy());
@@ -252,31 +249,26 @@ void TensorRTEngine::load() {
         std::unique_ptr<nvinfer1::IBuilderConfig, decltype(Destroy())> config(builder->createBuilderConfig(), Destroy());
         config->setMaxWorkspaceSize(m_maxWorkspaceSize);
 
-        m_engine = builder->buildEngineWithConfig(*network, *config);
-        if(!m_engine)
+        auto engine = builder->buildEngineWithConfig(*network, *config);
+        if(!engine)
             throw Exception("Failed to build CUDA engine for TensorRT");
         reportInfo() << "Finished building CUDA engine for TensorRT" << reportEnd();
 
-        // Serialize the model
-        std::unique_ptr<nvinfer1::IHostMemory, decltype(Destroy())> serializedModel(m_engine->serialize(), Destroy());
-        // Store model to disk
-        std::ofstream ofile(serializedBinaryFilename.c_str(), std::ios::binary);
+        // Serialize the model and store it to disk. Write to a temporary file first, so that other processes
+        // never read a partially written plan.
+        std::unique_ptr<nvinfer1::IHostMemory, decltype(Destroy())> serializedModel(engine->serialize(), Destroy());
+        const std::string temporaryFilename = serializedBinaryFilename + ".tmp";
+        std::ofstream ofile(temporaryFilename.c_str(), std::ios::binary);
         ofile.write((char *) serializedModel->data(), serializedModel->size());
         ofile.close();
-        std::ofstream ofileCache(serializedCacheFilename.c_str());
-        std::string modifiedDate = getModifiedDate(filename);
-        ofileCache.write(modifiedDate.c_str(), modifiedDate.size());
-        ofileCache.close();
-    } else {
-        std::unique_ptr<nvinfer1::IRuntime, decltype(Destroy())> runtime(nvinfer1::createInferRuntime(gLogger), Destroy());
-        // Read serialized model from disk
-        std::ifstream ifile(serializedBinaryFilename.c_str(), std::ios::binary);
-        std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(ifile), {});
-        ifile.close();
-        // Deserialize the model data
-        m_engine = runtime->deserializeCudaEngine(buffer.data(), buffer.size(), nullptr);
-    }
+        std::remove(serializedBinaryFilename.c_str());
+        if(std::rename(temporaryFilename.c_str(), serializedBinaryFilename.c_str()) != 0)
+            reportWarning() << "Failed to store serialized TensorRT plan " << serializedBinaryFilename << reportEnd();
+
+        return std::shared_ptr<nvinfer1::ICudaEngine>(engine, Destroy());
+    });
 
+    // Each engine needs its own execution context, since the context holds the state of an inference
     m_context = m_engine->createExecutionContext();
     setIsLoaded(true);
 }
@@ -286,8 +278,7 @@ ImageOrdering TensorRTEngine::getPreferredImageOrdering() const {
 }
 
 TensorRTEngine::~TensorRTEngine() {
-    if(m_engine != nullptr)
-        m_engine->destroy();
+    // The context must be destroyed before the engine, which is released after this when no other engine uses it
     if(m_context != nullptr)
         m_context->destroy();
     //nvuffparser::shutdownProtobufLibrary(); // This cannot be called twice in the same program. Maybe use atexit instead?
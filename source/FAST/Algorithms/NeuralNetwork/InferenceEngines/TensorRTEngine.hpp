@@ -23,7 +23,8 @@ class INFERENCEENGINETENSORRT_EXPORT TensorRTEngine : public InferenceEngine {
         int getMaxBatchSize() const;
         TensorRTEngine();
     private:
-        nvinfer1::ICudaEngine* m_engine = nullptr;
+        // Shared with other engines loading the same network, see InferenceEngineCache
+        std::shared_ptr<nvinfer1::ICudaEngine> m_engine;
         nvinfer1::IExecutionContext* m_context = nullptr;
         std::size_t m_maxWorkspaceSize = 128*1024*1024; // in bytes
 };
@@ -12,8 +12,11 @@ __kernel void normalize2DInput(
 	__private float minIntensity,
 	__private float maxIntensity,
 	__private int clipIntensity,
-	__private int channelFirst
+	__private int channelFirst,
+	__private int outputOffset
 	) {
+	// Offset of this image in the output buffer, which may contain a batch of images
+	output += outputOffset;
 	
 	const int2 pos = {get_global_id(0), get_global_id(1)};
 	const int dataType = get_image_channel_data_type(input);
@@ -75,8 +78,11 @@ __kernel void normalize3DInput(
 	__private float minIntensity,
 	__private float maxIntensity,
 	__private int clipIntensity,
-	__private int channelFirst
+	__private int channelFirst,
+	__private int outputOffset
 	) {
+	// Offset of this image in the output buffer, which may contain a batch of images
+	output += outputOffset;
 
 	const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
 	const int dataType = get_image_channel_data_type(input);
@@ -2,6 +2,7 @@
 #include "FAST/Data/Image.hpp"
 #include "FAST/Data/Tensor.hpp"
 #include "FAST/Algorithms/ImageResizer/ImageResizer.hpp"
+#include "FAST/Streamers/Streamer.hpp"
 #include "InferenceEngineManager.hpp"
 
 
@@ -67,6 +68,23 @@ std::unordered_map<std::string, Tensor::pointer> NeuralNetwork::processInputData
         SharedPointer<DataObject> data = getInputData<DataObject>(inputNode.second.portID);
         mRuntimeManager->startRegularTimer("input_processing");
 
+        // Check if this data was converted while the previous frame was inferred
+        if(m_prefetchedInputs.count(inputNode.first) > 0) {
+            auto prefetched = m_prefetchedInputs[inputNode.first];
+            m_prefetchedInputs.erase(inputNode.first);
+            if(prefetched.data == data) {
+                mInputImages[inputNode.first] = prefetched.images;
+                mNewInputSpacing = prefetched.spacing;
+                m_batchSize = prefetched.batchSize;
+                tensors[inputNode.first] = finishInputBuffer(prefetched.inputBuffer);
+                mRuntimeManager->stopRegularTimer("input_processing");
+                continue;
+            }
+            // Frames have been skipped, discard the prefetched data
+            finishInputBuffer(prefetched.inputBuffer);
+            prefetched.inputBuffer->inUse = false;
+        }
+
         bool containsSequence = false;
         // Check if data object is an tensor by doing a dynamic cast
         Tensor::pointer tensor = std::dynamic_pointer_cast<Tensor>(data);
@@ -81,6 +99,25 @@ std::unordered_map<std::string, Tensor::pointer> NeuralNetwork::processInputData
             if(batch) {
                 Batch::access access = batch->getAccess(ACCESS_READ);
                 auto dataList = access->getData();
+                if(dataList.hasBatchTensor()) {
+                    // Images have already been converted to a tensor for the engine, use it directly
+                    auto batchTensor = dataList.getBatchTensor();
+                    auto batchShape = batchTensor->getShape();
+                    if(batchShape.getDimensions() != shape.getDimensions())
+                        throw Exception("Batch tensor " + batchShape.toString() + " doesn't match input node shape " + shape.toString());
+                    for(int i = 1; i < shape.getDimensions(); ++i) {
+                        if(shape[i] >= 0 && shape[i] != batchShape[i])
+                            throw Exception("Batch tensor " + batchShape.toString() + " doesn't match input node shape " + shape.toString());
+                    }
+                    if(m_batchSize != -1 && m_batchSize != dataList.getSize())
+                        throw Exception("Inconsistent batch size accross input nodes");
+                    m_batchSize = dataList.getSize();
+                    mInputImages[inputNode.first] = dataList.getImages();
+                    mNewInputSpacing = dataList.getImages().front()->getSpacing();
+                    tensors[inputNode.first] = batchTensor;
+                    mRuntimeManager->stopRegularTimer("input_processing");
+                    continue;
+                }
                 if(dataList.isImages()) {
                     inputImages = dataList.getImages();
                 } else {
@@ -140,26 +177,8 @@ std::unordered_map<std::string, Tensor::pointer> NeuralNetwork::processInputData
                 mInputImages[inputNode.first] = inputImages;
 
                 // Resize images to fit input
-                const int dims = shape.getDimensions();
-                int height = shape[dims - 3];
-                int width = shape[dims - 2];
-                if(m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelFirst) {
-                    height = shape[dims - 2];
-                    width = shape[dims - 1];
-                }
-                int depth = 1;
-                int timesteps = 0;
-                if(containsSequence) {
-                    // Temporal input
-                    timesteps = shape[1];
-                    if(dims == 6) // 3D
-                        depth = m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelLast ? shape[dims - 4] : shape[
-                                dims - 3];
-                } else {
-                    if(dims == 5) // 3D
-                        depth = m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelLast ? shape[dims - 4] : shape[
-                                dims - 3];
-                }
+                int width, height, depth;
+                getInputImageSize(shape, containsSequence, width, height, depth);
                 auto inputImages2 = resizeImages(inputImages, width, height, depth);
 
                 // Convert images to tensors
@@ -205,10 +224,17 @@ void NeuralNetwork::run() {
         m_engine->setInputData(node.first, inputTensors[node.first]);
     }
 
+    // Start converting the next frame, so that it runs while this frame is inferred
+    if(m_asynchronousInputConversion)
+        prefetchInputData();
+
 	// Run network
     mRuntimeManager->startRegularTimer("inference");
 	m_engine->run();
     mRuntimeManager->stopRegularTimer("inference");
+
+    // The engine has consumed the input tensors, so their buffers can be reused
+    releaseInputBuffers();
 }
 
 void NeuralNetwork::execute() {
@@ -223,10 +249,8 @@ void NeuralNetwork::execute() {
         auto tensor = m_engine->getOutputData(node.first);
 
         if(m_batchSize > 1) {
-            // Create a batch of tensors
+            // Create a batch of tensors, which are views of the output tensor, thus nothing is copied
             std::vector<Tensor::pointer> tensorList;
-            auto tensorAccess = tensor->getAccess(ACCESS_READ);
-            const float* rawTensorData = tensorAccess->getRawData();
             // Calculate sample size
             auto shape = tensor->getShape();
             int size = 1;
@@ -238,9 +262,7 @@ void NeuralNetwork::execute() {
 
             for(int i = 0; i < m_batchSize; ++i) {
                 auto newTensor = Tensor::New();
-                auto newData = make_uninitialized_unique<float[]>(size);
-                std::memcpy(newData.get(), &(rawTensorData[i*size]), size*sizeof(float));
-                newTensor->create(std::move(newData), newShape);
+                newTensor->create(tensor, (std::size_t)i*size, newShape);
                 tensorList.push_back(newTensor);
                 for(auto& inputNode : m_engine->getInputNodes()) {
                     // TODO assuming input are images here:
@@ -272,12 +294,13 @@ void NeuralNetwork::execute() {
 }
 
 Tensor::pointer NeuralNetwork::convertImagesToTensor(std::vector<Image::pointer> images, const TensorShape& shape, bool temporal) {
+    return finishInputBuffer(enqueueImagesToTensor(images, shape, temporal));
+}
+
+SharedPointer<NeuralNetwork::InputBuffer> NeuralNetwork::enqueueImagesToTensor(std::vector<Image::pointer> images, const TensorShape& shape, bool temporal) {
     if(shape.getUnknownDimensions() > 0)
         throw Exception("Shape must be known at this time");
 
-    // Create input tensor
-    auto values = make_uninitialized_unique<float[]>(shape.getTotalSize());
-
     OpenCLDevice::pointer device = std::dynamic_pointer_cast<OpenCLDevice>(getMainDevice());
     cl::Program program = getOpenCLProgram(device);
     int depth = 1;
@@ -315,10 +338,8 @@ Tensor::pointer NeuralNetwork::convertImagesToTensor(std::vector<Image::pointer>
             depth = shape[dims - 4];
         }
     }
-    cl::Kernel kernel(program, kernelName.c_str());
-    const std::size_t size = width*height*depth*channels; // nr of elements per image
-    for(int i = 0; i < images.size(); ++i) {
-        auto image = images[i];
+    std::vector<OpenCLImageAccess::pointer> accesses;
+    for(auto&& image : images) {
         if(image->getWidth() != width ||
             image->getHeight() != height ||
             image->getDepth() != depth)
@@ -329,13 +350,24 @@ Tensor::pointer NeuralNetwork::convertImagesToTensor(std::vector<Image::pointer>
         if(image->getNrOfChannels() != channels)
             throw Exception("Input image sent to executeNetwork has incorrect nr of channels: " +
                     std::to_string(image->getNrOfChannels())+ ". Expected: " + std::to_string(channels) + ".");
-        OpenCLImageAccess::pointer access = image->getOpenCLImageAccess(ACCESS_READ, device);
-        cl::Buffer buffer(
-                device->getContext(),
-                CL_MEM_WRITE_ONLY,
-                sizeof(float) * size
-        );
-        kernel.setArg(1, buffer);
+        accesses.push_back(image->getOpenCLImageAccess(ACCESS_READ, device));
+    }
+
+    // Normalization runs on a separate queue, so that it can overlap with other work on the device.
+    // The input images may have been written by kernels on the default queue, thus wait for those to finish.
+    if(m_inputQueue() == nullptr || m_inputQueueDevice != device) {
+        m_inputQueue = cl::CommandQueue(device->getContext(), device->getDevice());
+        m_inputQueueDevice = device;
+    }
+    std::vector<cl::Event> waitList(1);
+    device->getCommandQueue().enqueueMarkerWithWaitList(nullptr, &waitList[0]);
+
+    auto inputBuffer = getInputBuffer(shape, device);
+    cl::Kernel kernel(program, kernelName.c_str());
+    const std::size_t size = width*height*depth*channels; // nr of elements per image
+    for(int i = 0; i < images.size(); ++i) {
+        auto image = images[i];
+        kernel.setArg(1, inputBuffer->buffer);
         kernel.setArg(2, mScaleFactor);
         kernel.setArg(3, mMean);
         kernel.setArg(4, mStd);
@@ -346,30 +378,149 @@ Tensor::pointer NeuralNetwork::convertImagesToTensor(std::vector<Image::pointer>
         kernel.setArg(9, mMaxIntensity);
         kernel.setArg(10, (int)(mMinAndMaxIntensitySet ? 1 : 0));
         kernel.setArg(11, (int)(m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelFirst ? 1 : 0));
+        kernel.setArg(12, (int)(i*size)); // Write directly into slice i of the batch
         cl::NDRange globalSize;
         if(image->getDimensions() == 2) {
-            kernel.setArg(0, *access->get2DImage());
+            kernel.setArg(0, *accesses[i]->get2DImage());
             globalSize = cl::NDRange(width, height);
         } else {
-            kernel.setArg(0, *access->get3DImage());
+            kernel.setArg(0, *accesses[i]->get3DImage());
             globalSize = cl::NDRange(width, height, depth);
         }
 
-        device->getCommandQueue().enqueueNDRangeKernel(
+        m_inputQueue.enqueueNDRangeKernel(
                 kernel,
                 cl::NullRange,
                 globalSize,
-                cl::NullRange
+                cl::NullRange,
+                &waitList
         );
+    }
+
+    // One non-blocking read of the entire batch into the host tensor
+    inputBuffer->access = inputBuffer->tensor->getAccess(ACCESS_READ_WRITE);
+    m_inputQueue.enqueueReadBuffer(inputBuffer->buffer, CL_FALSE, 0, sizeof(float) * size * images.size(),
+                                   inputBuffer->access->getRawData(), nullptr, &inputBuffer->readEvent);
+    m_inputQueue.flush();
+
+    return inputBuffer;
+}
+
+Tensor::pointer NeuralNetwork::finishInputBuffer(SharedPointer<InputBuffer> inputBuffer) {
+    if(inputBuffer->access) {
+        inputBuffer->readEvent.wait();
+        inputBuffer->access->release();
+        inputBuffer->access.reset();
+    }
+    return inputBuffer->tensor;
+}
+
+SharedPointer<NeuralNetwork::InputBuffer> NeuralNetwork::getInputBuffer(const TensorShape& shape, OpenCLDevice::pointer device) {
+    const std::string key = shape.toString();
+    for(auto&& inputBuffer : m_inputBuffers[key]) {
+        if(!inputBuffer->inUse) {
+            inputBuffer->inUse = true;
+            return inputBuffer;
+        }
+    }
+
+    // No free buffer of this shape, create a new one
+    auto inputBuffer = std::make_shared<InputBuffer>();
+    inputBuffer->buffer = cl::Buffer(
+            device->getContext(),
+            CL_MEM_READ_WRITE,
+            sizeof(float) * shape.getTotalSize()
+    );
+    inputBuffer->tensor = Tensor::New();
+    inputBuffer->tensor->create(make_uninitialized_unique<float[]>(shape.getTotalSize()), shape);
+    inputBuffer->inUse = true;
+    m_inputBuffers[key].push_back(inputBuffer);
+    reportInfo() << "Created input buffer nr " << m_inputBuffers[key].size() << " for shape " << key << reportEnd();
+    return inputBuffer;
+}
+
+void NeuralNetwork::releaseInputBuffers() {
+    for(auto&& buffers : m_inputBuffers) {
+        for(auto&& inputBuffer : buffers.second)
+            inputBuffer->inUse = false;
+    }
+    // Prefetched buffers are still in use until the next execute
+    for(auto&& prefetched : m_prefetchedInputs)
+        prefetched.second.inputBuffer->inUse = true;
+}
+
+void NeuralNetwork::prefetchInputData() {
+    auto inputNodes = m_engine->getInputNodes();
+    if(mTemporalWindow > 0 || inputNodes.size() != 1)
+        return;
+    auto inputNode = *inputNodes.begin();
+    const uint portID = inputNode.second.portID;
+    auto port = mInputConnections.at(portID);
+    // Only streamers are guaranteed to add complete data objects to the channel, before this PO retrieves them
+    if(dynamic_cast<Streamer*>(port->getProcessObject().get()) == nullptr || !port->hasCurrentData())
+        return;
+
+    mRuntimeManager->startRegularTimer("input_prefetching");
+    try {
+        DataObject::pointer data = port->getFrame();
+        if(mLastProcessed.count(portID) > 0 && mLastProcessed[portID].first == data) {
+            mRuntimeManager->stopRegularTimer("input_prefetching");
+            return;
+        }
+
+        PrefetchedInput prefetched;
+        prefetched.data = data;
+        prefetched.batchSize = 1;
+        // Only images and batches of images are prefetched
+        auto batch = std::dynamic_pointer_cast<Batch>(data);
+        if(batch) {
+            Batch::access access = batch->getAccess(ACCESS_READ);
+            auto dataList = access->getData();
+            if(dataList.isImages() && !dataList.hasBatchTensor()) {
+                prefetched.images = dataList.getImages();
+                prefetched.batchSize = dataList.getSize();
+            }
+        } else {
+            auto image = std::dynamic_pointer_cast<Image>(data);
+            if(image)
+                prefetched.images = {image};
+        }
+        auto shape = inputNode.second.shape;
+        if(!prefetched.images.empty() && shape.getDimensions() >= 4) {
+            int width, height, depth;
+            getInputImageSize(shape, false, width, height, depth);
+            // Resizing sets the input spacing, which is needed when processing the output of the current frame
+            const Vector3f spacing = mNewInputSpacing;
+            auto resizedImages = resizeImages(prefetched.images, width, height, depth);
+            prefetched.spacing = mNewInputSpacing;
+            mNewInputSpacing = spacing;
+
+            shape[0] = prefetched.batchSize;
+            prefetched.inputBuffer = enqueueImagesToTensor(resizedImages, shape, false);
+            m_prefetchedInputs[inputNode.first] = prefetched;
+        }
+    } catch(Exception &e) {
+        // Errors are reported when the frame is processed
+        reportWarning() << "Unable to prefetch input data in NeuralNetwork: " << e.what() << reportEnd();
+    }
+    mRuntimeManager->stopRegularTimer("input_prefetching");
+}
 
-        // Read data directly into slice
-        device->getCommandQueue().enqueueReadBuffer(buffer, CL_TRUE, 0, sizeof(float) * size,
-                                                    values.get() + i*size);
+void NeuralNetwork::getInputImageSize(const TensorShape& shape, bool temporal, int& width, int& height, int& depth) {
+    const int dims = shape.getDimensions();
+    height = shape[dims - 3];
+    width = shape[dims - 2];
+    if(m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelFirst) {
+        height = shape[dims - 2];
+        width = shape[dims - 1];
     }
+    depth = 1;
+    if((temporal && dims == 6) || (!temporal && dims == 5)) // 3D
+        depth = m_engine->getPreferredImageOrdering() == ImageOrdering::ChannelLast ? shape[dims - 4] : shape[dims - 3];
+}
 
-    auto tensor = Tensor::New();
-    tensor->create(std::move(values), shape);
-    return tensor;
+void NeuralNetwork::setAsynchronousInputConversion(bool async) {
+    m_asynchronousInputConversion = async;
 }
 
 std::vector<SharedPointer<Image>> NeuralNetwork::resizeImages(const std::vector<SharedPointer<Image>> &images, int width, int height, int depth) {
@@ -413,6 +564,9 @@ void NeuralNetwork::setSignedInputNormalization(bool signedInputNormalization) {
 }
 
 NeuralNetwork::~NeuralNetwork() {
+    // Wait for any pending reads into the prefetched tensors
+    for(auto&& prefetched : m_prefetchedInputs)
+        finishInputBuffer(prefetched.second.inputBuffer);
 }
 
 void NeuralNetwork::setInputNode(uint portID, std::string name, NodeType type, TensorShape shape) {
@@ -21,6 +21,14 @@ class FAST_EXPORT InferenceDataList {
         explicit InferenceDataList(std::vector<SharedPointer<Tensor>> tensors) {
             m_tensors = tensors;
         }
+        /**
+         * A list of images which have already been converted to one tensor, with the images as the first dimension.
+         * The images are kept for their frame data.
+         */
+        InferenceDataList(std::vector<SharedPointer<Image>> images, SharedPointer<Tensor> batchTensor) {
+            m_images = images;
+            m_batchTensor = batchTensor;
+        }
         InferenceDataList() {
 
         }
@@ -36,14 +44,22 @@ class FAST_EXPORT InferenceDataList {
 
             return m_tensors;
         }
+        SharedPointer<Tensor> getBatchTensor() const {
+            if(!hasBatchTensor())
+                throw Exception("The inference data list has no batch tensor");
+
+            return m_batchTensor;
+        }
         bool isTensors() const { return !m_tensors.empty(); };
         bool isImages() const { return !m_images.empty(); };
+        bool hasBatchTensor() const { return (bool)m_batchTensor; };
         int getSize() const {
             return isImages() ? m_images.size() : m_tensors.size();
         }
     private:
         std::vector<SharedPointer<Image>> m_images;
         std::vector<SharedPointer<Tensor>> m_tensors;
+        SharedPointer<Tensor> m_batchTensor;
 };
 
 class Sequence : public SimpleDataObject<InferenceDataList> {
@@ -69,6 +85,15 @@ class Batch : public SimpleDataObject<InferenceDataList> {
         void create(std::vector<SharedPointer<Tensor>> tensors) {
             mData = InferenceDataList(tensors);
         };
+        /**
+         * Create a batch of images which have already been converted to a tensor, ready to be given to an
+         * inference engine.
+         * @param images
+         * @param batchTensor
+         */
+        void create(std::vector<SharedPointer<Image>> images, SharedPointer<Tensor> batchTensor) {
+            mData = InferenceDataList(images, batchTensor);
+        };
         typedef DataAccess<InferenceDataList>::pointer access;
     private:
         Batch() {};
@@ -141,6 +166,15 @@ class FAST_EXPORT NeuralNetwork : public ProcessObject {
          */
         void setTemporalWindow(uint window);
 
+        /**
+         * Enable double buffered input conversion. When enabled and the input is streamed, the next frame
+         * is normalized and transferred on a separate OpenCL command queue while the current frame is inferred.
+         * Only used for networks with a single image input node and no temporal window.
+         *
+         * @param async
+         */
+        void setAsynchronousInputConversion(bool async);
+
         void loadAttributes();
 
         virtual ~NeuralNetwork();
@@ -165,6 +199,42 @@ class FAST_EXPORT NeuralNetwork : public ProcessObject {
         std::vector<SharedPointer<Image>> resizeImages(const std::vector<SharedPointer<Image>>& images, int width, int height, int depth);
         Tensor::pointer convertImagesToTensor(std::vector<SharedPointer<Image>> image, const TensorShape& shape, bool temporal);
 
+        /**
+         * An OpenCL buffer and host tensor used to convert a batch of images to a tensor.
+         * These are reused between executions, and there are at least two per shape for double buffering.
+         */
+        struct InputBuffer {
+            cl::Buffer buffer;
+            Tensor::pointer tensor;
+            // Kept while the non-blocking read into the tensor is pending
+            TensorAccess::pointer access;
+            cl::Event readEvent;
+            bool inUse = false;
+        };
+        /**
+         * A frame which has been converted ahead of time, while the previous frame was inferred
+         */
+        struct PrefetchedInput {
+            DataObject::pointer data;
+            std::vector<SharedPointer<Image>> images;
+            Vector3f spacing;
+            int batchSize;
+            SharedPointer<InputBuffer> inputBuffer;
+        };
+        bool m_asynchronousInputConversion = false;
+        // Input buffers keyed by tensor shape
+        std::unordered_map<std::string, std::vector<SharedPointer<InputBuffer>>> m_inputBuffers;
+        std::unordered_map<std::string, PrefetchedInput> m_prefetchedInputs;
+        cl::CommandQueue m_inputQueue;
+        OpenCLDevice::pointer m_inputQueueDevice;
+
+        void getInputImageSize(const TensorShape& shape, bool temporal, int& width, int& height, int& depth);
+        SharedPointer<InputBuffer> getInputBuffer(const TensorShape& shape, OpenCLDevice::pointer device);
+        SharedPointer<InputBuffer> enqueueImagesToTensor(std::vector<SharedPointer<Image>> images, const TensorShape& shape, bool temporal);
+        Tensor::pointer finishInputBuffer(SharedPointer<InputBuffer> inputBuffer);
+        void releaseInputBuffers();
+        void prefetchInputData();
+
     private:
         void execute();
 };
@@ -0,0 +1,24 @@
+__kernel void tensorToSegmentation(
+        __global const float* tensor,
+        __global uchar* segmentation,
+        __private int tensorOffset,
+        __private int nrOfClasses,
+        __private float threshold,
+        __private int channelFirst
+) {
+    // The tensor may be a view of a batch, starting at an offset in the buffer
+    tensor += tensorOffset;
+    const int x = get_global_id(0);
+    const int size = get_global_size(0);
+
+    uchar maxClass = 0;
+    float maxValue = channelFirst == 1 ? tensor[x] : tensor[x*nrOfClasses];
+    for(int j = 1; j < nrOfClasses; ++j) {
+        const float value = channelFirst == 1 ? tensor[x + j*size] : tensor[x*nrOfClasses + j];
+        if(value > threshold && value > maxValue) {
+            maxClass = j;
+            maxValue = value;
+        }
+    }
+    segmentation[x] = maxClass;
+}
@@ -1,7 +1,9 @@
 #include <FAST/Data/Tensor.hpp>
 #include <FAST/Data/Image.hpp>
+#include <FAST/Data/Access/OpenCLBufferAccess.hpp>
 #include "TensorToSegmentation.hpp"
 #include "InferenceEngine.hpp"
+#include "NeuralNetwork.hpp"
 
 namespace fast {
 
@@ -19,13 +21,51 @@ inline int getPosition(int x, int nrOfClasses, int j, int size, ImageOrdering or
 }
 
 TensorToSegmentation::TensorToSegmentation() {
-    createInputPort<Tensor>(0);
+    createInputPort<DataObject>(0);
     createOutputPort<Image>(0);
+
+    createOpenCLProgram(Config::getKernelSourcePath() + "Algorithms/NeuralNetwork/TensorToSegmentation.cl");
+    createFloatAttribute("threshold", "Segmentation threshold", "Lower threshold of accepting a label", m_threshold);
+}
+
+void TensorToSegmentation::loadAttributes() {
+    setThreshold(getFloatAttribute("threshold"));
+}
+
+void TensorToSegmentation::setThreshold(float threshold) {
+    m_threshold = threshold;
+    mIsModified = true;
 }
 
 void TensorToSegmentation::execute() {
-    auto tensor = getInputData<Tensor>();
-    auto output = getOutputData<Image>();
+    auto data = getInputData<DataObject>();
+
+    auto batch = std::dynamic_pointer_cast<Batch>(data);
+    if(batch) {
+        auto access = batch->getAccess(ACCESS_READ);
+        std::vector<Image::pointer> images;
+        for(auto&& tensor : access->getData().getTensors()) {
+            auto image = convertToSegmentation(tensor);
+            // Keep frame data of each element, such as patch info
+            for(auto&& frameData : tensor->getFrameData())
+                image->setFrameData(frameData.first, frameData.second);
+            for(auto&& lastFrame : tensor->getLastFrame())
+                image->setLastFrame(lastFrame);
+            images.push_back(image);
+        }
+        auto outputBatch = Batch::New();
+        outputBatch->create(images);
+        addOutputData(0, outputBatch);
+    } else {
+        auto tensor = std::dynamic_pointer_cast<Tensor>(data);
+        if(!tensor)
+            throw BadCastException(data->getNameOfClass(), Tensor::getStaticNameOfClass());
+        addOutputData(0, convertToSegmentation(tensor));
+    }
+}
+
+Image::pointer TensorToSegmentation::convertToSegmentation(Tensor::pointer tensor) {
+    auto output = Image::New();
 
     auto shape = tensor->getShape();
     const int dims = shape.getDimensions();
@@ -37,31 +77,59 @@ void TensorToSegmentation::execute() {
         outputWidth = shape[dims-1];
     }
     int outputDepth = 1;
-    auto access = tensor->getAccess(ACCESS_READ);
-    float* tensorData = access->getRawData();
     if(dims == 5) {
         outputDepth = shape[dims - 4];
     }
     const int size = outputWidth*outputHeight*outputDepth;
+    const int nrOfClasses = ordering == ImageOrdering::ChannelFirst ? shape[0] : shape[dims-1];
 
-    auto data = make_uninitialized_unique<uchar[]>(size);
-    const int nrOfClasses = ordering == ImageOrdering::ChannelFirst ? tensor->getShape()[0] : tensor->getShape()[tensor->getShape().getDimensions()-1];
-    for(int x = 0; x < size; ++x) {
-        uchar maxClass = 0;
-        for(uchar j = 1; j < nrOfClasses; j++) {
-            if(tensorData[getPosition(x, nrOfClasses, j, size, ordering)] > m_threshold &&
-               tensorData[getPosition(x, nrOfClasses, j, size, ordering)] > tensorData[getPosition(x, nrOfClasses, maxClass, size, ordering)]) {
-                maxClass = j;
+    if(getMainDevice()->isHost()) {
+        auto access = tensor->getAccess(ACCESS_READ);
+        float* tensorData = access->getRawData();
+        auto data = make_uninitialized_unique<uchar[]>(size);
+        for(int x = 0; x < size; ++x) {
+            uchar maxClass = 0;
+            for(uchar j = 1; j < nrOfClasses; j++) {
+                if(tensorData[getPosition(x, nrOfClasses, j, size, ordering)] > m_threshold &&
+                   tensorData[getPosition(x, nrOfClasses, j, size, ordering)] > tensorData[getPosition(x, nrOfClasses, maxClass, size, ordering)]) {
+                    maxClass = j;
+                }
             }
+            data[x] = maxClass;
+        }
+        if(outputDepth == 1) {
+            output->create(outputWidth, outputHeight, TYPE_UINT8, 1, std::move(data));
+        } else {
+            output->create(outputWidth, outputHeight, outputDepth, TYPE_UINT8, 1, std::move(data));
         }
-        data[x] = maxClass;
-    }
-    if(outputDepth == 1) {
-        output->create(outputWidth, outputHeight, TYPE_UINT8, 1, std::move(data));
     } else {
-        output->create(outputWidth, outputHeight, outputDepth, TYPE_UINT8, 1, std::move(data));
+        // Read the tensor buffer directly, for views this is the buffer of the entire batch
+        auto device = std::dynamic_pointer_cast<OpenCLDevice>(getMainDevice());
+        if(outputDepth == 1) {
+            output->create(outputWidth, outputHeight, TYPE_UINT8, 1);
+        } else {
+            output->create(outputWidth, outputHeight, outputDepth, TYPE_UINT8, 1);
+        }
+        auto tensorAccess = tensor->getOpenCLBufferAccess(ACCESS_READ, device);
+        auto outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+
+        cl::Kernel kernel(getOpenCLProgram(device), "tensorToSegmentation");
+        kernel.setArg(0, *tensorAccess->get());
+        kernel.setArg(1, *outputAccess->get());
+        kernel.setArg(2, (int)tensor->getOpenCLBufferOffset());
+        kernel.setArg(3, nrOfClasses);
+        kernel.setArg(4, m_threshold);
+        kernel.setArg(5, (int)(ordering == ImageOrdering::ChannelFirst ? 1 : 0));
+        device->getCommandQueue().enqueueNDRangeKernel(
+                kernel,
+                cl::NullRange,
+                cl::NDRange(size),
+                cl::NullRange
+        );
     }
     output->setSpacing(tensor->getSpacing());
+
+    return output;
 }
 
-}
\ No newline at end of file
+}
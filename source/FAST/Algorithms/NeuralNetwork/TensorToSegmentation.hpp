@@ -4,13 +4,31 @@
 
 namespace fast {
 
+class Tensor;
+class Image;
+
+/**
+ * Converts a tensor of class confidences to a segmentation, by selecting the class with the highest confidence
+ * above the threshold for each pixel. Class 0 is selected if no other class is above the threshold.
+ *
+ * The input can also be a batch of tensors, in which case the output is a batch of segmentations. Views of one
+ * batch tensor, as given by NeuralNetwork, are converted on the OpenCL device directly from the buffer of the batch
+ * tensor.
+ */
 class FAST_EXPORT TensorToSegmentation : public ProcessObject {
     FAST_OBJECT(TensorToSegmentation)
     public:
+        /**
+         * Lower threshold of accepting a class. Default is 0.5
+         * @param threshold
+         */
+        void setThreshold(float threshold);
+        void loadAttributes() override;
     protected:
         TensorToSegmentation();
         void execute() override;
+        SharedPointer<Image> convertToSegmentation(SharedPointer<Tensor> tensor);
         float m_threshold = 0.5f;
 };
 
-}
\ No newline at end of file
+}
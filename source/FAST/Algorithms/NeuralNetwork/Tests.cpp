@@ -2,6 +2,9 @@
 #include "NeuralNetwork.hpp"
 #include "SegmentationNetwork.hpp"
 #include "InferenceEngineManager.hpp"
+#include "InferenceEngineCache.hpp"
+#include "TensorToSegmentation.hpp"
+#include <FAST/Data/Tensor.hpp>
 #include <FAST/Importers/ImageFileImporter.hpp>
 #include <FAST/Visualization/SegmentationRenderer/SegmentationRenderer.hpp>
 #include <FAST/Visualization/ImageRenderer/ImageRenderer.hpp>
@@ -421,3 +424,142 @@ TEST_CASE("NN: temporal input temporal output, streaming mode", "[fast][neuralne
         }
     }
 }
+
+TEST_CASE("NN with asynchronous input conversion gives same output as synchronous", "[fast][neuralnetwork]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    const int frames = 5;
+    for(auto& engine : InferenceEngineManager::getEngineList()) {
+        auto streamer = ImageFileStreamer::New();
+        streamer->setFilenameFormat(Config::getTestDataPath() + "US/JugularVein/US-2D_#.mhd");
+        streamer->setMaximumNumberOfFrames(frames);
+
+        std::vector<NeuralNetwork::pointer> networks;
+        std::vector<DataChannel::pointer> ports;
+        for(bool async : {false, true}) {
+            auto network = NeuralNetwork::New();
+            network->setInferenceEngine(engine);
+            if(engine.substr(0, 10) == "TensorFlow") {
+                network->setOutputNode(0, "dense_1/BiasAdd", NodeType::TENSOR);
+                network->setOutputNode(1, "dense_2/BiasAdd", NodeType::TENSOR);
+                network->load(Config::getTestDataPath() + "NeuralNetworkModels/single_input_multi_output.pb");
+            } else if(engine == "TensorRT") {
+                network->setInputNode(0, "input_1", NodeType::IMAGE, TensorShape({-1, 1, 64, 64}));
+                network->setOutputNode(0, "dense_1/BiasAdd", NodeType::TENSOR, TensorShape({-1, 6}));
+                network->setOutputNode(1, "dense_2/BiasAdd", NodeType::TENSOR, TensorShape({-1, 6}));
+                network->load(
+                        Config::getTestDataPath() + "NeuralNetworkModels/single_input_multi_output_channels_first.uff");
+            } else {
+                network->load(Config::getTestDataPath() + "NeuralNetworkModels/single_input_multi_output.xml");
+            }
+            network->setAsynchronousInputConversion(async);
+            network->setInputConnection(0, streamer->getOutputPort());
+            ports.push_back(network->getOutputPort(0));
+            networks.push_back(network);
+        }
+
+        for(int i = 0; i < frames; ++i) {
+            networks[0]->update(i);
+            networks[1]->update(i);
+            auto data1 = ports[0]->getNextFrame<Tensor>();
+            auto data2 = ports[1]->getNextFrame<Tensor>();
+            REQUIRE(data1->getShape()[0] == data2->getShape()[0]);
+            auto access1 = data1->getAccess(ACCESS_READ);
+            auto access2 = data2->getAccess(ACCESS_READ);
+            auto tensor1 = access1->getData<1>();
+            auto tensor2 = access2->getData<1>();
+            for(int j = 0; j < data1->getShape()[0]; ++j)
+                CHECK(tensor1(j) == Approx(tensor2(j)));
+        }
+    }
+}
+
+TEST_CASE("Inference engine cache creates each network once", "[fast][neuralnetwork][InferenceEngineCache]") {
+    InferenceEngineCache::clear();
+    int created = 0;
+    auto create = [&created]() {
+        ++created;
+        return std::make_shared<int>(created);
+    };
+    std::vector<std::thread> threads;
+    std::vector<std::shared_ptr<int>> networks(4);
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i]() {
+            networks[i] = InferenceEngineCache::getOrCreate<int>("test network", create);
+        });
+    }
+    for(auto&& thread : threads)
+        thread.join();
+    CHECK(created == 1);
+    for(auto&& network : networks)
+        CHECK(network == networks[0]);
+    CHECK(InferenceEngineCache::contains("test network"));
+    CHECK_FALSE(InferenceEngineCache::contains("other network"));
+
+    // Nothing is cached if loading fails
+    CHECK_THROWS(InferenceEngineCache::getOrCreate<int>("failing network", []() -> std::shared_ptr<int> {
+        throw Exception("Failed to load");
+    }));
+    CHECK_FALSE(InferenceEngineCache::contains("failing network"));
+
+    InferenceEngineCache::clear();
+    CHECK_FALSE(InferenceEngineCache::contains("test network"));
+    CHECK(*InferenceEngineCache::getOrCreate<int>("test network", create) == 2);
+    InferenceEngineCache::clear();
+
+    CHECK(InferenceEngineCache::getHash({1, 2, 3}) == InferenceEngineCache::getHash({1, 2, 3}));
+    CHECK(InferenceEngineCache::getHash({1, 2, 3}) != InferenceEngineCache::getHash({1, 2, 4}));
+    CHECK(InferenceEngineCache::getDiskCacheFilename("a", ".plan") != InferenceEngineCache::getDiskCacheFilename("b", ".plan"));
+}
+
+TEST_CASE("TensorToSegmentation gives same result on device and host for a view of a batch tensor", "[fast][neuralnetwork][TensorToSegmentation]") {
+    const int batchSize = 3;
+    const int height = 8;
+    const int width = 6;
+    const int classes = 4;
+    const int sampleSize = height*width*classes;
+    auto data = std::make_unique<float[]>(batchSize*sampleSize);
+    // Distinct values in [0, 1) for the classes of each pixel, some pixels have no class above the threshold
+    for(int i = 0; i < batchSize*sampleSize; ++i)
+        data[i] = (float)((i*37) % 101) / 101.0f;
+    auto batchTensor = Tensor::New();
+    batchTensor->create(std::move(data), TensorShape({batchSize, height, width, classes}));
+
+    // The second sample starts in the middle of the buffer of the batch tensor
+    auto view = Tensor::New();
+    view->create(batchTensor, sampleSize, TensorShape({height, width, classes}));
+    REQUIRE(view->isView());
+    REQUIRE(view->getOpenCLBufferOffset() == sampleSize);
+
+    auto deviceConverter = TensorToSegmentation::New();
+    deviceConverter->setInputData(view);
+    auto deviceResult = deviceConverter->updateAndGetOutputData<Image>();
+
+    auto hostConverter = TensorToSegmentation::New();
+    hostConverter->setMainDevice(Host::getInstance());
+    hostConverter->setInputData(view);
+    auto hostResult = hostConverter->updateAndGetOutputData<Image>();
+
+    REQUIRE(deviceResult->getWidth() == width);
+    REQUIRE(deviceResult->getHeight() == height);
+    REQUIRE(hostResult->getSize() == deviceResult->getSize());
+    auto deviceAccess = deviceResult->getImageAccess(ACCESS_READ);
+    auto hostAccess = hostResult->getImageAccess(ACCESS_READ);
+    auto viewAccess = view->getAccess(ACCESS_READ);
+    const float* viewData = viewAccess->getRawData();
+    int background = 0;
+    for(int i = 0; i < width*height; ++i) {
+        CHECK(deviceAccess->getScalar(i) == hostAccess->getScalar(i));
+        // Values of the view, not of the first sample, are used
+        int expected = 0;
+        for(int j = 1; j < classes; ++j) {
+            if(viewData[i*classes + j] > 0.5f && viewData[i*classes + j] > viewData[i*classes + expected])
+                expected = j;
+        }
+        CHECK((int)hostAccess->getScalar(i) == expected);
+        if(expected == 0)
+            ++background;
+    }
+    // Both background and other classes are tested
+    CHECK(background > 0);
+    CHECK(background < width*height);
+}
@@ -37,7 +37,7 @@ int main(int argc, char** argv) {
         std::ofstream file(resultFilename.c_str());
 
         // Write header
-        file << "Engine;Device Type;Iteration;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Total\n";
+        file << "Engine;Device Type;Iteration;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Startup;Total\n";
 
         for(auto &engine : InferenceEngineManager::getEngineList()) {
             std::map<std::string, InferenceDeviceType> deviceTypes = {{"ANY", InferenceDeviceType::ANY}};
@@ -73,6 +73,8 @@ int main(int argc, char** argv) {
                         }
                     }
 
+                    // Loading includes compiling the network, unless it is in the inference engine cache
+                    auto startupStart = std::chrono::high_resolution_clock::now();
                     try {
                         segmentation->load(join(Config::getTestDataPath(),
                                                 "NeuralNetworkModels/jugular_vein_segmentation"+postfix+"." +
@@ -82,6 +84,7 @@ int main(int argc, char** argv) {
                         Reporter::warning() << e.what() << Reporter::end();
                         continue;
                     }
+                    std::chrono::duration<float, std::milli> startupTime = std::chrono::high_resolution_clock::now() - startupStart;
                     segmentation->setScaleFactor(1.0f / 255.0f);
                     //segmentation->setInputConnection(importer->getOutputPort());
                     segmentation->setInputConnection(streamer->getOutputPort());
@@ -96,6 +99,7 @@ int main(int argc, char** argv) {
                             std::chrono::high_resolution_clock::now() - start;
                     std::cout << "RUNTIME Ultrasound " << engine << std::endl;
                     std::cout << "=========================================" << std::endl;
+                    std::cout << "Startup time: " << startupTime.count() << std::endl;
                     std::cout << "Total runtime: " << timeUsed.count() << std::endl;
                     std::cout << "NN runtime: " << std::endl;
                     segmentation->getRuntime("input_processing")->print();
@@ -115,6 +119,7 @@ int main(int argc, char** argv) {
                          std::to_string(segmentation->getRuntime("inference")->getStdDeviation()) + ";" +
                          std::to_string(segmentation->getRuntime("output_processing")->getAverage()) + ";" +
                          std::to_string(segmentation->getRuntime("output_processing")->getStdDeviation()) + ";" +
+                         std::to_string(startupTime.count()) + ";" +
                          std::to_string(timeUsed.count())
                          << std::endl;
                 }
@@ -129,7 +134,7 @@ int main(int argc, char** argv) {
         std::ofstream file(resultFilename.c_str());
 
         // Write header
-        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Total\n";
+        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Startup;Total\n";
 
         //Reporter::setGlobalReportMethod(Reporter::NONE);
         for(std::string engine : {"TensorFlowCUDA", "TensorFlowCPU"}) {
@@ -159,7 +164,9 @@ int main(int argc, char** argv) {
                     network->setInferenceEngine(engine);
                     network->getInferenceEngine()->setDeviceType(deviceType.second);
                     network->setInferenceEngine(engine);
+                    auto startupStart = std::chrono::high_resolution_clock::now();
                     network->load(Config::getTestDataPath() + "/NeuralNetworkModels/lung_nodule_segmentation.pb");
+                    std::chrono::duration<float, std::milli> startupTime = std::chrono::high_resolution_clock::now() - startupStart;
                     network->setMinAndMaxIntensity(-1200.0f, 400.0f);
                     network->setScaleFactor(1.0f/(400+1200));
                     network->setMeanAndStandardDeviation(-1200.0f, 1.0f);
@@ -179,6 +186,7 @@ int main(int argc, char** argv) {
                         data = stitcher->updateAndGetOutputData<DataObject>();
                     } while(!data->isLastFrame());
                     std::chrono::duration<float, std::milli> timeUsed = std::chrono::high_resolution_clock::now() - start;
+                    std::cout << "Startup time: " << startupTime.count() << std::endl;
                     std::cout << "Total runtime: " << timeUsed.count() << std::endl;
                     std::cout << "Patch generator runtime: " << std::endl;
                     generator->getRuntime("create patch")->print();
@@ -204,6 +212,7 @@ int main(int argc, char** argv) {
                          std::to_string(network->getRuntime("output_processing")->getStdDeviation()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getAverage()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getStdDeviation()) + ";" +
+                         std::to_string(startupTime.count()) + ";" +
                          std::to_string(timeUsed.count())
                          << std::endl;
                 }
@@ -218,7 +227,7 @@ int main(int argc, char** argv) {
         std::ofstream file(resultFilename.c_str());
 
         // Write header
-        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Total\n";
+        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Startup;Total\n";
 
         for(auto &engine : InferenceEngineManager::getEngineList()) {
             std::map<std::string, InferenceDeviceType> deviceTypes = {{"ANY", InferenceDeviceType::ANY}};
@@ -262,8 +271,10 @@ int main(int argc, char** argv) {
                             postfix = "_fp16";
                         }
                     }
+                    auto startupStart = std::chrono::high_resolution_clock::now();
                     network->load(Config::getTestDataPath() + "NeuralNetworkModels/wsi_classification" + postfix + "." +
                                   network->getInferenceEngine()->getDefaultFileExtension());
+                    std::chrono::duration<float, std::milli> startupTime = std::chrono::high_resolution_clock::now() - startupStart;
                     network->setInputConnection(generator->getOutputPort());
                     network->setScaleFactor(1.0f / 255.0f);
                     network->enableRuntimeMeasurements();
@@ -278,6 +289,7 @@ int main(int argc, char** argv) {
                         data = stitcher->updateAndGetOutputData<DataObject>();
                     } while(!data->isLastFrame());
                     std::chrono::duration<float, std::milli> timeUsed = std::chrono::high_resolution_clock::now() - start;
+                    std::cout << "Startup time: " << startupTime.count() << std::endl;
                     std::cout << "Total runtime: " << timeUsed.count() << std::endl;
                     std::cout << "Patch generator runtime: " << std::endl;
                     generator->getRuntime("create patch")->print();
@@ -303,6 +315,7 @@ int main(int argc, char** argv) {
                          std::to_string(network->getRuntime("output_processing")->getStdDeviation()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getAverage()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getStdDeviation()) + ";" +
+                         std::to_string(startupTime.count()) + ";" +
                          std::to_string(timeUsed.count())
                          << std::endl;
                 }
@@ -317,7 +330,7 @@ int main(int argc, char** argv) {
         std::ofstream file(resultFilename.c_str());
 
         // Write header
-        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Total\n";
+        file << "Engine;Device Type;Iteration;Patch generator AVG;Patch generator STD;NN input AVG;NN input STD;NN inference AVG;NN inference STD;NN output AVG;NN output STD;Patch stitcher AVG;Patch stitcher STD;Startup;Total\n";
 
         for(std::string engine : {"TensorRT", "TensorFlowCUDA", "TensorFlowROCm", "OpenVINO"}) {
             if(!InferenceEngineManager::isEngineAvailable(engine))
@@ -368,8 +381,10 @@ int main(int argc, char** argv) {
                             postfix = "_fp16";
                         }
                     }
+                    auto startupStart = std::chrono::high_resolution_clock::now();
                     network->load(Config::getTestDataPath() + "NeuralNetworkModels/wsi_classification" + postfix + "." +
                                   network->getInferenceEngine()->getDefaultFileExtension());
+                    std::chrono::duration<float, std::milli> startupTime = std::chrono::high_resolution_clock::now() - startupStart;
                     network->setInputConnection(generator->getOutputPort());
                     network->setScaleFactor(1.0f / 255.0f);
                     network->enableRuntimeMeasurements();
@@ -384,6 +399,7 @@ int main(int argc, char** argv) {
                         data = stitcher->updateAndGetOutputData<DataObject>();
                     } while(!data->isLastFrame());
                     std::chrono::duration<float, std::milli> timeUsed = std::chrono::high_resolution_clock::now() - start;
+                    std::cout << "Startup time: " << startupTime.count() << std::endl;
                     std::cout << "Total runtime: " << timeUsed.count() << std::endl;
                     std::cout << "Patch generator runtime: " << std::endl;
                     generator->getRuntime("create patch")->print();
@@ -409,6 +425,7 @@ int main(int argc, char** argv) {
                          std::to_string(network->getRuntime("output_processing")->getStdDeviation()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getAverage()) + ";" +
                          std::to_string(stitcher->getRuntime("stitch patch")->getStdDeviation()) + ";" +
+                         std::to_string(startupTime.count()) + ";" +
                          std::to_string(timeUsed.count())
                          << std::endl;
                 }
@@ -94,7 +94,6 @@ void NonLocalMeans::execute() {
         bufferIn = bufferOut;
         bufferOut = tmp;
     }
-    queue.finish();
 }
 
 void NonLocalMeans::setSmoothingAmount(float parameterH) {
@@ -1,6 +1,6 @@
 #include "NonMaximumSuppression.hpp"
 #include <FAST/Data/BoundingBox.hpp>
-#include <queue>
+#include <numeric>
 
 namespace fast {
 
@@ -8,68 +8,163 @@ NonMaximumSuppression::NonMaximumSuppression() {
 	createInputPort<BoundingBoxSet>(0);
 	createOutputPort<BoundingBoxSet>(0);
 	createFloatAttribute("threshold", "Threshold", "Threshold", m_threshold);
+	createBooleanAttribute("per-class", "Per class", "Only suppress boxes with the same label", m_perClass);
+	createBooleanAttribute("soft", "Soft-NMS", "Reduce score of overlapping boxes instead of removing them", m_soft);
+	createFloatAttribute("sigma", "Sigma", "Sigma of gaussian score penalty in soft-NMS", m_sigma);
+	createFloatAttribute("score-threshold", "Score threshold", "Boxes with a score below this threshold are removed in soft-NMS", m_scoreThreshold);
 }
 
 void NonMaximumSuppression::loadAttributes() {
 	setThreshold(getFloatAttribute("threshold"));
+	setPerClass(getBooleanAttribute("per-class"));
+	setSoftNMS(getBooleanAttribute("soft"));
+	setSoftNMSSigma(getFloatAttribute("sigma"));
+	setScoreThreshold(getFloatAttribute("score-threshold"));
 }
 
 void NonMaximumSuppression::setThreshold(float threshold) {
 	m_threshold = threshold;
 }
 
+void NonMaximumSuppression::setPerClass(bool perClass) {
+	m_perClass = perClass;
+}
+
+void NonMaximumSuppression::setSoftNMS(bool soft) {
+	m_soft = soft;
+}
+
+void NonMaximumSuppression::setSoftNMSSigma(float sigma) {
+	if(sigma <= 0)
+		throw Exception("Sigma of soft-NMS must be > 0");
+	m_sigma = sigma;
+}
+
+void NonMaximumSuppression::setScoreThreshold(float threshold) {
+	m_scoreThreshold = threshold;
+}
+
+/**
+ * Same as BoundingBox::intersectionOverUnion, for boxes stored as x1, y1, x2, y2 with precomputed areas
+ */
+static inline float intersectionOverUnion(const float* box1, float area1, const float* box2, float area2) {
+	const float x_left = std::max(box1[0], box2[0]);
+	const float y_top = std::max(box1[1], box2[1]);
+	const float x_right = std::min(box1[2], box2[2]);
+	const float y_bottom = std::min(box1[3], box2[3]);
+
+	if(x_right < x_left || y_bottom < y_top) // There is no overlap
+		return 0.0f;
+
+	const float intersection_area = (x_right - x_left) * (y_bottom - y_top);
+	return intersection_area / (area1 + area2 - intersection_area);
+}
+
 void NonMaximumSuppression::execute() {
 	auto input = getInputData<BoundingBoxSet>();
 	auto output = getOutputData<BoundingBoxSet>();
 	output->create();
 
-	auto compare = [](BoundingBox::pointer a, BoundingBox::pointer b) {
-		return a->getScore() < b->getScore(); // if true, they swap place
-	};
-	std::priority_queue<BoundingBox::pointer, std::vector<BoundingBox::pointer>, decltype(compare)> queue(compare);
-	// Add bounding boxes to the queue
-	auto inputAccess = input->getAccess(ACCESS_READ);
-	auto outputAccess = output->getAccess(ACCESS_READ_WRITE);
-	auto coordinates = inputAccess->getCoordinates();
-	auto labels = inputAccess->getLabels();
-	auto scores = inputAccess->getScores();
-	for(int i = 0; i < coordinates.size(); i += 12) {
-		auto bbox = BoundingBox::New();
-		auto position = Vector2f(coordinates[i], coordinates[i + 1]);
-		auto size = Vector2f(coordinates[i + 6], coordinates[i + 7]) - position;
-		//std::cout << position << " " << size << std::endl;
-		//std::cout << labels[i / 3] << std::endl;
-		//std::cout << scores[i / 12] << std::endl;
-		bbox->create(position, size, labels[i / 3], scores[i / 12]);
-		//std::cout << "box created" << std::endl;
-		queue.push(bbox);
-		//std::cout << "box added" << std::endl;
+	std::vector<float> coordinates;
+	std::vector<uchar> labels;
+	std::vector<float> scores;
+	{
+		auto inputAccess = input->getAccess(ACCESS_READ);
+		coordinates = inputAccess->getCoordinates();
+		labels = inputAccess->getLabels();
+		scores = inputAccess->getScores();
+	}
+	const int nrOfBoxes = scores.size();
+
+	// Sort once by descending score, and store the boxes contiguously in that order
+	std::vector<int> order(nrOfBoxes);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&scores](int a, int b) {
+		return scores[a] > scores[b];
+	});
+	std::vector<float> boxes(nrOfBoxes*4); // x1, y1, x2, y2
+	std::vector<float> areas(nrOfBoxes);
+	std::vector<uchar> boxLabels(nrOfBoxes);
+	std::vector<float> boxScores(nrOfBoxes);
+	for(int i = 0; i < nrOfBoxes; ++i) {
+		const int index = order[i];
+		// Each box has 4 vertices with 3 coordinates and one label each. Vertex 0 and 2 are opposite corners.
+		boxes[i*4 + 0] = coordinates[index*12 + 0];
+		boxes[i*4 + 1] = coordinates[index*12 + 1];
+		boxes[i*4 + 2] = coordinates[index*12 + 6];
+		boxes[i*4 + 3] = coordinates[index*12 + 7];
+		areas[i] = (boxes[i*4 + 2] - boxes[i*4 + 0]) * (boxes[i*4 + 3] - boxes[i*4 + 1]);
+		boxLabels[i] = labels[index*4];
+		boxScores[i] = scores[index];
 	}
 
-	std::unordered_set<BoundingBox::pointer> erased;
-	while(!queue.empty()) {
-		BoundingBox::pointer b_m;
-		do {
-			b_m = queue.top();
-			queue.pop();
-		} while(erased.count(b_m) > 0 && !queue.empty());
-		if(!b_m)
-			break;
-		
-		outputAccess->addBoundingBox(b_m);
-		auto iterateQueue = queue; // Create new queue for iterating
-
-		// Remove overlapping bounding boxes
-		while(!iterateQueue.empty()) {
-			auto b = iterateQueue.top();
-			iterateQueue.pop();
-
-			if(b_m->intersectionOverUnion(b) > m_threshold) { // If large overlap
-				erased.insert(b);
+	std::vector<int> kept;
+	std::vector<float> keptScores;
+	// Boxes which have been suppressed (or kept for soft-NMS), in sorted order
+	std::vector<uchar> removed(nrOfBoxes, 0);
+	if(!m_soft) {
+		for(int i = 0; i < nrOfBoxes; ++i) {
+			if(removed[i])
+				continue;
+			kept.push_back(i);
+			keptScores.push_back(boxScores[i]);
+
+			// Suppress overlapping boxes with lower score
+			for(int j = i + 1; j < nrOfBoxes; ++j) {
+				if(removed[j] || (m_perClass && boxLabels[i] != boxLabels[j]))
+					continue;
+				if(intersectionOverUnion(&boxes[i*4], areas[i], &boxes[j*4], areas[j]) > m_threshold) // If large overlap
+					removed[j] = 1;
+			}
+		}
+	} else {
+		// Scores change while processing, thus find the remaining box with max score in every iteration
+		while(true) {
+			int best = -1;
+			for(int i = 0; i < nrOfBoxes; ++i) {
+				if(!removed[i] && (best == -1 || boxScores[i] > boxScores[best]))
+					best = i;
+			}
+			if(best == -1 || boxScores[best] < m_scoreThreshold)
+				break;
+			removed[best] = 1;
+			kept.push_back(best);
+			keptScores.push_back(boxScores[best]);
+
+			for(int j = 0; j < nrOfBoxes; ++j) {
+				if(removed[j] || (m_perClass && boxLabels[best] != boxLabels[j]))
+					continue;
+				const float iou = intersectionOverUnion(&boxes[best*4], areas[best], &boxes[j*4], areas[j]);
+				boxScores[j] *= std::exp(-iou*iou / m_sigma);
+				if(boxScores[j] < m_scoreThreshold)
+					removed[j] = 1;
 			}
 		}
 	}
 
+	// Add all kept boxes in one go
+	std::vector<float> outputCoordinates;
+	std::vector<uint> outputLines;
+	std::vector<uchar> outputLabels;
+	outputCoordinates.reserve(kept.size()*12);
+	outputLines.reserve(kept.size()*8);
+	outputLabels.reserve(kept.size()*4);
+	for(int k = 0; k < kept.size(); ++k) {
+		const float* box = &boxes[kept[k]*4];
+		const float corners[4][2] = {{box[0], box[1]}, {box[2], box[1]}, {box[2], box[3]}, {box[0], box[3]}};
+		const uint count = k*4;
+		for(int corner = 0; corner < 4; ++corner) {
+			outputCoordinates.push_back(corners[corner][0]);
+			outputCoordinates.push_back(corners[corner][1]);
+			outputCoordinates.push_back(0);
+			// Lines are pairs (from,to)
+			outputLines.push_back(count + corner);
+			outputLines.push_back(count + (corner + 1) % 4);
+			outputLabels.push_back(boxLabels[kept[k]]);
+		}
+	}
+	auto outputAccess = output->getAccess(ACCESS_READ_WRITE);
+	outputAccess->addBoundingBoxes(outputCoordinates, outputLines, outputLabels, keptScores);
 }
 
-}
\ No newline at end of file
+}
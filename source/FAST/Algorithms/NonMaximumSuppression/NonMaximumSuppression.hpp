@@ -4,16 +4,53 @@
 
 namespace fast {
 
-class NonMaximumSuppression : public ProcessObject {
+/**
+ * Non-maximum suppression of a set of bounding boxes.
+ *
+ * Boxes are sorted once by score, and then processed in descending order. Every box which overlaps a
+ * kept box with an intersection over union larger than the threshold is suppressed.
+ * With soft-NMS, the score of overlapping boxes are instead reduced with a gaussian penalty
+ * exp(-IoU^2/sigma), and boxes are removed when their score drops below the score threshold.
+ */
+class FAST_EXPORT NonMaximumSuppression : public ProcessObject {
 	FAST_OBJECT(NonMaximumSuppression)
 	public:
+		/**
+		 * Set intersection over union threshold above which boxes are suppressed. Default 0.5.
+		 * Not used for soft-NMS.
+		 * @param threshold
+		 */
 		void setThreshold(float threshold);
-		void loadAttributes();
+		/**
+		 * Only suppress boxes which have the same label as the kept box. Default false.
+		 * @param perClass
+		 */
+		void setPerClass(bool perClass);
+		/**
+		 * Use soft-NMS, which reduces the score of overlapping boxes instead of removing them. Default false.
+		 * @param soft
+		 */
+		void setSoftNMS(bool soft);
+		/**
+		 * Set sigma of the gaussian score penalty used by soft-NMS. Default 0.5.
+		 * @param sigma
+		 */
+		void setSoftNMSSigma(float sigma);
+		/**
+		 * Set score below which boxes are removed in soft-NMS. Default 0.001.
+		 * @param threshold
+		 */
+		void setScoreThreshold(float threshold);
+		void loadAttributes() override;
 	protected:
 		NonMaximumSuppression();
 		void execute() override;
 
 		float m_threshold = 0.5f;
+		bool m_perClass = false;
+		bool m_soft = false;
+		float m_sigma = 0.5f;
+		float m_scoreThreshold = 0.001f;
 };
 
-}
\ No newline at end of file
+}
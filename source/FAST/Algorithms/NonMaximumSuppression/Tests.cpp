@@ -0,0 +1,112 @@
+#include <FAST/Testing.hpp>
+#include "NonMaximumSuppression.hpp"
+#include <FAST/Data/BoundingBox.hpp>
+#include <random>
+
+using namespace fast;
+
+static BoundingBoxSet::pointer runNMS(NonMaximumSuppression::pointer nms, BoundingBoxSet::pointer input) {
+    nms->setInputData(input);
+    auto port = nms->getOutputPort();
+    nms->update();
+    return port->getNextFrame<BoundingBoxSet>();
+}
+
+TEST_CASE("Non maximum suppression removes overlapping boxes", "[fast][NonMaximumSuppression]") {
+    auto input = BoundingBoxSet::New();
+    input->create();
+    {
+        auto access = input->getAccess(ACCESS_READ_WRITE);
+        access->addBoundingBox(Vector2f(1, 1), Vector2f(9, 9), 1, 0.8f);
+        access->addBoundingBox(Vector2f(20, 20), Vector2f(5, 5), 1, 0.7f);
+        access->addBoundingBox(Vector2f(0, 0), Vector2f(10, 10), 1, 0.9f);
+        access->addBoundingBox(Vector2f(0, 0), Vector2f(10, 11), 2, 0.85f);
+    }
+
+    SECTION("all classes") {
+        auto nms = NonMaximumSuppression::New();
+        auto output = runNMS(nms, input);
+        auto access = output->getAccess(ACCESS_READ);
+        auto scores = access->getScores();
+        REQUIRE(scores.size() == 2);
+        CHECK(scores[0] == 0.9f);
+        CHECK(scores[1] == 0.7f);
+        auto coordinates = access->getCoordinates();
+        CHECK(coordinates[6] == 10.0f);
+        CHECK(coordinates[12 + 7] == 25.0f);
+        CHECK(access->getLines().size() == 16);
+        CHECK(access->getLines()[8] == 4);
+    }
+
+    SECTION("per class") {
+        auto nms = NonMaximumSuppression::New();
+        nms->setPerClass(true);
+        auto output = runNMS(nms, input);
+        auto access = output->getAccess(ACCESS_READ);
+        auto scores = access->getScores();
+        REQUIRE(scores.size() == 3);
+        CHECK(scores[0] == 0.9f);
+        CHECK(scores[1] == 0.85f);
+        CHECK(access->getLabels()[4] == 2);
+        CHECK(scores[2] == 0.7f);
+    }
+
+    SECTION("soft-NMS") {
+        auto nms = NonMaximumSuppression::New();
+        nms->setSoftNMS(true);
+        nms->setSoftNMSSigma(0.5f);
+        auto output = runNMS(nms, input);
+        auto access = output->getAccess(ACCESS_READ);
+        auto scores = access->getScores();
+        REQUIRE(scores.size() == 4);
+        CHECK(scores[0] == 0.9f);
+        // Overlapping boxes get a gaussian penalty from the box with highest score
+        const float iou1 = 100.0f / 110.0f;
+        const float iou2 = 81.0f / 100.0f;
+        CHECK(scores[1] == Approx(0.7f));
+        CHECK(scores[2] == Approx(0.8f*std::exp(-iou2*iou2/0.5f)));
+        // Penalized by both boxes with higher score
+        CHECK(scores[3] < 0.85f*std::exp(-iou1*iou1/0.5f));
+    }
+}
+
+TEST_CASE("Non maximum suppression of many boxes is equal to naive implementation", "[fast][NonMaximumSuppression]") {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> position(0, 500);
+    std::uniform_real_distribution<float> size(10, 60);
+    std::uniform_real_distribution<float> score(0, 1);
+    std::vector<BoundingBox::pointer> boxes;
+    auto input = BoundingBoxSet::New();
+    input->create();
+    {
+        auto access = input->getAccess(ACCESS_READ_WRITE);
+        for(int i = 0; i < 2000; ++i) {
+            auto box = BoundingBox::New();
+            box->create(Vector2f(position(generator), position(generator)), Vector2f(size(generator), size(generator)), 1, score(generator));
+            access->addBoundingBox(box);
+            boxes.push_back(box);
+        }
+    }
+
+    // Naive greedy NMS
+    std::sort(boxes.begin(), boxes.end(), [](BoundingBox::pointer a, BoundingBox::pointer b) {
+        return a->getScore() > b->getScore();
+    });
+    std::vector<float> expectedScores;
+    std::vector<bool> suppressed(boxes.size(), false);
+    for(int i = 0; i < boxes.size(); ++i) {
+        if(suppressed[i])
+            continue;
+        expectedScores.push_back(boxes[i]->getScore());
+        for(int j = i + 1; j < boxes.size(); ++j) {
+            if(boxes[i]->intersectionOverUnion(boxes[j]) > 0.3f)
+                suppressed[j] = true;
+        }
+    }
+
+    auto nms = NonMaximumSuppression::New();
+    nms->setThreshold(0.3f);
+    auto output = runNMS(nms, input);
+    auto access = output->getAccess(ACCESS_READ);
+    CHECK(access->getScores() == expectedScores);
+}
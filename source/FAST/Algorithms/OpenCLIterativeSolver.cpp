@@ -0,0 +1,79 @@
+#include "OpenCLIterativeSolver.hpp"
+
+namespace fast {
+
+OpenCLIterativeSolver::OpenCLIterativeSolver(OpenCLDevice::pointer device) {
+    m_device = device;
+}
+
+void OpenCLIterativeSolver::setInitialBatchSize(int iterations) {
+    if(iterations <= 0)
+        throw Exception("Initial batch size must be > 0 in OpenCLIterativeSolver");
+    m_initialBatchSize = iterations;
+}
+
+void OpenCLIterativeSolver::setMaximumBatchSize(int iterations) {
+    if(iterations <= 0)
+        throw Exception("Maximum batch size must be > 0 in OpenCLIterativeSolver");
+    m_maximumBatchSize = iterations;
+}
+
+void OpenCLIterativeSolver::setMaximumIterations(int iterations) {
+    m_maximumIterations = iterations;
+}
+
+int OpenCLIterativeSolver::getNrOfFlagReads() const {
+    return m_flagReads;
+}
+
+int OpenCLIterativeSolver::run(Iteration iteration) {
+    cl::CommandQueue queue = m_device->getCommandQueue();
+    // Two flags, so that the next batch can run while the flag of the current batch is read
+    cl::Buffer flags[2] = {
+            cl::Buffer(m_device->getContext(), CL_MEM_READ_WRITE, sizeof(char)),
+            cl::Buffer(m_device->getContext(), CL_MEM_READ_WRITE, sizeof(char))
+    };
+    char results[2];
+    cl::Event readEvents[2];
+    int iterations = 0;
+    int batchSize = std::min(m_initialBatchSize, m_maximumBatchSize);
+    m_flagReads = 0;
+
+    auto enqueueBatch = [&](int batch) {
+        const int index = batch % 2;
+        // The last batch is cut short, so that the maximum number of iterations isn't exceeded
+        const int size = m_maximumIterations > 0 ? std::min(batchSize, m_maximumIterations - iterations) : batchSize;
+        for(int i = 0; i < size; ++i) {
+            // Only changes in the last iteration of the batch matter, since an iteration which changes nothing
+            // means that the algorithm has converged
+            if(i == size - 1)
+                queue.enqueueFillBuffer(flags[index], (char)0, 0, sizeof(char));
+            iteration(iterations, flags[index]);
+            ++iterations;
+        }
+        queue.enqueueReadBuffer(flags[index], CL_FALSE, 0, sizeof(char), &results[index], nullptr, &readEvents[index]);
+        queue.flush();
+    };
+
+    enqueueBatch(0);
+    for(int batch = 0; ; ++batch) {
+        const bool limitReached = m_maximumIterations > 0 && iterations >= m_maximumIterations;
+        if(!limitReached)
+            enqueueBatch(batch + 1);
+        readEvents[batch % 2].wait();
+        ++m_flagReads;
+        if(results[batch % 2] == 0 || limitReached) {
+            if(results[batch % 2] != 0)
+                Reporter::warning() << "OpenCLIterativeSolver stopped after " << iterations << " iterations without converging" << Reporter::end();
+            // Results are local, thus the read of the next batch must finish before returning
+            if(!limitReached)
+                readEvents[(batch + 1) % 2].wait();
+            break;
+        }
+        batchSize = std::min(batchSize*2, m_maximumBatchSize);
+    }
+
+    return iterations;
+}
+
+}
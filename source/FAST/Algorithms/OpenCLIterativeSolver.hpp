@@ -0,0 +1,62 @@
+#pragma once
+
+#include "FAST/ExecutionDevice.hpp"
+#include <functional>
+
+namespace fast {
+
+/**
+ * Helper for OpenCL algorithms which repeat a kernel until nothing changes, such as distance transforms and
+ * region growing.
+ *
+ * Each iteration must set the first char of the changed buffer it is given to non-zero if it changed anything.
+ * Instead of reading this flag after every iteration, iterations are enqueued in batches and the flag is only
+ * cleared before the last iteration of each batch. The flag of one batch is read while the next batch is running,
+ * so the device is never idle waiting for the host. The batch size starts small, and is doubled every time a batch
+ * doesn't converge, thus slowly converging algorithms soon get few flag reads, while quickly converging ones
+ * don't run many extra iterations.
+ *
+ * An iteration after the algorithm has converged must not change the result, since up to two batches of extra
+ * iterations may run.
+ */
+class FAST_EXPORT OpenCLIterativeSolver {
+    public:
+        /**
+         * Function which enqueues the given iteration, using the given buffer as the changed flag
+         */
+        typedef std::function<void(int iteration, cl::Buffer& changed)> Iteration;
+        explicit OpenCLIterativeSolver(OpenCLDevice::pointer device);
+        /**
+         * Set number of iterations in the first batch. Default is 4.
+         * @param iterations
+         */
+        void setInitialBatchSize(int iterations);
+        /**
+         * Set maximum number of iterations between each read of the changed flag. Default is 64.
+         * @param iterations
+         */
+        void setMaximumBatchSize(int iterations);
+        /**
+         * Set maximum number of iterations before giving up. Default is no limit.
+         * @param iterations
+         */
+        void setMaximumIterations(int iterations);
+        /**
+         * Run iterations until one iteration doesn't change anything
+         * @param iteration
+         * @return number of iterations enqueued
+         */
+        int run(Iteration iteration);
+        /**
+         * @return number of times the changed flag was read in the last run
+         */
+        int getNrOfFlagReads() const;
+    private:
+        OpenCLDevice::pointer m_device;
+        int m_initialBatchSize = 4;
+        int m_maximumBatchSize = 64;
+        int m_maximumIterations = -1;
+        int m_flagReads = 0;
+};
+
+}
@@ -0,0 +1,75 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Algorithms/OpenCLIterativeSolver.hpp"
+#include "FAST/DeviceManager.hpp"
+
+using namespace fast;
+
+// Counts the iterations on the device, and reports a change in every iteration until the target is reached
+static const std::string countingKernel = R"(
+__kernel void countIterations(__global int* counter, __global char* changed, __private int target) {
+    const int iteration = counter[0];
+    counter[0] = iteration + 1;
+    if(iteration < target)
+        changed[0] = 1;
+}
+)";
+
+TEST_CASE("OpenCLIterativeSolver detects convergence across batch boundaries", "[fast][OpenCLIterativeSolver]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    cl::Kernel kernel(device->getProgram(device->createProgramFromString(countingKernel)), "countIterations");
+    cl::CommandQueue queue = device->getCommandQueue();
+    const int initialBatchSize = 4;
+    const int maximumBatchSize = 8;
+
+    // Batches are 4, 4, 8, 8, .. iterations, thus these include the last change happening at the last iteration of
+    // a batch, at the first iteration of a batch, and in the middle of a batch
+    for(int target : {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 50}) {
+        INFO("Iterations with changes " << target);
+        int counter = 0;
+        cl::Buffer counterBuffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(int), &counter);
+        kernel.setArg(0, counterBuffer);
+        kernel.setArg(2, target);
+
+        OpenCLIterativeSolver solver(device);
+        solver.setInitialBatchSize(initialBatchSize);
+        solver.setMaximumBatchSize(maximumBatchSize);
+        int callbacks = 0;
+        const int iterations = solver.run([&](int iteration, cl::Buffer& changed) {
+            CHECK(iteration == callbacks);
+            ++callbacks;
+            kernel.setArg(1, changed);
+            queue.enqueueTask(kernel);
+        });
+        queue.enqueueReadBuffer(counterBuffer, CL_TRUE, 0, sizeof(int), &counter);
+
+        CHECK(iterations == callbacks);
+        CHECK(counter == iterations);
+        // Must not stop before an iteration without changes has run
+        CHECK(iterations > target);
+        // At most two batches of extra iterations
+        CHECK(iterations <= target + 2*maximumBatchSize);
+        CHECK(solver.getNrOfFlagReads() <= iterations/initialBatchSize);
+    }
+}
+
+TEST_CASE("OpenCLIterativeSolver stops at maximum iterations", "[fast][OpenCLIterativeSolver]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    cl::Kernel kernel(device->getProgram(device->createProgramFromString(countingKernel)), "countIterations");
+    int counter = 0;
+    cl::Buffer counterBuffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(int), &counter);
+    kernel.setArg(0, counterBuffer);
+    kernel.setArg(2, 1000000); // Never converges
+
+    OpenCLIterativeSolver solver(device);
+    solver.setInitialBatchSize(4);
+    solver.setMaximumBatchSize(8);
+    solver.setMaximumIterations(20);
+    const int iterations = solver.run([&](int iteration, cl::Buffer& changed) {
+        kernel.setArg(1, changed);
+        device->getCommandQueue().enqueueTask(kernel);
+    });
+    device->getCommandQueue().enqueueReadBuffer(counterBuffer, CL_TRUE, 0, sizeof(int), &counter);
+    // Batches are 4, 4, 8, 8 iterations, thus the last batch has to be cut short
+    CHECK(iterations == 20);
+    CHECK(counter == 20);
+}
@@ -1,157 +1,246 @@
 #include <FAST/Data/Image.hpp>
 #include "RegionProperties.hpp"
-#include <unordered_set>
-#include <queue>
 #include <FAST/Data/Mesh.hpp>
+#include <FAST/SceneGraph.hpp>
+#include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace fast {
 
 RegionProperties::RegionProperties() {
     createInputPort<Image>(0);
     createOutputPort<RegionList>(0);
+    createOutputPort<Image>(1); // Label image
 }
 
+// Parent of pixels which are not part of any region
+static const uint32_t background = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Find root of a pixel, with path halving
+ */
+static inline uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t index) {
+    while(parent[index] != index) {
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+    return index;
+}
+
+/**
+ * Join the sets of two pixels. The root with the lowest index becomes the root of the union,
+ * thus the parent of a pixel always has a lower index than the pixel itself.
+ */
+static inline void unite(std::vector<uint32_t>& parent, uint32_t a, uint32_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if(a < b) {
+        parent[b] = a;
+    } else if(b < a) {
+        parent[a] = b;
+    }
+}
+
+struct RegionAccumulator {
+    int area = 0;
+    uchar label = 0;
+    double sum[3] = {0, 0, 0};
+    // xx, yy, zz, xy, xz, yz
+    double squaredSum[6] = {0, 0, 0, 0, 0, 0};
+    Vector3i minimum = Vector3i::Constant(std::numeric_limits<int>::max());
+    Vector3i maximum = Vector3i::Constant(std::numeric_limits<int>::min());
+
+    void add(int x, int y, int z) {
+        ++area;
+        sum[0] += x;
+        sum[1] += y;
+        sum[2] += z;
+        squaredSum[0] += (double)x*x;
+        squaredSum[1] += (double)y*y;
+        squaredSum[2] += (double)z*z;
+        squaredSum[3] += (double)x*y;
+        squaredSum[4] += (double)x*z;
+        squaredSum[5] += (double)y*z;
+        minimum = minimum.cwiseMin(Vector3i(x, y, z));
+        maximum = maximum.cwiseMax(Vector3i(x, y, z));
+    }
+
+    void add(const RegionAccumulator& other) {
+        area += other.area;
+        for(int i = 0; i < 3; ++i)
+            sum[i] += other.sum[i];
+        for(int i = 0; i < 6; ++i)
+            squaredSum[i] += other.squaredSum[i];
+        minimum = minimum.cwiseMin(other.minimum);
+        maximum = maximum.cwiseMax(other.maximum);
+    }
+};
+
 void RegionProperties::execute() {
     auto input = getInputData<Image>();
     if(input->getDataType() != TYPE_UINT8)
         throw Exception("Wrong input data type to RegionProperties");
-    if(input->getDimensions() != 2)
-        throw Exception("Region properties is only implemented for 2D segmentations");
-
-    std::vector<Region> regions;
 
     const int width = input->getWidth();
     const int height = input->getHeight();
-
-    std::unordered_set<uint> visited;
+    const int depth = input->getDepth();
+    const std::size_t nrOfPixels = (std::size_t)width*height*depth;
+    if(nrOfPixels >= background)
+        throw Exception("Image is too large for RegionProperties");
     auto access = input->getImageAccess(ACCESS_READ);
-    auto pixels = (uchar*)access->get();
-
-    // Get regions by flood fill first
-    std::queue<Vector2i> queue;
-    for(int y = 0; y < height; ++y) {
-        for(int x = 0; x < width; ++x) {
-            uchar currentLabel = pixels[x + y*width];
-            if(currentLabel == 0 || visited.count(x+y*width) > 0)
+    auto pixels = (const uchar*)access->get();
+
+    // Strips are made of rows in 2D and slices in 3D
+    const int layers = depth > 1 ? depth : height;
+    // Neighbors which are before the current pixel in raster order
+    std::vector<Vector3i> neighbors = {{-1, 0, 0}, {-1, -1, 0}, {0, -1, 0}, {1, -1, 0}};
+    if(depth > 1) {
+        for(int y = -1; y <= 1; ++y) {
+            for(int x = -1; x <= 1; ++x)
+                neighbors.push_back(Vector3i(x, y, -1));
+        }
+    }
+    auto visitPreviousNeighbors = [&](std::vector<uint32_t>& parent, int x, int y, int z, int firstLayer, int lastLayer) {
+        const uint32_t index = x + (y + (std::size_t)z*height)*width;
+        for(const Vector3i& offset : neighbors) {
+            const int nx = x + offset.x();
+            const int ny = y + offset.y();
+            const int nz = z + offset.z();
+            const int layer = depth > 1 ? nz : ny;
+            if(nx < 0 || nx >= width || ny < 0 || ny >= height || layer < firstLayer || layer > lastLayer)
                 continue;
-
-            // Start flood fill
-
-            // Create region
-            Region region;
-            region.label = currentLabel;
-            region.area = 0;
-            region.centroid = Vector2f::Zero();
-
-            queue.push(Vector2i(x,y));
-            visited.insert(x + y*width);
-            while(!queue.empty()) {
-                Vector2i current = queue.front();
-                queue.pop();
-
-                region.centroid += current.cast<float>();
-                region.pixels.push_back(current);
-
-                ++region.area;
-
-                // Check neighbors
-                for(int a = -1; a <= 1; ++a) {
-                    for(int b = -1; b <= 1; ++b) {
-                        Vector2i next = current + Vector2i(a,b);
-                        // Out of bounds check
-                        if(next.x() < 0 || next.y() < 0 || next.x() >= width || next.y() >= height)
-                            continue;
-                        uchar label = pixels[next.x() + next.y() * width];
-                        if(label == currentLabel && visited.count(next.x() + next.y() * width) == 0) {
-                            queue.push(next);
-                            visited.insert(next.x() + next.y()*width);
-                        }
-                    }
-                }
+            const uint32_t neighborIndex = nx + (ny + (std::size_t)nz*height)*width;
+            if(pixels[neighborIndex] == pixels[index])
+                unite(parent, index, neighborIndex);
+        }
+    };
+    // Visit all pixels in a range of layers in raster order
+    auto forEachPixel = [&](int firstLayer, int lastLayer, auto function) {
+        for(int layer = firstLayer; layer <= lastLayer; ++layer) {
+            const int z = depth > 1 ? layer : 0;
+            const int startY = depth > 1 ? 0 : layer;
+            const int endY = depth > 1 ? height : layer + 1;
+            for(int y = startY; y < endY; ++y) {
+                for(int x = 0; x < width; ++x)
+                    function(x, y, z, x + (y + (std::size_t)z*height)*width);
+            }
+        }
+    };
+
+    // First pass: label each strip independently. Each strip only modifies its own part of the parent buffer.
+    std::vector<uint32_t> parent(nrOfPixels);
+#ifdef _OPENMP
+    const int strips = std::max(1, std::min(layers, omp_get_max_threads()));
+#else
+    const int strips = 1;
+#endif
+    #pragma omp parallel for
+    for(int strip = 0; strip < strips; ++strip) {
+        const int firstLayer = (int)((std::size_t)strip*layers/strips);
+        const int lastLayer = (int)((std::size_t)(strip + 1)*layers/strips) - 1;
+        forEachPixel(firstLayer, lastLayer, [&](int x, int y, int z, uint32_t index) {
+            if(pixels[index] == 0) {
+                parent[index] = background;
+                return;
             }
+            parent[index] = index;
+            visitPreviousNeighbors(parent, x, y, z, firstLayer, lastLayer);
+        });
+    }
 
-            region.centroid /= region.area;
+    // Join regions across the borders between strips
+    for(int strip = 1; strip < strips; ++strip) {
+        const int firstLayer = (int)((std::size_t)strip*layers/strips);
+        forEachPixel(firstLayer, firstLayer, [&](int x, int y, int z, uint32_t index) {
+            if(pixels[index] != 0)
+                visitPreviousNeighbors(parent, x, y, z, firstLayer - 1, firstLayer);
+        });
+    }
 
-            regions.push_back(region);
+    // Second pass: replace parents with final region numbers, starting at 1.
+    // Parents always have a lower index, and have therefore already been replaced with their region number.
+    uint32_t nrOfRegions = 0;
+    for(std::size_t index = 0; index < nrOfPixels; ++index) {
+        if(parent[index] == background) {
+            parent[index] = 0;
+        } else if(parent[index] == index) {
+            parent[index] = ++nrOfRegions;
+        } else {
+            parent[index] = parent[parent[index]];
         }
     }
-
-    visited.clear();
-    std::vector<Vector2i> vertices;
-
-    // TODO do contour tracing for each region if enabled
-    // TODO handle holes
-    for(auto region : regions) {
-        // Start moore neigbhorhood tracing
-        int checkLocationNr = 1;  // The neighbor number of the location we want to check for a new border point
-        Vector2i checkPosition;      // The corresponding absolute array address of checkLocationNr
-        int newCheckLocationNr;   // Variable that holds the neighborhood position we want to check if we find a new border at checkLocationNr
-        Vector2i startPos = region.pixels[0];      // Set start position
-        int counter = 0;       // Counter is used for the jacobi stop criterion
-        int counter2 = 0;       // Counter2 is used to determine if the point we have discovered is one single point
-
-        // Defines the neighborhood offset position from current position and the neighborhood
-        // position we want to check next if we find a new border at checkLocationNr
-        Vector3i neighborhood[8] = {
-                {-1, 0, 7},
-                {-1, -1, 7},
-                {0, -1, 1},
-                {1, -1, 1},
-                {1, 0, 3},
-                {1, 1, 3},
-                {0, 1, 5},
-                {-1, 1, 5},
-        };
-        Vector2i pos = startPos;
-        // Trace around the neighborhood
-        while(true)
-        {
-            checkPosition = pos + neighborhood[checkLocationNr-1].head(2);
-            newCheckLocationNr = neighborhood[checkLocationNr-1].z();
-
-            if(pixels[checkPosition.x() + checkPosition.y()*width] == 2 && visited.count(checkPosition.x() + checkPosition.y()*width) == 0) // Next border point found
-            {
-                if(checkPosition == startPos) { // Should we stop?
-                    counter ++;
-
-                    // Stopping criterion (jacob)
-                    if(newCheckLocationNr == 1 || counter >= 3)
-                    {
-                        // Close loop
-                        //inside = true; // Since we are starting the search at were we first started we must set inside to true
-                        break;
-                    }
-                }
-
-                checkLocationNr = newCheckLocationNr; // Update which neighborhood position we should check next
-                pos = checkPosition;
-                counter2 = 0;             // Reset the counter that keeps track of how many neighbors we have visited
-                //borderImage[checkPosition] = BLACK; // Set the border pixel
-                visited.insert(pos.x() + pos.y()*width);
-                vertices.push_back(Vector2i(pos.x(), pos.y()));
-            } else {
-                // No match
-                // Rotate clockwise in the neighborhood
-                checkLocationNr = 1 + (checkLocationNr % 8);
-                if(counter2 > 8) {
-                    // If counter2 is above 8 we have traced around the neighborhood and
-                    // therefor the border is a single black pixel and we can exit
-                    counter2 = 0;
-                    break;
-                } else {
-                    counter2 ++;
-                }
+    // Region numbers are kept as 32 bit in parent, but the label image is 16 bit
+    const uint32_t maxLabel = std::numeric_limits<ushort>::max();
+    if(nrOfRegions > maxLabel)
+        reportWarning() << "RegionProperties found " << nrOfRegions << " regions, regions after nr " << maxLabel << " all get label " << maxLabel << " in the label image" << reportEnd();
+
+    // Create label image and calculate region properties on each strip in parallel
+    auto labelImage = Image::New();
+    labelImage->create(input->getSize(), TYPE_UINT16, 1);
+    labelImage->setSpacing(input->getSpacing());
+    SceneGraph::setParentNode(labelImage, input);
+    auto labelAccess = labelImage->getImageAccess(ACCESS_READ_WRITE);
+    auto labels = (ushort*)labelAccess->get();
+    // Each strip only touches a few of the regions, so accumulators are stored sparsely per strip
+    std::vector<std::unordered_map<uint32_t, RegionAccumulator>> stripRegions(strips);
+    #pragma omp parallel for
+    for(int strip = 0; strip < strips; ++strip) {
+        const int firstLayer = (int)((std::size_t)strip*layers/strips);
+        const int lastLayer = (int)((std::size_t)(strip + 1)*layers/strips) - 1;
+        std::unordered_map<uint32_t, RegionAccumulator>& accumulators = stripRegions[strip];
+        // Consecutive pixels are mostly in the same region, so keep the last accumulator to avoid a lookup per pixel
+        uint32_t lastRegion = 0;
+        RegionAccumulator* accumulator = nullptr;
+        forEachPixel(firstLayer, lastLayer, [&](int x, int y, int z, uint32_t index) {
+            const uint32_t region = parent[index];
+            labels[index] = (ushort)std::min(region, maxLabel);
+            if(region == 0)
+                return;
+            if(region != lastRegion) {
+                accumulator = &accumulators[region];
+                lastRegion = region;
             }
+            accumulator->label = pixels[index];
+            accumulator->add(x, y, z);
+        });
+    }
+    labelAccess->release();
+
+    std::vector<RegionAccumulator> totals(nrOfRegions);
+    for(int strip = 0; strip < strips; ++strip) {
+        for(const auto& entry : stripRegions[strip]) {
+            RegionAccumulator& total = totals[entry.first - 1];
+            total.label = entry.second.label;
+            total.add(entry.second);
         }
+    }
 
-        // TODO Create mesh
-        //region.contour = Mesh::New();
-        //region.contour->create(vertices);
+    std::vector<Region> regions(nrOfRegions);
+    for(int i = 0; i < nrOfRegions; ++i) {
+        const RegionAccumulator& total = totals[i];
+        Region& region = regions[i];
+        region.area = total.area;
+        region.label = total.label;
+        const Eigen::Vector3d mean = Eigen::Vector3d(total.sum[0], total.sum[1], total.sum[2]) / total.area;
+        region.centroid = mean.cast<float>();
+        region.boundingBoxMin = total.minimum;
+        region.boundingBoxMax = total.maximum;
+        Eigen::Matrix3d moments;
+        moments(0, 0) = total.squaredSum[0] / total.area - mean.x()*mean.x();
+        moments(1, 1) = total.squaredSum[1] / total.area - mean.y()*mean.y();
+        moments(2, 2) = total.squaredSum[2] / total.area - mean.z()*mean.z();
+        moments(0, 1) = moments(1, 0) = total.squaredSum[3] / total.area - mean.x()*mean.y();
+        moments(0, 2) = moments(2, 0) = total.squaredSum[4] / total.area - mean.x()*mean.z();
+        moments(1, 2) = moments(2, 1) = total.squaredSum[5] / total.area - mean.y()*mean.z();
+        region.moments = moments.cast<float>();
     }
 
     auto regionList = RegionList::New();
     regionList->create(regions);
     addOutputData(0, regionList);
+    addOutputData(1, labelImage);
 }
 
 }
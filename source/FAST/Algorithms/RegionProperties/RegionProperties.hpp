@@ -7,15 +7,45 @@ namespace fast {
 class Mesh;
 
 struct FAST_EXPORT Region {
+    /**
+     * Number of pixels/voxels in region
+     */
     int area;
+    /**
+     * Segmentation label of region
+     */
     uchar label;
-    Vector2f centroid;
+    /**
+     * Center of region in pixel coordinates. z is 0 for 2D images.
+     */
+    Vector3f centroid;
+    /**
+     * First and last pixel of the region in each direction, inclusive
+     */
+    Vector3i boundingBoxMin;
+    Vector3i boundingBoxMax;
+    /**
+     * Second order central moments (covariance of the pixel positions) in pixel units.
+     * The eigenvectors and eigenvalues give the orientation and extent of the region.
+     */
+    Matrix3f moments;
     SharedPointer<Mesh> contour;
-    std::vector<Vector2i> pixels;
 };
 
 FAST_SIMPLE_DATA_OBJECT(RegionList, std::vector<Region>)
 
+/**
+ * Finds all connected regions of pixels/voxels with the same label in a 2D or 3D segmentation, using
+ * 8-connectivity in 2D and 26-connectivity in 3D.
+ *
+ * Regions are labelled with a two-pass union-find algorithm, where the first pass is done in parallel
+ * on strips of rows (2D) or slices (3D). Regions are ordered by their first pixel in raster order.
+ *
+ * Outputs:
+ * - 0: RegionList with area, centroid, bounding box and moments of each region
+ * - 1: Label image of type TYPE_UINT16 where the pixels of region i in the list have the value i+1.
+ *      Labels saturate at 65535, thus all regions after nr 65535 get that label.
+ */
 class FAST_EXPORT RegionProperties : public ProcessObject {
     FAST_OBJECT(RegionProperties)
     public:
@@ -24,4 +54,4 @@ class FAST_EXPORT RegionProperties : public ProcessObject {
         void execute() override;
 };
 
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 #include <FAST/Testing.hpp>
 #include <FAST/Importers/ImageFileImporter.hpp>
 #include <FAST/Algorithms/BinaryThresholding/BinaryThresholding.hpp>
+#include <FAST/Data/Image.hpp>
 
 using namespace fast;
 
@@ -25,4 +26,150 @@ TEST_CASE("Region properties", "[regionproperties][fast]") {
         //std::cout << "Area: " << region.area << std::endl;
         //std::cout << "Label: " << (int)region.label << std::endl;
     }
-}
\ No newline at end of file
+}
+static void checkRegionsWithFloodFill(Image::pointer image, RegionList::pointer regionList, Image::pointer labelImage) {
+    const int width = image->getWidth();
+    const int height = image->getHeight();
+    const int depth = image->getDepth();
+    auto access = image->getImageAccess(ACCESS_READ);
+    auto pixels = (uchar*)access->get();
+    auto labelAccess = labelImage->getImageAccess(ACCESS_READ);
+    auto labels = (ushort*)labelAccess->get();
+    auto regions = regionList->getAccess(ACCESS_READ)->getData();
+
+    // Reference: flood fill from every unvisited pixel in raster order
+    std::vector<bool> visited(width*height*depth, false);
+    int regionNr = 0;
+    for(int start = 0; start < width*height*depth; ++start) {
+        if(pixels[start] == 0 || visited[start])
+            continue;
+        REQUIRE(regionNr < regions.size());
+        const Region& region = regions[regionNr];
+        ++regionNr;
+        CHECK(region.label == pixels[start]);
+
+        int area = 0;
+        Vector3f centroid = Vector3f::Zero();
+        Vector3i minimum = Vector3i::Constant(std::numeric_limits<int>::max());
+        Vector3i maximum = Vector3i::Constant(-1);
+        std::vector<int> stack = {start};
+        visited[start] = true;
+        while(!stack.empty()) {
+            const int current = stack.back();
+            stack.pop_back();
+            const Vector3i position(current % width, (current / width) % height, current / (width*height));
+            REQUIRE(labels[current] == regionNr);
+            ++area;
+            centroid += position.cast<float>();
+            minimum = minimum.cwiseMin(position);
+            maximum = maximum.cwiseMax(position);
+            for(int c = -1; c <= 1; ++c) {
+                for(int b = -1; b <= 1; ++b) {
+                    for(int a = -1; a <= 1; ++a) {
+                        const Vector3i next = position + Vector3i(a, b, c);
+                        if((next.array() < 0).any() || next.x() >= width || next.y() >= height || next.z() >= depth)
+                            continue;
+                        const int nextIndex = next.x() + (next.y() + next.z()*height)*width;
+                        if(!visited[nextIndex] && pixels[nextIndex] == pixels[start]) {
+                            visited[nextIndex] = true;
+                            stack.push_back(nextIndex);
+                        }
+                    }
+                }
+            }
+        }
+        CHECK(region.area == area);
+        CHECK(region.centroid.x() == Approx(centroid.x() / area));
+        CHECK(region.centroid.y() == Approx(centroid.y() / area));
+        CHECK(region.centroid.z() == Approx(centroid.z() / area));
+        CHECK(region.boundingBoxMin == minimum);
+        CHECK(region.boundingBoxMax == maximum);
+    }
+    CHECK(regionNr == regions.size());
+}
+
+static Image::pointer createRandomSegmentation(int width, int height, int depth) {
+    std::vector<uchar> data(width*height*depth);
+    uint32_t random = 7;
+    for(auto& value : data) {
+        random = random*1664525u + 1013904223u;
+        // Sparse with two labels, which gives many regions of different shapes
+        const int sample = random >> 24;
+        value = sample < 160 ? 0 : (sample < 220 ? 1 : 2);
+    }
+    auto image = Image::New();
+    if(depth == 1) {
+        image->create(width, height, TYPE_UINT8, 1, Host::getInstance(), data.data());
+    } else {
+        image->create(width, height, depth, TYPE_UINT8, 1, Host::getInstance(), data.data());
+    }
+    return image;
+}
+
+TEST_CASE("Region properties of 2D segmentation are equal to flood fill", "[regionproperties][fast]") {
+    auto image = createRandomSegmentation(203, 151, 1);
+    auto regionProperties = RegionProperties::New();
+    regionProperties->setInputData(image);
+    auto regionPort = regionProperties->getOutputPort(0);
+    auto labelPort = regionProperties->getOutputPort(1);
+    regionProperties->update();
+    checkRegionsWithFloodFill(image, regionPort->getNextFrame<RegionList>(), labelPort->getNextFrame<Image>());
+}
+
+TEST_CASE("Region properties of 3D segmentation are equal to flood fill", "[regionproperties][fast]") {
+    auto image = createRandomSegmentation(41, 37, 29);
+    auto regionProperties = RegionProperties::New();
+    regionProperties->setInputData(image);
+    auto regionPort = regionProperties->getOutputPort(0);
+    auto labelPort = regionProperties->getOutputPort(1);
+    regionProperties->update();
+    checkRegionsWithFloodFill(image, regionPort->getNextFrame<RegionList>(), labelPort->getNextFrame<Image>());
+}
+
+TEST_CASE("Region properties moments", "[regionproperties][fast]") {
+    // Horizontal line of 5 pixels
+    std::vector<uchar> data(10*10, 0);
+    for(int x = 2; x < 7; ++x)
+        data[x + 4*10] = 1;
+    auto image = Image::New();
+    image->create(10, 10, TYPE_UINT8, 1, Host::getInstance(), data.data());
+    auto regionProperties = RegionProperties::New();
+    regionProperties->setInputData(image);
+    auto regions = regionProperties->updateAndGetOutputData<RegionList>()->getAccess(ACCESS_READ)->getData();
+    REQUIRE(regions.size() == 1);
+    CHECK(regions[0].area == 5);
+    CHECK(regions[0].centroid.x() == Approx(4));
+    CHECK(regions[0].centroid.y() == Approx(4));
+    CHECK(regions[0].moments(0, 0) == Approx(2));
+    CHECK(regions[0].moments(1, 1) == Approx(0).margin(1e-6));
+    CHECK(regions[0].moments(0, 1) == Approx(0).margin(1e-6));
+}
+
+TEST_CASE("Region properties with more regions than labels in the label image", "[regionproperties][fast]") {
+    // Single pixels with a gap between them, thus 300*300 regions
+    const int size = 600;
+    std::vector<uchar> data(size*size, 0);
+    for(int y = 0; y < size; y += 2) {
+        for(int x = 0; x < size; x += 2)
+            data[x + y*size] = 1;
+    }
+    auto image = Image::New();
+    image->create(size, size, TYPE_UINT8, 1, Host::getInstance(), data.data());
+    auto regionProperties = RegionProperties::New();
+    regionProperties->setInputData(image);
+    auto regionPort = regionProperties->getOutputPort(0);
+    auto labelPort = regionProperties->getOutputPort(1);
+    regionProperties->update();
+    auto regions = regionPort->getNextFrame<RegionList>()->getAccess(ACCESS_READ)->getData();
+    REQUIRE(regions.size() == 300*300);
+    CHECK(regions.back().area == 1);
+    CHECK(regions.back().centroid.x() == Approx(size - 2));
+    CHECK(regions.back().centroid.y() == Approx(size - 2));
+
+    // Labels saturate
+    auto labelAccess = labelPort->getNextFrame<Image>()->getImageAccess(ACCESS_READ);
+    auto labels = (const ushort*)labelAccess->get();
+    CHECK(labels[0] == 1);
+    CHECK(labels[1] == 0);
+    CHECK(labels[(size - 2) + (size - 2)*size] == 65535);
+}
@@ -3,6 +3,7 @@
 #include "FAST/SceneGraph.hpp"
 #include <stack>
 #include "FAST/Data/Segmentation.hpp"
+#include "FAST/Algorithms/OpenCLIterativeSolver.hpp"
 
 namespace fast {
 
@@ -35,6 +36,11 @@ void SeededRegionGrowing::addSeedPoint(Vector3ui position) {
     mSeedPoints.push_back(position);
 }
 
+void SeededRegionGrowing::setMaximumFrontierSize(int voxels) {
+    mMaximumFrontierSize = voxels < 0 ? -1 : voxels;
+    mIsModified = true;
+}
+
 SeededRegionGrowing::SeededRegionGrowing() {
     createInputPort<Image>(0);
     createOutputPort<Segmentation>(0);
@@ -64,6 +70,7 @@ void SeededRegionGrowing::recompileOpenCLCode(Image::pointer input) {
     }
     int programNr = device->createProgramFromSource(Config::getKernelSourcePath() + filename, buildOptions);
     mKernel = cl::Kernel(device->getProgram(programNr), "seededRegionGrowing");
+    mFrontierKernel = cl::Kernel(device->getProgram(programNr), "growFrontier");
     mDimensionCLCodeCompiledFor = input->getDimensions();
     mTypeCLCodeCompiledFor = input->getDataType();
 }
@@ -163,64 +170,155 @@ void SeededRegionGrowing::execute() {
 
         recompileOpenCLCode(input);
 
-        ImageAccess::pointer access = output->getImageAccess(ACCESS_READ_WRITE);
-        uchar* outputData = (uchar*)access->get();
-        // Initialize to all 0s
-        memset(outputData,0,sizeof(uchar)*output->getWidth()*output->getHeight()*output->getDepth());
+        const uint width = output->getWidth();
+        const uint height = output->getHeight();
+        const uint depth = output->getDepth();
+        const uint nrOfVoxels = width*height*depth;
 
-        // Add sedd points
+        // Seed points, without duplicates, since each voxel can only be in the frontier once
+        std::vector<uint> seeds;
+        std::vector<uint> visited((nrOfVoxels + 31) / 32, 0);
         for(int i = 0; i < mSeedPoints.size(); i++) {
             Vector3ui pos = mSeedPoints[i];
 
             // Check if seed point is in bounds
             if(pos.x() < 0 || pos.y() < 0 || pos.z() < 0 ||
-                pos.x() >= output->getWidth() || pos.y() >= output->getHeight() || pos.z() >= output->getDepth())
+                pos.x() >= width || pos.y() >= height || pos.z() >= depth)
                 throw Exception("One of the seed points given to SeededRegionGrowing was out of bounds.");
 
-            outputData[pos.x() + pos.y()*output->getWidth() + pos.z()*output->getWidth()*output->getHeight()] = 2;
+            const uint linearPos = pos.x() + pos.y()*width + pos.z()*width*height;
+            if((visited[linearPos / 32] & (1u << (linearPos % 32))) != 0)
+                continue;
+            visited[linearPos / 32] |= 1u << (linearPos % 32);
+            seeds.push_back(linearPos);
         }
-        access->release();
 
-        cl::NDRange globalSize;
         OpenCLImageAccess::pointer inputAccess = input->getOpenCLImageAccess(ACCESS_READ, device);
+        cl::Image* inputImage;
+        cl::NDRange globalSize;
+        int nrOfNeighbors;
         if(output->getDimensions() == 2) {
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight());
-            mKernel.setArg(0, *inputAccess->get2DImage());
+            inputImage = inputAccess->get2DImage();
+            globalSize = cl::NDRange(width, height);
+            nrOfNeighbors = 8;
         } else {
-            globalSize = cl::NDRange(input->getWidth(),input->getHeight(), input->getDepth());
-            mKernel.setArg(0, *inputAccess->get3DImage());
+            inputImage = inputAccess->get3DImage();
+            globalSize = cl::NDRange(width, height, depth);
+            nrOfNeighbors = 6;
         }
 
         OpenCLBufferAccess::pointer outputAccess = output->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
-        cl::Buffer stopGrowingBuffer = cl::Buffer(
-                device->getContext(),
-                CL_MEM_READ_WRITE,
-                sizeof(char));
+        cl::Buffer* segmentation = outputAccess->get();
         cl::CommandQueue queue = device->getCommandQueue();
-        mKernel.setArg(1, *outputAccess->get());
-        mKernel.setArg(2, stopGrowingBuffer);
+        // Initialize to all 0s
+        queue.enqueueFillBuffer(*segmentation, (char)0, 0, nrOfVoxels*sizeof(char));
+
+        mKernel.setArg(0, *inputImage);
+        mKernel.setArg(1, *segmentation);
         mKernel.setArg(3, mMinimumIntensity);
         mKernel.setArg(4, mMaximumIntensity);
-
-        bool stopGrowing = false;
-        char stopGrowingInit = 1;
-        char stopGrowingResult;
-        int iterations = 0;
-        do {
-            iterations++;
-            queue.enqueueWriteBuffer(stopGrowingBuffer, CL_TRUE, 0, sizeof(char), &stopGrowingInit);
-
+        auto growEntireImage = [&](int iteration, cl::Buffer& changed) {
+            mKernel.setArg(2, changed);
             queue.enqueueNDRangeKernel(
                     mKernel,
                     cl::NullRange,
                     globalSize,
                     cl::NullRange
             );
+        };
+        OpenCLIterativeSolver solver(device);
+
+        if(mMaximumFrontierSize == 0) {
+            // Queue the seeds, and process the entire image in every iteration
+            const char queued = 2;
+            for(uint seed : seeds)
+                queue.enqueueFillBuffer(*segmentation, queued, seed*sizeof(char), sizeof(char));
+            const int iterations = solver.run(growEntireImage);
+            reportInfo() << "Seeded region growing finished in " << iterations << " iterations" << reportEnd();
+            return;
+        }
 
-            queue.enqueueReadBuffer(stopGrowingBuffer, CL_TRUE, 0, sizeof(char), &stopGrowingResult);
-            if(stopGrowingResult == 1)
-                stopGrowing = true;
-        } while(!stopGrowing);
+        // Only the frontier of the region is processed in each iteration. The frontier can't be larger than the
+        // surface of the image, unless the region is very irregular. In that case, the frontier overflows and the
+        // remaining voxels are processed by the kernel which processes the entire image.
+        const uint maximumFrontierSize = mMaximumFrontierSize > 0 ? (uint)mMaximumFrontierSize :
+                2*(width*height + width*depth + height*depth);
+        const uint frontierCapacity = std::min(nrOfVoxels, std::max((uint)seeds.size(), maximumFrontierSize));
+        cl::Buffer visitedBuffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                visited.size()*sizeof(uint), visited.data());
+        cl::Buffer frontiers[2] = {
+                cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, frontierCapacity*sizeof(uint)),
+                cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, frontierCapacity*sizeof(uint))
+        };
+        const uint nrOfSeeds = seeds.size();
+        cl::Buffer frontierSizes[2] = {
+                cl::Buffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(uint), (void*)&nrOfSeeds),
+                cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, sizeof(uint))
+        };
+        queue.enqueueWriteBuffer(frontiers[0], CL_FALSE, 0, seeds.size()*sizeof(uint), seeds.data());
+        char overflow = 0;
+        cl::Buffer overflowBuffer(device->getContext(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(char), &overflow);
+
+        mFrontierKernel.setArg(0, *inputImage);
+        mFrontierKernel.setArg(1, *segmentation);
+        mFrontierKernel.setArg(2, visitedBuffer);
+        mFrontierKernel.setArg(7, frontierCapacity);
+        mFrontierKernel.setArg(8, overflowBuffer);
+        mFrontierKernel.setArg(9, mMinimumIntensity);
+        mFrontierKernel.setArg(10, mMaximumIntensity);
+
+        // The size of the frontier is read back without blocking, one read at a time. Until a read is done, the
+        // size is bounded by the last known size multiplied by the number of neighbors for each iteration since then.
+        // The bound is used as global size, and no kernel is run once the frontier is known to be empty.
+        uint knownFrontierSize = seeds.size();
+        int knownIteration = 0;
+        uint frontierSizeRead = 0;
+        cl::Event frontierSizeReadEvent;
+        int readIteration = -1;
+        int iterations = solver.run([&](int iteration, cl::Buffer& changed) {
+            const int current = iteration % 2;
+            const int next = (iteration + 1) % 2;
+            if(readIteration >= 0 && frontierSizeReadEvent.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() == CL_COMPLETE) {
+                knownFrontierSize = frontierSizeRead;
+                knownIteration = readIteration;
+                readIteration = -1;
+            }
+            uint64_t frontierSizeBound = std::min(knownFrontierSize, frontierCapacity);
+            for(int i = knownIteration; i < iteration && frontierSizeBound > 0 && frontierSizeBound < frontierCapacity; ++i)
+                frontierSizeBound = std::min(frontierSizeBound*nrOfNeighbors, (uint64_t)frontierCapacity);
+            // An empty frontier stays empty, thus nothing changes and the solver stops
+            if(frontierSizeBound == 0)
+                return;
+            if(readIteration < 0) {
+                // Size of the frontier of this iteration, as the queue is in order
+                queue.enqueueReadBuffer(frontierSizes[current], CL_FALSE, 0, sizeof(uint), &frontierSizeRead, nullptr, &frontierSizeReadEvent);
+                readIteration = iteration;
+            }
+            queue.enqueueFillBuffer(frontierSizes[next], (uint)0, 0, sizeof(uint));
+            mFrontierKernel.setArg(3, frontiers[current]);
+            mFrontierKernel.setArg(4, frontierSizes[current]);
+            mFrontierKernel.setArg(5, frontiers[next]);
+            mFrontierKernel.setArg(6, frontierSizes[next]);
+            mFrontierKernel.setArg(11, changed);
+            queue.enqueueNDRangeKernel(
+                    mFrontierKernel,
+                    cl::NullRange,
+                    cl::NDRange(frontierSizeBound),
+                    cl::NullRange
+            );
+        });
+        // frontierSizeRead is local, thus the last read must finish
+        if(readIteration >= 0)
+            frontierSizeReadEvent.wait();
+
+        // Blocking read, but only once
+        queue.enqueueReadBuffer(overflowBuffer, CL_TRUE, 0, sizeof(char), &overflow);
+        if(overflow != 0) {
+            // Continue from the queued voxels using the entire image
+            iterations += solver.run(growEntireImage);
+        }
+        reportInfo() << "Seeded region growing finished in " << iterations << " iterations" <<
+            (overflow != 0 ? " (frontier overflowed)" : "") << reportEnd();
     }
 
 }
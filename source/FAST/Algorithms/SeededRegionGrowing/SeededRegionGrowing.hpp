@@ -14,6 +14,14 @@ class FAST_EXPORT  SeededRegionGrowing : public ProcessObject {
         void addSeedPoint(uint x, uint y);
         void addSeedPoint(uint x, uint y, uint z);
         void addSeedPoint(Vector3ui position);
+        /**
+         * Set maximum number of voxels in the frontier of the region, which is what each iteration processes on
+         * OpenCL devices. If the frontier gets larger, the rest of the region is grown by processing the entire
+         * image in each iteration. Default is -1, which sets it from the surface area of the image.
+         * 0 processes the entire image in every iteration.
+         * @param voxels
+         */
+        void setMaximumFrontierSize(int voxels);
     private:
         SeededRegionGrowing();
         void execute();
@@ -24,8 +32,10 @@ class FAST_EXPORT  SeededRegionGrowing : public ProcessObject {
 
         float mMinimumIntensity, mMaximumIntensity;
         std::vector<Vector3ui> mSeedPoints;
+        int mMaximumFrontierSize = -1;
 
         cl::Kernel mKernel;
+        cl::Kernel mFrontierKernel;
         unsigned char mDimensionCLCodeCompiledFor;
         DataType mTypeCLCodeCompiledFor;
 
@@ -14,7 +14,7 @@ __constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_FILTER_NEAREST
 __kernel void seededRegionGrowing(
         __read_only image3d_t image,
         __global char* segmentation,
-        __global char* stopGrowing,
+        __global char* changed,
         __private float min,
         __private float max
         ) {
@@ -46,7 +46,7 @@ __kernel void seededRegionGrowing(
                         neighborPos.z*get_global_size(0)*get_global_size(1);
                 if(segmentation[neighborLinearPos] == 0) {
                     segmentation[neighborLinearPos] = 2; // add to queue
-                    stopGrowing[0] = 0;
+                    changed[0] = 1;
                 }
             }
         } else {
@@ -55,4 +55,67 @@ __kernel void seededRegionGrowing(
     }
 }
         
-            
\ No newline at end of file
+            
+/**
+ * Process only the voxels of the current frontier. Voxels in the intensity range are added to the segmentation,
+ * and their neighbors which haven't been visited before become the next frontier. Visited voxels are marked in a
+ * bit mask, so that each voxel is added to a frontier only once. If the next frontier is full, the voxel is instead
+ * marked as queued in the segmentation, and left for seededRegionGrowing.
+ */
+__kernel void growFrontier(
+        __read_only image3d_t image,
+        __global char* segmentation,
+        __global uint* visited,
+        __global const uint* frontier,
+        __global const uint* frontierSize,
+        __global uint* nextFrontier,
+        __global uint* nextFrontierSize,
+        __private uint frontierCapacity,
+        __global char* overflow,
+        __private float min,
+        __private float max,
+        __global char* changed
+        ) {
+    const uint id = get_global_id(0);
+    if(id >= frontierSize[0] || id >= frontierCapacity) // The size may exceed the capacity on overflow
+        return;
+    const int width = get_image_width(image);
+    const int height = get_image_height(image);
+    const int depth = get_image_depth(image);
+    const uint linearPos = frontier[id];
+    const int4 pos = {linearPos % width, (linearPos / width) % height, linearPos / (width*height), 0};
+
+    float intensity = READ_IMAGE(image, pos);
+    if(intensity < min || intensity > max)
+        return;
+    segmentation[linearPos] = 1; // add voxel to segmentation
+
+    const int4 offsets[6] = {
+        {0,0,1,0},
+        {0,1,0,0},
+        {1,0,0,0},
+        {0,0,-1,0},
+        {0,-1,0,0},
+        {-1,0,0,0},
+    };
+    for(int i = 0; i < 6; i++) {
+        int4 neighborPos = pos + offsets[i];
+        if(neighborPos.x < 0 || neighborPos.y < 0 || neighborPos.z < 0 ||
+            neighborPos.x >= width || neighborPos.y >= height || neighborPos.z >= depth)
+            continue;
+        uint neighborLinearPos = neighborPos.x + neighborPos.y*width + neighborPos.z*width*height;
+        uint bit = 1u << (neighborLinearPos & 31);
+        if((visited[neighborLinearPos >> 5] & bit) != 0)
+            continue;
+        if((atomic_or(&visited[neighborLinearPos >> 5], bit) & bit) != 0)
+            continue; // Another work item visited it first
+        uint index = atomic_inc(nextFrontierSize);
+        if(index < frontierCapacity) {
+            nextFrontier[index] = neighborLinearPos;
+        } else {
+            segmentation[neighborLinearPos] = 2; // add to queue
+            overflow[0] = 1;
+        }
+        changed[0] = 1;
+    }
+}
@@ -3,6 +3,7 @@
 #include "FAST/Importers/ImageFileImporter.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/Data/Segmentation.hpp"
+#include <algorithm>
 
 namespace fast {
 
@@ -94,4 +95,62 @@ TEST_CASE("3D Seeded region growing on Host", "[fast][SeededRegionGrowing]") {
     CHECK(4106484 == sum);
 }
 
+// Noise gives an irregular region with a large frontier. The center has max intensity, to be used as seed.
+static Image::pointer createNoiseImage(int width, int height, int depth) {
+    const int size = width*height*depth;
+    auto data = make_uninitialized_unique<uchar[]>(size);
+    uint state = 12345;
+    for(int i = 0; i < size; i++) {
+        state = state*1664525u + 1013904223u;
+        data[i] = (uchar)(state >> 24);
+    }
+    data[width/2 + (height/2)*width + (depth/2)*width*height] = 255;
+    auto image = Image::New();
+    if(depth == 1) {
+        image->create(width, height, TYPE_UINT8, 1, std::move(data));
+    } else {
+        image->create(width, height, depth, TYPE_UINT8, 1, std::move(data));
+    }
+    return image;
+}
+
+static std::vector<uchar> growRegion(Image::pointer image, Vector3ui seed, float minimum, int maximumFrontierSize, OpenCLDevice::pointer device) {
+    auto algorithm = SeededRegionGrowing::New();
+    algorithm->setInputData(image);
+    algorithm->addSeedPoint(seed);
+    algorithm->setIntensityRange(minimum, 255);
+    algorithm->setMaximumFrontierSize(maximumFrontierSize);
+    algorithm->setMainDevice(device);
+    auto result = algorithm->updateAndGetOutputData<Segmentation>();
+    auto access = result->getImageAccess(ACCESS_READ);
+    auto data = (uchar*)access->get();
+    return std::vector<uchar>(data, data + result->getNrOfVoxels());
+}
+
+static void checkFrontierGrowing(Image::pointer image, Vector3ui seed, float minimum) {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    // Processing the entire image in every iteration, as before frontier growing
+    const auto expected = growRegion(image, seed, minimum, 0, device);
+    const int segmented = std::count(expected.begin(), expected.end(), 1);
+    CHECK(segmented > image->getNrOfVoxels()/4);
+    CHECK(std::count(expected.begin(), expected.end(), 0) + segmented == expected.size());
+
+    SECTION("Frontier growing") {
+        CHECK(growRegion(image, seed, minimum, -1, device) == expected);
+    }
+    SECTION("Frontier growing which overflows the frontier") {
+        CHECK(growRegion(image, seed, minimum, 16, device) == expected);
+    }
+}
+
+TEST_CASE("2D Seeded region growing of frontier matches growing on entire image", "[fast][SeededRegionGrowing]") {
+    // 8-connected pixels, thus the region spans the image
+    checkFrontierGrowing(createNoiseImage(256, 256, 1), Vector3ui(128, 128, 0), 100);
+}
+
+TEST_CASE("3D Seeded region growing of frontier matches growing on entire image", "[fast][SeededRegionGrowing]") {
+    // 6-connected voxels, thus the region spans the volume
+    checkFrontierGrowing(createNoiseImage(64, 64, 64), Vector3ui(32, 32, 32), 100);
+}
+
 } // end namespace fast
@@ -1,5 +1,7 @@
 #include <FAST/Data/Image.hpp>
 #include "TemplateMatching.hpp"
+#include <eigen3/unsupported/Eigen/FFT>
+#include <complex>
 
 namespace fast {
 
@@ -11,15 +13,158 @@ TemplateMatching::TemplateMatching() {
     createOutputPort<Image>(0); // Match scores
 }
 
-static float calculateMeanIntensity(ImageAccess::pointer& access, const Vector2i start, const Vector2i size) {
-    float sum = 0;
-    for(int y = start.y(); y < start.y() + size.y(); ++y) {
-        for(int x = start.x(); x < start.x() + size.x(); ++x) {
-            sum += access->getScalar(Vector2i(x, y));
+/**
+ * Copy the first channel of a region of an image to a float buffer
+ */
+static std::vector<float> getRegionAsFloat(SharedPointer<Image> image, const Vector2i start, const Vector2i size) {
+    auto access = image->getImageAccess(ACCESS_READ);
+    const int width = image->getWidth();
+    const int channels = image->getNrOfChannels();
+    std::vector<float> result(size.x()*size.y());
+    switch(image->getDataType()) {
+        fastSwitchTypeMacro(
+            const FAST_TYPE* data = (const FAST_TYPE*)access->get();
+            for(int y = 0; y < size.y(); ++y) {
+                for(int x = 0; x < size.x(); ++x)
+                    result[x + y*size.x()] = data[((start.x() + x) + (start.y() + y)*width)*channels];
+            }
+        )
+    }
+    return result;
+}
+
+/**
+ * Smallest size >= n which only has the prime factors 2, 3 and 5, which are fast FFT sizes
+ */
+static int getFFTSize(int n) {
+    while(true) {
+        int remainder = n;
+        for(int factor : {2, 3, 5}) {
+            while(remainder % factor == 0)
+                remainder /= factor;
+        }
+        if(remainder == 1)
+            return n;
+        ++n;
+    }
+}
+
+/**
+ * In-place 2D FFT, by doing 1D FFTs of all rows and then all columns
+ */
+static void fft2D(std::vector<std::complex<double>>& data, const int width, const int height, const bool inverse) {
+    #pragma omp parallel
+    {
+        Eigen::FFT<double> fft;
+        std::vector<std::complex<double>> input;
+        std::vector<std::complex<double>> output;
+        #pragma omp for
+        for(int y = 0; y < height; ++y) {
+            input.assign(data.begin() + y*width, data.begin() + (y + 1)*width);
+            if(inverse) {
+                fft.inv(output, input);
+            } else {
+                fft.fwd(output, input);
+            }
+            std::copy(output.begin(), output.end(), data.begin() + y*width);
+        }
+        input.resize(height);
+        #pragma omp for
+        for(int x = 0; x < width; ++x) {
+            for(int y = 0; y < height; ++y)
+                input[y] = data[x + y*width];
+            if(inverse) {
+                fft.inv(output, input);
+            } else {
+                fft.fwd(output, input);
+            }
+            for(int y = 0; y < height; ++y)
+                data[x + y*width] = output[y];
+        }
+    }
+}
+
+/**
+ * Cross correlation of a region with a template, for every position where the template is inside the region:
+ * result(x, y) = sum over a, b of region(x + a, y + b)*templateData(a, b)
+ *
+ * Uses FFT when it requires fewer operations than direct summation, which is typically the case when
+ * searching the entire image. For small regions of interest, direct summation is faster.
+ */
+static std::vector<double> crossCorrelate(const std::vector<float>& region, const int regionWidth, const int regionHeight,
+                                          const std::vector<float>& templateData, const int templateWidth, const int templateHeight) {
+    const int width = regionWidth - templateWidth + 1;
+    const int height = regionHeight - templateHeight + 1;
+    std::vector<double> result(width*height);
+
+    const int fftWidth = getFFTSize(regionWidth);
+    const int fftHeight = getFFTSize(regionHeight);
+    const double directCost = (double)width*height*templateWidth*templateHeight;
+    // 2 forward and 1 inverse complex 2D FFT
+    const double fftCost = 3.0*4.0*fftWidth*fftHeight*(std::log2(fftWidth) + std::log2(fftHeight));
+
+    if(directCost <= fftCost) {
+        #pragma omp parallel for
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                double sum = 0.0;
+                for(int b = 0; b < templateHeight; ++b) {
+                    const float* regionRow = &region[x + (y + b)*regionWidth];
+                    const float* templateRow = &templateData[b*templateWidth];
+                    float rowSum = 0.0f;
+                    for(int a = 0; a < templateWidth; ++a)
+                        rowSum += regionRow[a]*templateRow[a];
+                    sum += rowSum;
+                }
+                result[x + y*width] = sum;
+            }
+        }
+    } else {
+        // Zero padded, large enough to avoid wrap around for the valid positions
+        std::vector<std::complex<double>> regionFFT(fftWidth*fftHeight, 0.0);
+        std::vector<std::complex<double>> templateFFT(fftWidth*fftHeight, 0.0);
+        for(int y = 0; y < regionHeight; ++y) {
+            for(int x = 0; x < regionWidth; ++x)
+                regionFFT[x + y*fftWidth] = region[x + y*regionWidth];
+        }
+        for(int y = 0; y < templateHeight; ++y) {
+            for(int x = 0; x < templateWidth; ++x)
+                templateFFT[x + y*fftWidth] = templateData[x + y*templateWidth];
+        }
+        fft2D(regionFFT, fftWidth, fftHeight, false);
+        fft2D(templateFFT, fftWidth, fftHeight, false);
+        for(int i = 0; i < regionFFT.size(); ++i)
+            regionFFT[i] *= std::conj(templateFFT[i]);
+        fft2D(regionFFT, fftWidth, fftHeight, true);
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x)
+                result[x + y*width] = regionFFT[x + y*fftWidth].real();
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Summed area table with an extra row and column of zeros at the start
+ */
+static std::vector<double> createSummedAreaTable(const std::vector<float>& region, const int width, const int height, const bool squared) {
+    const int stride = width + 1;
+    std::vector<double> table(stride*(height + 1), 0.0);
+    for(int y = 0; y < height; ++y) {
+        double rowSum = 0.0;
+        for(int x = 0; x < width; ++x) {
+            const double value = region[x + y*width];
+            rowSum += squared ? value*value : value;
+            table[(x + 1) + (y + 1)*stride] = table[(x + 1) + y*stride] + rowSum;
         }
     }
+    return table;
+}
 
-    return sum / (size.x()*size.y());
+static double getWindowSum(const std::vector<double>& table, const int stride, const int x, const int y, const int width, const int height) {
+    return table[(x + width) + (y + height)*stride] - table[x + (y + height)*stride]
+         - table[(x + width) + y*stride] + table[x + y*stride];
 }
 
 void TemplateMatching::execute() {
@@ -29,112 +174,125 @@ void TemplateMatching::execute() {
     if(templateImage->getWidth() % 2 == 0 || templateImage->getHeight() % 2 == 0)
         throw Exception("Template image size for template matching must be odd");
 
-    outputScores = Image::New();
-    outputScores->create(image->getSize(), TYPE_FLOAT, 1);
-    outputScores->fill(0);
-    auto outputAccess = outputScores->getImageAccess(ACCESS_READ_WRITE);
-    auto templateAccess = templateImage->getImageAccess(ACCESS_READ);
-    uchar* templatePointer = (uchar*)templateAccess->get();
-    auto imageAccess = image->getImageAccess(ACCESS_READ);
-    uchar* imagePointer = (uchar*)imageAccess->get();
-
-    float templateMean = 0.0f;
-    if(m_type == MatchingMetric::NORMALIZED_CROSS_CORRELATION)
-        templateMean = calculateMeanIntensity(templateAccess, Vector2i::Zero(), Vector2i(templateImage->getWidth(), templateImage->getHeight()));
-
-    int start_y = templateImage->getHeight();
-    int start_x = templateImage->getWidth();
-    int end_y = image->getHeight() - templateImage->getHeight();
-    int end_x = image->getWidth() - templateImage->getWidth();
+    const int templateWidth = templateImage->getWidth();
+    const int templateHeight = templateImage->getHeight();
+    const int halfSize_x = templateWidth / 2;
+    const int halfSize_y = templateHeight / 2;
+    int start_y = templateHeight;
+    int start_x = templateWidth;
+    int end_y = image->getHeight() - templateHeight;
+    int end_x = image->getWidth() - templateWidth;
     if(m_center.x() != -1) {
         start_x = m_center.x() - m_offset.x();
         end_x = m_center.x() + m_offset.x();
         start_y = m_center.y() - m_offset.y();
         end_y = m_center.y() + m_offset.y();
     }
+    // The template must be inside the image at every position
+    start_x = std::max(start_x, halfSize_x);
+    start_y = std::max(start_y, halfSize_y);
+    end_x = std::min(end_x, (int)image->getWidth() - 1 - halfSize_x);
+    end_y = std::min(end_y, (int)image->getHeight() - 1 - halfSize_y);
+    if(start_x > end_x || start_y > end_y)
+        throw Exception("Region of interest for template matching is outside the image");
+
+    // All scores are calculated from the part of the image covered by the template at any position
+    const int positions_x = end_x - start_x + 1;
+    const int positions_y = end_y - start_y + 1;
+    const int regionWidth = positions_x + templateWidth - 1;
+    const int regionHeight = positions_y + templateHeight - 1;
+    const std::vector<float> region = getRegionAsFloat(image, Vector2i(start_x - halfSize_x, start_y - halfSize_y), Vector2i(regionWidth, regionHeight));
+    std::vector<float> templateData = getRegionAsFloat(templateImage, Vector2i::Zero(), Vector2i(templateWidth, templateHeight));
+    const int templateSize = templateWidth*templateHeight;
 
-    int halfSize_x = templateImage->getWidth() / 2;
-    int halfSize_y = templateImage->getHeight() / 2;
-    float bestMatchScore = std::numeric_limits<float>::min();
     float maxIntensity = image->calculateMaximumIntensity();
     float minIntensity = image->calculateMinimumIntensity();
-    // For every possible ROI position
-    switch(m_type) {
-        case MatchingMetric::NORMALIZED_CROSS_CORRELATION:
-            for (int y = start_y; y <= end_y; ++y) {
-                for (int x = start_x; x <= end_x; ++x) {
-                    float imageTargetMean = calculateMeanIntensity(imageAccess,
-                                                                   Vector2i(x - halfSize_x, y - halfSize_y),
-                                                                   Vector2i(templateImage->getWidth(),
-                                                                            templateImage->getHeight()));
-                    float upperPart = 0.0f;
-                    float lowerPart1 = 0.0f;
-                    float lowerPart2 = 0.0f;
-                    // Loop over current ROI
-                    for (int a = -halfSize_x; a <= halfSize_x; ++a) {
-                        for (int b = -halfSize_y; b <= halfSize_y; ++b) {
-                            float imagePart = (imageAccess->getScalar(Vector2i(x + a, y + b)) - imageTargetMean);
-                            float templatePart = (templateAccess->getScalar(Vector2i(a + halfSize_x, b + halfSize_y)) -
-                                                  templateMean);
-                            upperPart += imagePart * templatePart;
-                            lowerPart1 += imagePart * imagePart;
-                            lowerPart2 += templatePart * templatePart;
-                        }
-                    }
+    const float intensityRange = maxIntensity > minIntensity ? maxIntensity - minIntensity : 1.0f;
 
-                    float result = upperPart / std::sqrt(lowerPart1 * lowerPart2);
-                    outputAccess->setScalar(Vector2i(x, y), result);
-                    if (result > bestMatchScore) {
-                        bestMatchScore = result;
-                        m_bestFitPosition = Vector2i(x, y);
-                    }
+    std::vector<float> scores(positions_x*positions_y);
+    switch(m_type) {
+        case MatchingMetric::NORMALIZED_CROSS_CORRELATION: {
+            // The numerator sum (I - mean(I))*(T - mean(T)) is equal to sum I*(T - mean(T)), thus
+            // only the template has to be zero mean for the cross correlation.
+            // The image variance of each position is found using summed area tables.
+            double templateMean = 0.0;
+            for(float value : templateData)
+                templateMean += value;
+            templateMean /= templateSize;
+            double templateVariance = 0.0;
+            for(float& value : templateData) {
+                value -= templateMean;
+                templateVariance += value*value;
+            }
+            const auto correlation = crossCorrelate(region, regionWidth, regionHeight, templateData, templateWidth, templateHeight);
+            const auto sumTable = createSummedAreaTable(region, regionWidth, regionHeight, false);
+            const auto squaredSumTable = createSummedAreaTable(region, regionWidth, regionHeight, true);
+            #pragma omp parallel for
+            for(int y = 0; y < positions_y; ++y) {
+                for(int x = 0; x < positions_x; ++x) {
+                    const double sum = getWindowSum(sumTable, regionWidth + 1, x, y, templateWidth, templateHeight);
+                    const double squaredSum = getWindowSum(squaredSumTable, regionWidth + 1, x, y, templateWidth, templateHeight);
+                    const double imageVariance = std::max(0.0, squaredSum - sum*sum/templateSize);
+                    const double lowerPart = std::sqrt(imageVariance*templateVariance);
+                    scores[x + y*positions_x] = lowerPart > 0.0 ? (float)(correlation[x + y*positions_x] / lowerPart) : 0.0f;
+                }
+            }
+            break;
+        }
+        case MatchingMetric::SUM_OF_SQUARED_DIFFERENCES: {
+            // sum (I - T)^2 = sum I^2 - 2*sum I*T + sum T^2
+            double templateSquaredSum = 0.0;
+            for(float value : templateData)
+                templateSquaredSum += value*value;
+            const auto correlation = crossCorrelate(region, regionWidth, regionHeight, templateData, templateWidth, templateHeight);
+            const auto squaredSumTable = createSummedAreaTable(region, regionWidth, regionHeight, true);
+            const double normalization = (double)intensityRange*intensityRange*templateSize;
+            #pragma omp parallel for
+            for(int y = 0; y < positions_y; ++y) {
+                for(int x = 0; x < positions_x; ++x) {
+                    const double squaredSum = getWindowSum(squaredSumTable, regionWidth + 1, x, y, templateWidth, templateHeight);
+                    const double ssd = std::max(0.0, squaredSum - 2.0*correlation[x + y*positions_x] + templateSquaredSum);
+                    scores[x + y*positions_x] = (float)(1.0 - ssd / normalization); // calculate average and invert
                 }
             }
             break;
-        case MatchingMetric::SUM_OF_ABSOLUTE_DIFFERENCES:
-            for (int y = start_y; y <= end_y; ++y) {
-                for (int x = start_x; x <= end_x; ++x) {
+        }
+        case MatchingMetric::SUM_OF_ABSOLUTE_DIFFERENCES: {
+            #pragma omp parallel for
+            for(int y = 0; y < positions_y; ++y) {
+                for(int x = 0; x < positions_x; ++x) {
                     float sad = 0.0f;
-                    // Loop over current ROI
-                    for (int a = -halfSize_x; a <= halfSize_x; ++a) {
-                        for (int b = -halfSize_y; b <= halfSize_y; ++b) {
-                            float imagePart = (imagePointer[x + a + (y + b)*image->getWidth()] - minIntensity) / (maxIntensity - minIntensity);
-                            float templatePart = (templatePointer[a + halfSize_x + (b + halfSize_y)*templateImage->getWidth()] - minIntensity) / (maxIntensity - minIntensity);
-                            sad += std::fabs(imagePart - templatePart);
-                        }
-                    }
-                    const float result = 1.0f - (sad/(templateImage->getWidth()*templateImage->getHeight())); // calculate average and invert
-
-                    outputAccess->setScalar(Vector2i(x, y), result);
-                    if (result > bestMatchScore) {
-                        bestMatchScore = result;
-                        m_bestFitPosition = Vector2i(x, y);
+                    for(int b = 0; b < templateHeight; ++b) {
+                        const float* regionRow = &region[x + (y + b)*regionWidth];
+                        const float* templateRow = &templateData[b*templateWidth];
+                        for(int a = 0; a < templateWidth; ++a)
+                            sad += std::fabs(regionRow[a] - templateRow[a]);
                     }
+                    scores[x + y*positions_x] = 1.0f - (sad / (intensityRange*templateSize)); // calculate average and invert
                 }
             }
             break;
-        case MatchingMetric::SUM_OF_SQUARED_DIFFERENCES:
-            for (int y = start_y; y <= end_y; ++y) {
-                for (int x = start_x; x <= end_x; ++x) {
-                    float ssd = 0.0f;
-                    // Loop over current ROI
-                    for (int a = -halfSize_x; a <= halfSize_x; ++a) {
-                        for (int b = -halfSize_y; b <= halfSize_y; ++b) {
-                            float imagePart = (imageAccess->getScalar(Vector2i(x + a, y + b)) - minIntensity) / (maxIntensity - minIntensity);
-                            float templatePart = (templateAccess->getScalar(Vector2i(a + halfSize_x, b + halfSize_y)) - minIntensity) / (maxIntensity - minIntensity);
-                            ssd += (imagePart - templatePart)*(imagePart - templatePart);
-                        }
-                    }
-                    const float result = 1.0f - (ssd/(templateImage->getWidth()*templateImage->getHeight())); // calculate average and invert
+        }
+    }
 
-                    outputAccess->setScalar(Vector2i(x, y), result);
-                    if (result > bestMatchScore) {
-                        bestMatchScore = result;
-                        m_bestFitPosition = Vector2i(x, y);
-                    }
+    outputScores = Image::New();
+    outputScores->create(image->getSize(), TYPE_FLOAT, 1);
+    {
+        auto outputAccess = outputScores->getImageAccess(ACCESS_READ_WRITE);
+        float* output = (float*)outputAccess->get();
+        const int width = image->getWidth();
+        std::fill(output, output + width*image->getHeight(), 0.0f);
+        float bestMatchScore = std::numeric_limits<float>::lowest();
+        for(int y = 0; y < positions_y; ++y) {
+            for(int x = 0; x < positions_x; ++x) {
+                const float result = scores[x + y*positions_x];
+                output[(start_x + x) + (start_y + y)*width] = result;
+                if(result > bestMatchScore) {
+                    bestMatchScore = result;
+                    m_bestFitPosition = Vector2i(start_x + x, start_y + y);
                 }
             }
-            break;
+        }
     }
 
     addOutputData(0, outputScores);
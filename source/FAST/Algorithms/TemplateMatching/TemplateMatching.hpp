@@ -9,6 +9,10 @@ class Image;
 /**
  * This algorithms matches a template image to an image using normalized cross correlation (NCC),
  * sum of absolute differences (SAD) or sum of squared differences (SSD).
+ *
+ * For NCC and SSD the local image sums are found using summed area tables, and the cross correlation
+ * with the template is calculated with FFT when searching large regions, or by direct summation for small
+ * regions of interest.
  */
 class FAST_EXPORT TemplateMatching : public ProcessObject {
     FAST_OBJECT(TemplateMatching)
@@ -99,3 +99,93 @@ TEST_CASE("Template matching NCC synthetic sequence", "[fast][NCC][TemplateMatch
         position = newPosition.cast<int>();
     }
 }
+
+static float calculateReferenceScore(const std::vector<uchar>& image, int width, const std::vector<uchar>& templateData, int templateWidth, int templateHeight,
+                                     int x, int y, TemplateMatching::MatchingMetric metric, float minIntensity, float maxIntensity) {
+    const int size = templateWidth*templateHeight;
+    double imageMean = 0.0;
+    double templateMean = 0.0;
+    for(int b = 0; b < templateHeight; ++b) {
+        for(int a = 0; a < templateWidth; ++a) {
+            imageMean += image[(x - templateWidth/2 + a) + (y - templateHeight/2 + b)*width];
+            templateMean += templateData[a + b*templateWidth];
+        }
+    }
+    imageMean /= size;
+    templateMean /= size;
+    double upperPart = 0.0, lowerPart1 = 0.0, lowerPart2 = 0.0, ssd = 0.0, sad = 0.0;
+    for(int b = 0; b < templateHeight; ++b) {
+        for(int a = 0; a < templateWidth; ++a) {
+            const double imageValue = image[(x - templateWidth/2 + a) + (y - templateHeight/2 + b)*width];
+            const double templateValue = templateData[a + b*templateWidth];
+            upperPart += (imageValue - imageMean)*(templateValue - templateMean);
+            lowerPart1 += (imageValue - imageMean)*(imageValue - imageMean);
+            lowerPart2 += (templateValue - templateMean)*(templateValue - templateMean);
+            const double difference = (imageValue - templateValue) / (maxIntensity - minIntensity);
+            ssd += difference*difference;
+            sad += std::fabs(difference);
+        }
+    }
+    switch(metric) {
+        case TemplateMatching::MatchingMetric::NORMALIZED_CROSS_CORRELATION:
+            return upperPart / std::sqrt(lowerPart1*lowerPart2);
+        case TemplateMatching::MatchingMetric::SUM_OF_SQUARED_DIFFERENCES:
+            return 1.0 - ssd / size;
+        default:
+            return 1.0 - sad / size;
+    }
+}
+
+TEST_CASE("Template matching scores are equal to direct calculation", "[fast][TemplateMatching]") {
+    // Large enough for the entire image search to use FFT
+    const int width = 301;
+    const int height = 257;
+    std::vector<uchar> data(width*height);
+    uint32_t random = 1;
+    for(int i = 0; i < data.size(); ++i) {
+        random = random*1664525u + 1013904223u;
+        data[i] = (uchar)(random >> 24);
+    }
+    auto image = Image::New();
+    image->create(width, height, TYPE_UINT8, 1, Host::getInstance(), data.data());
+
+    const int templateWidth = 21;
+    const int templateHeight = 19;
+    const Vector2i position(140, 97);
+    std::vector<uchar> templateData(templateWidth*templateHeight);
+    for(int y = 0; y < templateHeight; ++y) {
+        for(int x = 0; x < templateWidth; ++x)
+            templateData[x + y*templateWidth] = data[(position.x() - templateWidth/2 + x) + (position.y() - templateHeight/2 + y)*width];
+    }
+    auto templateImage = Image::New();
+    templateImage->create(templateWidth, templateHeight, TYPE_UINT8, 1, Host::getInstance(), templateData.data());
+    const float minIntensity = image->calculateMinimumIntensity();
+    const float maxIntensity = image->calculateMaximumIntensity();
+
+    for(auto metric : {TemplateMatching::MatchingMetric::NORMALIZED_CROSS_CORRELATION,
+                       TemplateMatching::MatchingMetric::SUM_OF_SQUARED_DIFFERENCES,
+                       TemplateMatching::MatchingMetric::SUM_OF_ABSOLUTE_DIFFERENCES}) {
+        // Search the entire image, and a small region of interest
+        for(bool useRegionOfInterest : {false, true}) {
+            auto matching = TemplateMatching::New();
+            matching->setMatchingMetric(metric);
+            matching->setInputData(0, image);
+            matching->setInputData(1, templateImage);
+            if(useRegionOfInterest)
+                matching->setRegionOfInterest(position + Vector2i(1, -1), Vector2i(3, 2));
+            auto port = matching->getOutputPort();
+            matching->update();
+            auto scores = port->getNextFrame<Image>();
+            CHECK(matching->getBestFitPixelPosition() == position);
+
+            auto access = scores->getImageAccess(ACCESS_READ);
+            for(int y = templateHeight; y <= height - templateHeight; ++y) {
+                for(int x = templateWidth; x <= width - templateWidth; ++x) {
+                    const bool inside = !useRegionOfInterest || (std::abs(x - position.x() - 1) <= 3 && std::abs(y - position.y() + 1) <= 2);
+                    const float expected = inside ? calculateReferenceScore(data, width, templateData, templateWidth, templateHeight, x, y, metric, minIntensity, maxIntensity) : 0.0f;
+                    REQUIRE(access->getScalar(Vector2i(x, y)) == Approx(expected).margin(1e-4));
+                }
+            }
+        }
+    }
+}
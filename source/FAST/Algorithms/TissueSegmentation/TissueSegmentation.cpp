@@ -37,7 +37,6 @@ void TissueSegmentation::execute() {
                 cl::NDRange(input->getWidth(), input->getHeight()),
                 cl::NullRange
         );
-        device->getCommandQueue().finish();
     }
 
     auto erosion = Erosion::New();
@@ -16,6 +16,8 @@ namespace Config {
     FAST_EXPORT std::string getQtPluginsPath();
     FAST_EXPORT StreamingMode getStreamingMode();
     FAST_EXPORT void setStreamingMode(StreamingMode mode);
+    FAST_EXPORT ExecutionMode getExecutionMode();
+    FAST_EXPORT void setExecutionMode(ExecutionMode mode);
 	FAST_EXPORT void setTestDataPath(std::string path);
 	FAST_EXPORT void setKernelSourcePath(std::string path);
 	FAST_EXPORT void setKernelBinaryPath(std::string path);
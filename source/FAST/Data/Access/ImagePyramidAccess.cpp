@@ -14,9 +14,38 @@ ImagePyramidAccess::ImagePyramidAccess(std::vector<ImagePyramidLevel> levels, op
 	m_levels = levels;
 	m_write = write;
     m_fileHandle = fileHandle;
+	m_cursors.resize(m_levels.size());
+}
+
+void ImagePyramidAccess::unpinTiles() {
+	for(int level = 0; level < m_cursors.size(); ++level) {
+		TileCursor& cursor = m_cursors[level];
+		if(cursor.data != nullptr)
+			m_levels[level].tiles->unpinTile(cursor.tileIndex);
+		cursor = TileCursor();
+	}
+}
+
+uint8_t* ImagePyramidAccess::getPixelData(uint x, uint y, uint level, bool write) {
+	const auto& tiles = m_levels[level].tiles;
+	TileCursor& cursor = m_cursors[level];
+	const int tileIndex = tiles->getTileIndex(x, y);
+	if(tileIndex != cursor.tileIndex || (write && !cursor.write)) {
+		// Pin the new tile before unpinning the previous one, as it may be the same tile
+		uint8_t* data = tiles->pinTile(tileIndex, write);
+		if(cursor.data != nullptr)
+			tiles->unpinTile(cursor.tileIndex);
+		cursor.tileIndex = tileIndex;
+		cursor.data = data;
+		cursor.write = write;
+	}
+	if(cursor.data == nullptr)
+		return nullptr;
+	return cursor.data + tiles->getTileDataOffset(x, y);
 }
 
 void ImagePyramidAccess::release() {
+	unpinTiles();
 	m_image->accessFinished();
 }
 
@@ -24,21 +53,15 @@ ImagePyramidAccess::~ImagePyramidAccess() {
 	release();
 }
 
-void ImagePyramidAccess::setScalarFast(uint x, uint y, uint level, uint8_t value, uint channel) noexcept {
+void ImagePyramidAccess::setScalarFast(uint x, uint y, uint level, uint8_t value, uint channel) {
     if(!m_write)
         return;
-	auto levelData = m_levels[level];
-    std::size_t pos = (x + (std::size_t)y * levelData.width) * m_image->getNrOfChannels() + channel;
-	levelData.data[pos] = value;
+	getPixelData(x, y, level, true)[channel] = value;
 
     // add patch to list of dirty patches
     int levelWidth = m_image->getLevelWidth(level);
     int levelHeight = m_image->getLevelHeight(level);
-    int patches = m_image->getLevelPatches(level);
-
-    int patchIdX = std::floor(((float)x / levelWidth)* patches);
-    int patchIdY = std::floor(((float)y / levelHeight)* patches);
-    m_image->setDirtyPatch(level, patchIdX, patchIdY);
+    m_image->setDirtyPatch(level, x / m_levels[level].tileWidth, y / m_levels[level].tileHeight);
 
     // Propagate change upwards recursively
     if(level != m_levels.size() - 1) {
@@ -67,7 +90,7 @@ void ImagePyramidAccess::setScalar(uint x, uint y, uint level, uint8_t value, ui
 	// Make sure it has write rights
 	if(!m_write)
 		throw Exception("ImagePyramidAccess has not write rights, but tried to write a value");
-	auto levelData = m_levels[level];
+	const auto& levelData = m_levels[level];
 	if(x >= levelData.width || y >= levelData.height)
 		throw OutOfBoundsException();
 
@@ -75,17 +98,140 @@ void ImagePyramidAccess::setScalar(uint x, uint y, uint level, uint8_t value, ui
 }
 
 uint8_t ImagePyramidAccess::getScalar(uint x, uint y, uint level, uint channel) {
-	auto levelData = m_levels[level];
+	const auto& levelData = m_levels[level];
 	if(x >= levelData.width || y >= levelData.height)
 		throw OutOfBoundsException();
-	return levelData.data[(x + y * levelData.width) * m_image->getNrOfChannels() + channel];
+	return getScalarFast(x, y, level, channel);
+}
+
+uint8_t ImagePyramidAccess::getScalarFast(uint x, uint y, uint level, uint channel) {
+	const uint8_t* data = getPixelData(x, y, level, false);
+	return data == nullptr ? 0 : data[channel];
 }
 
-uint8_t ImagePyramidAccess::getScalarFast(uint x, uint y, uint level, uint channel) noexcept {
-	auto levelData = m_levels[level];
-	return levelData.data[(x + y * levelData.width) * m_image->getNrOfChannels() + channel];
+
+/**
+ * Average each 2x2 block of source into one pixel of destination. Blocks which are only partly inside the
+ * valid region of source are averaged over the valid pixels, like in setScalarFast.
+ * Integer rounding is equal to std::round of the float average.
+ * The number of channels is a template parameter, so that the compiler can vectorize the inner loops.
+ */
+template <int C>
+static void downsample2x2(const uint8_t* source, int sourceWidth, int validWidth, int validHeight,
+                          uint8_t* destination, int width, int height) {
+    // Number of destination pixels with a full 2x2 block in x direction
+    const int fullWidth = std::min(width, validWidth / 2);
+    for(int y = 0; y < height; ++y) {
+        const uint8_t* row0 = source + (std::size_t)(y * 2) * sourceWidth * C;
+        const uint8_t* row1 = row0 + (std::size_t)sourceWidth * C;
+        uint8_t* out = destination + (std::size_t)y * width * C;
+        const bool hasBelow = y * 2 + 1 < validHeight;
+        if(hasBelow) {
+            for(int x = 0; x < fullWidth; ++x) {
+                for(int c = 0; c < C; ++c)
+                    out[x*C + c] = (uint8_t)((row0[x*2*C + c] + row0[(x*2 + 1)*C + c] + row1[x*2*C + c] + row1[(x*2 + 1)*C + c] + 2) >> 2);
+            }
+        } else {
+            for(int x = 0; x < fullWidth; ++x) {
+                for(int c = 0; c < C; ++c)
+                    out[x*C + c] = (uint8_t)((row0[x*2*C + c] + row0[(x*2 + 1)*C + c] + 1) >> 1);
+            }
+        }
+        // Last column, if the valid source width is odd
+        for(int x = fullWidth; x < width; ++x) {
+            for(int c = 0; c < C; ++c)
+                out[x*C + c] = hasBelow ? (uint8_t)((row0[x*2*C + c] + row1[x*2*C + c] + 1) >> 1) : row0[x*2*C + c];
+        }
+    }
 }
 
+static void downsample2x2(const uint8_t* source, int sourceWidth, int validWidth, int validHeight,
+                          uint8_t* destination, int width, int height, int channels) {
+    switch(channels) {
+        case 1:
+            downsample2x2<1>(source, sourceWidth, validWidth, validHeight, destination, width, height);
+            break;
+        case 2:
+            downsample2x2<2>(source, sourceWidth, validWidth, validHeight, destination, width, height);
+            break;
+        case 3:
+            downsample2x2<3>(source, sourceWidth, validWidth, validHeight, destination, width, height);
+            break;
+        case 4:
+            downsample2x2<4>(source, sourceWidth, validWidth, validHeight, destination, width, height);
+            break;
+        default:
+            throw Exception("Unsupported number of channels in image pyramid");
+    }
+}
+
+void ImagePyramidAccess::setPatch(int level, int x, int y, int width, int height, const uint8_t* data) {
+    if(!m_write)
+        throw Exception("ImagePyramidAccess has not write rights, but tried to write a patch");
+    if(m_fileHandle != nullptr)
+        throw Exception("Writing to image pyramids read with openslide is not supported");
+    if(level < 0 || level >= m_levels.size())
+        throw Exception("Incorrect level given to setPatch: " + std::to_string(level));
+    if(x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > m_levels[level].width || y + height > m_levels[level].height)
+        throw OutOfBoundsException();
+
+    // Tiles which were not allocated when pinned are allocated by setRegion
+    unpinTiles();
+    const int channels = m_image->getNrOfChannels();
+    m_levels[level].tiles->setRegion(x, y, width, height, data);
+    setDirtyPatches(level, x, y, width, height);
+
+    // Propagate change to the coarser levels, one level at a time
+    for(int parentLevel = level + 1; parentLevel < m_levels.size(); ++parentLevel) {
+        const auto& child = m_levels[parentLevel - 1];
+        const auto& parent = m_levels[parentLevel];
+        const int parentX = x / 2;
+        const int parentY = y / 2;
+        const int parentWidth = std::min((x + width + 1) / 2, parent.width) - parentX;
+        const int parentHeight = std::min((y + height + 1) / 2, parent.height) - parentY;
+        if(parentWidth <= 0 || parentHeight <= 0)
+            break;
+
+        // Read all child pixels of the parent region, which includes neighbours of the updated child region
+        const int sourceWidth = parentWidth * 2;
+        const int sourceHeight = parentHeight * 2;
+        auto source = make_uninitialized_unique<uint8_t[]>((std::size_t)sourceWidth * sourceHeight * channels);
+        child.tiles->getRegion(parentX * 2, parentY * 2, sourceWidth, sourceHeight, source.get());
+        auto destination = make_uninitialized_unique<uint8_t[]>((std::size_t)parentWidth * parentHeight * channels);
+        downsample2x2(source.get(), sourceWidth, std::min(sourceWidth, child.width - parentX * 2),
+                      std::min(sourceHeight, child.height - parentY * 2), destination.get(), parentWidth, parentHeight, channels);
+        parent.tiles->setRegion(parentX, parentY, parentWidth, parentHeight, destination.get());
+        setDirtyPatches(parentLevel, parentX, parentY, parentWidth, parentHeight);
+
+        x = parentX;
+        y = parentY;
+        width = parentWidth;
+        height = parentHeight;
+    }
+}
+
+void ImagePyramidAccess::setPatch(int level, int x, int y, SharedPointer<Image> patch) {
+    if(patch->getDataType() != TYPE_UINT8)
+        throw Exception("Image given to ImagePyramidAccess::setPatch must be of type TYPE_UINT8");
+    if(patch->getNrOfChannels() != m_image->getNrOfChannels())
+        throw Exception("Image given to ImagePyramidAccess::setPatch must have the same number of channels as the image pyramid");
+    auto access = patch->getImageAccess(ACCESS_READ);
+    setPatch(level, x, y, patch->getWidth(), patch->getHeight(), (const uint8_t*)access->get());
+}
+
+void ImagePyramidAccess::setDirtyPatches(int level, int x, int y, int width, int height) {
+    // Same patch id calculation as in setScalarFast
+    const int tileWidth = m_levels[level].tileWidth;
+    const int tileHeight = m_levels[level].tileHeight;
+    const int startPatchX = x / tileWidth;
+    const int startPatchY = y / tileHeight;
+    const int endPatchX = (x + width - 1) / tileWidth;
+    const int endPatchY = (y + height - 1) / tileHeight;
+    for(int patchY = startPatchY; patchY <= endPatchY; ++patchY) {
+        for(int patchX = startPatchX; patchX <= endPatchX; ++patchX)
+            m_image->setDirtyPatch(level, patchX, patchY);
+    }
+}
 
 ImagePyramidPatch ImagePyramidAccess::getPatch(std::string tile) {
     auto parts = split(tile, "_");
@@ -109,14 +255,8 @@ std::unique_ptr<uchar[]> ImagePyramidAccess::getPatchData(int level, int x, int
 		float scale = (float)m_image->getFullWidth()/levelWidth;
         openslide_read_region(m_fileHandle, (uint32_t*)data.get(), x * scale, y * scale, level, width, height);
     } else {
-        auto levelData = m_levels[level];
-        for(int cy = y; cy < std::min(y + height, levelHeight); ++cy) {
-            for(int cx = x; cx < std::min(x + width, levelWidth); ++cx) {
-                for(int channel = 0; channel < channels; ++channel) {
-                    data[(cx - x + (cy - y) * width)*channels + channel] = levelData.data[(cx + cy * levelWidth)*channels + channel];
-                }
-            }
-        }
+        // Only the tiles overlapping the region are read
+        m_levels[level].tiles->getRegion(x, y, width, height, data.get());
     }
 
     return data;
@@ -126,17 +266,12 @@ ImagePyramidPatch ImagePyramidAccess::getPatch(int level, int tile_x, int tile_y
     // Create patch
     int levelWidth = m_image->getLevelWidth(level);
     int levelHeight = m_image->getLevelHeight(level);
-    int tiles = m_image->getLevelPatches(level);
     ImagePyramidPatch tile;
-    tile.offsetX = tile_x * (int) std::floor((float) levelWidth / tiles);
-    tile.offsetY = tile_y * (int) std::floor((float) levelHeight / tiles);
-
-    tile.width = std::floor(((float) levelWidth / tiles));
-    if(tile_x == tiles - 1)
-        tile.width = levelWidth - tile.offsetX;
-    tile.height = std::floor((float) levelHeight / tiles);
-    if(tile_y == tiles - 1)
-        tile.height = levelHeight - tile.offsetY;
+    tile.offsetX = tile_x * m_levels[level].tileWidth;
+    tile.offsetY = tile_y * m_levels[level].tileHeight;
+    // Tiles at the right and bottom border may be smaller
+    tile.width = std::min(m_levels[level].tileWidth, levelWidth - tile.offsetX);
+    tile.height = std::min(m_levels[level].tileHeight, levelHeight - tile.offsetY);
 
     // Read the actual data
     tile.data = getPatchData(level, tile.offsetX, tile.offsetY, tile.width, tile.height);
@@ -155,7 +290,9 @@ SharedPointer<Image> ImagePyramidAccess::getLevelAsImage(int level) {
 
     auto image = Image::New();
     if(m_fileHandle == nullptr) {
-		image->create(width, height, TYPE_UINT8, 4, m_levels[level].data);
+		auto data = make_uninitialized_unique<uchar[]>(width*height*m_image->getNrOfChannels());
+		m_levels[level].tiles->getRegion(0, 0, width, height, data.get());
+		image->create(width, height, TYPE_UINT8, m_image->getNrOfChannels(), std::move(data));
     } else {
 		auto data = make_uninitialized_unique<uchar[]>(width*height*4);
         openslide_read_region(m_fileHandle, (uint32_t*)data.get(), 0, 0, level, width, height);
@@ -168,9 +305,10 @@ SharedPointer<Image> ImagePyramidAccess::getLevelAsImage(int level) {
     ));
     SceneGraph::setParentNode(image, std::dynamic_pointer_cast<SpatialDataObject>(m_image));
 
-    // Data is stored as BGRA, need to delete alpha channel and reverse it
+    // Data is stored as BGRA, need to delete alpha channel and reverse it. Same for both kinds of storage.
     auto channelConverter = ImageChannelConverter::New();
-    channelConverter->setChannelsToRemove(false, false, false, true);
+    if(image->getNrOfChannels() == 4)
+        channelConverter->setChannelsToRemove(false, false, false, true);
     channelConverter->setReverseChannels(true);
     channelConverter->setInputData(image);
 
@@ -211,17 +349,11 @@ SharedPointer<Image> ImagePyramidAccess::getPatchAsImage(int level, int offsetX,
 SharedPointer<Image> ImagePyramidAccess::getPatchAsImage(int level, int patchIdX, int patchIdY) {
     int levelWidth = m_image->getLevelWidth(level);
     int levelHeight = m_image->getLevelHeight(level);
-    int tiles = m_image->getLevelPatches(level);
     ImagePyramidPatch tile;
-    tile.offsetX = patchIdX * (int) std::floor((float) levelWidth / tiles);
-    tile.offsetY = patchIdY * (int) std::floor((float) levelHeight / tiles);
-
-    tile.width = std::floor(((float) levelWidth / tiles));
-    if(patchIdX == tiles - 1)
-        tile.width = levelWidth - tile.offsetX;
-    tile.height = std::floor((float) levelHeight / tiles);
-    if(patchIdY == tiles - 1)
-        tile.height = levelHeight - tile.offsetY;
+    tile.offsetX = patchIdX * m_levels[level].tileWidth;
+    tile.offsetY = patchIdY * m_levels[level].tileHeight;
+    tile.width = std::min(m_levels[level].tileWidth, levelWidth - tile.offsetX);
+    tile.height = std::min(m_levels[level].tileHeight, levelHeight - tile.offsetY);
 
     // Read the actual data
     auto data = getPatchData(level, tile.offsetX, tile.offsetY, tile.width, tile.height);
@@ -2,6 +2,7 @@
 
 #include <FAST/Object.hpp>
 #include <FAST/Data/DataTypes.hpp>
+#include <FAST/Data/ImagePyramidTileStorage.hpp>
 
 typedef struct _openslide openslide_t;
 
@@ -23,14 +24,11 @@ typedef struct ImagePyramidLevel {
 	int height;
 	int tileWidth = 256;
 	int tileHeight = 256;
-	int patches;
-	bool memoryMapped;
-	uint8_t* data;
-#ifdef WIN32
-	void* fileHandle;
-#else
-	int fileHandle;
-#endif
+	// Number of tiles in x and y direction. Dirty patches, and the patches given by getPatch, are these tiles.
+	int tilesX;
+	int tilesY;
+	// Pixel data of pyramids created in memory. Not used for pyramids read with openslide.
+	ImagePyramidTileStorage::pointer tiles;
 } Level;
 
 class FAST_EXPORT ImagePyramidAccess : Object {
@@ -38,9 +36,32 @@ public:
 	typedef std::unique_ptr<ImagePyramidAccess> pointer;
 	ImagePyramidAccess(std::vector<ImagePyramidLevel> levels, openslide_t* fileHandle, SharedPointer<ImagePyramid> imagePyramid, bool writeAccess);
 	void setScalar(uint x, uint y, uint level, uint8_t value, uint channel = 0);
-	void setScalarFast(uint x, uint y, uint level, uint8_t value, uint channel = 0) noexcept;
+	/**
+	 * Set a pixel without bounds checking. Not noexcept, since writing may allocate a tile, or read an
+	 * evicted tile back from the swap file.
+	 * The last tile used on each level is pinned by the access, so consecutive pixels in the same tile are
+	 * accessed without locking the tile storage.
+	 */
+	void setScalarFast(uint x, uint y, uint level, uint8_t value, uint channel = 0);
 	uint8_t getScalar(uint x, uint y, uint level, uint channel = 0);
-	uint8_t getScalarFast(uint x, uint y, uint level, uint channel = 0) noexcept;
+	uint8_t getScalarFast(uint x, uint y, uint level, uint channel = 0);
+	/**
+	 * Write a region of a level, and update all coarser levels of the pyramid.
+	 * This is much faster than calling setScalar for each pixel, as the region is copied row by row into the tiles,
+	 * the coarser levels are computed once by 2x2 averaging, and each affected patch is marked as dirty once.
+	 * @param level
+	 * @param x offset
+	 * @param y offset
+	 * @param width
+	 * @param height
+	 * @param data Buffer of size width*height*channels, stored row by row with interleaved channels
+	 */
+	void setPatch(int level, int x, int y, int width, int height, const uint8_t* data);
+	/**
+	 * Write an image to a region of a level, and update all coarser levels of the pyramid.
+	 * The image must be of type TYPE_UINT8 and have the same number of channels as the pyramid.
+	 */
+	void setPatch(int level, int x, int y, SharedPointer<Image> patch);
 	std::unique_ptr<uchar[]> getPatchData(int level, int x, int y, int width, int height);
 	ImagePyramidPatch getPatch(std::string tile);
 	ImagePyramidPatch getPatch(int level, int patchX, int patchY);
@@ -50,6 +71,16 @@ public:
 	void release();
 	~ImagePyramidAccess();
 private:
+	// Last tile used by setScalarFast and getScalarFast on a level. The tile is pinned if data is not nullptr.
+	struct TileCursor {
+		int tileIndex = -1;
+		uint8_t* data = nullptr;
+		bool write = false;
+	};
+	uint8_t* getPixelData(uint x, uint y, uint level, bool write);
+	void unpinTiles();
+	void setDirtyPatches(int level, int x, int y, int width, int height);
+	std::vector<TileCursor> m_cursors;
 	SharedPointer<ImagePyramid> m_image;
 	std::vector<ImagePyramidLevel> m_levels;
 	bool m_write;
@@ -16,7 +16,23 @@ OpenCLBufferAccess::OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<DataOb
     mDataObject = dataObject;
 }
 
+OpenCLBufferAccess::OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<DataObject> dataObject, SharedPointer<OpenCLDevice> device, bool write) : OpenCLBufferAccess(buffer, dataObject) {
+    m_device = device;
+    m_write = write;
+}
+
+void OpenCLBufferAccess::setEvent(cl::Event event) {
+    m_event = event;
+}
+
 void OpenCLBufferAccess::release() {
+    if(!mIsDeleted && m_device && m_device->isMultiQueueMode()) {
+        // Record when the commands using the buffer are finished, before others are allowed to access it
+        cl::Event event = m_event;
+        if(event() == nullptr)
+            m_device->getCommandQueue().enqueueMarkerWithWaitList(nullptr, &event);
+        mDataObject->addOpenCLEvent(m_device, event, m_write);
+    }
     if(!mIsDeleted) {
         delete mBuffer;
         mBuffer = nullptr;
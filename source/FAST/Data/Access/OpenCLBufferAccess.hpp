@@ -14,6 +14,20 @@ class FAST_EXPORT OpenCLBufferAccess {
     public:
         cl::Buffer* get() const;
         OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<DataObject> dataObject);
+        /**
+         * Access which records an event on the data object when released, if the device is in multi queue mode.
+         * @param buffer
+         * @param dataObject
+         * @param device device the buffer is used on
+         * @param write whether the buffer is changed
+         */
+        OpenCLBufferAccess(cl::Buffer* buffer,  SharedPointer<DataObject> dataObject, SharedPointer<OpenCLDevice> device, bool write);
+        /**
+         * Set the event of the last command using the buffer. If no event is set, a marker is enqueued on the
+         * command queue of the device when the access is released.
+         * @param event
+         */
+        void setEvent(cl::Event event);
         void release();
         ~OpenCLBufferAccess();
 		typedef std::unique_ptr<OpenCLBufferAccess> pointer;
@@ -23,6 +37,9 @@ class FAST_EXPORT OpenCLBufferAccess {
         cl::Buffer* mBuffer;
         bool mIsDeleted;
         SharedPointer<DataObject> mDataObject;
+        SharedPointer<OpenCLDevice> m_device;
+        bool m_write = false;
+        cl::Event m_event;
 };
 
 } // end namespace fast
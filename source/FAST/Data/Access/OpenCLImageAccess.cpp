@@ -1,5 +1,6 @@
 #include "OpenCLImageAccess.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/ExecutionDevice.hpp"
 
 namespace fast {
 
@@ -30,7 +31,28 @@ OpenCLImageAccess::OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> ob
     mImageObject = object;
 }
 
+OpenCLImageAccess::OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object, SharedPointer<OpenCLDevice> device, bool write) : OpenCLImageAccess(image, object) {
+    m_device = device;
+    m_write = write;
+}
+
+OpenCLImageAccess::OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object, SharedPointer<OpenCLDevice> device, bool write) : OpenCLImageAccess(image, object) {
+    m_device = device;
+    m_write = write;
+}
+
+void OpenCLImageAccess::setEvent(cl::Event event) {
+    m_event = event;
+}
+
 void OpenCLImageAccess::release() {
+    if(!mIsDeleted && m_device && m_device->isMultiQueueMode()) {
+        // Record when the commands using the image are finished, before others are allowed to access it
+        cl::Event event = m_event;
+        if(event() == nullptr)
+            m_device->getCommandQueue().enqueueMarkerWithWaitList(nullptr, &event);
+        mImageObject->addOpenCLEvent(m_device, event, m_write);
+    }
 	mImageObject->accessFinished();
     if(!mIsDeleted) {
         delete mImage;
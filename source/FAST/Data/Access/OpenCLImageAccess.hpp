@@ -18,6 +18,21 @@ class FAST_EXPORT  OpenCLImageAccess {
         cl::Image3D* get3DImage() const;
         OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object);
         OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object);
+        /**
+         * Access which records an event on the image when released, if the device is in multi queue mode.
+         * @param image
+         * @param object
+         * @param device device the image is used on
+         * @param write whether the image is changed
+         */
+        OpenCLImageAccess(cl::Image2D* image, SharedPointer<Image> object, SharedPointer<OpenCLDevice> device, bool write);
+        OpenCLImageAccess(cl::Image3D* image, SharedPointer<Image> object, SharedPointer<OpenCLDevice> device, bool write);
+        /**
+         * Set the event of the last command using the image. If no event is set, a marker is enqueued on the
+         * command queue of the device when the access is released.
+         * @param event
+         */
+        void setEvent(cl::Event event);
         void release();
         ~OpenCLImageAccess();
 		typedef std::unique_ptr<OpenCLImageAccess> pointer;
@@ -27,6 +42,9 @@ class FAST_EXPORT  OpenCLImageAccess {
         cl::Image* mImage;
         bool mIsDeleted;
         SharedPointer<Image> mImageObject;
+        SharedPointer<OpenCLDevice> m_device;
+        bool m_write = false;
+        cl::Event m_event;
 
 };
 
@@ -9,6 +9,12 @@ TensorAccess::TensorAccess(float *data, TensorShape shape, SharedPointer<Tensor>
     m_tensor = tensor;
 }
 
+TensorAccess::TensorAccess(float *data, TensorShape shape, std::unique_ptr<TensorAccess> viewedAccess) {
+    m_data = data;
+    m_shape = shape;
+    m_viewedAccess = std::move(viewedAccess);
+}
+
 TensorShape TensorAccess::getShape() const {
     return m_shape;
 }
@@ -18,6 +24,10 @@ TensorAccess::~TensorAccess() {
 }
 
 void TensorAccess::release() {
+    if(m_viewedAccess) {
+        m_viewedAccess->release();
+        return;
+    }
     m_tensor->accessFinished();
 }
 
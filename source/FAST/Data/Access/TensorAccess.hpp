@@ -17,6 +17,10 @@ class FAST_EXPORT TensorAccess {
     public:
         typedef std::unique_ptr<TensorAccess> pointer;
         TensorAccess(float* data, TensorShape shape, SharedPointer<Tensor> tensor);
+        /**
+         * Access to a part of the data of another access, used for tensor views
+         */
+        TensorAccess(float* data, TensorShape shape, std::unique_ptr<TensorAccess> viewedAccess);
         float * getRawData();
         TensorShape getShape() const;
         ~TensorAccess();
@@ -25,6 +29,7 @@ class FAST_EXPORT TensorAccess {
         TensorData<NumDimensions> getData() const;
     private:
         SharedPointer<Tensor> m_tensor;
+        std::unique_ptr<TensorAccess> m_viewedAccess;
         TensorShape m_shape;
         float* m_data;
 };
@@ -1,5 +1,7 @@
 #include "FAST/Data/DataObject.hpp"
 #include "FAST/ProcessObject.hpp"
+#include <algorithm>
+#include <map>
 
 namespace fast {
 
@@ -39,6 +41,71 @@ void DataObject::accessFinished() {
 	mDataIsBeingAccessedCondition.notify_one();
 }
 
+void DataObject::addOpenCLEvent(OpenCLDevice::pointer device, cl::Event event, bool write) {
+    std::lock_guard<std::mutex> lock(m_openCLEventsMutex);
+    if(write) {
+        // The writer waited for all earlier commands, so only it has to be waited for from now on
+        m_openCLWriteEvents = {{device, event}};
+        m_openCLReadEvents.clear();
+    } else {
+        // Forget readers which have finished, to avoid accumulating events of data which is read many times
+        m_openCLReadEvents.erase(std::remove_if(m_openCLReadEvents.begin(), m_openCLReadEvents.end(),
+                [](const std::pair<OpenCLDevice::pointer, cl::Event>& readEvent) {
+            return readEvent.second.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() == CL_COMPLETE;
+        }), m_openCLReadEvents.end());
+        m_openCLReadEvents.push_back({device, event});
+    }
+}
+
+void DataObject::waitForOpenCLEvents(ExecutionDevice::pointer device, bool write) {
+    std::vector<std::pair<OpenCLDevice::pointer, cl::Event>> events;
+    {
+        std::lock_guard<std::mutex> lock(m_openCLEventsMutex);
+        events = m_openCLWriteEvents;
+        if(write)
+            events.insert(events.end(), m_openCLReadEvents.begin(), m_openCLReadEvents.end());
+    }
+    if(events.empty())
+        return;
+
+    OpenCLDevice::pointer clDevice;
+    if(!device->isHost())
+        clDevice = std::static_pointer_cast<OpenCLDevice>(device);
+    std::vector<cl::Event> deviceEvents;
+    // Events can only be waited for together if they are in the same context
+    std::map<cl_context, std::vector<cl::Event>> hostEvents;
+    for(auto&& event : events) {
+        if(clDevice && event.first->getContext()() == clDevice->getContext()()) {
+            deviceEvents.push_back(event.second);
+        } else {
+            hostEvents[event.first->getContext()()].push_back(event.second);
+        }
+    }
+    if(!deviceEvents.empty())
+        clDevice->getCommandQueue().enqueueBarrierWithWaitList(&deviceEvents);
+    for(auto&& contextEvents : hostEvents)
+        cl::WaitForEvents(contextEvents.second);
+}
+
+void DataObject::finishOpenCLEvents() {
+    std::vector<std::pair<OpenCLDevice::pointer, cl::Event>> events;
+    {
+        std::lock_guard<std::mutex> lock(m_openCLEventsMutex);
+        events = m_openCLWriteEvents;
+        events.insert(events.end(), m_openCLReadEvents.begin(), m_openCLReadEvents.end());
+        m_openCLWriteEvents.clear();
+        m_openCLReadEvents.clear();
+    }
+    for(auto&& event : events) {
+        try {
+            event.second.wait();
+        } catch(cl::Error& e) {
+            // Failed commands don't use the memory anymore either. Don't throw, since this is used by destructors.
+            reportWarning() << "OpenCL command using data object failed: " << e.what() << reportEnd();
+        }
+    }
+}
+
 uint64_t DataObject::getTimestamp() const {
     return mTimestampModified;
 }
@@ -37,10 +37,33 @@ class FAST_EXPORT  DataObject : public Object {
         std::string getFrameData(std::string name);
         std::unordered_map<std::string, std::string> getFrameData();
         void accessFinished();
+        /**
+         * Record an event of an OpenCL command using this data object, which has to finish before commands on other
+         * command queues, or the host, may use the data. Only used in multi queue mode, see
+         * OpenCLDevice::setMultiQueueMode. Called by OpenCL accesses when they are released.
+         * @param device
+         * @param event
+         * @param write whether the command changes the data
+         */
+        void addOpenCLEvent(OpenCLDevice::pointer device, cl::Event event, bool write);
     protected:
         virtual void free(ExecutionDevice::pointer device) = 0;
         virtual void freeAll() = 0;
 
+        /**
+         * Make the current command queue of the given device wait for recorded OpenCL commands using this data object.
+         * If the device is the host, or a command is in another OpenCL context, the calling thread waits instead.
+         * Writers wait for earlier readers and writers, while readers only wait for earlier writers.
+         * @param device
+         * @param write
+         */
+        void waitForOpenCLEvents(ExecutionDevice::pointer device, bool write);
+        /**
+         * Wait on the host for all recorded OpenCL commands using this data object, and forget them.
+         * Must be done before memory of the data object is reused.
+         */
+        void finishOpenCLEvents();
+
         void blockIfBeingWrittenTo();
         void blockIfBeingAccessed();
 
@@ -67,6 +90,9 @@ class FAST_EXPORT  DataObject : public Object {
         // Indicates whether this data object is the last frame in a stream, and if so, the name of the stream
         std::unordered_set<std::string> m_lastFrame;
 
+        std::mutex m_openCLEventsMutex;
+        std::vector<std::pair<OpenCLDevice::pointer, cl::Event>> m_openCLWriteEvents;
+        std::vector<std::pair<OpenCLDevice::pointer, cl::Event>> m_openCLReadEvents;
 
 };
 
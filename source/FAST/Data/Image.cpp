@@ -1,5 +1,7 @@
 #include "Image.hpp"
+#include "FAST/Data/ImageMemoryPool.hpp"
 #include "FAST/Data/Access/ImageAccess.hpp"
+#include "FAST/Data/ImageStatistics.hpp"
 #include "FAST/Utility.hpp"
 #include "FAST/Exception.hpp"
 #include "FAST/Utility.hpp"
@@ -10,12 +12,7 @@
 namespace fast {
 
 unique_pixel_ptr allocatePixelArray(std::size_t size, DataType type) {
-    unique_pixel_ptr ptr;
-    switch(type) {
-        fastSwitchTypeMacro(ptr = make_unique_pixel<FAST_TYPE>(new FAST_TYPE[size]))
-    }
-
-    return ptr;
+    return ImageMemoryPool::allocateHost(size, type);
 }
 
 // Pad data with 1, 2 or 3 channels to 4 channels with 0
@@ -89,8 +86,17 @@ void Image::transferCLImageFromHost(OpenCLDevice::pointer device) {
 
     // Special treatment for images with 3 channels because an OpenCL image can only have 1, 2 or 4 channels
 	// And if the device does not support 1 or 2 channels
-    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mChannels);
-    if(format.image_channel_order == CL_RGBA && mChannels != 4) {
+    if(isChannelPadded(device) && canPadOnDevice(device, true)) {
+        // Upload the data as it is, and pad it on the device
+        const uint bufferSize = getBufferSize();
+        cl::Buffer* buffer = ImageMemoryPool::allocateBuffer(device, bufferSize);
+        device->getCommandQueue().enqueueWriteBuffer(*buffer, CL_TRUE, 0, bufferSize, mHostData.get());
+        cl::Event padEvent;
+        padBufferToImage(device, *buffer, mCLImages[device], &padEvent);
+        // The pool may give the buffer to another command queue at once, thus the kernel must be done with it
+        padEvent.wait();
+        ImageMemoryPool::releaseBuffer(device, buffer, bufferSize);
+    } else if(isChannelPadded(device)) {
         auto tempData = adaptDataToImage(mHostData.get(), CL_RGBA, mWidth*mHeight*mDepth, mType, mChannels);
         device->getCommandQueue().enqueueWriteImage(*(cl::Image*)mCLImages[device],
         CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
@@ -106,13 +112,24 @@ void Image::transferCLImageFromHost(OpenCLDevice::pointer device) {
 void Image::transferCLImageToHost(OpenCLDevice::pointer device) {
     // Special treatment for images with 3 channels because an OpenCL image can only have 1, 2 or 4 channels
 	// And if the device does not support 1 or 2 channels
-    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mChannels);
-    if(format.image_channel_order == CL_RGBA && mChannels != 4) {
+    if(isChannelPadded(device) && canPadOnDevice(device, false)) {
+        // Remove the padding on the device, and download the result
+        const uint bufferSize = getBufferSize();
+        cl::Buffer* buffer = ImageMemoryPool::allocateBuffer(device, bufferSize);
+        unpadImageToBuffer(device, mCLImages[device], *buffer);
+        if(!mHostHasData) {
+            mHostData = allocatePixelArray(mWidth*mHeight*mDepth*mChannels, mType);
+            mHostHasData = true;
+        }
+        device->getCommandQueue().enqueueReadBuffer(*buffer, CL_TRUE, 0, bufferSize, mHostData.get());
+        ImageMemoryPool::releaseBuffer(device, buffer, bufferSize);
+    } else if(isChannelPadded(device)) {
         auto tempData = allocatePixelArray(mWidth*mHeight*mDepth*4, mType);
         device->getCommandQueue().enqueueReadImage(*(cl::Image*)mCLImages[device],
         CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
                 0, tempData.get());
         mHostData = adaptImageDataToHostData(std::move(tempData), CL_RGBA, mWidth*mHeight*mDepth,mType,mChannels);
+        mHostHasData = true;
     } else {
         if(!mHostHasData) {
             // Must allocate memory for host data
@@ -139,14 +156,7 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
     bool updated = false;
     if (mCLImagesIsUpToDate.count(device) == 0) {
         // Data is not on device, create it
-        cl::Image * newImage;
-        if(mDimensions == 2) {
-            newImage = new cl::Image2D(device->getContext(),
-            CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE2D, mType,mChannels), mWidth, mHeight);
-        } else {
-            newImage = new cl::Image3D(device->getContext(),
-            CL_MEM_READ_WRITE, getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE3D, mType,mChannels), mWidth, mHeight, mDepth);
-        }
+        cl::Image * newImage = ImageMemoryPool::allocateImage(device, mDimensions, mWidth, mHeight, mDepth, mType, mChannels);
 
         if(hasAnyData()) {
             mCLImagesIsUpToDate[device] = false;
@@ -163,13 +173,15 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
 			// Transfer host data to this device
 			transferCLImageFromHost(device);
 			updated = true;
+		} else if(copyCLImageFromDevice(device)) {
+			updated = true;
 		} else {
+			// Up to date data is in another context, transfer it through host
 			std::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
 			for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end();
 				it++) {
 				if (it->second == true) {
 					// Transfer from this device(it->first) to device
-					// TODO should use copy image to image here, if possible
 					transferCLImageToHost(it->first);
 					transferCLImageFromHost(device);
 					mHostDataIsUpToDate = true;
@@ -181,7 +193,6 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
 				it++) {
 				if (it->second == true) {
 					// Transfer from this device(it->first) to device
-					// TODO should use copy buffer to image here, if possible
 					transferCLBufferToHost(it->first);
 					transferCLImageFromHost(device);
 					mHostDataIsUpToDate = true;
@@ -197,6 +208,145 @@ void Image::updateOpenCLImageData(OpenCLDevice::pointer device) {
                 "Data was not updated because no data was marked as up to date");
 }
 
+static bool isSameContext(OpenCLDevice::pointer device1, OpenCLDevice::pointer device2) {
+    return device1 == device2 || device1->getContext()() == device2->getContext()();
+}
+
+bool Image::isChannelPadded(OpenCLDevice::pointer device) {
+    cl::ImageFormat format = getOpenCLImageFormat(device, mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mChannels);
+    return format.image_channel_order == CL_RGBA && mChannels != 4;
+}
+
+bool Image::canPadOnDevice(OpenCLDevice::pointer device, bool writeToImage) {
+    // A snorm int16 image can't hold -32768 when written and read as float, which is the only way to access it in a kernel
+    if(mType == TYPE_SNORM_INT16)
+        return false;
+    if(writeToImage && mDimensions == 3 && !device->isWritingTo3DTexturesSupported())
+        return false;
+    return true;
+}
+
+cl::Kernel Image::getChannelPaddingKernel(OpenCLDevice::pointer device, std::string kernelName) {
+    std::string buildOptions = "";
+    switch(mType) {
+    case TYPE_FLOAT:
+        buildOptions = "-DTYPE_FLOAT";
+        break;
+    case TYPE_UINT8:
+        buildOptions = "-DTYPE_UINT8";
+        break;
+    case TYPE_INT8:
+        buildOptions = "-DTYPE_INT8";
+        break;
+    case TYPE_UINT16:
+        buildOptions = "-DTYPE_UINT16";
+        break;
+    case TYPE_INT16:
+        buildOptions = "-DTYPE_INT16";
+        break;
+    case TYPE_UNORM_INT16:
+        buildOptions = "-DTYPE_UNORM_INT16";
+        break;
+    default:
+        throw Exception("Data type not supported by channel padding kernels");
+    }
+    if(device->isWritingTo3DTexturesSupported())
+        buildOptions += " -Dfast_3d_image_writes";
+    std::string sourceFilename = Config::getKernelSourcePath() + "/ImageChannelPadding.cl";
+    std::string programName = sourceFilename + buildOptions;
+    // Only create program if it doesn't exist for this device from before
+    if(!device->hasProgram(programName))
+        device->createProgramFromSourceWithName(programName, sourceFilename, buildOptions);
+    return cl::Kernel(device->getProgram(programName), kernelName.c_str());
+}
+
+void Image::padBufferToImage(OpenCLDevice::pointer device, cl::Buffer buffer, cl::Image* image, cl::Event* event) {
+    cl::Kernel kernel = getChannelPaddingKernel(device, mDimensions == 2 ? "padBufferToImage2D" : "padBufferToImage3D");
+    kernel.setArg(0, buffer);
+    kernel.setArg(1, *image);
+    kernel.setArg(2, (int)mChannels);
+    device->getCommandQueue().enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            mDimensions == 2 ? cl::NDRange(mWidth, mHeight) : cl::NDRange(mWidth, mHeight, mDepth),
+            cl::NullRange,
+            nullptr,
+            event
+    );
+}
+
+void Image::unpadImageToBuffer(OpenCLDevice::pointer device, cl::Image* image, cl::Buffer buffer) {
+    cl::Kernel kernel = getChannelPaddingKernel(device, mDimensions == 2 ? "unpadImageToBuffer2D" : "unpadImageToBuffer3D");
+    kernel.setArg(0, *image);
+    kernel.setArg(1, buffer);
+    kernel.setArg(2, (int)mChannels);
+    device->getCommandQueue().enqueueNDRangeKernel(
+            kernel,
+            cl::NullRange,
+            mDimensions == 2 ? cl::NDRange(mWidth, mHeight) : cl::NDRange(mWidth, mHeight, mDepth),
+            cl::NullRange
+    );
+}
+
+bool Image::copyCLImageFromDevice(OpenCLDevice::pointer device) {
+    cl::CommandQueue queue = device->getCommandQueue();
+    cl::Image* image = mCLImages[device];
+    const bool padded = isChannelPadded(device);
+    for(auto&& it : mCLBuffersIsUpToDate) {
+        if(!it.second || !isSameContext(it.first, device))
+            continue;
+        if(padded && !canPadOnDevice(device, true))
+            return false;
+        // Commands on other queues in the same context have to finish first
+        if(it.first != device)
+            it.first->getCommandQueue().finish();
+        if(padded) {
+            padBufferToImage(device, *mCLBuffers[it.first], image);
+        } else {
+            queue.enqueueCopyBufferToImage(*mCLBuffers[it.first], *image, 0, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth));
+        }
+        return true;
+    }
+    for(auto&& it : mCLImagesIsUpToDate) {
+        // Images can only be copied if they have the same format
+        if(!it.second || it.first == device || !isSameContext(it.first, device) || isChannelPadded(it.first) != padded)
+            continue;
+        it.first->getCommandQueue().finish();
+        queue.enqueueCopyImage(*mCLImages[it.first], *image, createOrigoRegion(), createOrigoRegion(), createRegion(mWidth, mHeight, mDepth));
+        return true;
+    }
+    return false;
+}
+
+bool Image::copyCLBufferFromDevice(OpenCLDevice::pointer device) {
+    cl::CommandQueue queue = device->getCommandQueue();
+    cl::Buffer* buffer = mCLBuffers[device];
+    for(auto&& it : mCLImagesIsUpToDate) {
+        if(!it.second || !isSameContext(it.first, device))
+            continue;
+        const bool padded = isChannelPadded(it.first);
+        if(padded && !canPadOnDevice(device, false))
+            return false;
+        // Commands on other queues in the same context have to finish first
+        if(it.first != device)
+            it.first->getCommandQueue().finish();
+        if(padded) {
+            unpadImageToBuffer(device, mCLImages[it.first], *buffer);
+        } else {
+            queue.enqueueCopyImageToBuffer(*mCLImages[it.first], *buffer, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0);
+        }
+        return true;
+    }
+    for(auto&& it : mCLBuffersIsUpToDate) {
+        if(!it.second || it.first == device || !isSameContext(it.first, device))
+            continue;
+        it.first->getCommandQueue().finish();
+        queue.enqueueCopyBuffer(*mCLBuffers[it.first], *buffer, 0, 0, getBufferSize());
+        return true;
+    }
+    return false;
+}
+
 OpenCLBufferAccess::pointer Image::getOpenCLBufferAccess(
         accessType type,
         OpenCLDevice::pointer device) {
@@ -211,6 +361,7 @@ OpenCLBufferAccess::pointer Image::getOpenCLBufferAccess(
         std::unique_lock<std::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
+    waitForOpenCLEvents(device, type == ACCESS_READ_WRITE);
     updateOpenCLBufferData(device);
     if(type == ACCESS_READ_WRITE) {
         setAllDataToOutOfDate();
@@ -223,7 +374,7 @@ OpenCLBufferAccess::pointer Image::getOpenCLBufferAccess(
     }
 
     // Now it is guaranteed that the data is on the device and that it is up to date
-	OpenCLBufferAccess::pointer accessObject(new OpenCLBufferAccess(mCLBuffers[device],  std::static_pointer_cast<Image>(mPtr.lock())));
+	OpenCLBufferAccess::pointer accessObject(new OpenCLBufferAccess(mCLBuffers[device],  std::static_pointer_cast<Image>(mPtr.lock()), device, type == ACCESS_READ_WRITE));
 	return std::move(accessObject);
 }
 
@@ -248,8 +399,7 @@ void Image::updateOpenCLBufferData(OpenCLDevice::pointer device) {
     if (mCLBuffers.count(device) == 0) {
         // Data is not on device, create it
         unsigned int bufferSize = getBufferSize();
-        cl::Buffer * newBuffer = new cl::Buffer(device->getContext(),
-        CL_MEM_READ_WRITE, bufferSize);
+        cl::Buffer * newBuffer = ImageMemoryPool::allocateBuffer(device, bufferSize);
 
         if(hasAnyData()) {
             mCLBuffersIsUpToDate[device] = false;
@@ -267,7 +417,10 @@ void Image::updateOpenCLBufferData(OpenCLDevice::pointer device) {
             // Transfer host data to this device
             transferCLBufferFromHost(device);
             updated = true;
+        } else if(copyCLBufferFromDevice(device)) {
+            updated = true;
         } else {
+            // Up to date data is in another context, transfer it through host
             std::unordered_map<OpenCLDevice::pointer, bool>::iterator it;
             for (it = mCLImagesIsUpToDate.begin(); it != mCLImagesIsUpToDate.end();
                     it++) {
@@ -392,6 +545,7 @@ OpenCLImageAccess::pointer Image::getOpenCLImageAccess(
     	std::lock_guard<std::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
+    waitForOpenCLEvents(device, type == ACCESS_READ_WRITE);
     updateOpenCLImageData(device);
     if (type == ACCESS_READ_WRITE) {
         setAllDataToOutOfDate();
@@ -405,10 +559,10 @@ OpenCLImageAccess::pointer Image::getOpenCLImageAccess(
 
     // Now it is guaranteed that the data is on the device and that it is up to date
     if(mDimensions == 2) {
-        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image2D*)mCLImages[device], std::static_pointer_cast<Image>(mPtr.lock())));
+        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image2D*)mCLImages[device], std::static_pointer_cast<Image>(mPtr.lock()), device, type == ACCESS_READ_WRITE));
         return accessObject;
     } else {
-        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image3D*)mCLImages[device], std::static_pointer_cast<Image>(mPtr.lock())));
+        OpenCLImageAccess::pointer accessObject(new OpenCLImageAccess((cl::Image3D*)mCLImages[device], std::static_pointer_cast<Image>(mPtr.lock()), device, type == ACCESS_READ_WRITE));
         return accessObject;
     }
 }
@@ -419,6 +573,7 @@ Image::Image() {
     mSpacing = Vector3f(1,1,1);
     mMaxMinInitialized = false;
     mAverageInitialized = false;
+    mPercentileHistogramInitialized = false;
     mIsInitialized = false;
 }
 
@@ -433,6 +588,7 @@ ImageAccess::pointer Image::getImageAccess(accessType type) {
         std::unique_lock<std::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
+    waitForOpenCLEvents(Host::getInstance(), type == ACCESS_READ_WRITE);
     updateHostData();
     if(type == ACCESS_READ_WRITE) {
         setAllDataToOutOfDate();
@@ -598,31 +754,13 @@ void Image::copyData(ExecutionDevice::pointer device, const void* const data) {
         mIsInitialized = true;
     } else {
         OpenCLDevice::pointer clDevice = std::static_pointer_cast<OpenCLDevice>(device);
-        cl::Image* clImage;
-        void* tempData;
-        if(mDimensions == 2) {
-            tempData = (void*)adaptDataToImage(data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE2D, mType,
-                                                                         mChannels).image_channel_order,
-                                              mWidth * mHeight, mType, mChannels);
-            clImage = new cl::Image2D(
-                    clDevice->getContext(),
-                    CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                    getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE2D, mType, mChannels),
-                    mWidth, mHeight,
-                    0,
-                    tempData
-            );
-        } else {
-            tempData = (void*)adaptDataToImage(data, getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE3D, mType, mChannels).image_channel_order, mWidth*mHeight*mDepth, mType, mChannels);
-            clImage = new cl::Image3D(
-                clDevice->getContext(),
-                CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE3D, mType, mChannels),
-                mWidth, mHeight, mDepth,
-                0, 0,
-                tempData
-            );
-        }
+        void* tempData = (void*)adaptDataToImage(data, getOpenCLImageFormat(clDevice,
+                mDimensions == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D, mType, mChannels).image_channel_order,
+                mWidth*mHeight*mDepth, mType, mChannels);
+        cl::Image* clImage = ImageMemoryPool::allocateImage(clDevice, mDimensions, mWidth, mHeight, mDepth, mType, mChannels);
+        clDevice->getCommandQueue().enqueueWriteImage(*clImage,
+                CL_TRUE, createOrigoRegion(), createRegion(mWidth, mHeight, mDepth), 0,
+                0, tempData);
         mCLImages[clDevice] = clImage;
         mCLImagesIsUpToDate[clDevice] = true;
         if(tempData != data) // If a new copy was made, delete it
@@ -656,36 +794,41 @@ bool Image::isInitialized() const {
 }
 
 void Image::free(ExecutionDevice::pointer device) {
+    // Memory is reused by the memory pool, thus commands on other queues using it must be finished
+    finishOpenCLEvents();
     // Delete data on a specific device
     if(device->isHost()) {
         mHostData.reset();
         mHostHasData = false;
     } else {
         OpenCLDevice::pointer clDevice = std::static_pointer_cast<OpenCLDevice>(device);
-        // Delete any OpenCL images
-        delete mCLImages[clDevice];
+        // Give any OpenCL images and buffers back to the memory pool
+        if(mCLImages.count(clDevice) > 0)
+            ImageMemoryPool::releaseImage(clDevice, mCLImages[clDevice], mDimensions, mWidth, mHeight, mDepth, mType, mChannels);
         mCLImages.erase(clDevice);
         mCLImagesIsUpToDate.erase(clDevice);
-        // Delete any OpenCL buffers
-        delete mCLBuffers[clDevice];
+        if(mCLBuffers.count(clDevice) > 0)
+            ImageMemoryPool::releaseBuffer(clDevice, mCLBuffers[clDevice], getBufferSize());
         mCLBuffers.erase(clDevice);
         mCLBuffersIsUpToDate.erase(clDevice);
     }
 }
 
 void Image::freeAll() {
-    // Delete OpenCL Images
+    // Memory is reused by the memory pool, thus commands on other queues using it must be finished
+    finishOpenCLEvents();
+    // Give OpenCL Images back to the memory pool
     std::unordered_map<OpenCLDevice::pointer, cl::Image*>::iterator it;
     for (it = mCLImages.begin(); it != mCLImages.end(); it++) {
-        delete it->second;
+        ImageMemoryPool::releaseImage(it->first, it->second, mDimensions, mWidth, mHeight, mDepth, mType, mChannels);
     }
     mCLImages.clear();
     mCLImagesIsUpToDate.clear();
 
-    // Delete OpenCL buffers
+    // Give OpenCL buffers back to the memory pool
     std::unordered_map<OpenCLDevice::pointer, cl::Buffer*>::iterator it2;
     for (it2 = mCLBuffers.begin(); it2 != mCLBuffers.end(); it2++) {
-        delete it2->second;
+        ImageMemoryPool::releaseBuffer(it2->first, it2->second, getBufferSize());
     }
     mCLBuffers.clear();
     mCLBuffersIsUpToDate.clear();
@@ -757,27 +900,7 @@ void Image::calculateMaxAndMinIntensity() {
         unsigned int nrOfElements = mWidth*mHeight*mDepth*mChannels;
         if(mHostHasData && mHostDataIsUpToDate) {
             // Host data is up to date, calculate min and max on host
-            ImageAccess::pointer access = getImageAccess(ACCESS_READ);
-            void* data = access->get();
-            switch(mType) {
-            case TYPE_FLOAT:
-            case TYPE_SNORM_INT16:
-            case TYPE_UNORM_INT16:
-                getMaxAndMinFromData<float>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_INT8:
-                getMaxAndMinFromData<char>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_UINT8:
-                getMaxAndMinFromData<uchar>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_INT16:
-                getMaxAndMinFromData<short>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            case TYPE_UINT16:
-                getMaxAndMinFromData<ushort>(data,nrOfElements,&mMinimumIntensity,&mMaximumIntensity);
-                break;
-            }
+            calculateStatisticsOnHost();
         } else {
             // TODO the logic here can be improved. For instance choose the best device
             // Find some OpenCL image data or buffer data that is up to date
@@ -834,27 +957,8 @@ float Image::calculateAverageIntensity() {
     if(!mAverageInitialized || mAverageIntensityTimestamp != getTimestamp()) {
         unsigned int nrOfElements = mWidth*mHeight*mDepth;
         if(mHostHasData && mHostDataIsUpToDate) {
-            reportInfo() << "calculating sum on host" << Reporter::end();
-            // Host data is up to date, calculate min and max on host
-            ImageAccess::pointer access = getImageAccess(ACCESS_READ);
-            void* data = access->get();
-            switch(mType) {
-            case TYPE_FLOAT:
-                mAverageIntensity = getSumFromData<float>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_INT8:
-                mAverageIntensity = getSumFromData<char>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_UINT8:
-                mAverageIntensity = getSumFromData<uchar>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_INT16:
-                mAverageIntensity = getSumFromData<short>(data,nrOfElements) / nrOfElements;
-                break;
-            case TYPE_UINT16:
-                mAverageIntensity = getSumFromData<ushort>(data,nrOfElements) / nrOfElements;
-                break;
-            }
+            // Host data is up to date, calculate average on host
+            calculateStatisticsOnHost();
         } else {
             reportInfo() << "calculating sum with OpenCL" << Reporter::end();
             // TODO the logic here can be improved. For instance choose the best device
@@ -930,6 +1034,99 @@ float Image::calculateMinimumIntensity() {
     return mMinimumIntensity;
 }
 
+void Image::calculateStatisticsOnHost() {
+    ImageAccess::pointer access = getImageAccess(ACCESS_READ);
+    const std::size_t nrOfElements = (std::size_t)mWidth*mHeight*mDepth*mChannels;
+    double sum;
+    getStatisticsFromData(access->get(), nrOfElements, mType, &mMinimumIntensity, &mMaximumIntensity, &sum);
+    mAverageIntensity = (float)(sum / nrOfElements);
+
+    // Min, max and average are calculated in a single pass, thus cache all of them
+    mMaxMinTimestamp = getTimestamp();
+    mMaxMinInitialized = true;
+    mAverageIntensityTimestamp = getTimestamp();
+    mAverageInitialized = true;
+}
+
+std::vector<uint64_t> Image::calculateHistogram(int bins, float min, float max) {
+    if(!isInitialized())
+        throw Exception("Image has not been initialized.");
+
+    ImageAccess::pointer access = getImageAccess(ACCESS_READ);
+    return getHistogramFromData(access->get(), (std::size_t)mWidth*mHeight*mDepth*mChannels, mType, bins, min, max);
+}
+
+std::vector<uint64_t> Image::calculateHistogram(int bins) {
+    const float min = calculateMinimumIntensity();
+    const float max = calculateMaximumIntensity();
+    if(min == max) {
+        // Constant image, put everything in the first bin
+        std::vector<uint64_t> histogram(bins, 0);
+        histogram.at(0) = (uint64_t)mWidth*mHeight*mDepth*mChannels;
+        return histogram;
+    }
+    return calculateHistogram(bins, min, max);
+}
+
+float Image::calculatePercentileIntensity(float percentile) {
+    if(percentile < 0 || percentile > 100)
+        throw Exception("Percentile must be in the range [0, 100]");
+    const float min = calculateMinimumIntensity();
+    const float max = calculateMaximumIntensity();
+    if(min == max)
+        return min;
+
+    if(!mPercentileHistogramInitialized || mPercentileHistogramTimestamp != getTimestamp()) {
+        const bool integerType = mType == TYPE_UINT8 || mType == TYPE_INT8 || mType == TYPE_UINT16 || mType == TYPE_INT16;
+        if(integerType && max - min < 65536) {
+            // One bin per intensity, which gives the exact percentile
+            const int bins = (int)(max - min) + 1;
+            mPercentileHistogram = calculateHistogram(bins, min, max + 1);
+            mPercentileHistogramBinWidth = 1.0f;
+            mPercentileHistogramIsExact = true;
+        } else {
+            const int bins = 4096;
+            mPercentileHistogram = calculateHistogram(bins, min, max);
+            mPercentileHistogramBinWidth = (max - min) / bins;
+            mPercentileHistogramIsExact = false;
+        }
+        mPercentileHistogramTimestamp = getTimestamp();
+        mPercentileHistogramInitialized = true;
+    }
+
+    uint64_t total = 0;
+    for(uint64_t count : mPercentileHistogram)
+        total += count;
+    if(total == 0)
+        return min;
+
+    // Find the intensity of element number k when sorted, by searching the cumulative histogram
+    auto getSortedElement = [this, min](uint64_t k) -> float {
+        uint64_t cumulative = 0;
+        for(int bin = 0; bin < mPercentileHistogram.size(); ++bin) {
+            const uint64_t count = mPercentileHistogram[bin];
+            if(cumulative + count > k) {
+                const float binStart = min + bin*mPercentileHistogramBinWidth;
+                if(mPercentileHistogramIsExact)
+                    return binStart;
+                // Assume intensities are uniformly distributed within the bin
+                return binStart + mPercentileHistogramBinWidth*((k - cumulative) + 0.5f) / count;
+            }
+            cumulative += count;
+        }
+        return min + mPercentileHistogram.size()*mPercentileHistogramBinWidth;
+    };
+
+    // Linear interpolation between the two closest elements
+    const double position = percentile / 100.0 * (total - 1);
+    const uint64_t lower = (uint64_t)position;
+    const uint64_t upper = std::min(lower + 1, total - 1);
+    const float fraction = (float)(position - lower);
+    const float lowerValue = getSortedElement(lower);
+    const float upperValue = getSortedElement(upper);
+    return std::min(max, std::max(min, lowerValue + fraction*(upperValue - lowerValue)));
+}
+
 void Image::createFromImage(
         Image::pointer image) {
     // Create image first
@@ -1029,23 +1226,8 @@ void Image::fill(float value) {
     } catch(...) {
     	// Has no data
     	// Create an OpenCL image
-    	cl::Image* clImage;
         OpenCLDevice::pointer clDevice = std::dynamic_pointer_cast<OpenCLDevice>(DeviceManager::getInstance()->getDefaultComputationDevice());
-    	if(getDimensions() == 2) {
-			clImage = new cl::Image2D(
-				clDevice->getContext(),
-				CL_MEM_READ_WRITE,
-				getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE2D, mType, mChannels),
-				mWidth, mHeight
-			);
-    	} else {
-			clImage = new cl::Image3D(
-				clDevice->getContext(),
-				CL_MEM_READ_WRITE,
-				getOpenCLImageFormat(clDevice, CL_MEM_OBJECT_IMAGE3D, mType, mChannels),
-				mWidth, mHeight, mDepth
-			);
-    	}
+        cl::Image* clImage = ImageMemoryPool::allocateImage(clDevice, mDimensions, mWidth, mHeight, mDepth, mType, mChannels);
 		mCLImages[clDevice] = clImage;
 		mCLImagesIsUpToDate[clDevice] = true;
 		device = clDevice;
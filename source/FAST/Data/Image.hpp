@@ -8,6 +8,7 @@
 #include <FAST/Data/Access/OpenCLBufferAccess.hpp>
 #include <FAST/DeviceManager.hpp>
 #include <unordered_map>
+#include <vector>
 
 namespace fast {
 
@@ -226,6 +227,34 @@ class FAST_EXPORT  Image : public SpatialDataObject {
         float calculateMaximumIntensity();
         float calculateMinimumIntensity();
         float calculateAverageIntensity();
+        /**
+         * Calculate histogram of the intensities of all channels in the image.
+         * Bin i covers the intensities [min + i*(max-min)/bins, min + (i+1)*(max-min)/bins).
+         * Intensities outside [min, max] are ignored.
+         *
+         * @param bins
+         * @param min
+         * @param max
+         * @return number of pixels/voxels in each bin
+         */
+        std::vector<uint64_t> calculateHistogram(int bins, float min, float max);
+        /**
+         * Calculate histogram of the intensities of all channels in the image, from the minimum to the maximum intensity
+         * @param bins
+         * @return number of pixels/voxels in each bin
+         */
+        std::vector<uint64_t> calculateHistogram(int bins);
+        /**
+         * Calculate the intensity below which a given percentage of the intensities in the image are,
+         * with linear interpolation between the two closest intensities. Useful for robust window/level
+         * and normalization.
+         * The result is exact for 8 and 16 bit integer images. For other types, it is estimated from
+         * a histogram with 4096 bins.
+         *
+         * @param percentile in the range [0, 100]
+         * @return intensity
+         */
+        float calculatePercentileIntensity(float percentile);
 
         /**
          * Copy image and put contents to specific device
@@ -295,6 +324,29 @@ class FAST_EXPORT  Image : public SpatialDataObject {
 
         void updateHostData();
 
+        /**
+         * Copy up to date data in a buffer or image of the same OpenCL context to the image of the given device.
+         * @return false if there is no such data, or it can't be copied on the device
+         */
+        bool copyCLImageFromDevice(OpenCLDevice::pointer device);
+        /**
+         * Copy up to date data in an image or buffer of the same OpenCL context to the buffer of the given device.
+         * @return false if there is no such data, or it can't be copied on the device
+         */
+        bool copyCLBufferFromDevice(OpenCLDevice::pointer device);
+        /**
+         * @return true if OpenCL images of this image on the given device are padded to 4 channels
+         */
+        bool isChannelPadded(OpenCLDevice::pointer device);
+        bool canPadOnDevice(OpenCLDevice::pointer device, bool writeToImage);
+        cl::Kernel getChannelPaddingKernel(OpenCLDevice::pointer device, std::string kernelName);
+        /**
+         * Enqueue a kernel which pads the channels of the buffer into the image
+         * @param event if given, set to the event of the kernel
+         */
+        void padBufferToImage(OpenCLDevice::pointer device, cl::Buffer buffer, cl::Image* image, cl::Event* event = nullptr);
+        void unpadImageToBuffer(OpenCLDevice::pointer device, cl::Image* image, cl::Buffer buffer);
+
         bool hasAnyData();
 
         uint getBufferSize() const;
@@ -311,6 +363,13 @@ class FAST_EXPORT  Image : public SpatialDataObject {
         unsigned long mMaxMinTimestamp, mAverageIntensityTimestamp;
         bool mMaxMinInitialized, mAverageInitialized;
         void calculateMaxAndMinIntensity();
+        void calculateStatisticsOnHost();
+
+        std::vector<uint64_t> mPercentileHistogram;
+        float mPercentileHistogramBinWidth;
+        bool mPercentileHistogramIsExact;
+        unsigned long mPercentileHistogramTimestamp;
+        bool mPercentileHistogramInitialized;
 
         // Declare as friends so they can get access to the accessFinished methods
         friend class ImageAccess;
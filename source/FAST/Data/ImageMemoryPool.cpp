@@ -0,0 +1,244 @@
+#include "ImageMemoryPool.hpp"
+#include <list>
+#include <mutex>
+
+namespace fast {
+
+enum class PoolMemoryKind {
+    Host,
+    Buffer,
+    Image2D,
+    Image3D
+};
+
+struct PoolKey {
+    PoolMemoryKind kind;
+    std::size_t width;
+    std::size_t height;
+    std::size_t depth;
+    DataType type;
+    uint channels;
+
+    bool operator==(const PoolKey& other) const {
+        return kind == other.kind && width == other.width && height == other.height && depth == other.depth &&
+            type == other.type && channels == other.channels;
+    }
+};
+
+struct PoolEntry {
+    PoolKey key;
+    void* memory;
+    std::size_t bytes;
+};
+
+struct DevicePool {
+    // Most recently released memory first
+    std::list<PoolEntry> entries;
+    ImageMemoryPool::Statistics statistics;
+    bool hasMaxBytes = false;
+    std::size_t maxBytes = 0;
+};
+
+// The pool is never deleted, since images may be deleted by static destructors at exit
+static std::mutex& getPoolMutex() {
+    static auto mutex = new std::mutex();
+    return *mutex;
+}
+
+static std::size_t& getDefaultMaxBytes() {
+    static std::size_t bytes = 256*1024*1024;
+    return bytes;
+}
+
+// The host has a separate pool instead of being looked up through Host::getInstance, which may already be deleted
+// when pixel arrays are deleted at exit.
+static DevicePool& getHostPool() {
+    static auto pool = new DevicePool();
+    return *pool;
+}
+
+static std::unordered_map<OpenCLDevice::pointer, DevicePool>& getDevicePools() {
+    static auto pools = new std::unordered_map<OpenCLDevice::pointer, DevicePool>();
+    return *pools;
+}
+
+// Caller must hold the pool mutex. A null device is the host.
+static DevicePool& getPool(const OpenCLDevice::pointer& device) {
+    if(!device)
+        return getHostPool();
+    return getDevicePools()[device];
+}
+
+static OpenCLDevice::pointer toPoolDevice(ExecutionDevice::pointer device) {
+    if(device->isHost())
+        return nullptr;
+    return std::static_pointer_cast<OpenCLDevice>(device);
+}
+
+static std::size_t getPoolMaxBytes(const DevicePool& pool) {
+    return pool.hasMaxBytes ? pool.maxBytes : getDefaultMaxBytes();
+}
+
+static void freeMemory(const PoolEntry& entry) {
+    switch(entry.key.kind) {
+        case PoolMemoryKind::Host:
+            deleteArray(entry.memory, entry.key.type);
+            break;
+        case PoolMemoryKind::Buffer:
+            delete (cl::Buffer*)entry.memory;
+            break;
+        case PoolMemoryKind::Image2D:
+        case PoolMemoryKind::Image3D:
+            delete (cl::Image*)entry.memory;
+            break;
+    }
+}
+
+// Remove the oldest entries until the pool is within the given budget. Caller must hold the pool mutex,
+// and free the returned entries.
+static std::vector<PoolEntry> evict(DevicePool& pool, std::size_t maxBytes) {
+    std::vector<PoolEntry> evicted;
+    while(pool.statistics.bytesHeld > maxBytes) {
+        evicted.push_back(pool.entries.back());
+        pool.statistics.bytesHeld -= pool.entries.back().bytes;
+        pool.entries.pop_back();
+    }
+    return evicted;
+}
+
+static void* take(const OpenCLDevice::pointer& device, const PoolKey& key) {
+    std::lock_guard<std::mutex> lock(getPoolMutex());
+    auto& pool = getPool(device);
+    for(auto it = pool.entries.begin(); it != pool.entries.end(); ++it) {
+        if(it->key == key) {
+            void* memory = it->memory;
+            pool.statistics.bytesHeld -= it->bytes;
+            pool.statistics.hits += 1;
+            pool.entries.erase(it);
+            return memory;
+        }
+    }
+    pool.statistics.misses += 1;
+    return nullptr;
+}
+
+static void give(const OpenCLDevice::pointer& device, const PoolKey& key, void* memory, std::size_t bytes) {
+    std::vector<PoolEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(getPoolMutex());
+        auto& pool = getPool(device);
+        pool.entries.push_front({key, memory, bytes});
+        pool.statistics.bytesHeld += bytes;
+        evicted = evict(pool, getPoolMaxBytes(pool));
+    }
+    // Free outside the lock, since releasing OpenCL objects may have to wait for the device
+    for(auto&& entry : evicted)
+        freeMemory(entry);
+}
+
+unique_pixel_ptr ImageMemoryPool::allocateHost(std::size_t size, DataType type) {
+    const PoolKey key = {PoolMemoryKind::Host, size, 1, 1, type, 1};
+    const std::size_t bytes = size*getSizeOfDataType(type, 1);
+    void* memory = take(nullptr, key);
+    if(memory == nullptr) {
+        switch(type) {
+            fastSwitchTypeMacro(memory = new FAST_TYPE[size])
+        }
+    }
+    return unique_pixel_ptr(memory, [key, bytes](void* memory) {
+        give(nullptr, key, memory, bytes);
+    });
+}
+
+cl::Image* ImageMemoryPool::allocateImage(OpenCLDevice::pointer device, uchar dimensions, uint width, uint height, uint depth, DataType type, uint channels) {
+    const PoolKey key = {dimensions == 2 ? PoolMemoryKind::Image2D : PoolMemoryKind::Image3D, width, height, depth, type, channels};
+    auto memory = take(device, key);
+    if(memory != nullptr)
+        return (cl::Image*)memory;
+
+    if(dimensions == 2) {
+        return new cl::Image2D(device->getContext(), CL_MEM_READ_WRITE,
+                getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE2D, type, channels), width, height);
+    } else {
+        return new cl::Image3D(device->getContext(), CL_MEM_READ_WRITE,
+                getOpenCLImageFormat(device, CL_MEM_OBJECT_IMAGE3D, type, channels), width, height, depth);
+    }
+}
+
+void ImageMemoryPool::releaseImage(OpenCLDevice::pointer device, cl::Image* image, uchar dimensions, uint width, uint height, uint depth, DataType type, uint channels) {
+    const PoolKey key = {dimensions == 2 ? PoolMemoryKind::Image2D : PoolMemoryKind::Image3D, width, height, depth, type, channels};
+    give(device, key, image, (std::size_t)width*height*depth*getSizeOfDataType(type, channels));
+}
+
+cl::Buffer* ImageMemoryPool::allocateBuffer(OpenCLDevice::pointer device, std::size_t size) {
+    const PoolKey key = {PoolMemoryKind::Buffer, size, 1, 1, TYPE_UINT8, 1};
+    auto memory = take(device, key);
+    if(memory != nullptr)
+        return (cl::Buffer*)memory;
+
+    return new cl::Buffer(device->getContext(), CL_MEM_READ_WRITE, size);
+}
+
+void ImageMemoryPool::releaseBuffer(OpenCLDevice::pointer device, cl::Buffer* buffer, std::size_t size) {
+    const PoolKey key = {PoolMemoryKind::Buffer, size, 1, 1, TYPE_UINT8, 1};
+    give(device, key, buffer, size);
+}
+
+void ImageMemoryPool::setMaxBytes(ExecutionDevice::pointer device, std::size_t bytes) {
+    std::vector<PoolEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(getPoolMutex());
+        auto& pool = getPool(toPoolDevice(device));
+        pool.hasMaxBytes = true;
+        pool.maxBytes = bytes;
+        evicted = evict(pool, bytes);
+    }
+    for(auto&& entry : evicted)
+        freeMemory(entry);
+}
+
+std::size_t ImageMemoryPool::getMaxBytes(ExecutionDevice::pointer device) {
+    std::lock_guard<std::mutex> lock(getPoolMutex());
+    return getPoolMaxBytes(getPool(toPoolDevice(device)));
+}
+
+void ImageMemoryPool::setDefaultMaxBytes(std::size_t bytes) {
+    std::vector<PoolEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(getPoolMutex());
+        getDefaultMaxBytes() = bytes;
+        for(auto&& pool : getDevicePools()) {
+            auto poolEvicted = evict(pool.second, getPoolMaxBytes(pool.second));
+            evicted.insert(evicted.end(), poolEvicted.begin(), poolEvicted.end());
+        }
+        auto poolEvicted = evict(getHostPool(), getPoolMaxBytes(getHostPool()));
+        evicted.insert(evicted.end(), poolEvicted.begin(), poolEvicted.end());
+    }
+    for(auto&& entry : evicted)
+        freeMemory(entry);
+}
+
+ImageMemoryPool::Statistics ImageMemoryPool::getStatistics(ExecutionDevice::pointer device) {
+    std::lock_guard<std::mutex> lock(getPoolMutex());
+    return getPool(toPoolDevice(device)).statistics;
+}
+
+void ImageMemoryPool::clear() {
+    std::vector<PoolEntry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(getPoolMutex());
+        auto& hostPool = getHostPool();
+        evicted.insert(evicted.end(), hostPool.entries.begin(), hostPool.entries.end());
+        hostPool.entries.clear();
+        hostPool.statistics = Statistics();
+        for(auto&& pool : getDevicePools()) {
+            evicted.insert(evicted.end(), pool.second.entries.begin(), pool.second.entries.end());
+            pool.second.entries.clear();
+            pool.second.statistics = Statistics();
+        }
+    }
+    for(auto&& entry : evicted)
+        freeMemory(entry);
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <FAST/Data/Image.hpp>
+
+namespace fast {
+
+/**
+ * A purely static class which recycles the memory of images: host pixel arrays, OpenCL images and OpenCL buffers.
+ *
+ * When an image is deleted, or recreated, its memory is given to the pool instead of being freed. The next image
+ * which needs memory of the same kind is given the pooled memory instead of allocating new. In streaming pipelines,
+ * where every frame has the same size, this removes most allocator and OpenCL driver calls.
+ *
+ * Memory is only reused if it is an exact match: Host pixel arrays must have the same number of elements and data type,
+ * OpenCL buffers the same number of bytes, and OpenCL images the same size, data type and number of channels.
+ * Memory is never shared between devices.
+ *
+ * Each device has a budget of how many bytes of unused memory the pool may hold. When the budget is exceeded,
+ * the memory which has been unused the longest is freed. Setting the budget of a device to 0 disables the pool
+ * for that device.
+ */
+class FAST_EXPORT ImageMemoryPool {
+    public:
+        /**
+         * Counters for a single device
+         */
+        struct Statistics {
+            /**
+             * Number of allocations which were given memory from the pool
+             */
+            uint64_t hits = 0;
+            /**
+             * Number of allocations which had to allocate new memory
+             */
+            uint64_t misses = 0;
+            /**
+             * Number of bytes of unused memory currently held by the pool
+             */
+            std::size_t bytesHeld = 0;
+        };
+        /**
+         * Allocate a host pixel array. The memory is given back to the pool when the returned pointer is deleted.
+         * @param size number of elements
+         * @param type
+         */
+        static unique_pixel_ptr allocateHost(std::size_t size, DataType type);
+        /**
+         * Get an OpenCL image from the pool, or create a new one. The content of the image is undefined.
+         * Give the image back with releaseImage, using the same parameters.
+         * @param device
+         * @param dimensions 2 or 3
+         * @param width
+         * @param height
+         * @param depth
+         * @param type
+         * @param channels
+         */
+        static cl::Image* allocateImage(OpenCLDevice::pointer device, uchar dimensions, uint width, uint height, uint depth, DataType type, uint channels);
+        /**
+         * Give an OpenCL image allocated with allocateImage back to the pool
+         */
+        static void releaseImage(OpenCLDevice::pointer device, cl::Image* image, uchar dimensions, uint width, uint height, uint depth, DataType type, uint channels);
+        /**
+         * Get an OpenCL buffer from the pool, or create a new one. The content of the buffer is undefined.
+         * Give the buffer back with releaseBuffer.
+         * @param device
+         * @param size in bytes
+         */
+        static cl::Buffer* allocateBuffer(OpenCLDevice::pointer device, std::size_t size);
+        /**
+         * Give an OpenCL buffer allocated with allocateBuffer back to the pool
+         */
+        static void releaseBuffer(OpenCLDevice::pointer device, cl::Buffer* buffer, std::size_t size);
+        /**
+         * Set the maximum number of bytes of unused memory the pool may hold for a device.
+         * Memory above the budget is freed at once.
+         * @param device Host::getInstance() for host memory
+         * @param bytes 0 disables the pool for this device
+         */
+        static void setMaxBytes(ExecutionDevice::pointer device, std::size_t bytes);
+        static std::size_t getMaxBytes(ExecutionDevice::pointer device);
+        /**
+         * Set budget of devices which have not been given one with setMaxBytes. Default is 256 MB.
+         * @param bytes
+         */
+        static void setDefaultMaxBytes(std::size_t bytes);
+        /**
+         * @param device Host::getInstance() for host memory
+         * @return counters of the given device
+         */
+        static Statistics getStatistics(ExecutionDevice::pointer device);
+        /**
+         * Free all unused memory held by the pool, and reset all counters.
+         */
+        static void clear();
+};
+
+}
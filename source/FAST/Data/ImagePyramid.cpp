@@ -3,25 +3,12 @@
 #include <FAST/Utility.hpp>
 #include <FAST/Data/Image.hpp>
 #include <FAST/Data/Access/ImagePyramidAccess.hpp>
-#ifdef WIN32
-#include <winbase.h>
-#else
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#endif
 
 namespace fast {
 
 int ImagePyramid::m_counter = 0;
 
 void ImagePyramid::create(int width, int height, int channels, int levels) {
-    // TODO Create memory mapped files on disk to use as virtual memory
-
     if(channels <= 0 || channels > 4)
         throw Exception("Nr of channels must be between 1 and 4");
 
@@ -48,93 +35,23 @@ void ImagePyramid::create(int width, int height, int channels, int levels) {
 		ImagePyramidLevel levelData;
 		levelData.width = currentWidth;
 		levelData.height = currentHeight;
-
-		if(sizeInMB < 512) {
-			// If level is less than X MBs, use system memory
-			levelData.data = new uint8_t[bytes];
-			levelData.memoryMapped = false;
-		} else {
-			reportInfo() << "Using memory mapping.." << reportEnd();
-			uint8_t* data;
+		levelData.tilesX = (currentWidth + levelData.tileWidth - 1) / levelData.tileWidth;
+		levelData.tilesY = (currentHeight + levelData.tileHeight - 1) / levelData.tileHeight;
+		// Tiles are allocated on first write, and swapped to disk when a level uses more than 512 MB
 #ifdef WIN32
-			HANDLE hFile = CreateFile(("C:/windows/temp/fast_mmap_" + std::to_string(currentLevel) + "_" + std::to_string(m_counter) + ".bin").c_str(),
-				GENERIC_WRITE | GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE,
-				NULL, OPEN_ALWAYS, NULL, NULL);
-			if(hFile == nullptr) {
-				throw Exception("Error creating memory mapped file: " + std::to_string(GetLastError()));
-			}
-
-			levelData.fileHandle = hFile;
-
-			HANDLE hMapFile = CreateFileMappingA(
-				//INVALID_HANDLE_VALUE,    // use paging file, Creating Named Shared Memory
-				hFile,
-				NULL,                    // default security
-				PAGE_READWRITE,          // read/write access
-				bytes >> 32,                       // buffer size (high part of 64 bit nr)
-				bytes,                // buffer size (low part of 64 bit nr)
-				("fast_mmap_" + std::to_string(currentLevel)).c_str());                 // name of mapping object
-
-			if(hMapFile == NULL || hMapFile == INVALID_HANDLE_VALUE) {
-				throw Exception("Error opening memory mapped file");
-			}
-
-			data = (uint8_t*) MapViewOfFile(hMapFile,   // handle to map object
-				FILE_MAP_ALL_ACCESS, // read/write permission
-				0,
-				0,
-				bytes);
-			if(data == nullptr) {
-			  throw Exception("Failed to create map view of file: " + std::to_string(GetLastError()));
-			}
+		const std::string swapFilename = "C:/windows/temp/fast_tiles_" + std::to_string(currentLevel) + "_" + std::to_string(m_counter) + ".bin";
 #else
-			int fd = open(("/tmp/fast_mmap_" + std::to_string(currentLevel) + "_" + std::to_string(m_counter) + ".bin").c_str(), O_RDWR | O_CREAT | O_TRUNC, (mode_t)0600);
-			if (fd == -1) {
-				perror("Error opening file for writing");
-				exit(EXIT_FAILURE);
-			}
-
-			// Stretch the file size to the size of the (mmapped) array of ints
-			int result = lseek(fd, bytes-1, SEEK_SET);
-			if (result == -1) {
-				close(fd);
-				perror("Error calling lseek() to 'stretch' the file");
-				exit(EXIT_FAILURE);
-			}
-			result = write(fd, "", 1);
-			if (result != 1) {
-				close(fd);
-				perror("Error writing last byte of the file");
-				exit(EXIT_FAILURE);
-			}
-
-			// Now the file is ready to be mmapped.
-			data = (uint8_t*)mmap64(0, bytes-1, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-			if (data == MAP_FAILED) {
-				close(fd);
-				perror("Error mmapping the file");
-				exit(EXIT_FAILURE);
-			}
-			levelData.fileHandle = fd;
+		const std::string swapFilename = "/tmp/fast_tiles_" + std::to_string(currentLevel) + "_" + std::to_string(m_counter) + ".bin";
 #endif
-			// Initialize data to all zeros
-			std::memset(data, 0, bytes);
-
-			levelData.data = data;
-			levelData.memoryMapped = true;
-		}
+		levelData.tiles = std::make_shared<ImagePyramidTileStorage>(currentWidth, currentHeight, m_channels,
+				levelData.tileWidth, levelData.tileHeight, (std::size_t)512*1024*1024, swapFilename);
 		m_levels.push_back(levelData);
 
-		// TODO Initialize data to zeros?
 		reportInfo() << "Done creating level " << currentLevel << reportEnd();
 		++currentLevel;
     }
 
-    for(int i = 0; i < m_levels.size(); ++i) {
-        int x = m_levels.size() - i - 1;
-        //m_levels[i].patches = x*x*x + 10;
-		m_levels[i].patches = std::ceil(m_levels[i].width / 256);
-    }
+    m_dirtyPatches = std::vector<std::unordered_set<int>>(m_levels.size());
     mBoundingBox = DataBoundingBox(Vector3f(getFullWidth(), getFullHeight(), 0));
     m_initialized = true;
 	m_counter += 1;
@@ -144,10 +61,11 @@ void ImagePyramid::create(openslide_t *fileHandle, std::vector<ImagePyramidLevel
     m_fileHandle = fileHandle;
     m_levels = levels;
     m_channels = 4;
-    for(int i = 0; i < m_levels.size(); ++i) {
-        int x = m_levels.size() - i - 1;
-		m_levels[i].patches = std::ceil(m_levels[i].width / m_levels[i].tileWidth); // TODO different patch size in X and Y
+    for(auto& level : m_levels) {
+        level.tilesX = (level.width + level.tileWidth - 1) / level.tileWidth;
+        level.tilesY = (level.height + level.tileHeight - 1) / level.tileHeight;
     }
+    m_dirtyPatches = std::vector<std::unordered_set<int>>(m_levels.size());
     mBoundingBox = DataBoundingBox(Vector3f(getFullWidth(), getFullHeight(), 0));
     m_initialized = true;
 	m_counter += 1;
@@ -169,8 +87,20 @@ int ImagePyramid::getLevelHeight(int level) {
     return m_levels.at(level).height;
 }
 
-int ImagePyramid::getLevelPatches(int level) {
-    return m_levels.at(level).patches;
+int ImagePyramid::getLevelTileWidth(int level) {
+    return m_levels.at(level).tileWidth;
+}
+
+int ImagePyramid::getLevelTileHeight(int level) {
+    return m_levels.at(level).tileHeight;
+}
+
+int ImagePyramid::getLevelTilesX(int level) {
+    return m_levels.at(level).tilesX;
+}
+
+int ImagePyramid::getLevelTilesY(int level) {
+    return m_levels.at(level).tilesY;
 }
 
 int ImagePyramid::getFullWidth() {
@@ -190,19 +120,7 @@ void ImagePyramid::freeAll() {
         m_levels.clear();
         openslide_close(m_fileHandle);
     } else {
-		for(auto& item : m_levels) {
-			if(item.memoryMapped) {
-#ifdef WIN32
-				UnmapViewOfFile(item.data);
-				CloseHandle(item.fileHandle);
-#else
-				munmap(item.data, item.width*item.height*m_channels);
-				close(item.fileHandle);
-#endif
-			} else {
-				delete[] item.data;
-			}
-		}
+        // Tile storage, and its swap file, is freed when the last access is done with it
         m_levels.clear();
     }
 	m_initialized = false;
@@ -242,25 +160,44 @@ ImagePyramidAccess::pointer ImagePyramid::getAccess(accessType type) {
 
 void ImagePyramid::setDirtyPatch(int level, int patchIdX, int patchIdY) {
 	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
-	const std::string tileString =
-		std::to_string(level) + "_" + std::to_string(patchIdX) + "_" + std::to_string(patchIdY);
-	m_dirtyPatches.insert(tileString);
+	m_dirtyPatches.at(level).insert(patchIdX + patchIdY*m_levels[level].tilesX);
+}
+
+bool ImagePyramid::isDirtyPatch(int level, int patchIdX, int patchIdY) {
+	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
+	return m_dirtyPatches.at(level).count(patchIdX + patchIdY*m_levels[level].tilesX) > 0;
+}
+
+void ImagePyramid::clearDirtyPatch(int level, int patchIdX, int patchIdY) {
+	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
+	m_dirtyPatches.at(level).erase(patchIdX + patchIdY*m_levels[level].tilesX);
 }
 
 std::unordered_set<std::string> ImagePyramid::getDirtyPatches() {
 	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
-	return m_dirtyPatches;
+	std::unordered_set<std::string> result;
+	for(int level = 0; level < m_dirtyPatches.size(); ++level) {
+		const int tilesX = m_levels[level].tilesX;
+		for(int patch : m_dirtyPatches[level])
+			result.insert(std::to_string(level) + "_" + std::to_string(patch % tilesX) + "_" + std::to_string(patch / tilesX));
+	}
+	return result;
 }
 
 bool ImagePyramid::isDirtyPatch(const std::string& tileID) {
-	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
-	return m_dirtyPatches.count(tileID);
+	auto parts = split(tileID, "_");
+	if(parts.size() != 3)
+		throw Exception("incorrect tile format");
+	return isDirtyPatch(std::stoi(parts[0]), std::stoi(parts[1]), std::stoi(parts[2]));
 }
 
 void ImagePyramid::clearDirtyPatches(std::set<std::string> patches) {
-	std::lock_guard<std::mutex> lock(m_dirtyPatchMutex);
-	for(auto&& patch : patches)
-		m_dirtyPatches.erase(patch);
+	for(auto&& patch : patches) {
+		auto parts = split(patch, "_");
+		if(parts.size() != 3)
+			throw Exception("incorrect tile format");
+		clearDirtyPatch(std::stoi(parts[0]), std::stoi(parts[1]), std::stoi(parts[2]));
+	}
 }
 
 void ImagePyramid::setSpacing(Vector3f spacing) {
@@ -13,7 +13,8 @@ class Image;
 
 /**
  * Data object for storing large images as tiled image pyramids.
- * Storage uses virtual memory enabling the images to be larger than
+ * Each level is stored sparsely in tiles, which are allocated on first write.
+ * Least recently used tiles are compressed and swapped to disk, enabling the images to be larger than
  * the available RAM.
  */
 class FAST_EXPORT ImagePyramid : public SpatialDataObject {
@@ -24,7 +25,10 @@ class FAST_EXPORT ImagePyramid : public SpatialDataObject {
         int getNrOfLevels();
         int getLevelWidth(int level);
         int getLevelHeight(int level);
-        int getLevelPatches(int level);
+        int getLevelTileWidth(int level);
+        int getLevelTileHeight(int level);
+        int getLevelTilesX(int level);
+        int getLevelTilesY(int level);
         int getFullWidth();
         int getFullHeight();
         int getNrOfChannels() const;
@@ -33,8 +37,10 @@ class FAST_EXPORT ImagePyramid : public SpatialDataObject {
         ImagePyramidAccess::pointer getAccess(accessType type);
         std::unordered_set<std::string> getDirtyPatches();
         bool isDirtyPatch(const std::string& tileID);
+        bool isDirtyPatch(int level, int patchIdX, int patchIdY);
         void setDirtyPatch(int level, int patchIdX, int patchIdY);
         void clearDirtyPatches(std::set<std::string> patches);
+        void clearDirtyPatch(int level, int patchIdX, int patchIdY);
         void free(ExecutionDevice::pointer device) override;
         void freeAll() override;
         ~ImagePyramid();
@@ -47,7 +53,8 @@ class FAST_EXPORT ImagePyramid : public SpatialDataObject {
         int m_channels;
         bool m_initialized;
 
-        std::unordered_set<std::string> m_dirtyPatches;
+        // Dirty patches of each level, stored as patchIdX + patchIdY*tilesX, which is the index of the tile in the tile storage
+        std::vector<std::unordered_set<int>> m_dirtyPatches;
         static int m_counter;
         std::mutex m_dirtyPatchMutex;
         Vector3f m_spacing = Vector3f::Ones();
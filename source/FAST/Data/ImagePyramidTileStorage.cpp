@@ -0,0 +1,253 @@
+#include "ImagePyramidTileStorage.hpp"
+#include <FAST/Exception.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace fast {
+
+ImagePyramidTileStorage::ImagePyramidTileStorage(int width, int height, int channels, int tileWidth, int tileHeight,
+                                                 std::size_t memoryLimit, std::string swapFilename) :
+        m_width(width),
+        m_height(height),
+        m_channels(channels),
+        m_tileWidth(tileWidth),
+        m_tileHeight(tileHeight),
+        m_tilesX((width + tileWidth - 1) / tileWidth),
+        m_tilesY((height + tileHeight - 1) / tileHeight),
+        m_tileBytes((std::size_t)tileWidth * tileHeight * channels),
+        m_memoryLimit(memoryLimit),
+        m_swapFilename(swapFilename) {
+    if(width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0)
+        throw Exception("Size and tile size of ImagePyramidTileStorage must be > 0");
+    m_tiles = std::vector<Tile>((std::size_t)m_tilesX * m_tilesY);
+}
+
+ImagePyramidTileStorage::~ImagePyramidTileStorage() {
+    if(m_swapFile.is_open()) {
+        m_swapFile.close();
+        std::remove(m_swapFilename.c_str());
+    }
+}
+
+int ImagePyramidTileStorage::getTileWidth() const {
+    return m_tileWidth;
+}
+
+int ImagePyramidTileStorage::getTileHeight() const {
+    return m_tileHeight;
+}
+
+int ImagePyramidTileStorage::getTileCountX() const {
+    return m_tilesX;
+}
+
+int ImagePyramidTileStorage::getTileCountY() const {
+    return m_tilesY;
+}
+
+int ImagePyramidTileStorage::getTileIndex(int x, int y) const {
+    return (x / m_tileWidth) + (y / m_tileHeight) * m_tilesX;
+}
+
+std::size_t ImagePyramidTileStorage::getTileDataOffset(int x, int y) const {
+    return ((x % m_tileWidth) + (std::size_t)(y % m_tileHeight) * m_tileWidth) * m_channels;
+}
+
+uint8_t ImagePyramidTileStorage::getScalar(int x, int y, int channel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint8_t* data = getTileData(getTileIndex(x, y), false);
+    if(data == nullptr)
+        return 0;
+    return data[getTileDataOffset(x, y) + channel];
+}
+
+void ImagePyramidTileStorage::setScalar(int x, int y, int channel, uint8_t value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint8_t* data = getTileData(getTileIndex(x, y), true);
+    data[getTileDataOffset(x, y) + channel] = value;
+}
+
+uint8_t* ImagePyramidTileStorage::pinTile(int tileIndex, bool write) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint8_t* data = getTileData(tileIndex, write);
+    if(data != nullptr)
+        ++m_tiles[tileIndex].pins;
+    return data;
+}
+
+void ImagePyramidTileStorage::unpinTile(int tileIndex) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Tile& tile = m_tiles.at(tileIndex);
+    if(tile.pins <= 0)
+        throw Exception("Tried to unpin a tile which is not pinned");
+    --tile.pins;
+    // Tiles may have been kept in memory above the limit because they were pinned
+    evictTiles();
+}
+
+void ImagePyramidTileStorage::getRegion(int x, int y, int width, int height, uint8_t* data) {
+    const int startX = std::max(x, 0);
+    const int startY = std::max(y, 0);
+    const int endX = std::min(x + width, m_width);
+    const int endY = std::min(y + height, m_height);
+    if(startX > x || startY > y || endX < x + width || endY < y + height)
+        std::memset(data, 0, (std::size_t)width * height * m_channels);
+    if(startX >= endX || startY >= endY)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(int tileY = startY / m_tileHeight; tileY <= (endY - 1) / m_tileHeight; ++tileY) {
+        for(int tileX = startX / m_tileWidth; tileX <= (endX - 1) / m_tileWidth; ++tileX) {
+            // Intersection of region and tile
+            const int fromX = std::max(startX, tileX * m_tileWidth);
+            const int toX = std::min(endX, (tileX + 1) * m_tileWidth);
+            const int fromY = std::max(startY, tileY * m_tileHeight);
+            const int toY = std::min(endY, (tileY + 1) * m_tileHeight);
+            const std::size_t rowBytes = (std::size_t)(toX - fromX) * m_channels;
+            const uint8_t* tileData = getTileData(tileX + tileY * m_tilesX, false);
+            for(int cy = fromY; cy < toY; ++cy) {
+                uint8_t* destination = data + ((fromX - x) + (std::size_t)(cy - y) * width) * m_channels;
+                if(tileData == nullptr) {
+                    std::memset(destination, 0, rowBytes);
+                } else {
+                    std::memcpy(destination, tileData + ((fromX - tileX * m_tileWidth) + (std::size_t)(cy - tileY * m_tileHeight) * m_tileWidth) * m_channels, rowBytes);
+                }
+            }
+        }
+    }
+}
+
+void ImagePyramidTileStorage::setRegion(int x, int y, int width, int height, const uint8_t* data) {
+    const int startX = std::max(x, 0);
+    const int startY = std::max(y, 0);
+    const int endX = std::min(x + width, m_width);
+    const int endY = std::min(y + height, m_height);
+    if(startX >= endX || startY >= endY)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(int tileY = startY / m_tileHeight; tileY <= (endY - 1) / m_tileHeight; ++tileY) {
+        for(int tileX = startX / m_tileWidth; tileX <= (endX - 1) / m_tileWidth; ++tileX) {
+            const int fromX = std::max(startX, tileX * m_tileWidth);
+            const int toX = std::min(endX, (tileX + 1) * m_tileWidth);
+            const int fromY = std::max(startY, tileY * m_tileHeight);
+            const int toY = std::min(endY, (tileY + 1) * m_tileHeight);
+            const std::size_t rowBytes = (std::size_t)(toX - fromX) * m_channels;
+            uint8_t* tileData = getTileData(tileX + tileY * m_tilesX, true);
+            for(int cy = fromY; cy < toY; ++cy) {
+                std::memcpy(tileData + ((fromX - tileX * m_tileWidth) + (std::size_t)(cy - tileY * m_tileHeight) * m_tileWidth) * m_channels,
+                            data + ((fromX - x) + (std::size_t)(cy - y) * width) * m_channels, rowBytes);
+            }
+        }
+    }
+}
+
+bool ImagePyramidTileStorage::isTileAllocated(int tileIndex) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Tile& tile = m_tiles.at(tileIndex);
+    return tile.data || tile.swapSize > 0;
+}
+
+std::size_t ImagePyramidTileStorage::getMemoryUsage() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_residentTiles * m_tileBytes;
+}
+
+uint8_t* ImagePyramidTileStorage::getTileData(int tileIndex, bool write) {
+    Tile& tile = m_tiles[tileIndex];
+    if(tile.data) {
+        // Mark as most recently used
+        if(m_lru.front() != tileIndex)
+            m_lru.splice(m_lru.begin(), m_lru, tile.lruPosition);
+    } else {
+        if(tile.swapSize > 0) {
+            readTileFromSwap(tile);
+        } else if(write) {
+            // First write to tile, allocate and initialize to zero
+            tile.data = std::make_unique<uint8_t[]>(m_tileBytes);
+        } else {
+            return nullptr;
+        }
+        m_lru.push_front(tileIndex);
+        tile.lruPosition = m_lru.begin();
+        ++m_residentTiles;
+        evictTiles();
+    }
+    if(write)
+        tile.modified = true;
+    return tile.data.get();
+}
+
+void ImagePyramidTileStorage::evictTiles() {
+    // Never evict the most recently used tile, as it is about to be accessed, or pinned tiles
+    auto position = m_lru.end();
+    while(m_residentTiles * m_tileBytes > m_memoryLimit && position != m_lru.begin()) {
+        --position;
+        const int tileIndex = *position;
+        if(position == m_lru.begin() || m_tiles[tileIndex].pins > 0)
+            continue;
+        // Evicting removes the tile from the LRU list, so step past it to keep a valid position
+        ++position;
+        evictTile(tileIndex);
+    }
+}
+
+void ImagePyramidTileStorage::evictTile(int tileIndex) {
+    Tile& tile = m_tiles[tileIndex];
+    m_lru.erase(tile.lruPosition);
+    --m_residentTiles;
+    if(!tile.modified) {
+        // Swap file is up to date
+        tile.data.reset();
+        return;
+    }
+
+    // Tiles with only zeros don't have to be stored
+    const bool empty = std::all_of(tile.data.get(), tile.data.get() + m_tileBytes, [](uint8_t value) { return value == 0; });
+    if(empty) {
+        tile.data.reset();
+        tile.swapSize = 0;
+        tile.modified = false;
+        return;
+    }
+
+    uLongf compressedSize = compressBound(m_tileBytes);
+    auto compressed = std::make_unique<Bytef[]>(compressedSize);
+    if(compress2(compressed.get(), &compressedSize, tile.data.get(), m_tileBytes, Z_BEST_SPEED) != Z_OK)
+        throw Exception("Failed to compress image pyramid tile");
+
+    if(!m_swapFile.is_open()) {
+        m_swapFile.open(m_swapFilename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!m_swapFile.is_open())
+            throw Exception("Unable to create image pyramid swap file " + m_swapFilename);
+    }
+    // Reuse the previous location of this tile if it is large enough, otherwise append
+    if(tile.swapSize == 0 || compressedSize > tile.swapSize) {
+        tile.swapOffset = m_swapFileSize;
+        m_swapFileSize += compressedSize;
+    }
+    m_swapFile.seekp(tile.swapOffset);
+    m_swapFile.write((const char*)compressed.get(), compressedSize);
+    if(!m_swapFile)
+        throw Exception("Failed to write tile to image pyramid swap file " + m_swapFilename);
+    tile.swapSize = compressedSize;
+    tile.data.reset();
+    tile.modified = false;
+}
+
+void ImagePyramidTileStorage::readTileFromSwap(Tile& tile) {
+    auto compressed = std::make_unique<Bytef[]>(tile.swapSize);
+    m_swapFile.seekg(tile.swapOffset);
+    m_swapFile.read((char*)compressed.get(), tile.swapSize);
+    if(!m_swapFile)
+        throw Exception("Failed to read tile from image pyramid swap file " + m_swapFilename);
+    tile.data = std::make_unique<uint8_t[]>(m_tileBytes);
+    uLongf size = m_tileBytes;
+    if(uncompress(tile.data.get(), &size, compressed.get(), tile.swapSize) != Z_OK || size != m_tileBytes)
+        throw Exception("Failed to decompress image pyramid tile");
+    tile.modified = false;
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <FAST/Object.hpp>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Sparse, tiled storage of a single image pyramid level with 8 bit pixels.
+ *
+ * The level is divided into fixed size tiles which are allocated on first write.
+ * Tiles which have never been written are read as zero, thus an empty level uses almost no memory.
+ * When the uncompressed tiles exceed the memory limit, the least recently used tiles are compressed
+ * and written to a swap file on disk, and read back the next time they are accessed.
+ * Tiles which only contain zeros are freed instead of being written to disk.
+ *
+ * All methods are thread-safe.
+ */
+class FAST_EXPORT ImagePyramidTileStorage {
+    public:
+        typedef std::shared_ptr<ImagePyramidTileStorage> pointer;
+        /**
+         * @param width Width of level
+         * @param height Height of level
+         * @param channels Number of channels
+         * @param tileWidth
+         * @param tileHeight
+         * @param memoryLimit Maximum number of bytes used by uncompressed tiles before tiles are evicted to disk
+         * @param swapFilename File used to store evicted tiles. Created when the first tile is evicted.
+         */
+        ImagePyramidTileStorage(int width, int height, int channels, int tileWidth, int tileHeight, std::size_t memoryLimit, std::string swapFilename);
+        int getTileWidth() const;
+        int getTileHeight() const;
+        int getTileCountX() const;
+        int getTileCountY() const;
+        /**
+         * @return integer index of the tile containing pixel x, y
+         */
+        int getTileIndex(int x, int y) const;
+        uint8_t getScalar(int x, int y, int channel = 0);
+        void setScalar(int x, int y, int channel, uint8_t value);
+        /**
+         * Get the data of a tile and pin it in memory, so that it is not evicted before unpinTile is called.
+         * This lets a caller access many pixels of the same tile while locking and updating the LRU list only once.
+         * @param tileIndex
+         * @param write marks the tile as modified, and allocates it if it has never been written
+         * @return tile data, or nullptr if write is false and the tile has never been written. Nothing is pinned in that case.
+         */
+        uint8_t* pinTile(int tileIndex, bool write);
+        void unpinTile(int tileIndex);
+        /**
+         * @return offset of the first channel of pixel x, y in the data of the tile containing the pixel
+         */
+        std::size_t getTileDataOffset(int x, int y) const;
+        /**
+         * Copy a region to a buffer of size width*height*channels. Parts of the region outside the level are set to zero.
+         */
+        void getRegion(int x, int y, int width, int height, uint8_t* data);
+        /**
+         * Copy a buffer of size width*height*channels into a region. Parts of the region outside the level are ignored.
+         */
+        void setRegion(int x, int y, int width, int height, const uint8_t* data);
+        /**
+         * @return true if the tile has been written to, and has not been freed because it only contained zeros
+         */
+        bool isTileAllocated(int tileIndex);
+        /**
+         * @return number of bytes used by uncompressed tiles in memory
+         */
+        std::size_t getMemoryUsage();
+        ~ImagePyramidTileStorage();
+    private:
+        struct Tile {
+            // Uncompressed data, nullptr if the tile is not in memory
+            std::unique_ptr<uint8_t[]> data;
+            // Location of the compressed tile in the swap file. swapSize is 0 if the tile has never been evicted.
+            std::streamoff swapOffset = 0;
+            std::size_t swapSize = 0;
+            // Whether the data in memory differs from the data in the swap file
+            bool modified = false;
+            // Number of pinTile calls without a matching unpinTile. Pinned tiles are never evicted.
+            int pins = 0;
+            std::list<int>::iterator lruPosition;
+        };
+
+        uint8_t* getTileData(int tileIndex, bool write);
+        void evictTiles();
+        void evictTile(int tileIndex);
+        void readTileFromSwap(Tile& tile);
+
+        const int m_width;
+        const int m_height;
+        const int m_channels;
+        const int m_tileWidth;
+        const int m_tileHeight;
+        const int m_tilesX;
+        const int m_tilesY;
+        const std::size_t m_tileBytes;
+        const std::size_t m_memoryLimit;
+        std::vector<Tile> m_tiles;
+        // Tiles in memory, most recently used first
+        std::list<int> m_lru;
+        std::size_t m_residentTiles = 0;
+        std::string m_swapFilename;
+        std::fstream m_swapFile;
+        std::streamoff m_swapFileSize = 0;
+        std::mutex m_mutex;
+};
+
+}
@@ -0,0 +1,294 @@
+#include "ImageStatistics.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FAST_STATISTICS_SSE2
+#include <immintrin.h>
+#endif
+
+// Undefine windows crap
+#undef min
+#undef max
+
+namespace fast {
+
+// Number of elements processed at a time by each thread.
+// Small enough that the sum of a chunk of 16 bit integers can't overflow the 32 bit accumulators.
+static const std::size_t chunkSize = 1 << 16;
+
+struct ChunkStatistics {
+    float min;
+    float max;
+    double sum;
+};
+
+// Floats are summed as doubles, since float sums lose precision on large chunks
+template <class T>
+using ChunkSumType = typename std::conditional<std::is_floating_point<T>::value, double,
+        typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type>::type;
+
+/**
+ * Portable version. Uses independent lanes without branches, so that the compiler is able to
+ * vectorize the main loop with the instruction set it is targeting.
+ */
+template <class T>
+static ChunkStatistics getChunkStatistics(const T* data, std::size_t size) {
+    constexpr int lanes = 16;
+    T laneMin[lanes];
+    T laneMax[lanes];
+    ChunkSumType<T> laneSum[lanes];
+    for(int lane = 0; lane < lanes; ++lane) {
+        laneMin[lane] = data[0];
+        laneMax[lane] = data[0];
+        laneSum[lane] = 0;
+    }
+    std::size_t i = 0;
+    for(; i + lanes <= size; i += lanes) {
+        for(int lane = 0; lane < lanes; ++lane) {
+            const T value = data[i + lane];
+            laneMin[lane] = value < laneMin[lane] ? value : laneMin[lane];
+            laneMax[lane] = value > laneMax[lane] ? value : laneMax[lane];
+            laneSum[lane] += value;
+        }
+    }
+    for(; i < size; ++i) {
+        laneMin[0] = std::min(laneMin[0], data[i]);
+        laneMax[0] = std::max(laneMax[0], data[i]);
+        laneSum[0] += data[i];
+    }
+
+    ChunkStatistics result = {(float)laneMin[0], (float)laneMax[0], 0.0};
+    for(int lane = 0; lane < lanes; ++lane) {
+        result.min = std::min(result.min, (float)laneMin[lane]);
+        result.max = std::max(result.max, (float)laneMax[lane]);
+        result.sum += laneSum[lane];
+    }
+    return result;
+}
+
+#ifdef FAST_STATISTICS_SSE2
+#ifdef __AVX2__
+template <>
+ChunkStatistics getChunkStatistics<float>(const float* data, std::size_t size) {
+    __m256 minimum = _mm256_set1_ps(data[0]);
+    __m256 maximum = minimum;
+    // Each half of the floats is widened and summed in double lanes
+    __m256d sumLow = _mm256_setzero_pd();
+    __m256d sumHigh = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        const __m256 value = _mm256_loadu_ps(data + i);
+        minimum = _mm256_min_ps(minimum, value);
+        maximum = _mm256_max_ps(maximum, value);
+        sumLow = _mm256_add_pd(sumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+        sumHigh = _mm256_add_pd(sumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+    }
+    float laneMin[8], laneMax[8];
+    double laneSum[4];
+    _mm256_storeu_ps(laneMin, minimum);
+    _mm256_storeu_ps(laneMax, maximum);
+    _mm256_storeu_pd(laneSum, _mm256_add_pd(sumLow, sumHigh));
+    ChunkStatistics result = {laneMin[0], laneMax[0], 0.0};
+    for(int lane = 0; lane < 8; ++lane) {
+        result.min = std::min(result.min, laneMin[lane]);
+        result.max = std::max(result.max, laneMax[lane]);
+    }
+    for(int lane = 0; lane < 4; ++lane)
+        result.sum += laneSum[lane];
+    for(; i < size; ++i) {
+        result.min = std::min(result.min, data[i]);
+        result.max = std::max(result.max, data[i]);
+        result.sum += data[i];
+    }
+    return result;
+}
+
+template <>
+ChunkStatistics getChunkStatistics<uchar>(const uchar* data, std::size_t size) {
+    __m256i minimum = _mm256_set1_epi8((char)data[0]);
+    __m256i maximum = minimum;
+    // Sum of absolute differences against zero gives four 64 bit sums
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    std::size_t i = 0;
+    for(; i + 32 <= size; i += 32) {
+        const __m256i value = _mm256_loadu_si256((const __m256i*)(data + i));
+        minimum = _mm256_min_epu8(minimum, value);
+        maximum = _mm256_max_epu8(maximum, value);
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(value, zero));
+    }
+    uchar laneMin[32], laneMax[32];
+    uint64_t laneSum[4];
+    _mm256_storeu_si256((__m256i*)laneMin, minimum);
+    _mm256_storeu_si256((__m256i*)laneMax, maximum);
+    _mm256_storeu_si256((__m256i*)laneSum, sum);
+    uchar resultMin = laneMin[0];
+    uchar resultMax = laneMax[0];
+    for(int lane = 0; lane < 32; ++lane) {
+        resultMin = std::min(resultMin, laneMin[lane]);
+        resultMax = std::max(resultMax, laneMax[lane]);
+    }
+    uint64_t resultSum = laneSum[0] + laneSum[1] + laneSum[2] + laneSum[3];
+    for(; i < size; ++i) {
+        resultMin = std::min(resultMin, data[i]);
+        resultMax = std::max(resultMax, data[i]);
+        resultSum += data[i];
+    }
+    return {(float)resultMin, (float)resultMax, (double)resultSum};
+}
+#else
+template <>
+ChunkStatistics getChunkStatistics<float>(const float* data, std::size_t size) {
+    __m128 minimum = _mm_set1_ps(data[0]);
+    __m128 maximum = minimum;
+    // Each half of the floats is widened and summed in double lanes
+    __m128d sumLow = _mm_setzero_pd();
+    __m128d sumHigh = _mm_setzero_pd();
+    std::size_t i = 0;
+    for(; i + 4 <= size; i += 4) {
+        const __m128 value = _mm_loadu_ps(data + i);
+        minimum = _mm_min_ps(minimum, value);
+        maximum = _mm_max_ps(maximum, value);
+        sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(value));
+        sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(value, value)));
+    }
+    float laneMin[4], laneMax[4];
+    double laneSum[2];
+    _mm_storeu_ps(laneMin, minimum);
+    _mm_storeu_ps(laneMax, maximum);
+    _mm_storeu_pd(laneSum, _mm_add_pd(sumLow, sumHigh));
+    ChunkStatistics result = {laneMin[0], laneMax[0], laneSum[0] + laneSum[1]};
+    for(int lane = 0; lane < 4; ++lane) {
+        result.min = std::min(result.min, laneMin[lane]);
+        result.max = std::max(result.max, laneMax[lane]);
+    }
+    for(; i < size; ++i) {
+        result.min = std::min(result.min, data[i]);
+        result.max = std::max(result.max, data[i]);
+        result.sum += data[i];
+    }
+    return result;
+}
+
+template <>
+ChunkStatistics getChunkStatistics<uchar>(const uchar* data, std::size_t size) {
+    __m128i minimum = _mm_set1_epi8((char)data[0]);
+    __m128i maximum = minimum;
+    // Sum of absolute differences against zero gives two 64 bit sums
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    std::size_t i = 0;
+    for(; i + 16 <= size; i += 16) {
+        const __m128i value = _mm_loadu_si128((const __m128i*)(data + i));
+        minimum = _mm_min_epu8(minimum, value);
+        maximum = _mm_max_epu8(maximum, value);
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(value, zero));
+    }
+    uchar laneMin[16], laneMax[16];
+    uint64_t laneSum[2];
+    _mm_storeu_si128((__m128i*)laneMin, minimum);
+    _mm_storeu_si128((__m128i*)laneMax, maximum);
+    _mm_storeu_si128((__m128i*)laneSum, sum);
+    uchar resultMin = laneMin[0];
+    uchar resultMax = laneMax[0];
+    for(int lane = 0; lane < 16; ++lane) {
+        resultMin = std::min(resultMin, laneMin[lane]);
+        resultMax = std::max(resultMax, laneMax[lane]);
+    }
+    uint64_t resultSum = laneSum[0] + laneSum[1];
+    for(; i < size; ++i) {
+        resultMin = std::min(resultMin, data[i]);
+        resultMax = std::max(resultMax, data[i]);
+        resultSum += data[i];
+    }
+    return {(float)resultMin, (float)resultMax, (double)resultSum};
+}
+#endif
+#endif
+
+template <class T>
+static void getStatistics(const T* data, std::size_t nrOfElements, float* min, float* max, double* sum) {
+    const int chunks = (int)((nrOfElements + chunkSize - 1) / chunkSize);
+    std::vector<ChunkStatistics> results(chunks);
+    #pragma omp parallel for if(chunks >= 4)
+    for(int chunk = 0; chunk < chunks; ++chunk) {
+        const std::size_t start = (std::size_t)chunk * chunkSize;
+        results[chunk] = getChunkStatistics<T>(data + start, std::min(chunkSize, nrOfElements - start));
+    }
+
+    *min = results[0].min;
+    *max = results[0].max;
+    *sum = 0.0;
+    for(const ChunkStatistics& result : results) {
+        *min = std::min(*min, result.min);
+        *max = std::max(*max, result.max);
+        *sum += result.sum;
+    }
+}
+
+template <class T>
+static void getHistogram(const T* data, std::size_t nrOfElements, float scale, int bins, float min, float max, std::vector<uint64_t>& histogram) {
+    const int chunks = (int)((nrOfElements + chunkSize - 1) / chunkSize);
+    const double binsPerIntensity = bins / ((double)max - min);
+    #pragma omp parallel if(chunks >= 4)
+    {
+        std::vector<uint64_t> localHistogram(bins, 0);
+        #pragma omp for
+        for(int chunk = 0; chunk < chunks; ++chunk) {
+            const std::size_t start = (std::size_t)chunk * chunkSize;
+            const std::size_t end = std::min(start + chunkSize, nrOfElements);
+            for(std::size_t i = start; i < end; ++i) {
+                const float value = data[i] * scale;
+                // Also skips NaN
+                if(!(value >= min && value <= max))
+                    continue;
+                const int bin = (int)((value - min) * binsPerIntensity);
+                ++localHistogram[std::min(bin, bins - 1)];
+            }
+        }
+        #pragma omp critical
+        for(int bin = 0; bin < bins; ++bin)
+            histogram[bin] += localHistogram[bin];
+    }
+}
+
+/**
+ * Normalized types are stored as 16 bit integers, but are read as floats in [0, 1] or [-1, 1] from OpenCL images
+ */
+static float getNormalizationScale(DataType type) {
+    if(type == TYPE_UNORM_INT16)
+        return 1.0f / 65535.0f;
+    if(type == TYPE_SNORM_INT16)
+        return 1.0f / 32767.0f;
+    return 1.0f;
+}
+
+void getStatisticsFromData(const void* data, std::size_t nrOfElements, DataType type, float* min, float* max, double* sum) {
+    if(nrOfElements == 0)
+        throw Exception("Unable to calculate statistics of an empty array");
+
+    switch(type) {
+        fastSwitchTypeMacro(getStatistics<FAST_TYPE>((const FAST_TYPE*)data, nrOfElements, min, max, sum))
+    }
+    const float scale = getNormalizationScale(type);
+    *min *= scale;
+    *max *= scale;
+    *sum *= scale;
+}
+
+std::vector<uint64_t> getHistogramFromData(const void* data, std::size_t nrOfElements, DataType type, int bins, float min, float max) {
+    if(bins < 1)
+        throw Exception("Number of histogram bins must be > 0");
+    if(!(max > min))
+        throw Exception("Histogram max must be larger than min");
+
+    std::vector<uint64_t> histogram(bins, 0);
+    const float scale = getNormalizationScale(type);
+    switch(type) {
+        fastSwitchTypeMacro(getHistogram<FAST_TYPE>((const FAST_TYPE*)data, nrOfElements, scale, bins, min, max, histogram))
+    }
+    return histogram;
+}
+
+}
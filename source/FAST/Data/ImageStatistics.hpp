@@ -0,0 +1,39 @@
+#pragma once
+
+#include <FAST/Data/DataTypes.hpp>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Calculate minimum, maximum and sum of an array in a single pass.
+ * The array is split in chunks which are processed in parallel with OpenMP, and each chunk is
+ * processed with SSE2/AVX2 instructions for float and uint8 data when available.
+ * Normalized types (TYPE_SNORM_INT16 and TYPE_UNORM_INT16) are scaled to [-1, 1] and [0, 1]
+ * to match the values read from OpenCL images.
+ *
+ * @param data
+ * @param nrOfElements
+ * @param type
+ * @param min
+ * @param max
+ * @param sum
+ */
+FAST_EXPORT void getStatisticsFromData(const void* data, std::size_t nrOfElements, DataType type, float* min, float* max, double* sum);
+
+/**
+ * Calculate histogram of an array in parallel.
+ * Bin i covers the intensities [min + i*(max-min)/bins, min + (i+1)*(max-min)/bins).
+ * Intensities equal to max are put in the last bin, while intensities outside [min, max] are ignored.
+ *
+ * @param data
+ * @param nrOfElements
+ * @param type
+ * @param bins
+ * @param min
+ * @param max
+ * @return number of elements in each bin
+ */
+FAST_EXPORT std::vector<uint64_t> getHistogramFromData(const void* data, std::size_t nrOfElements, DataType type, int bins, float min, float max);
+
+}
@@ -24,6 +24,7 @@ void Tensor::create(TensorShape shape) {
     if(shape.getUnknownDimensions() > 0)
         throw Exception("When creating a tensor, shape must be fully defined");
     m_data = make_uninitialized_unique<float[]>(shape.getTotalSize());
+    m_shape = shape;
     m_spacing = VectorXf::Ones(shape.getDimensions());
     mHostDataIsUpToDate = true;
     if(m_shape.getDimensions() >= 3) {
@@ -53,6 +54,38 @@ void Tensor::create(std::initializer_list<float> data) {
     }
 }
 
+void Tensor::create(SharedPointer<Tensor> tensor, std::size_t offset, TensorShape shape) {
+    if(shape.empty())
+        throw Exception("Shape can't be empty");
+    if(shape.getUnknownDimensions() > 0)
+        throw Exception("When creating a tensor view, shape must be fully defined");
+    if(tensor->isView()) {
+        offset += tensor->m_viewOffset;
+        tensor = tensor->m_viewedTensor;
+    }
+    if(offset + shape.getTotalSize() > (std::size_t)tensor->getShape().getTotalSize())
+        throw Exception("Tensor view " + shape.toString() + " at offset " + std::to_string(offset) +
+                        " is outside of the tensor with shape " + tensor->getShape().toString());
+    m_viewedTensor = tensor;
+    m_viewOffset = offset;
+    m_shape = shape;
+    m_spacing = VectorXf::Ones(shape.getDimensions());
+    mHostDataIsUpToDate = false;
+    if(m_shape.getDimensions() >= 3) {
+        const int width = m_shape[m_shape.getDimensions() - 2];
+        const int height = m_shape[m_shape.getDimensions() - 3];
+        mBoundingBox = DataBoundingBox(Vector3f(width, height, 1));
+    }
+}
+
+bool Tensor::isView() const {
+    return (bool)m_viewedTensor;
+}
+
+std::size_t Tensor::getOpenCLBufferOffset() const {
+    return m_viewOffset;
+}
+
 void Tensor::expandDims(int position) {
 	if(position < 0) { // append to end
 		m_shape.addDimension(1);
@@ -70,6 +103,15 @@ TensorAccess::pointer Tensor::getAccess(accessType type) {
     if(!isInitialized())
         throw Exception("Tensor has not been initialized.");
 
+    if(isView()) {
+        // The viewed tensor handles locking and transfers
+        if(type == ACCESS_READ_WRITE)
+            updateModifiedTimestamp();
+        auto access = m_viewedTensor->getAccess(type);
+        float* data = access->getRawData() + m_viewOffset;
+        return std::make_unique<TensorAccess>(data, m_shape, std::move(access));
+    }
+
     blockIfBeingWrittenTo();
 
     if(type == ACCESS_READ_WRITE) {
@@ -77,6 +119,7 @@ TensorAccess::pointer Tensor::getAccess(accessType type) {
         std::unique_lock<std::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
+    waitForOpenCLEvents(Host::getInstance(), type == ACCESS_READ_WRITE);
     updateHostData();
     if(type == ACCESS_READ_WRITE) {
         setAllDataToOutOfDate();
@@ -114,6 +157,12 @@ OpenCLBufferAccess::pointer Tensor::getOpenCLBufferAccess(accessType type, OpenC
     if(!isInitialized())
         throw Exception("Tensor has not been initialized.");
 
+    if(isView()) {
+        if(type == ACCESS_READ_WRITE)
+            updateModifiedTimestamp();
+        return m_viewedTensor->getOpenCLBufferAccess(type, device);
+    }
+
     blockIfBeingWrittenTo();
 
     if(type == ACCESS_READ_WRITE) {
@@ -121,6 +170,7 @@ OpenCLBufferAccess::pointer Tensor::getOpenCLBufferAccess(accessType type, OpenC
         std::unique_lock<std::mutex> lock(mDataIsBeingWrittenToMutex);
         mDataIsBeingWrittenTo = true;
     }
+    waitForOpenCLEvents(device, type == ACCESS_READ_WRITE);
     updateOpenCLBufferData(device);
     if(type == ACCESS_READ_WRITE) {
         setAllDataToOutOfDate();
@@ -133,7 +183,7 @@ OpenCLBufferAccess::pointer Tensor::getOpenCLBufferAccess(accessType type, OpenC
     }
 
     // Now it is guaranteed that the data is on the device and that it is up to date
-	auto accessObject = std::make_unique<OpenCLBufferAccess>(mCLBuffers[device],  std::dynamic_pointer_cast<DataObject>(mPtr.lock()));
+	auto accessObject = std::make_unique<OpenCLBufferAccess>(mCLBuffers[device],  std::dynamic_pointer_cast<DataObject>(mPtr.lock()), device, type == ACCESS_READ_WRITE);
 	return std::move(accessObject);
 }
 
@@ -142,6 +192,8 @@ bool Tensor::isInitialized() {
 }
 
 bool Tensor::hasAnyData() {
+    if(isView())
+        return m_viewedTensor->hasAnyData();
     return m_data.get() != nullptr || mCLBuffers.size() > 0;
 }
 
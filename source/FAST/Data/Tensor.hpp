@@ -28,6 +28,24 @@ class FAST_EXPORT Tensor : public SpatialDataObject {
 		 * @param data
 		 */
 		virtual void create(std::initializer_list<float> data);
+        /**
+         * Create a view of a part of another tensor. No data is copied, the view and the other tensor share the
+         * same data, thus writing to one changes the other. This is used to split a batch into its samples.
+         * @param tensor Tensor to view. If this is a view as well, the view is made of the tensor it views.
+         * @param offset Position of the first element of the view in the data of the tensor
+         * @param shape Shape of the view
+         */
+        virtual void create(SharedPointer<Tensor> tensor, std::size_t offset, TensorShape shape);
+        /**
+         * @return true if this tensor is a view of another tensor
+         */
+        virtual bool isView() const;
+        /**
+         * Position of the first element of this tensor in its OpenCL buffer. This is 0, unless the tensor is a view,
+         * since views give access to the OpenCL buffer of the tensor they view.
+         * @return offset in number of elements
+         */
+        virtual std::size_t getOpenCLBufferOffset() const;
 		/**
 		 * Add a dimension of size 1 at provided position. -1 is last position.
 		 * @param position
@@ -35,6 +53,10 @@ class FAST_EXPORT Tensor : public SpatialDataObject {
 		virtual void expandDims(int position = 0);
         virtual TensorShape getShape() const;
         virtual TensorAccess::pointer getAccess(accessType type);
+        /**
+         * Get access to the data of this tensor on an OpenCL device. For views, the buffer of the viewed tensor is
+         * given, see getOpenCLBufferOffset.
+         */
         virtual std::unique_ptr<OpenCLBufferAccess> getOpenCLBufferAccess(accessType type, OpenCLDevice::pointer);
         virtual void freeAll() override;
         virtual void free(ExecutionDevice::pointer device) override;
@@ -65,6 +87,10 @@ class FAST_EXPORT Tensor : public SpatialDataObject {
 
         VectorXf m_spacing;
 
+        // Tensor which has the data of this view, if this is a view
+        SharedPointer<Tensor> m_viewedTensor;
+        std::size_t m_viewOffset = 0;
+
         friend TensorAccess;
         friend OpenCLBufferAccess;
 };
@@ -1,6 +1,7 @@
 #include "FAST/Testing.hpp"
 #include "FAST/Tests/DummyObjects.hpp"
 #include "FAST/DeviceManager.hpp"
+#include "FAST/Data/Tensor.hpp"
 
 namespace fast {
 
@@ -14,4 +15,39 @@ TEST_CASE("Update timestamp on DataObject", "[fast][DataObject]") {
 
 
 
+TEST_CASE("Tensor view shares data with the viewed tensor", "[fast][DataObject][Tensor]") {
+    auto data = make_uninitialized_unique<float[]>(3*2*2);
+    for(int i = 0; i < 3*2*2; ++i)
+        data[i] = i;
+    auto tensor = Tensor::New();
+    tensor->create(std::move(data), TensorShape({3, 2, 2}));
+
+    auto view = Tensor::New();
+    view->create(tensor, 4, TensorShape({2, 2}));
+    CHECK(view->isView());
+    CHECK(view->getOpenCLBufferOffset() == 4);
+    {
+        auto access = view->getAccess(ACCESS_READ_WRITE);
+        CHECK(access->getShape().getDimensions() == 2);
+        CHECK(access->getShape()[0] == 2);
+        float* values = access->getRawData();
+        CHECK(values[0] == 4);
+        CHECK(values[3] == 7);
+        values[1] = -1;
+    }
+    {
+        auto access = tensor->getAccess(ACCESS_READ);
+        CHECK(access->getRawData()[5] == -1);
+    }
+
+    // A view of a view views the original tensor
+    auto viewOfView = Tensor::New();
+    viewOfView->create(view, 2, TensorShape({2}));
+    CHECK(viewOfView->getOpenCLBufferOffset() == 6);
+    CHECK(viewOfView->getAccess(ACCESS_READ)->getRawData()[0] == 6);
+
+    auto outside = Tensor::New();
+    CHECK_THROWS(outside->create(tensor, 10, TensorShape({2, 2})));
+}
+
 };
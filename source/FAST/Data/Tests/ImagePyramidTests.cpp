@@ -0,0 +1,165 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Data/ImagePyramid.hpp"
+#include "FAST/Data/ImagePyramidTileStorage.hpp"
+
+using namespace fast;
+
+TEST_CASE("Tile storage reads zero from tiles which have not been written", "[fast][ImagePyramid]") {
+    ImagePyramidTileStorage storage(1000, 600, 3, 256, 256, 1024*1024, "/tmp/fast_tile_storage_test_0.bin");
+    CHECK(storage.getTileCountX() == 4);
+    CHECK(storage.getTileCountY() == 3);
+    CHECK(storage.getScalar(999, 599, 2) == 0);
+    CHECK(storage.getMemoryUsage() == 0);
+
+    storage.setScalar(300, 10, 1, 42);
+    CHECK(storage.getScalar(300, 10, 1) == 42);
+    CHECK(storage.getScalar(300, 10, 0) == 0);
+    CHECK(storage.isTileAllocated(storage.getTileIndex(300, 10)));
+    CHECK_FALSE(storage.isTileAllocated(storage.getTileIndex(0, 0)));
+    CHECK(storage.getMemoryUsage() == 256*256*3);
+}
+
+TEST_CASE("Tile storage region read and write across tiles", "[fast][ImagePyramid]") {
+    ImagePyramidTileStorage storage(600, 600, 2, 256, 256, 1024*1024*1024, "/tmp/fast_tile_storage_test_1.bin");
+    const int width = 300;
+    const int height = 280;
+    std::vector<uint8_t> data(width*height*2);
+    for(int i = 0; i < data.size(); ++i)
+        data[i] = i % 251 + 1;
+    storage.setRegion(200, 100, width, height, data.data());
+
+    CHECK(storage.getScalar(200, 100, 0) == data[0]);
+    CHECK(storage.getScalar(200 + width - 1, 100 + height - 1, 1) == data.back());
+
+    // Read a region which is larger than the written region, and partly outside the level
+    std::vector<uint8_t> result((width + 20)*(height + 20)*2);
+    storage.getRegion(190, 90, width + 20, height + 20, result.data());
+    for(int y = 0; y < height + 20; ++y) {
+        for(int x = 0; x < width + 20; ++x) {
+            const int sourceX = x - 10;
+            const int sourceY = y - 10;
+            uint8_t expected = 0;
+            if(sourceX >= 0 && sourceX < width && sourceY >= 0 && sourceY < height)
+                expected = data[(sourceX + sourceY*width)*2 + 1];
+            REQUIRE((int)result[(x + y*(width + 20))*2 + 1] == (int)expected);
+        }
+    }
+}
+
+TEST_CASE("Tile storage swaps least recently used tiles to disk", "[fast][ImagePyramid]") {
+    const std::size_t tileBytes = 64*64*4;
+    // Room for two tiles in memory
+    ImagePyramidTileStorage storage(64*8, 64*8, 4, 64, 64, 2*tileBytes, "/tmp/fast_tile_storage_test_2.bin");
+    for(int tile = 0; tile < 8; ++tile)
+        storage.setScalar(tile*64 + 5, tile*64 + 7, 3, tile + 1);
+    CHECK(storage.getMemoryUsage() <= 2*tileBytes);
+
+    for(int tile = 0; tile < 8; ++tile) {
+        CHECK(storage.isTileAllocated(storage.getTileIndex(tile*64, tile*64)));
+        CHECK(storage.getScalar(tile*64 + 5, tile*64 + 7, 3) == tile + 1);
+        CHECK(storage.getScalar(tile*64 + 6, tile*64 + 7, 3) == 0);
+    }
+    CHECK(storage.getMemoryUsage() <= 2*tileBytes);
+
+    // Modify a swapped tile, and check that the new value is swapped
+    storage.setScalar(5, 7, 3, 100);
+    for(int tile = 1; tile < 8; ++tile)
+        storage.getScalar(tile*64, tile*64, 0);
+    CHECK(storage.getScalar(5, 7, 3) == 100);
+
+    // Tiles with only zeros are freed when evicted
+    storage.setScalar(64 + 5, 64 + 7, 3, 0);
+    for(int tile = 2; tile < 8; ++tile)
+        storage.getScalar(tile*64, tile*64, 0);
+    CHECK_FALSE(storage.isTileAllocated(storage.getTileIndex(64, 64)));
+}
+
+TEST_CASE("Tile storage does not evict pinned tiles", "[fast][ImagePyramid]") {
+    const std::size_t tileBytes = 64*64;
+    // Room for one tile in memory
+    ImagePyramidTileStorage storage(64*4, 64, 1, 64, 64, tileBytes, "/tmp/fast_tile_storage_test_3.bin");
+    CHECK(storage.pinTile(0, false) == nullptr);
+    uint8_t* data = storage.pinTile(0, true);
+    REQUIRE(data != nullptr);
+    data[storage.getTileDataOffset(5, 7)] = 42;
+    for(int tile = 1; tile < 4; ++tile)
+        storage.setScalar(tile*64, 0, 0, tile);
+    // The pinned tile stays in memory, and is written to directly
+    data[storage.getTileDataOffset(6, 7)] = 43;
+    CHECK(storage.getMemoryUsage() == 2*tileBytes);
+
+    storage.unpinTile(0);
+    CHECK(storage.getMemoryUsage() <= tileBytes);
+    CHECK(storage.getScalar(5, 7) == 42);
+    CHECK(storage.getScalar(6, 7) == 43);
+    for(int tile = 1; tile < 4; ++tile)
+        CHECK(storage.getScalar(tile*64, 0) == tile);
+}
+
+TEST_CASE("ImagePyramidAccess setPatch gives same result as setScalar", "[fast][ImagePyramid]") {
+    const int channels = 3;
+    auto pyramid1 = ImagePyramid::New();
+    pyramid1->create(8192, 8200, channels);
+    auto pyramid2 = ImagePyramid::New();
+    pyramid2->create(8192, 8200, channels);
+    REQUIRE(pyramid1->getNrOfLevels() == 2);
+
+    // Odd offset and size, to test partial 2x2 blocks at the border of the patch
+    const int offsetX = 1001;
+    const int offsetY = 999;
+    const int width = 301;
+    const int height = 203;
+    std::vector<uint8_t> data(width*height*channels);
+    for(int i = 0; i < data.size(); ++i)
+        data[i] = (i * 7919) % 256;
+
+    {
+        auto access1 = pyramid1->getAccess(ACCESS_READ_WRITE);
+        access1->setPatch(0, offsetX, offsetY, width, height, data.data());
+    }
+    {
+        auto access2 = pyramid2->getAccess(ACCESS_READ_WRITE);
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                for(int c = 0; c < channels; ++c)
+                    access2->setScalar(offsetX + x, offsetY + y, 0, data[(x + y*width)*channels + c], c);
+            }
+        }
+    }
+
+    auto access1 = pyramid1->getAccess(ACCESS_READ);
+    auto access2 = pyramid2->getAccess(ACCESS_READ);
+    for(int level = 0; level < 2; ++level) {
+        const int scale = 1 << level;
+        for(int y = offsetY / scale - 2; y < (offsetY + height) / scale + 2; ++y) {
+            for(int x = offsetX / scale - 2; x < (offsetX + width) / scale + 2; ++x) {
+                for(int c = 0; c < channels; ++c)
+                    REQUIRE((int)access1->getScalar(x, y, level, c) == (int)access2->getScalar(x, y, level, c));
+            }
+        }
+    }
+    CHECK(pyramid1->getDirtyPatches() == pyramid2->getDirtyPatches());
+}
+
+TEST_CASE("ImagePyramid dirty patches are the tiles of each level", "[fast][ImagePyramid]") {
+    // Size which is not a multiple of the tile size
+    auto pyramid = ImagePyramid::New();
+    pyramid->create(8300, 8200, 1);
+    REQUIRE(pyramid->getNrOfLevels() == 2);
+    CHECK(pyramid->getLevelTilesX(0) == 33);
+    CHECK(pyramid->getLevelTilesY(0) == 33);
+    CHECK(pyramid->getLevelTilesX(1) == 17);
+    CHECK(pyramid->getLevelTilesY(1) == 17);
+
+    auto access = pyramid->getAccess(ACCESS_READ_WRITE);
+    access->setScalar(8299, 8199, 0, 200);
+    CHECK(pyramid->getDirtyPatches() == std::unordered_set<std::string>({"0_32_32", "1_16_16"}));
+
+    // The last tile only covers the rest of the level
+    auto patch = access->getPatch(0, 32, 32);
+    CHECK(patch.offsetX == 8192);
+    CHECK(patch.offsetY == 8192);
+    CHECK(patch.width == 108);
+    CHECK(patch.height == 8);
+    CHECK((int)patch.data[patch.width*patch.height - 1] == 200);
+}
@@ -1,9 +1,11 @@
 #include "FAST/Testing.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/Data/ImageMemoryPool.hpp"
 #include "FAST/DeviceManager.hpp"
 #include "FAST/Tests/DataComparison.hpp"
 #include "FAST/Utility.hpp"
 #include <limits>
+#include <algorithm>
 
 using namespace fast;
 
@@ -1299,6 +1301,110 @@ TEST_CASE("calculateAverageIntensity returns the average intensity of a 3D image
     //}
 }
 
+
+TEST_CASE("Intensity statistics of a large multi-channel image stored on host", "[fast][image]") {
+    // Large enough to be split in several chunks
+    const unsigned int width = 1024;
+    const unsigned int height = 601;
+    const unsigned int nrOfChannels = 2;
+    const unsigned int nrOfElements = width*height*nrOfChannels;
+    for(unsigned int typeNr = 0; typeNr < 5; typeNr++) {
+        DataType type = (DataType)typeNr;
+        void* data = allocateRandomData(nrOfElements, type);
+
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+        double sum = 0;
+        switch(type) {
+            fastSwitchTypeMacro(
+                for(unsigned int i = 0; i < nrOfElements; ++i) {
+                    const float value = ((FAST_TYPE*)data)[i];
+                    min = std::min(min, value);
+                    max = std::max(max, value);
+                    sum += value;
+                }
+            )
+        }
+
+        Image::pointer image = Image::New();
+        image->create(width, height, type, nrOfChannels, Host::getInstance(), data);
+        CHECK(image->calculateMinimumIntensity() == min);
+        CHECK(image->calculateMaximumIntensity() == max);
+        CHECK(image->calculateAverageIntensity() == Approx(sum / nrOfElements));
+        deleteArray(data, type);
+    }
+}
+
+TEST_CASE("Intensity statistics of an image with only negative values", "[fast][image]") {
+    Image::pointer image = Image::New();
+    std::vector<float> data = {-5.0f, -2.5f, -3.0f, -1.0f, -4.0f};
+    image->create(5, 1, TYPE_FLOAT, 1, Host::getInstance(), data.data());
+    CHECK(image->calculateMinimumIntensity() == -5.0f);
+    CHECK(image->calculateMaximumIntensity() == -1.0f);
+    CHECK(image->calculateAverageIntensity() == Approx(-3.1f));
+}
+
+TEST_CASE("calculateHistogram counts intensities of all channels", "[fast][image]") {
+    const unsigned int width = 512;
+    const unsigned int height = 300;
+    const unsigned int nrOfChannels = 3;
+    std::vector<uchar> data(width*height*nrOfChannels);
+    std::vector<uint64_t> expected(256, 0);
+    for(int i = 0; i < data.size(); ++i) {
+        data[i] = (uchar)((i*31 + i/7) % 256);
+        expected[data[i]]++;
+    }
+    Image::pointer image = Image::New();
+    image->create(width, height, TYPE_UINT8, nrOfChannels, Host::getInstance(), data.data());
+
+    CHECK(image->calculateHistogram(256, 0, 256) == expected);
+
+    auto histogram = image->calculateHistogram(4, 0, 256);
+    REQUIRE(histogram.size() == 4);
+    for(int bin = 0; bin < 4; ++bin) {
+        uint64_t count = 0;
+        for(int value = bin*64; value < (bin + 1)*64; ++value)
+            count += expected[value];
+        CHECK(histogram[bin] == count);
+    }
+    CHECK_THROWS(image->calculateHistogram(0, 0, 256));
+    CHECK_THROWS(image->calculateHistogram(10, 5, 5));
+}
+
+TEST_CASE("calculatePercentileIntensity matches percentiles of sorted intensities", "[fast][image]") {
+    const unsigned int width = 400;
+    const unsigned int height = 301;
+    const std::vector<float> percentiles = {0.0f, 1.0f, 2.5f, 50.0f, 99.0f, 99.9f, 100.0f};
+    for(DataType type : {TYPE_UINT8, TYPE_INT16, TYPE_FLOAT}) {
+        void* data = allocateRandomData(width*height, type);
+        std::vector<float> sorted(width*height);
+        switch(type) {
+            fastSwitchTypeMacro(
+                for(int i = 0; i < sorted.size(); ++i)
+                    sorted[i] = ((FAST_TYPE*)data)[i];
+            )
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        Image::pointer image = Image::New();
+        image->create(width, height, type, 1, Host::getInstance(), data);
+        const float binWidth = (sorted.back() - sorted.front()) / 4096;
+        for(float percentile : percentiles) {
+            const double position = percentile / 100.0 * (sorted.size() - 1);
+            const int lower = (int)position;
+            const int upper = std::min(lower + 1, (int)sorted.size() - 1);
+            const float expected = sorted[lower] + (float)(position - lower)*(sorted[upper] - sorted[lower]);
+            if(type == TYPE_FLOAT) {
+                CHECK(image->calculatePercentileIntensity(percentile) == Approx(expected).margin(binWidth));
+            } else {
+                CHECK(image->calculatePercentileIntensity(percentile) == Approx(expected));
+            }
+        }
+        CHECK_THROWS(image->calculatePercentileIntensity(101));
+        deleteArray(data, type);
+    }
+}
+
 TEST_CASE("calculateMaximum/MinimumIntensity returns the maximum/minimum intensity of a 2D image stored as OpenCL image" , "[fast][image]") {
     DeviceManager* deviceManager = DeviceManager::getInstance();
     OpenCLDevice::pointer device = deviceManager->getOneOpenCLDevice();
@@ -1483,3 +1589,200 @@ TEST_CASE("createFromImage on 3D image", "[fast][image]") {
 }
 
 
+
+TEST_CASE("Image memory pool reuses host memory of deleted images", "[fast][image][ImageMemoryPool]") {
+    ImageMemoryPool::clear();
+    auto host = Host::getInstance();
+    void* firstData;
+    {
+        auto image = Image::New();
+        image->create(64, 32, TYPE_UINT8, 2);
+        auto access = image->getImageAccess(ACCESS_READ_WRITE);
+        firstData = access->get();
+    }
+    CHECK(ImageMemoryPool::getStatistics(host).misses == 1);
+    CHECK(ImageMemoryPool::getStatistics(host).bytesHeld == 64*32*2);
+
+    // Same size and type is given the memory of the deleted image
+    auto image = Image::New();
+    image->create(32, 64, TYPE_UINT8, 2);
+    CHECK(image->getImageAccess(ACCESS_READ_WRITE)->get() == firstData);
+    CHECK(ImageMemoryPool::getStatistics(host).hits == 1);
+    CHECK(ImageMemoryPool::getStatistics(host).bytesHeld == 0);
+
+    // Different type is not
+    auto image2 = Image::New();
+    image2->create(64, 32, TYPE_INT8, 2);
+    image2->getImageAccess(ACCESS_READ_WRITE);
+    CHECK(ImageMemoryPool::getStatistics(host).hits == 1);
+    CHECK(ImageMemoryPool::getStatistics(host).misses == 2);
+    ImageMemoryPool::clear();
+}
+
+TEST_CASE("Image memory pool frees memory above budget", "[fast][image][ImageMemoryPool]") {
+    ImageMemoryPool::clear();
+    auto host = Host::getInstance();
+    const std::size_t defaultMaxBytes = ImageMemoryPool::getMaxBytes(host);
+    ImageMemoryPool::setMaxBytes(host, 100*100*4*2);
+    {
+        // Three images alive at the same time
+        std::vector<Image::pointer> images;
+        for(int i = 0; i < 3; ++i) {
+            auto image = Image::New();
+            image->create(100, 100, TYPE_FLOAT, 1);
+            image->getImageAccess(ACCESS_READ_WRITE);
+            images.push_back(image);
+        }
+    }
+    CHECK(ImageMemoryPool::getStatistics(host).bytesHeld == 100*100*4*2);
+
+    // Budget of 0 disables the pool
+    ImageMemoryPool::setMaxBytes(host, 0);
+    CHECK(ImageMemoryPool::getStatistics(host).bytesHeld == 0);
+    {
+        auto image = Image::New();
+        image->create(100, 100, TYPE_FLOAT, 1);
+        image->getImageAccess(ACCESS_READ_WRITE);
+    }
+    CHECK(ImageMemoryPool::getStatistics(host).bytesHeld == 0);
+    ImageMemoryPool::setMaxBytes(host, defaultMaxBytes);
+    ImageMemoryPool::clear();
+}
+
+TEST_CASE("Image memory pool reuses OpenCL images and buffers", "[fast][image][ImageMemoryPool]") {
+    ImageMemoryPool::clear();
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    cl::Image* firstImage;
+    cl::Buffer* firstBuffer;
+    {
+        auto image = Image::New();
+        image->create(64, 32, TYPE_FLOAT, 1);
+        firstImage = image->getOpenCLImageAccess(ACCESS_READ_WRITE, device)->get2DImage();
+        firstBuffer = image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device)->get();
+    }
+    CHECK(ImageMemoryPool::getStatistics(device).misses == 2);
+    auto image = Image::New();
+    image->create(64, 32, TYPE_FLOAT, 1);
+    CHECK(image->getOpenCLImageAccess(ACCESS_READ_WRITE, device)->get2DImage() == firstImage);
+    CHECK(image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device)->get() == firstBuffer);
+    CHECK(ImageMemoryPool::getStatistics(device).hits == 2);
+    ImageMemoryPool::clear();
+}
+
+TEST_CASE("Image data is copied between OpenCL images and buffers on the device for all data types", "[fast][image]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    const uint width = 64;
+    const uint height = 32;
+    for(uint depth : {1, 8}) {
+        for(uint nrOfChannels = 1; nrOfChannels <= 4; nrOfChannels++) {
+            for(uint typeNr = 0; typeNr < 7; typeNr++) {
+                const DataType type = (DataType)typeNr;
+                INFO("Depth " << depth);
+                INFO("Channels " << nrOfChannels);
+                INFO("Type " << typeNr);
+                const uint size = width*height*depth*nrOfChannels;
+                void* data = allocateRandomData(size, type);
+                auto image = Image::New();
+                if(depth == 1) {
+                    image->create(width, height, type, nrOfChannels, Host::getInstance(), data);
+                } else {
+                    image->create(width, height, depth, type, nrOfChannels, Host::getInstance(), data);
+                }
+
+                // Each write access makes the accessed data the only up to date data:
+                // host -> buffer -> image -> buffer -> host
+                image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+                image->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
+                image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+                {
+                    auto access = image->getImageAccess(ACCESS_READ);
+                    CHECK(compareDataArrays(data, access->get(), size, type));
+                }
+
+                // host -> image -> host
+                image->getImageAccess(ACCESS_READ_WRITE);
+                image->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
+                {
+                    auto access = image->getImageAccess(ACCESS_READ);
+                    CHECK(compareDataArrays(data, access->get(), size, type));
+                }
+                deleteArray(data, type);
+            }
+        }
+    }
+}
+
+TEST_CASE("Image accesses wait for commands on other command queues in multi queue mode", "[fast][image]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    device->setMultiQueueMode(true);
+    auto queue1 = device->createCommandQueue();
+    auto queue2 = device->createCommandQueue();
+
+    auto image = Image::New();
+    image->create(512, 512, TYPE_FLOAT, 1);
+    auto previousQueue = device->setThreadCommandQueue(queue1);
+    CHECK(device->getCommandQueue()() == queue1());
+    image->getOpenCLImageAccess(ACCESS_READ_WRITE, device); // Place the image on this device
+    image->fill(2);
+
+    // Copying the image to a buffer on another queue must wait for the fill
+    device->setThreadCommandQueue(queue2);
+    CHECK(device->getCommandQueue()() == queue2());
+    image->getOpenCLBufferAccess(ACCESS_READ_WRITE, device);
+
+    // The host must wait for the copy
+    device->setThreadCommandQueue(previousQueue);
+    {
+        auto access = image->getImageAccess(ACCESS_READ);
+        float* data = (float*)access->get();
+        bool allCorrect = true;
+        for(int i = 0; i < 512*512; ++i) {
+            if(data[i] != 2) {
+                allCorrect = false;
+                break;
+            }
+        }
+        CHECK(allCorrect);
+    }
+    device->setMultiQueueMode(false);
+    CHECK(device->getCommandQueue()() == device->getQueue(0)());
+}
+
+TEST_CASE("3 channel images uploaded on different command queues in multi queue mode get their own data", "[fast][image]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    device->setMultiQueueMode(true);
+    std::vector<cl::CommandQueue> queues = {device->createCommandQueue(), device->createCommandQueue()};
+    const int width = 256;
+    const int height = 256;
+    const int size = width*height*3;
+
+    // Images with 3 channels are padded to 4 channels when placed in an OpenCL image. The images are uploaded in
+    // turn on each queue, so that the staging buffers of the memory pool are reused across queues.
+    std::vector<Image::pointer> images;
+    for(int i = 0; i < 8; ++i) {
+        auto data = make_uninitialized_unique<uchar[]>(size);
+        for(int j = 0; j < size; ++j)
+            data[j] = (uchar)(i*10 + j % 3);
+        auto image = Image::New();
+        image->create(width, height, TYPE_UINT8, 3, std::move(data));
+        auto previousQueue = device->setThreadCommandQueue(queues[i % 2]);
+        image->getOpenCLImageAccess(ACCESS_READ_WRITE, device);
+        device->setThreadCommandQueue(previousQueue);
+        images.push_back(image);
+    }
+
+    for(int i = 0; i < images.size(); ++i) {
+        INFO("Image " << i);
+        auto access = images[i]->getImageAccess(ACCESS_READ);
+        auto data = (uchar*)access->get();
+        bool allCorrect = true;
+        for(int j = 0; j < size; ++j) {
+            if(data[j] != (uchar)(i*10 + j % 3)) {
+                allCorrect = false;
+                break;
+            }
+        }
+        CHECK(allCorrect);
+    }
+    device->setMultiQueueMode(false);
+}
@@ -10,6 +10,7 @@ void DataChannel::stop() {
 
 DataChannel::DataChannel() {
     m_stop = false;
+    resetStatistics();
 }
 
 SharedPointer<ProcessObject> DataChannel::getProcessObject() const {
@@ -20,9 +21,63 @@ void DataChannel::setProcessObject(SharedPointer<ProcessObject> po) {
     m_processObject = po;
 }
 
+void DataChannel::setFrameCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_frameCallbackMutex);
+    m_frameCallback = callback;
+}
+
+void DataChannel::frameChanged() {
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_frameCallbackMutex);
+        callback = m_frameCallback;
+    }
+    if(callback)
+        callback();
+}
+
+void DataChannel::recordFrameAdded(int occupancy, std::chrono::steady_clock::duration blocked) {
+    m_framesAdded.fetch_add(1, std::memory_order_relaxed);
+    m_occupancySum.fetch_add(occupancy, std::memory_order_relaxed);
+    // Only the producer updates the max, so a plain load and store is enough
+    if(occupancy > m_maxOccupancy.load(std::memory_order_relaxed))
+        m_maxOccupancy.store(occupancy, std::memory_order_relaxed);
+    if(blocked > std::chrono::steady_clock::duration::zero())
+        m_producerBlockNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(blocked).count(), std::memory_order_relaxed);
+}
+
+void DataChannel::recordFrameRetrieved(std::chrono::steady_clock::duration waited) {
+    m_framesRetrieved.fetch_add(1, std::memory_order_relaxed);
+    if(waited > std::chrono::steady_clock::duration::zero())
+        m_consumerWaitNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(), std::memory_order_relaxed);
+}
+
+DataChannel::Statistics DataChannel::getStatistics() const {
+    Statistics statistics;
+    statistics.framesAdded = m_framesAdded.load(std::memory_order_relaxed);
+    statistics.framesRetrieved = m_framesRetrieved.load(std::memory_order_relaxed);
+    if(statistics.framesAdded > 0)
+        statistics.meanOccupancy = (float)((double)m_occupancySum.load(std::memory_order_relaxed) / statistics.framesAdded);
+    statistics.maxOccupancy = m_maxOccupancy.load(std::memory_order_relaxed);
+    statistics.producerBlockTime = m_producerBlockNanoseconds.load(std::memory_order_relaxed)*1e-6;
+    statistics.consumerWaitTime = m_consumerWaitNanoseconds.load(std::memory_order_relaxed)*1e-6;
+    return statistics;
+}
+
+void DataChannel::resetStatistics() {
+    m_framesAdded = 0;
+    m_occupancySum = 0;
+    m_maxOccupancy = 0;
+    m_producerBlockNanoseconds = 0;
+    m_framesRetrieved = 0;
+    m_consumerWaitNanoseconds = 0;
+}
+
 template <>
 SharedPointer<DataObject> DataChannel::getNextFrame<DataObject>() {
-    return getNextDataFrame();
+    auto data = getNextDataFrame();
+    frameChanged();
+    return data;
 }
 
 }
\ No newline at end of file
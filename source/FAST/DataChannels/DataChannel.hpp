@@ -2,11 +2,26 @@
 
 #include <FAST/Data/DataObject.hpp>
 #include <FAST/Data/DataTypes.hpp>
+#include <functional>
+#include <chrono>
+#include <atomic>
 
 namespace fast {
 
 class ProcessObject;
 
+/**
+ * Type of data channel used for a connection, see ProcessObject::getOutputPort
+ */
+enum class DataChannelType {
+    // StaticDataChannel for process objects, and the channel given by Config::getStreamingMode() for streamers
+    Default,
+    Static,
+    NewestFrame,
+    Queued,
+    RingBuffer
+};
+
 class FAST_EXPORT DataChannel : public Object {
     public:
         typedef SharedPointer<DataChannel> pointer;
@@ -24,6 +39,14 @@ class FAST_EXPORT DataChannel : public Object {
         template <class T = DataObject>
         SharedPointer<T> getNextFrame();
 
+        /**
+         * Get next frame in the data channel, waiting at most the given time for it to become available.
+         * @param timeout
+         * @return the frame, or an empty pointer if no frame became available in time
+         */
+        template <class T = DataObject>
+        SharedPointer<T> getNextFrame(std::chrono::microseconds timeout);
+
         /**
          * @return the number of frames stored in this DataChannel
          */
@@ -34,6 +57,11 @@ class FAST_EXPORT DataChannel : public Object {
          */
         virtual void setMaximumNumberOfFrames(uint frames) = 0;
 
+        /**
+         * @return true if adding a frame now would block, or overwrite a frame which has not been retrieved yet
+         */
+        virtual bool isFull() = 0;
+
         /**
          * This will unblock if this DataChannel is currently blocking. Used to stop a pipeline.
          */
@@ -49,13 +77,93 @@ class FAST_EXPORT DataChannel : public Object {
 
         SharedPointer<ProcessObject> getProcessObject() const;
         void setProcessObject(SharedPointer<ProcessObject> po);
+
+        /**
+         * Set a function which is called every time a frame is added to or retrieved from this channel.
+         * Used by the PipelineExecutor to schedule process objects as data moves through the pipeline.
+         * The callback is called without any locks held.
+         */
+        void setFrameCallback(std::function<void()> callback);
+
+        /**
+         * Telemetry of a data channel, used to find which stage of a pipeline is the bottleneck.
+         * A producer which is often blocked, or a channel which is mostly full, means the consumer is too slow.
+         * A consumer which waits a lot means the producer is too slow.
+         */
+        struct Statistics {
+            /**
+             * Number of frames added to the channel
+             */
+            uint64_t framesAdded = 0;
+            /**
+             * Number of frames retrieved from the channel
+             */
+            uint64_t framesRetrieved = 0;
+            /**
+             * Number of frames in the channel right after a frame was added, averaged over all added frames
+             */
+            float meanOccupancy = 0;
+            /**
+             * Largest number of frames which has been in the channel
+             */
+            int maxOccupancy = 0;
+            /**
+             * Total time in milliseconds addFrame has been blocked because the channel was full
+             */
+            double producerBlockTime = 0;
+            /**
+             * Total time in milliseconds getNextFrame has waited because the channel was empty
+             */
+            double consumerWaitTime = 0;
+        };
+        /**
+         * @return telemetry recorded since the channel was created, or since resetStatistics was called
+         */
+        Statistics getStatistics() const;
+        /**
+         * Reset all telemetry of this channel
+         */
+        void resetStatistics();
     protected:
         bool m_stop;
         std::mutex m_mutex;
         SharedPointer<ProcessObject> m_processObject;
+        std::function<void()> m_frameCallback;
+        std::mutex m_frameCallbackMutex;
+
+        /**
+         * Calls the frame callback if set. Should be called after a frame has been added or retrieved,
+         * and never while m_mutex is locked.
+         */
+        void frameChanged();
+
+        /**
+         * Record that a frame was added. Should only be called by the producer.
+         * @param occupancy number of frames in the channel after the frame was added
+         * @param blocked time addFrame was blocked because the channel was full
+         */
+        void recordFrameAdded(int occupancy, std::chrono::steady_clock::duration blocked = std::chrono::steady_clock::duration::zero());
+        /**
+         * Record that a frame was retrieved. Should only be called by the consumer.
+         * @param waited time getNextFrame waited because the channel was empty
+         */
+        void recordFrameRetrieved(std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero());
 
         virtual DataObject::pointer getNextDataFrame() = 0;
+        /**
+         * @return next frame, or an empty pointer if it didn't become available before the timeout
+         */
+        virtual DataObject::pointer getNextDataFrame(std::chrono::microseconds timeout) = 0;
         DataChannel();
+    private:
+        // Producer and consumer counters are on separate cache lines, so that recording them doesn't make
+        // the producer and consumer threads invalidate each others caches.
+        alignas(64) std::atomic<uint64_t> m_framesAdded;
+        std::atomic<uint64_t> m_occupancySum;
+        std::atomic<int> m_maxOccupancy;
+        std::atomic<int64_t> m_producerBlockNanoseconds;
+        alignas(64) std::atomic<uint64_t> m_framesRetrieved;
+        std::atomic<int64_t> m_consumerWaitNanoseconds;
 };
 
 // Template specialization when T = DataObject
@@ -65,6 +173,20 @@ FAST_EXPORT SharedPointer<DataObject> DataChannel::getNextFrame<DataObject>();
 template <class T>
 SharedPointer<T> DataChannel::getNextFrame() {
     auto data = getNextDataFrame();
+    frameChanged();
+    auto convertedData = std::dynamic_pointer_cast<T>(data);
+    // Check if the conversion went ok
+    if(!convertedData)
+        throw BadCastException(data->getNameOfClass(), T::getStaticNameOfClass());
+    return convertedData;
+}
+
+template <class T>
+SharedPointer<T> DataChannel::getNextFrame(std::chrono::microseconds timeout) {
+    auto data = getNextDataFrame(timeout);
+    if(!data)
+        return nullptr;
+    frameChanged();
     auto convertedData = std::dynamic_pointer_cast<T>(data);
     // Check if the conversion went ok
     if(!convertedData)
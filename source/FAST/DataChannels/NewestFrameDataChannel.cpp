@@ -7,16 +7,24 @@ void NewestFrameDataChannel::addFrame(DataObject::pointer data) {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_frame = data;
+        m_frameConsumed = false;
+        recordFrameAdded(1);
     }
     m_frameConditionVariable.notify_one();
+    frameChanged();
 }
 
 DataObject::pointer NewestFrameDataChannel::getNextDataFrame() {
     std::unique_lock<std::mutex> lock(m_mutex);
 
     // Block until we get any data or a stop signal
-    while(getSize() == 0 && !m_stop) {
-        m_frameConditionVariable.wait(lock);
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(getSize() == 0 && !m_stop) {
+        const auto start = std::chrono::steady_clock::now();
+        while(getSize() == 0 && !m_stop) {
+            m_frameConditionVariable.wait(lock);
+        }
+        waited = std::chrono::steady_clock::now() - start;
     }
 
     // If stop is signaled, throw an exception to stop the entire computation thread
@@ -28,6 +36,35 @@ DataObject::pointer NewestFrameDataChannel::getNextDataFrame() {
     // Remove frame as we don't want to process the same frame again
     m_frame.reset();
 
+    recordFrameRetrieved(waited);
+    return data;
+}
+
+DataObject::pointer NewestFrameDataChannel::getNextDataFrame(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Block until we get any data, a stop signal or the timeout
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(getSize() == 0 && !m_stop) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + timeout;
+        while(getSize() == 0 && !m_stop) {
+            if(m_frameConditionVariable.wait_until(lock, deadline) == std::cv_status::timeout && getSize() == 0 && !m_stop)
+                return nullptr;
+        }
+        waited = std::chrono::steady_clock::now() - start;
+    }
+
+    // If stop is signaled, throw an exception to stop the entire computation thread
+    if(m_stop)
+        throw ThreadStopped();
+
+    DataObject::pointer data = m_frame;
+
+    // Remove frame as we don't want to process the same frame again
+    m_frame.reset();
+
+    recordFrameRetrieved(waited);
     return data;
 }
 
@@ -39,6 +76,11 @@ void NewestFrameDataChannel::setMaximumNumberOfFrames(uint frames) {
 
 }
 
+bool NewestFrameDataChannel::isFull() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frame && !m_frameConsumed;
+}
+
 void NewestFrameDataChannel::stop() {
     DataChannel::stop();
 
@@ -28,6 +28,11 @@ class FAST_EXPORT NewestFrameDataChannel : public DataChannel {
          */
         void setMaximumNumberOfFrames(uint frames) override;
 
+        /**
+         * @return true if the current frame has not been retrieved yet
+         */
+        bool isFull() override;
+
         /**
          * This will unblock if this DataChannel is currently blocking. Used to stop a pipeline.
          */
@@ -43,8 +48,11 @@ class FAST_EXPORT NewestFrameDataChannel : public DataChannel {
     protected:
         std::condition_variable m_frameConditionVariable;
         SharedPointer<DataObject> m_frame;
+        // Whether the current frame has been retrieved with getNextFrame
+        bool m_frameConsumed = false;
 
         DataObject::pointer getNextDataFrame() override;
+        DataObject::pointer getNextDataFrame(std::chrono::microseconds timeout) override;
 
 };
 
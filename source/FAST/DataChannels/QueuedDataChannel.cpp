@@ -8,8 +8,14 @@ void QueuedDataChannel::addFrame(DataObject::pointer data) {
     //    Reporter::error() << "EXECUTION BLOCKED by DataChannel from " << mProcessObject->getNameOfClass() << ". Do you have a DataChannel object that is not used?" << Reporter::end();
 
     // Increment semaphore by one, wait if queue is full
-    m_emptyCount->wait();
+    std::chrono::steady_clock::duration blocked = std::chrono::steady_clock::duration::zero();
+    if(!m_emptyCount->tryWait()) {
+        const auto start = std::chrono::steady_clock::now();
+        m_emptyCount->wait();
+        blocked = std::chrono::steady_clock::now() - start;
+    }
 
+    int occupancy;
     {
         std::unique_lock<std::mutex> lock(m_mutex);
 
@@ -18,16 +24,50 @@ void QueuedDataChannel::addFrame(DataObject::pointer data) {
             throw ThreadStopped();
 
         m_queue.push(data);
+        occupancy = m_queue.size();
     }
+    recordFrameAdded(occupancy, blocked);
 
     // Decrement semaphore by one, signal any waiting due to empty queue
     m_fillCount->signal();
+    frameChanged();
 }
 
 DataObject::pointer QueuedDataChannel::getNextDataFrame() {
     // Decrement semaphore by one, and wait if queue is empty
-    m_fillCount->wait();
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(!m_fillCount->tryWait()) {
+        const auto start = std::chrono::steady_clock::now();
+        m_fillCount->wait();
+        waited = std::chrono::steady_clock::now() - start;
+    }
+
+    auto data = popFrame();
+    recordFrameRetrieved(waited);
+    return data;
+}
+
+DataObject::pointer QueuedDataChannel::getNextDataFrame(std::chrono::microseconds timeout) {
+    // Decrement semaphore by one, and wait at most the timeout if queue is empty
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(!m_fillCount->tryWait()) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool available = m_fillCount->wait(timeout.count());
+        waited = std::chrono::steady_clock::now() - start;
+        if(!available) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_stop)
+                throw ThreadStopped();
+            return nullptr;
+        }
+    }
 
+    auto data = popFrame();
+    recordFrameRetrieved(waited);
+    return data;
+}
+
+DataObject::pointer QueuedDataChannel::popFrame() {
     DataObject::pointer data;
     {
         std::unique_lock<std::mutex> lock(m_mutex);
@@ -48,10 +88,12 @@ DataObject::pointer QueuedDataChannel::getNextDataFrame() {
 }
 
 int QueuedDataChannel::getSize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_queue.size();
 }
 
 void QueuedDataChannel::setMaximumNumberOfFrames(uint frames) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     if(!m_queue.empty())
         throw Exception("Have to call setMaximumNumberOfFrames before executing pipeline");
     mMaximumNumberOfFrames = frames;
@@ -59,6 +101,11 @@ void QueuedDataChannel::setMaximumNumberOfFrames(uint frames) {
     m_emptyCount = std::make_unique<LightweightSemaphore>(mMaximumNumberOfFrames);
 }
 
+bool QueuedDataChannel::isFull() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size() >= mMaximumNumberOfFrames;
+}
+
 void QueuedDataChannel::stop() {
     DataChannel::stop();
     Reporter::info() << "SIGNALING SEMAPHORES in QueuedDataChannel" << Reporter::end();
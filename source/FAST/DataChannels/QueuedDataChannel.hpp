@@ -30,6 +30,11 @@ class FAST_EXPORT QueuedDataChannel : public DataChannel {
          */
         void setMaximumNumberOfFrames(uint frames) override;
 
+        /**
+         * @return true if the queue has reached the maximum number of frames
+         */
+        bool isFull() override;
+
         /**
          * This will unblock if this DataChannel is currently blocking. Used to stop a pipeline.
          */
@@ -49,6 +54,8 @@ class FAST_EXPORT QueuedDataChannel : public DataChannel {
         std::unique_ptr<LightweightSemaphore> m_emptyCount;
 
         DataObject::pointer getNextDataFrame() override;
+        DataObject::pointer getNextDataFrame(std::chrono::microseconds timeout) override;
+        DataObject::pointer popFrame();
         QueuedDataChannel();
 
 };
@@ -0,0 +1,172 @@
+#include "RingBufferDataChannel.hpp"
+#include <thread>
+
+namespace fast {
+
+/**
+ * Wake the other side of the channel if it is blocked. Must be called after the index it waits for is updated.
+ */
+static void wake(std::atomic<bool>& waiting, Semaphore& semaphore) {
+    // Pairs with the fence in waitUntil: either the waiting side sees the new index, or we see its flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Only the side which clears the flag signals, so every wait is signaled at most once
+    if(waiting.load(std::memory_order_relaxed) && waiting.exchange(false, std::memory_order_acq_rel))
+        semaphore.signal();
+}
+
+/**
+ * Wait until ready() returns true. Spins for a while first, since the other side is often only a few microseconds
+ * away, and then blocks on the semaphore until woken by wake().
+ * @param timeoutUsecs negative to wait forever
+ * @return false if timed out
+ */
+template <class Predicate>
+static bool waitUntil(std::atomic<bool>& waiting, Semaphore& semaphore, Predicate ready, std::int64_t timeoutUsecs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUsecs);
+    // Spinning only wastes time if the other side can't run at the same time
+    static const int spinCount = std::thread::hardware_concurrency() > 1 ? 10000 : 0;
+    int spin = spinCount;
+    while(spin--) {
+        if(ready())
+            return true;
+        std::atomic_signal_fence(std::memory_order_acquire); // Prevent the compiler from collapsing the loop.
+    }
+
+    while(true) {
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(ready()) {
+            // If the other side cleared the flag, it has signaled, or is about to, and the signal must be consumed
+            if(!waiting.exchange(false, std::memory_order_acq_rel))
+                semaphore.wait();
+            return true;
+        }
+
+        if(timeoutUsecs < 0) {
+            semaphore.wait();
+        } else {
+            const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if(remaining <= 0 || !semaphore.timedWait((std::uint64_t)remaining)) {
+                if(!waiting.exchange(false, std::memory_order_acq_rel))
+                    semaphore.wait();
+                return ready();
+            }
+        }
+        if(ready())
+            return true;
+    }
+}
+
+void RingBufferDataChannel::addFrame(DataObject::pointer data) {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    std::size_t head = m_head.load(std::memory_order_acquire);
+    std::chrono::steady_clock::duration blocked = std::chrono::steady_clock::duration::zero();
+    if(tail - head >= m_capacity && !m_stopped.load(std::memory_order_acquire)) {
+        // Buffer is full, wait for the consumer
+        const auto start = std::chrono::steady_clock::now();
+        waitUntil(m_producerWaiting, m_producerSemaphore, [this, tail, &head]() {
+            head = m_head.load(std::memory_order_acquire);
+            return tail - head < m_capacity || m_stopped.load(std::memory_order_acquire);
+        }, -1);
+        blocked = std::chrono::steady_clock::now() - start;
+    }
+
+    // If stop is signaled, throw an exception to stop the entire computation thread
+    if(m_stopped.load(std::memory_order_acquire))
+        throw ThreadStopped();
+
+    m_buffer[tail & m_mask] = std::move(data);
+    m_tail.store(tail + 1, std::memory_order_release);
+    wake(m_consumerWaiting, m_consumerSemaphore);
+
+    recordFrameAdded((int)(tail + 1 - head), blocked);
+    frameChanged();
+}
+
+DataObject::pointer RingBufferDataChannel::getNextDataFrame() {
+    return popFrame(-1);
+}
+
+DataObject::pointer RingBufferDataChannel::getNextDataFrame(std::chrono::microseconds timeout) {
+    return popFrame(timeout.count());
+}
+
+DataObject::pointer RingBufferDataChannel::popFrame(std::int64_t timeoutUsecs) {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(head == m_tail.load(std::memory_order_acquire) && !m_stopped.load(std::memory_order_acquire)) {
+        // Buffer is empty, wait for the producer
+        const auto start = std::chrono::steady_clock::now();
+        const bool available = waitUntil(m_consumerWaiting, m_consumerSemaphore, [this, head]() {
+            return head != m_tail.load(std::memory_order_acquire) || m_stopped.load(std::memory_order_acquire);
+        }, timeoutUsecs);
+        waited = std::chrono::steady_clock::now() - start;
+        if(!available)
+            return nullptr;
+    }
+
+    // If stop is signaled, throw an exception to stop the entire computation thread
+    if(m_stopped.load(std::memory_order_acquire))
+        throw ThreadStopped();
+
+    // Move the frame out, so that the channel doesn't keep it alive
+    DataObject::pointer data = std::move(m_buffer[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    wake(m_producerWaiting, m_producerSemaphore);
+
+    recordFrameRetrieved(waited);
+    return data;
+}
+
+int RingBufferDataChannel::getSize() {
+    // Read head first, since tail can only have increased when it is read afterwards
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+    return (int)std::min(tail - head, m_capacity);
+}
+
+void RingBufferDataChannel::setMaximumNumberOfFrames(uint frames) {
+    if(frames == 0)
+        throw Exception("Maximum number of frames of RingBufferDataChannel must be larger than 0");
+    if(getSize() > 0)
+        throw Exception("Have to call setMaximumNumberOfFrames before executing pipeline");
+    std::size_t size = 1;
+    while(size < frames)
+        size *= 2;
+    m_buffer = std::vector<DataObject::pointer>(size);
+    m_mask = size - 1;
+    m_capacity = frames;
+    m_head = 0;
+    m_tail = 0;
+}
+
+bool RingBufferDataChannel::isFull() {
+    return getSize() >= (int)m_capacity;
+}
+
+void RingBufferDataChannel::stop() {
+    DataChannel::stop();
+    m_stopped.store(true, std::memory_order_release);
+
+    // Since getNextFrame or addFrame might be waiting, we need to wake them to stop them blocking
+    wake(m_producerWaiting, m_producerSemaphore);
+    wake(m_consumerWaiting, m_consumerSemaphore);
+}
+
+bool RingBufferDataChannel::hasCurrentData() {
+    return getSize() > 0;
+}
+
+DataObject::pointer RingBufferDataChannel::getFrame() {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if(head == m_tail.load(std::memory_order_acquire))
+        throw Exception("No frames available in getFrame");
+    return m_buffer[head & m_mask];
+}
+
+RingBufferDataChannel::RingBufferDataChannel() : m_mask(0), m_capacity(0), m_tail(0), m_head(0),
+        m_stopped(false), m_producerWaiting(false), m_consumerWaiting(false) {
+    setMaximumNumberOfFrames(50);
+}
+
+}
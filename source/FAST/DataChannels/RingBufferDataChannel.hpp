@@ -0,0 +1,84 @@
+#pragma once
+
+#include <FAST/DataChannels/DataChannel.hpp>
+#include <FAST/Semaphore.hpp>
+#include <vector>
+
+namespace fast {
+
+/**
+ * A bounded data channel for exactly one producer and one consumer, implemented as a lock-free ring buffer.
+ *
+ * Like QueuedDataChannel every frame is delivered, and addFrame blocks when the channel is full. Adding and
+ * retrieving frames only needs atomic loads and stores of the read and write indices, which are kept on
+ * separate cache lines. If a side has to wait, it spins for a short while before blocking on an OS semaphore,
+ * which is futex based on Linux.
+ *
+ * Only one thread may add frames, and only one thread may retrieve frames. This is the case for a connection
+ * between two process objects. Select it with ProcessObject::getOutputPort(portID, DataChannelType::RingBuffer).
+ */
+class FAST_EXPORT RingBufferDataChannel : public DataChannel {
+    FAST_OBJECT(RingBufferDataChannel)
+    public:
+        /**
+         * Add frame to the data channel. This call blocks if the buffer is full.
+         */
+        void addFrame(DataObject::pointer data) override;
+
+        /**
+         * @return the number of frames stored in this DataChannel
+         */
+        int getSize() override;
+
+        /**
+         * Set the maximum nr of frames that can be stored in this data channel. Default is 50.
+         * Must be called before the pipeline is executed.
+         */
+        void setMaximumNumberOfFrames(uint frames) override;
+
+        /**
+         * @return true if the buffer has reached the maximum number of frames
+         */
+        bool isFull() override;
+
+        /**
+         * This will unblock if this DataChannel is currently blocking. Used to stop a pipeline.
+         */
+        void stop() override;
+
+        bool hasCurrentData() override;
+
+        /**
+         * Get next frame in the buffer without removing it, throws if no frame is available.
+         * May only be called by the consumer.
+         */
+        DataObject::pointer getFrame() override;
+    protected:
+        DataObject::pointer getNextDataFrame() override;
+        DataObject::pointer getNextDataFrame(std::chrono::microseconds timeout) override;
+        /**
+         * @param timeoutUsecs negative to wait until a frame is available
+         * @return next frame, or an empty pointer on timeout
+         */
+        DataObject::pointer popFrame(std::int64_t timeoutUsecs);
+        RingBufferDataChannel();
+
+        // Size is a power of two, so that indices can be wrapped with a mask
+        std::vector<DataObject::pointer> m_buffer;
+        std::size_t m_mask;
+        std::size_t m_capacity;
+
+        // The indices only increase, and are wrapped when the buffer is accessed. Tail is only written by the
+        // producer and head only by the consumer, and they are on separate cache lines to avoid false sharing.
+        alignas(64) std::atomic<std::size_t> m_tail;
+        alignas(64) std::atomic<std::size_t> m_head;
+
+        // Blocking fallback, rarely written
+        alignas(64) std::atomic<bool> m_stopped;
+        std::atomic<bool> m_producerWaiting;
+        std::atomic<bool> m_consumerWaiting;
+        Semaphore m_producerSemaphore;
+        Semaphore m_consumerSemaphore;
+};
+
+}
@@ -6,8 +6,13 @@ DataObject::pointer StaticDataChannel::getNextDataFrame() {
     std::unique_lock<std::mutex> lock(m_mutex);
 
     // Block until we get any data or a stop signal
-    while(getSize() == 0 && !m_stop) {
-        m_frameConditionVariable.wait(lock);
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(getSize() == 0 && !m_stop) {
+        const auto start = std::chrono::steady_clock::now();
+        while(getSize() == 0 && !m_stop) {
+            m_frameConditionVariable.wait(lock);
+        }
+        waited = std::chrono::steady_clock::now() - start;
     }
 
     // If stop is signaled, throw an exception to stop the entire computation thread
@@ -17,7 +22,37 @@ DataObject::pointer StaticDataChannel::getNextDataFrame() {
     DataObject::pointer data = m_frame;
 
     // For static channels the data is not removed
+    m_frameConsumed = true;
 
+    recordFrameRetrieved(waited);
+    return data;
+}
+
+DataObject::pointer StaticDataChannel::getNextDataFrame(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Block until we get any data, a stop signal or the timeout
+    std::chrono::steady_clock::duration waited = std::chrono::steady_clock::duration::zero();
+    if(getSize() == 0 && !m_stop) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + timeout;
+        while(getSize() == 0 && !m_stop) {
+            if(m_frameConditionVariable.wait_until(lock, deadline) == std::cv_status::timeout && getSize() == 0 && !m_stop)
+                return nullptr;
+        }
+        waited = std::chrono::steady_clock::now() - start;
+    }
+
+    // If stop is signaled, throw an exception to stop the entire computation thread
+    if(m_stop)
+        throw ThreadStopped();
+
+    DataObject::pointer data = m_frame;
+
+    // For static channels the data is not removed
+    m_frameConsumed = true;
+
+    recordFrameRetrieved(waited);
     return data;
 }
 
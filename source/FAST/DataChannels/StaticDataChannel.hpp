@@ -13,6 +13,7 @@ class FAST_EXPORT StaticDataChannel : public NewestFrameDataChannel {
     public:
     protected:
         DataObject::pointer getNextDataFrame() override;
+        DataObject::pointer getNextDataFrame(std::chrono::microseconds timeout) override;
 
 };
 
@@ -69,10 +69,51 @@ throw Exception("Not able to get sharegroup");
     return cps;
 }
 
+// Queue of each device used by the current thread in multi queue mode
+static std::unordered_map<OpenCLDevice*, cl::CommandQueue>& getThreadCommandQueues() {
+    static thread_local std::unordered_map<OpenCLDevice*, cl::CommandQueue> queues;
+    return queues;
+}
+
 cl::CommandQueue OpenCLDevice::getCommandQueue() {
+    if(m_multiQueueMode) {
+        auto& threadQueues = getThreadCommandQueues();
+        auto it = threadQueues.find(this);
+        if(it != threadQueues.end())
+            return it->second;
+    }
     return getQueue(0);
 }
 
+cl::CommandQueue OpenCLDevice::createCommandQueue() {
+    if(profilingEnabled) {
+        return cl::CommandQueue(context, devices[0], CL_QUEUE_PROFILING_ENABLE);
+    } else {
+        return cl::CommandQueue(context, devices[0]);
+    }
+}
+
+void OpenCLDevice::setMultiQueueMode(bool multiQueue) {
+    m_multiQueueMode = multiQueue;
+}
+
+bool OpenCLDevice::isMultiQueueMode() const {
+    return m_multiQueueMode;
+}
+
+cl::CommandQueue OpenCLDevice::setThreadCommandQueue(cl::CommandQueue queue) {
+    auto& threadQueues = getThreadCommandQueues();
+    cl::CommandQueue previous;
+    if(threadQueues.count(this) > 0)
+        previous = threadQueues[this];
+    if(queue() == nullptr) {
+        threadQueues.erase(this);
+    } else {
+        threadQueues[this] = queue;
+    }
+    return previous;
+}
+
 cl::Device OpenCLDevice::getDevice() {
     return OpenCLDevice::getDevice(0);
 }
@@ -87,7 +128,7 @@ OpenCLDevice::~OpenCLDevice() {
      getQueue(0).finish();
 }
 
-OpenCLDevice::OpenCLDevice() {
+OpenCLDevice::OpenCLDevice() : m_multiQueueMode(false) {
     mIsHost = false;
 }
 
@@ -131,7 +172,7 @@ std::string readFile(std::string filename) {
     return retval;
 }
 
-OpenCLDevice::OpenCLDevice(std::vector<cl::Device> devices, unsigned long* OpenGLContext) {
+OpenCLDevice::OpenCLDevice(std::vector<cl::Device> devices, unsigned long* OpenGLContext) : m_multiQueueMode(false) {
     runtimeManager = RuntimeMeasurementsManager::New();
     mIsHost = false;
     mGLContext = OpenGLContext;
@@ -3,6 +3,7 @@
 
 #include "FAST/Object.hpp"
 #include "RuntimeMeasurementManager.hpp"
+#include <atomic>
 
 namespace fast {
 
@@ -68,8 +69,35 @@ enum DeviceVendor {
 class FAST_EXPORT  OpenCLDevice : public ExecutionDevice {
     FAST_OBJECT(OpenCLDevice)
     public:
+        /**
+         * Get the command queue to enqueue commands on. This is the default queue of the device, unless
+         * multi queue mode is enabled and a queue has been set for the calling thread with setThreadCommandQueue.
+         */
         cl::CommandQueue getCommandQueue();
         cl::Device getDevice();
+        /**
+         * Create a new in-order command queue on this device.
+         * Commands on different queues may execute at the same time.
+         */
+        cl::CommandQueue createCommandQueue();
+        /**
+         * In multi queue mode each process object enqueues its commands on its own command queue, so that independent
+         * branches of a pipeline can execute at the same time on the device. Images and tensors record an event when
+         * an OpenCL access is released, and later accesses from other queues, or the host, wait for these events
+         * instead of the entire device.
+         *
+         * Default is disabled, where all process objects use the same queue, which needs no synchronization.
+         * The mode should only be changed while no pipeline is running on the device.
+         * @param multiQueue
+         */
+        void setMultiQueueMode(bool multiQueue);
+        bool isMultiQueueMode() const;
+        /**
+         * Make getCommandQueue return the given queue in the calling thread when multi queue mode is enabled.
+         * @param queue an empty queue resets the calling thread to the default queue
+         * @return the previous queue of the calling thread, which is empty if it used the default queue
+         */
+        cl::CommandQueue setThreadCommandQueue(cl::CommandQueue queue);
 
         int createProgramFromSource(std::string filename, std::string buildOptions = "", bool caching = true);
         int createProgramFromSource(std::vector<std::string> filenames, std::string buildOptions = "");
@@ -116,6 +144,7 @@ class FAST_EXPORT  OpenCLDevice : public ExecutionDevice {
         cl::Platform platform;
 
         bool profilingEnabled;
+        std::atomic<bool> m_multiQueueMode;
         RuntimeMeasurementsManager::pointer runtimeManager;
 
 };
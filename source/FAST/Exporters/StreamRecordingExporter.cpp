@@ -0,0 +1,68 @@
+#include "StreamRecordingExporter.hpp"
+
+namespace fast {
+
+StreamRecordingExporter::StreamRecordingExporter() {
+    createInputPort<DataObject>(0);
+    createOutputPort<DataObject>(0);
+    createStringAttribute("filename", "Filename", "Stream recording file to create", "");
+    createBooleanAttribute("compression", "Compression", "Compress recording with zlib", true);
+}
+
+void StreamRecordingExporter::loadAttributes() {
+    setFilename(getStringAttribute("filename"));
+    setCompression(getBooleanAttribute("compression") ? StreamRecordingCompression::ZLIB : StreamRecordingCompression::NONE);
+}
+
+void StreamRecordingExporter::setFilename(std::string filename) {
+    m_filename = filename;
+}
+
+void StreamRecordingExporter::setCompression(StreamRecordingCompression compression) {
+    m_compression = compression;
+}
+
+void StreamRecordingExporter::setChunkSize(std::size_t bytes) {
+    if(bytes == 0)
+        throw Exception("Chunk size must be > 0 in StreamRecordingExporter");
+    m_chunkSize = bytes;
+}
+
+void StreamRecordingExporter::setEnabled(bool enabled) {
+    m_enabled = enabled;
+}
+
+void StreamRecordingExporter::close() {
+    if(!m_writer)
+        return;
+    m_writer->close();
+    m_bytesWritten += m_writer->getBytesWritten();
+    m_writer.reset();
+}
+
+uint64_t StreamRecordingExporter::getFrameCounter() const {
+    return m_frameCounter;
+}
+
+uint64_t StreamRecordingExporter::getBytesWritten() const {
+    return m_bytesWritten + (m_writer ? m_writer->getBytesWritten() : 0);
+}
+
+void StreamRecordingExporter::execute() {
+    auto input = getInputData<DataObject>();
+    if(m_filename.empty())
+        throw Exception("You must give a filename to StreamRecordingExporter");
+
+    if(m_enabled) {
+        if(!m_writer)
+            m_writer = std::make_shared<StreamRecordingWriter>(m_filename, m_compression, m_chunkSize);
+        m_writer->addFrame(input);
+        ++m_frameCounter;
+        if(input->isLastFrame())
+            close();
+    }
+
+    addOutputData(0, input);
+}
+
+}
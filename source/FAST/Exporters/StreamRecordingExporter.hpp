@@ -0,0 +1,49 @@
+#pragma once
+
+#include <FAST/ProcessObject.hpp>
+#include <FAST/Streamers/StreamRecording.hpp>
+
+namespace fast {
+
+/**
+ * Records every Image or Mesh frame of a stream to a single stream recording file, and passes the frames on unchanged.
+ *
+ * The recording is closed when the last frame of the stream is received, when close() is called,
+ * or when the exporter is destroyed. Use StreamRecordingStreamer to play back the recording.
+ */
+class FAST_EXPORT StreamRecordingExporter : public ProcessObject {
+    FAST_OBJECT(StreamRecordingExporter)
+    public:
+        void setFilename(std::string filename);
+        /**
+         * Set compression of the recording. Default is ZLIB.
+         * @param compression
+         */
+        void setCompression(StreamRecordingCompression compression);
+        /**
+         * Set minimum size in bytes of each chunk of frames in the recording. Default is 4 MB.
+         * @param bytes
+         */
+        void setChunkSize(std::size_t bytes);
+        void setEnabled(bool enabled);
+        /**
+         * Write the index and close the recording. The next frame starts a new recording.
+         */
+        void close();
+        uint64_t getFrameCounter() const;
+        uint64_t getBytesWritten() const;
+        void loadAttributes() override;
+    private:
+        StreamRecordingExporter();
+        void execute() override;
+
+        std::string m_filename;
+        StreamRecordingCompression m_compression = StreamRecordingCompression::ZLIB;
+        std::size_t m_chunkSize = 4*1024*1024;
+        bool m_enabled = true;
+        StreamRecordingWriter::pointer m_writer;
+        uint64_t m_frameCounter = 0;
+        uint64_t m_bytesWritten = 0;
+};
+
+}
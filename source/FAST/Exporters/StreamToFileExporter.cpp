@@ -5,9 +5,40 @@
 #include "VTKMeshFileExporter.hpp"
 #include "MetaImageExporter.hpp"
 #include <FAST/Utility.hpp>
+#include <fstream>
 
 namespace fast {
 
+static uint64_t getFileSize(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+        return 0;
+    return (uint64_t)file.tellg();
+}
+
+/**
+ * Write an image or mesh to disk, and return the number of bytes written
+ */
+static uint64_t writeFrame(DataObject::pointer data, const std::string& filename, bool compress) {
+    if(auto imageInput = std::dynamic_pointer_cast<Image>(data)) {
+        auto exporter = MetaImageExporter::New();
+        if(compress)
+            exporter->enableCompression();
+        exporter->setFilename(filename + ".mhd");
+        exporter->setInputData(data);
+        exporter->update();
+        return getFileSize(filename + ".mhd") + getFileSize(filename + (compress ? ".zraw" : ".raw"));
+    } else if(auto meshInput = std::dynamic_pointer_cast<Mesh>(data)) {
+        auto exporter = VTKMeshFileExporter::New();
+        exporter->setFilename(filename + ".vtk");
+        exporter->setInputData(data);
+        exporter->update();
+        return getFileSize(filename + ".vtk");
+    } else {
+        throw Exception("StreamToFileExporter can only handle Image and Mesh data objects");
+    }
+}
+
 
 void StreamToFileExporter::setPath(std::string path) {
     m_path = path;
@@ -30,10 +61,113 @@ void StreamToFileExporter::setFrameLimit(uint64_t limit) {
     m_frameLimit = limit;
 }
 
+void StreamToFileExporter::setAsynchronous(bool asynchronous) {
+    if(!asynchronous)
+        flush();
+    m_asynchronous = asynchronous;
+}
+
+void StreamToFileExporter::setWriterThreads(int threads) {
+    if(threads <= 0)
+        throw Exception("Number of writer threads must be > 0 in StreamToFileExporter");
+    if(!m_writerThreads.empty())
+        throw Exception("Number of writer threads must be set before the first frame in StreamToFileExporter");
+    m_nrOfWriterThreads = threads;
+}
+
+void StreamToFileExporter::setMaximumQueueSize(int size) {
+    if(size <= 0)
+        throw Exception("Maximum queue size must be > 0 in StreamToFileExporter");
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_maximumQueueSize = size;
+}
+
+void StreamToFileExporter::setQueueFullPolicy(QueueFullPolicy policy) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_queueFullPolicy = policy;
+}
+
 uint64_t StreamToFileExporter::getFrameCounter() const {
     return m_frameCounter;
 }
 
+int StreamToFileExporter::getQueueDepth() {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_queue.size();
+}
+
+uint64_t StreamToFileExporter::getDroppedFrames() const {
+    return m_droppedFrames;
+}
+
+uint64_t StreamToFileExporter::getBytesWritten() const {
+    return m_bytesWritten;
+}
+
+float StreamToFileExporter::getBytesWrittenPerSecond() const {
+    if(!m_hasStarted)
+        return 0.0f;
+    return m_bytesWritten / std::max(getRecordingDuration(), 1e-6f);
+}
+
+void StreamToFileExporter::writeFrames() {
+    while(true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            // Remaining frames are written before stopping
+            while(m_queue.empty() && !m_stopWriters)
+                m_queueNotEmpty.wait(lock);
+            if(m_queue.empty())
+                break;
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_writing;
+        }
+        // Frames are compressed and written in parallel by the writer threads
+        std::string error;
+        try {
+            m_bytesWritten += writeFrame(frame.data, frame.filename, true);
+        } catch(Exception& e) {
+            error = e.what();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            --m_writing;
+            if(!error.empty() && m_writerError.empty())
+                m_writerError = error;
+        }
+        m_frameWritten.notify_all();
+    }
+}
+
+void StreamToFileExporter::flush() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    while(!m_queue.empty() || m_writing > 0)
+        m_frameWritten.wait(lock);
+    if(!m_writerError.empty()) {
+        std::string error = m_writerError;
+        m_writerError.clear();
+        throw Exception("Error while writing frame in StreamToFileExporter: " + error);
+    }
+}
+
+void StreamToFileExporter::stopWriters() {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopWriters = true;
+    }
+    m_queueNotEmpty.notify_all();
+    for(auto& thread : m_writerThreads)
+        thread.join();
+    m_writerThreads.clear();
+    m_stopWriters = false;
+}
+
+StreamToFileExporter::~StreamToFileExporter() {
+    stopWriters();
+}
+
 void StreamToFileExporter::execute() {
     // Get data object
     auto input = getInputData<DataObject>();
@@ -59,31 +193,65 @@ void StreamToFileExporter::execute() {
         throw Exception("Maximum nr of frames (" + std::to_string(m_frameLimit) + ") reached in StreamToFileExporter");
 
     std::string currentFileName = join(m_path, m_currentFolder, m_filename + "_" + std::to_string(m_frameCounter));
-    if(auto imageInput = std::dynamic_pointer_cast<Image>(input)) {
-        auto exporter = MetaImageExporter::New();
-        exporter->enableCompression();
-        exporter->setFilename(currentFileName + ".mhd");
-        exporter->setInputData(input);
-        exporter->update();
-    } else if(auto meshInput = std::dynamic_pointer_cast<Mesh>(input)) {
-        auto exporter = VTKMeshFileExporter::New();
-        exporter->setFilename(currentFileName + ".vtk");
-        exporter->setInputData(input);
-        exporter->update();
+    if(!m_asynchronous) {
+        m_bytesWritten += writeFrame(input, currentFileName, true);
     } else {
-        throw Exception("StreamToFileExporter can only handle Image and Mesh data objects");
+        if(!std::dynamic_pointer_cast<Image>(input) && !std::dynamic_pointer_cast<Mesh>(input))
+            throw Exception("StreamToFileExporter can only handle Image and Mesh data objects");
+        if(m_writerThreads.empty()) {
+            for(int i = 0; i < m_nrOfWriterThreads; ++i)
+                m_writerThreads.push_back(std::thread(&StreamToFileExporter::writeFrames, this));
+        }
+
+        bool spill = false;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            if(!m_writerError.empty()) {
+                std::string error = m_writerError;
+                m_writerError.clear();
+                throw Exception("Error while writing frame in StreamToFileExporter: " + error);
+            }
+            if(m_queue.size() >= m_maximumQueueSize) {
+                if(m_queueFullPolicy == QueueFullPolicy::BLOCK) {
+                    while(m_queue.size() >= m_maximumQueueSize)
+                        m_frameWritten.wait(lock);
+                } else if(m_queueFullPolicy == QueueFullPolicy::DROP) {
+                    // Frame counter is still increased, so that file numbers match the input frame indices
+                    ++m_droppedFrames;
+                    ++m_frameCounter;
+                    lock.unlock();
+                    addOutputData(0, input);
+                    return;
+                } else {
+                    spill = true;
+                }
+            }
+            if(!spill)
+                m_queue.push_back({input, currentFileName});
+        }
+        if(spill) {
+            // Skip compression, as it is the most time consuming part
+            m_bytesWritten += writeFrame(input, currentFileName, false);
+        } else {
+            m_queueNotEmpty.notify_one();
+        }
+        if(mRuntimeManager->isEnabled())
+            mRuntimeManager->getTiming("queue_depth")->addSample(getQueueDepth());
     }
     m_frameCounter += 1;
     addOutputData(0, input);
 }
 
 void StreamToFileExporter::reset() {
+    flush();
     m_frameCounter = 0;
+    m_droppedFrames = 0;
+    m_bytesWritten = 0;
     m_currentFolder = "";
     m_hasStarted = false;
 }
 
-StreamToFileExporter::StreamToFileExporter() {
+StreamToFileExporter::StreamToFileExporter() : m_bytesWritten(0) {
     createInputPort<DataObject>(0);
     createOutputPort<DataObject>(0);
 }
@@ -2,25 +2,79 @@
 
 #include <FAST/ProcessObject.hpp>
 #include <chrono>
+#include <atomic>
+#include <deque>
+#include <thread>
 
 namespace fast {
 
+/**
+ * Writes every frame of a stream to a folder, as frame_0.mhd, frame_1.mhd etc. for images
+ * and frame_0.vtk etc. for meshes, and passes the frames on unchanged.
+ *
+ * In asynchronous mode, frames are put on a bounded queue and written and compressed by a pool of writer threads,
+ * so that recording doesn't slow down the pipeline.
+ */
 class FAST_EXPORT StreamToFileExporter : public ProcessObject {
     FAST_OBJECT(StreamToFileExporter)
     public:
+        /**
+         * What to do with a new frame in asynchronous mode when the queue is full
+         */
+        enum class QueueFullPolicy {
+            BLOCK = 0, // Wait until there is room in the queue
+            DROP, // Skip the frame. The frame number of a dropped frame is not used by any file.
+            SPILL // Write the frame without compression on the pipeline thread
+        };
         void setPath(std::string path);
         void setRecordingFolderName(std::string folder);
         void setFrameFilename(std::string name);
         void setEnabled(bool enabled);
         void setFrameLimit(uint64_t limit);
+        /**
+         * Write frames in background threads. Default false.
+         * @param asynchronous
+         */
+        void setAsynchronous(bool asynchronous);
+        /**
+         * Set number of threads used to write frames in asynchronous mode. Must be set before the first frame.
+         * Default is 2.
+         * @param threads
+         */
+        void setWriterThreads(int threads);
+        /**
+         * Set maximum number of frames waiting to be written in asynchronous mode. Default is 64.
+         * @param size
+         */
+        void setMaximumQueueSize(int size);
+        void setQueueFullPolicy(QueueFullPolicy policy);
+        /**
+         * Block until all queued frames have been written
+         */
+        void flush();
         uint64_t getFrameCounter() const;
+        /**
+         * @return number of frames waiting to be written
+         */
+        int getQueueDepth();
+        uint64_t getDroppedFrames() const;
+        uint64_t getBytesWritten() const;
+        float getBytesWrittenPerSecond() const;
         std::string getCurrentDestinationFolder() const;
         float getRecordingDuration() const;
         void reset();
         bool isEnabled();
+        ~StreamToFileExporter() override;
     private:
         StreamToFileExporter();
         void execute() override;
+        void writeFrames();
+        void stopWriters();
+
+        struct Frame {
+            DataObject::pointer data;
+            std::string filename;
+        };
 
         std::string m_path = "";
         std::string m_folder;
@@ -31,6 +85,24 @@ class FAST_EXPORT StreamToFileExporter : public ProcessObject {
         std::chrono::high_resolution_clock::time_point m_recordingStartTime;
         bool m_enabled = true;
         bool m_hasStarted = false;
+
+        bool m_asynchronous = false;
+        int m_nrOfWriterThreads = 2;
+        int m_maximumQueueSize = 64;
+        QueueFullPolicy m_queueFullPolicy = QueueFullPolicy::BLOCK;
+        std::deque<Frame> m_queue;
+        std::vector<std::thread> m_writerThreads;
+        std::mutex m_queueMutex;
+        // Signaled when a frame is added to the queue
+        std::condition_variable m_queueNotEmpty;
+        // Signaled when a frame has been written
+        std::condition_variable m_frameWritten;
+        // Frames currently being written
+        int m_writing = 0;
+        bool m_stopWriters = false;
+        std::string m_writerError;
+        std::atomic<uint64_t> m_bytesWritten;
+        uint64_t m_droppedFrames = 0;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,92 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Exporters/StreamToFileExporter.hpp"
+#include "FAST/Importers/MetaImageImporter.hpp"
+#include "FAST/Data/Image.hpp"
+
+using namespace fast;
+
+static Image::pointer createFrame(int frameNr) {
+    auto data = make_uninitialized_unique<uchar[]>(64*32);
+    for(int i = 0; i < 64*32; ++i)
+        data[i] = (uchar)(frameNr + i);
+    auto image = Image::New();
+    image->create(64, 32, TYPE_UINT8, 1, std::move(data));
+    return image;
+}
+
+static void writeFrames(StreamToFileExporter::pointer exporter, int frames) {
+    for(int i = 0; i < frames; ++i) {
+        exporter->setInputData(createFrame(i));
+        exporter->update();
+    }
+    exporter->flush();
+}
+
+TEST_CASE("StreamToFileExporter asynchronous writes all frames in order", "[fast][StreamToFileExporter]") {
+    auto exporter = StreamToFileExporter::New();
+    exporter->setPath(Config::getTestDataPath() + "temp/StreamToFileExporterTest");
+    exporter->setRecordingFolderName("asynchronous");
+    exporter->setAsynchronous(true);
+    exporter->setWriterThreads(3);
+    exporter->setMaximumQueueSize(2);
+    exporter->setQueueFullPolicy(StreamToFileExporter::QueueFullPolicy::BLOCK);
+    writeFrames(exporter, 20);
+
+    CHECK(exporter->getFrameCounter() == 20);
+    CHECK(exporter->getDroppedFrames() == 0);
+    CHECK(exporter->getQueueDepth() == 0);
+    CHECK(exporter->getBytesWritten() > 0);
+    for(int i = 0; i < 20; ++i) {
+        auto importer = MetaImageImporter::New();
+        importer->setFilename(exporter->getCurrentDestinationFolder() + "/frame_" + std::to_string(i) + ".mhd");
+        auto image = importer->updateAndGetOutputData<Image>();
+        auto access = image->getImageAccess(ACCESS_READ);
+        auto data = (uchar*)access->get();
+        CHECK(data[0] == (uchar)i);
+        CHECK(data[100] == (uchar)(i + 100));
+    }
+}
+
+TEST_CASE("StreamToFileExporter dropping frames keeps input frame numbers", "[fast][StreamToFileExporter]") {
+    auto exporter = StreamToFileExporter::New();
+    exporter->setPath(Config::getTestDataPath() + "temp/StreamToFileExporterTest");
+    // No folder name, so that a new timestamped folder is used, without files from earlier runs
+    exporter->setAsynchronous(true);
+    exporter->setWriterThreads(1);
+    exporter->setMaximumQueueSize(1);
+    exporter->setQueueFullPolicy(StreamToFileExporter::QueueFullPolicy::DROP);
+    writeFrames(exporter, 20);
+
+    CHECK(exporter->getFrameCounter() == 20);
+    int framesWritten = 0;
+    for(int i = 0; i < 20; ++i) {
+        const std::string filename = exporter->getCurrentDestinationFolder() + "/frame_" + std::to_string(i) + ".mhd";
+        if(!fileExists(filename))
+            continue;
+        ++framesWritten;
+        // File number must match the index of the input frame
+        auto importer = MetaImageImporter::New();
+        importer->setFilename(filename);
+        auto image = importer->updateAndGetOutputData<Image>();
+        auto access = image->getImageAccess(ACCESS_READ);
+        auto data = (uchar*)access->get();
+        CHECK(data[0] == (uchar)i);
+    }
+    CHECK(framesWritten + exporter->getDroppedFrames() == 20);
+}
+
+TEST_CASE("StreamToFileExporter spilling frames writes all frames", "[fast][StreamToFileExporter]") {
+    auto exporter = StreamToFileExporter::New();
+    exporter->setPath(Config::getTestDataPath() + "temp/StreamToFileExporterTest");
+    exporter->setRecordingFolderName("spill");
+    exporter->setAsynchronous(true);
+    exporter->setWriterThreads(1);
+    exporter->setMaximumQueueSize(1);
+    exporter->setQueueFullPolicy(StreamToFileExporter::QueueFullPolicy::SPILL);
+    writeFrames(exporter, 20);
+
+    CHECK(exporter->getFrameCounter() == 20);
+    CHECK(exporter->getDroppedFrames() == 0);
+    for(int i = 0; i < 20; ++i)
+        CHECK(fileExists(exporter->getCurrentDestinationFolder() + "/frame_" + std::to_string(i) + ".mhd"));
+}
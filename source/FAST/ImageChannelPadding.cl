@@ -0,0 +1,112 @@
+// Copies between buffers with 1-3 channels and images which have been padded to 4 channels (CL_RGBA),
+// because OpenCL has no 3 channel images and not all devices support 1 and 2 channel images.
+#ifdef fast_3d_image_writes
+#pragma OPENCL EXTENSION cl_khr_3d_image_writes : enable
+#endif
+
+__constant sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_FILTER_NEAREST;
+
+#ifdef TYPE_FLOAT
+#define TYPE float4
+#define BUFFER_TYPE float
+#define READ_IMAGE read_imagef
+#define WRITE_IMAGE write_imagef
+#define TO_IMAGE(x) (x)
+#define FROM_IMAGE(x) (x)
+#elif TYPE_UINT8
+#define TYPE uint4
+#define BUFFER_TYPE uchar
+#define READ_IMAGE read_imageui
+#define WRITE_IMAGE write_imageui
+#define TO_IMAGE(x) (uint)(x)
+#define FROM_IMAGE(x) (uchar)(x)
+#elif TYPE_INT8
+#define TYPE int4
+#define BUFFER_TYPE char
+#define READ_IMAGE read_imagei
+#define WRITE_IMAGE write_imagei
+#define TO_IMAGE(x) (int)(x)
+#define FROM_IMAGE(x) (char)(x)
+#elif TYPE_UINT16
+#define TYPE uint4
+#define BUFFER_TYPE ushort
+#define READ_IMAGE read_imageui
+#define WRITE_IMAGE write_imageui
+#define TO_IMAGE(x) (uint)(x)
+#define FROM_IMAGE(x) (ushort)(x)
+#elif TYPE_UNORM_INT16
+// Normalized images can only be accessed as float. This conversion is exact for all 16 bit values.
+#define TYPE float4
+#define BUFFER_TYPE ushort
+#define READ_IMAGE read_imagef
+#define WRITE_IMAGE write_imagef
+#define TO_IMAGE(x) ((float)(x)/65535.0f)
+#define FROM_IMAGE(x) convert_ushort_sat_rte((x)*65535.0f)
+#else
+#define TYPE int4
+#define BUFFER_TYPE short
+#define READ_IMAGE read_imagei
+#define WRITE_IMAGE write_imagei
+#define TO_IMAGE(x) (int)(x)
+#define FROM_IMAGE(x) (short)(x)
+#endif
+
+TYPE padValue(__global const BUFFER_TYPE* buffer, const int position, const int channels) {
+    TYPE value = (TYPE)(0);
+    value.x = TO_IMAGE(buffer[position*channels]);
+    if(channels > 1)
+        value.y = TO_IMAGE(buffer[position*channels + 1]);
+    if(channels > 2)
+        value.z = TO_IMAGE(buffer[position*channels + 2]);
+    return value;
+}
+
+void unpadValue(__global BUFFER_TYPE* buffer, const int position, const int channels, const TYPE value) {
+    buffer[position*channels] = FROM_IMAGE(value.x);
+    if(channels > 1)
+        buffer[position*channels + 1] = FROM_IMAGE(value.y);
+    if(channels > 2)
+        buffer[position*channels + 2] = FROM_IMAGE(value.z);
+}
+
+__kernel void padBufferToImage2D(
+        __global const BUFFER_TYPE* buffer,
+        __write_only image2d_t image,
+        __private int channels
+        ) {
+    const int2 pos = {get_global_id(0), get_global_id(1)};
+    const int position = pos.x + pos.y*get_global_size(0);
+    WRITE_IMAGE(image, pos, padValue(buffer, position, channels));
+}
+
+__kernel void unpadImageToBuffer2D(
+        __read_only image2d_t image,
+        __global BUFFER_TYPE* buffer,
+        __private int channels
+        ) {
+    const int2 pos = {get_global_id(0), get_global_id(1)};
+    const int position = pos.x + pos.y*get_global_size(0);
+    unpadValue(buffer, position, channels, READ_IMAGE(image, sampler, pos));
+}
+
+#ifdef fast_3d_image_writes
+__kernel void padBufferToImage3D(
+        __global const BUFFER_TYPE* buffer,
+        __write_only image3d_t image,
+        __private int channels
+        ) {
+    const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    const int position = pos.x + pos.y*get_global_size(0) + pos.z*get_global_size(0)*get_global_size(1);
+    WRITE_IMAGE(image, pos, padValue(buffer, position, channels));
+}
+#endif
+
+__kernel void unpadImageToBuffer3D(
+        __read_only image3d_t image,
+        __global BUFFER_TYPE* buffer,
+        __private int channels
+        ) {
+    const int4 pos = {get_global_id(0), get_global_id(1), get_global_id(2), 0};
+    const int position = pos.x + pos.y*get_global_size(0) + pos.z*get_global_size(0)*get_global_size(1);
+    unpadValue(buffer, position, channels, READ_IMAGE(image, sampler, pos));
+}
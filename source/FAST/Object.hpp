@@ -12,6 +12,8 @@
 namespace fast {
 
 enum StreamingMode { STREAMING_MODE_NEWEST_FRAME_ONLY, STREAMING_MODE_STORE_ALL_FRAMES, STREAMING_MODE_PROCESS_ALL_FRAMES };
+// Serial: the computation thread updates all POs recursively every tick. Parallel: POs are scheduled on a PipelineExecutor
+enum ExecutionMode { EXECUTION_MODE_SERIAL, EXECUTION_MODE_PARALLEL };
 
 class FAST_EXPORT  Object {
     public:
@@ -0,0 +1,251 @@
+#include "PipelineExecutor.hpp"
+#include "FAST/Streamers/Streamer.hpp"
+
+namespace fast {
+
+PipelineExecutor::PipelineExecutor() {
+}
+
+PipelineExecutor::~PipelineExecutor() {
+    stop();
+}
+
+void PipelineExecutor::addProcessObject(SharedPointer<ProcessObject> po) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_started)
+        throw Exception("Process objects have to be added to the PipelineExecutor before it is started");
+    addNode(po);
+}
+
+SharedPointer<PipelineExecutor::Node> PipelineExecutor::addNode(SharedPointer<ProcessObject> po) {
+    if(m_nodes.count(po.get()) > 0)
+        return m_nodes[po.get()];
+
+    auto node = std::make_shared<Node>();
+    node->processObject = po;
+    m_nodes[po.get()] = node;
+
+    // Add all parents, and register the input channels of this PO as outputs of the parent
+    for(auto&& input : po->mInputConnections) {
+        auto parent = addNode(input.second->getProcessObject());
+        parent->outputChannels.push_back(input.second);
+    }
+
+    return node;
+}
+
+void PipelineExecutor::setNumberOfThreads(int threads) {
+    if(threads < 0)
+        throw Exception("Number of threads in PipelineExecutor must be >= 0");
+    m_numberOfThreads = threads;
+}
+
+void PipelineExecutor::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_started)
+        throw Exception("PipelineExecutor has already been started");
+    m_started = true;
+
+    // Get notified every time data moves through a connection in the pipeline
+    std::weak_ptr<Object> weakThis = mPtr;
+    for(auto&& node : m_nodes) {
+        node.second->processObject->m_executedByPipelineExecutor = true;
+        for(auto&& input : node.second->processObject->mInputConnections) {
+            input.second->setFrameCallback([weakThis]() {
+                auto executor = weakThis.lock();
+                if(executor)
+                    std::static_pointer_cast<PipelineExecutor>(executor)->frameChanged();
+            });
+        }
+    }
+
+    schedule();
+    m_finished = isFinished();
+
+    int threads = m_numberOfThreads > 0 ? m_numberOfThreads : m_nodes.size();
+    reportInfo() << "Starting PipelineExecutor with " << threads << " threads for " << m_nodes.size() << " process objects" << reportEnd();
+    for(int i = 0; i < threads; ++i)
+        m_threads.push_back(std::thread(std::bind(&PipelineExecutor::workerLoop, this)));
+}
+
+void PipelineExecutor::join() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while(m_started && !m_finished && !m_stop)
+            m_condition.wait(lock);
+    }
+    stop();
+    if(m_exception) {
+        auto exception = m_exception;
+        m_exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+void PipelineExecutor::stop() {
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_started || (m_stop && m_threads.empty()))
+            return;
+        m_stop = true;
+        finished = m_finished;
+    }
+    m_condition.notify_all();
+
+    // Unblock any POs waiting for data in their input connections
+    if(!finished)
+        stopPipelines();
+
+    for(auto&& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+
+    for(auto&& node : m_nodes) {
+        node.second->processObject->m_executedByPipelineExecutor = false;
+        node.second->processObject->m_unfinishedOutputData.clear();
+        for(auto&& input : node.second->processObject->mInputConnections)
+            input.second->setFrameCallback(nullptr);
+    }
+}
+
+bool PipelineExecutor::isRunning() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_started && !m_finished && !m_stop;
+}
+
+void PipelineExecutor::workerLoop() {
+    while(true) {
+        SharedPointer<Node> node;
+        int executeToken;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_stop && m_readyQueue.empty())
+                m_condition.wait(lock);
+            if(m_stop)
+                break;
+            node = m_readyQueue.front();
+            m_readyQueue.pop_front();
+            executeToken = m_executeToken++;
+            ++m_runningNodes;
+        }
+
+        bool stopped = false;
+        try {
+            node->processObject->executeIfNeeded(node->newInputData, executeToken);
+        } catch(ThreadStopped &e) {
+            reportInfo() << "Thread stopped exception occured in PipelineExecutor, exiting.." << reportEnd();
+            stopped = true;
+        } catch(...) {
+            reportError() << "Exception occured in " << node->processObject->getNameOfClass() << " in PipelineExecutor, stopping.." << reportEnd();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_exception)
+                m_exception = std::current_exception();
+            stopped = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(node->processObject->m_unfinishedOutputMutex);
+            node->processObject->m_unfinishedOutputData.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            node->scheduled = false;
+            --m_runningNodes;
+            if(stopped) {
+                m_stop = true;
+            } else if(!m_stop) {
+                schedule();
+                m_finished = isFinished();
+            }
+        }
+        m_condition.notify_all();
+        if(stopped) {
+            stopPipelines();
+            break;
+        }
+    }
+}
+
+void PipelineExecutor::frameChanged() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_started || m_stop)
+            return;
+        schedule();
+        m_finished = isFinished();
+    }
+    m_condition.notify_all();
+}
+
+void PipelineExecutor::schedule() {
+    for(auto&& item : m_nodes) {
+        auto node = item.second;
+        if(node->scheduled)
+            continue;
+        bool newInputData = node->processObject->hasUnprocessedInputData(true);
+        if(!isReady(node, newInputData))
+            continue;
+        node->scheduled = true;
+        node->newInputData = newInputData;
+        m_readyQueue.push_back(node);
+    }
+}
+
+bool PipelineExecutor::isReady(SharedPointer<Node> node, bool newInputData) {
+    auto po = node->processObject;
+    if(!po->mIsModified && !newInputData)
+        return false;
+
+    for(auto&& input : po->mInputConnections) {
+        // All input connections must have data, so that the PO doesn't block a worker while waiting
+        if(!input.second->hasCurrentData())
+            return false;
+        // Output data is added to the channel before it is filled in execute, thus wait until the execute of the
+        // parent which added it has finished. The parent may meanwhile execute again on its next input.
+        auto parent = input.second->getProcessObject();
+        std::lock_guard<std::mutex> lock(parent->m_unfinishedOutputMutex);
+        if(parent->m_unfinishedOutputData.count(input.second->getFrame()) > 0)
+            return false;
+    }
+
+    // Don't produce new output before all consumers have retrieved the previous output
+    for(auto&& channel : node->outputChannels) {
+        if(channel->isFull())
+            return false;
+    }
+
+    return true;
+}
+
+bool PipelineExecutor::isFinished() {
+    if(m_runningNodes > 0 || !m_readyQueue.empty())
+        return false;
+
+    // Streamers which have not sent their last frame may still produce data
+    for(auto&& node : m_nodes) {
+        auto po = node.second->processObject;
+        for(auto&& input : po->mInputConnections) {
+            auto parent = input.second->getProcessObject();
+            if(dynamic_cast<Streamer*>(parent.get()) != nullptr && po->m_lastFrame.count(parent->getNameOfClass()) == 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void PipelineExecutor::stopPipelines() {
+    // Stop the pipeline from every PO which is not consumed by any other PO in the executor
+    std::unordered_set<ProcessObject*> parents;
+    for(auto&& node : m_nodes) {
+        for(auto&& input : node.second->processObject->mInputConnections)
+            parents.insert(input.second->getProcessObject().get());
+    }
+    for(auto&& node : m_nodes) {
+        if(parents.count(node.first) == 0)
+            node.second->processObject->stopPipeline();
+    }
+}
+
+}
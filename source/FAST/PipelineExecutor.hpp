@@ -0,0 +1,90 @@
+#pragma once
+
+#include <FAST/ProcessObject.hpp>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+
+namespace fast {
+
+/**
+ * Executes a pipeline by scheduling its process objects (POs) on a pool of worker threads.
+ *
+ * Instead of recursively pulling data through ProcessObject::update on a single thread,
+ * a PO is executed as soon as its input connections have data it has not processed yet,
+ * and all consumers of its previous output have retrieved it.
+ * Thus the stages of a streaming pipeline overlap: stage N can process frame k+1 while stage N+1 processes frame k.
+ *
+ * A PO is never executed by more than one thread at a time, and the execute token and last processed data
+ * of each PO are handled the same way as in ProcessObject::update.
+ */
+class FAST_EXPORT PipelineExecutor : public Object {
+    FAST_OBJECT(PipelineExecutor)
+    public:
+        /**
+         * Add a process object, and all process objects upstream of it, to the executor.
+         * Has to be called before start.
+         * @param po
+         */
+        void addProcessObject(SharedPointer<ProcessObject> po);
+        /**
+         * Set the number of worker threads. The default (0) is one thread per process object,
+         * which ensures that POs blocking on their input can't starve the others.
+         * @param threads
+         */
+        void setNumberOfThreads(int threads);
+        /**
+         * Start the worker threads and execute the pipeline. This call does not block.
+         */
+        void start();
+        /**
+         * Block until the pipeline has finished, i.e. all streamers have sent their last frame and
+         * no PO has any data left to process, or until the executor is stopped.
+         * Any exception thrown by a PO, except ThreadStopped, is rethrown here.
+         */
+        void join();
+        /**
+         * Stop the pipeline, unblock any POs waiting for data and join all worker threads.
+         */
+        void stop();
+        /**
+         * @return true if the executor has been started and has not finished or been stopped yet
+         */
+        bool isRunning();
+        ~PipelineExecutor();
+    private:
+        struct Node {
+            SharedPointer<ProcessObject> processObject;
+            // Input channels of other POs in this executor which are connected to this PO
+            std::vector<DataChannel::pointer> outputChannels;
+            // Whether this node is queued or being executed
+            bool scheduled = false;
+            bool newInputData = false;
+        };
+
+        PipelineExecutor();
+        SharedPointer<Node> addNode(SharedPointer<ProcessObject> po);
+        void workerLoop();
+        void frameChanged();
+        // These must be called while m_mutex is locked
+        void schedule();
+        bool isReady(SharedPointer<Node> node, bool newInputData);
+        bool isFinished();
+        void stopPipelines();
+
+        std::unordered_map<ProcessObject*, SharedPointer<Node>> m_nodes;
+        std::deque<SharedPointer<Node>> m_readyQueue;
+        std::vector<std::thread> m_threads;
+        int m_numberOfThreads = 0;
+        int m_runningNodes = 0;
+        int m_executeToken = 0;
+        bool m_started = false;
+        bool m_finished = false;
+        bool m_stop = false;
+        std::exception_ptr m_exception;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+};
+
+}
@@ -2,10 +2,12 @@
 #include "FAST/Exception.hpp"
 #include "FAST/OpenCLProgram.hpp"
 #include "FAST/Streamers/Streamer.hpp"
+#include "FAST/RuntimeTracer.hpp"
 #include <unordered_set>
 #include <FAST/DataChannels/QueuedDataChannel.hpp>
 #include <FAST/DataChannels/NewestFrameDataChannel.hpp>
 #include <FAST/DataChannels/StaticDataChannel.hpp>
+#include <FAST/DataChannels/RingBufferDataChannel.hpp>
 
 
 namespace fast {
@@ -26,11 +28,18 @@ static bool isStreamer(ProcessObject* po) {
 
 void ProcessObject::update(int executeToken) {
     // Call update on all parents
-    bool newInputData = false;
     for(auto parent : mInputConnections) {
         auto port = parent.second;
         port->getProcessObject()->update(executeToken);
+    }
+
+    executeIfNeeded(hasUnprocessedInputData(false), executeToken);
+}
 
+bool ProcessObject::hasUnprocessedInputData(bool requireStreamedData) {
+    bool newInputData = false;
+    for(auto parent : mInputConnections) {
+        auto port = parent.second;
         if(mLastProcessed.count(parent.first) > 0) {
             //std::cout << "" << getNameOfClass() << " has last processed data.. " << std::endl;
             // Compare the last processed data with the new data for this data port
@@ -58,12 +67,13 @@ void ProcessObject::update(int executeToken) {
                     // Check if last data element was last frame or not
                     // If it is last frame, don't update
                     if(m_lastFrame.count(port->getProcessObject()->getNameOfClass()) == 0) {
-                        newInputData = true;
+                        if(!requireStreamedData)
+                            newInputData = true;
                         //reportInfo() << "Parent is streamer, execute.." << reportEnd();
                     } else {
                         //reportInfo() << "Parent is streamer but last frame has been sent: don't execute" << reportEnd();
                     }
-                } else {
+                } else if(!requireStreamedData) {
                     // TODO should not be possible?
                     reportError() << "Impossible event in ProcessObject::update of " << getNameOfClass() << reportEnd();
                 }
@@ -71,10 +81,87 @@ void ProcessObject::update(int executeToken) {
         } else {
             //std::cout << "" << getNameOfClass() << " first time execute.. " << std::endl;
             // First time executing, always execute in this case
-            newInputData = true;
+            // When data is required, the parent has to have produced something first
+            if(!requireStreamedData || port->hasCurrentData())
+                newInputData = true;
         }
     }
 
+    return newInputData;
+}
+
+namespace {
+/**
+ * Makes the commands of a process object go to its own command queue while it executes,
+ * if the main device is in multi queue mode.
+ */
+class CommandQueueScope {
+    public:
+        CommandQueueScope(ExecutionDevice::pointer device, std::unordered_map<OpenCLDevice::pointer, cl::CommandQueue>& queues) {
+            m_device = std::dynamic_pointer_cast<OpenCLDevice>(device);
+            if(!m_device || !m_device->isMultiQueueMode()) {
+                m_device.reset();
+                return;
+            }
+            if(queues.count(m_device) == 0)
+                queues[m_device] = m_device->createCommandQueue();
+            m_previousQueue = m_device->setThreadCommandQueue(queues[m_device]);
+        }
+        ~CommandQueueScope() {
+            if(m_device)
+                m_device->setThreadCommandQueue(m_previousQueue);
+        }
+    private:
+        OpenCLDevice::pointer m_device;
+        cl::CommandQueue m_previousQueue;
+};
+
+/**
+ * Measures the runtime of an execute of a process object if runtime measurements are enabled, and records it as a
+ * trace span if tracing is enabled. Spans recorded by the thread during the execute are attributed to the process object.
+ */
+class ExecuteMeasurementScope {
+    public:
+        ExecuteMeasurementScope(ProcessObject* po, RuntimeMeasurementsManager::pointer manager) : m_manager(manager) {
+            m_measure = manager->isEnabled();
+            m_trace = RuntimeTracer::isEnabled();
+            if(m_trace) {
+                m_name = po->getNameOfClass();
+                m_previousProcessObject = RuntimeTracer::setThreadProcessObject(m_name);
+            }
+            if(m_measure || m_trace)
+                m_begin = std::chrono::steady_clock::now();
+        }
+        bool isTracing() const {
+            return m_trace;
+        }
+        /**
+         * Record the runtime, should be called when execute has finished
+         * @param frameTimestamp creation timestamp of the input data
+         */
+        void stop(uint64_t frameTimestamp) {
+            if(!m_measure && !m_trace)
+                return;
+            const auto end = std::chrono::steady_clock::now();
+            if(m_measure)
+                m_manager->getTiming("execute")->addSample(std::chrono::duration<double, std::milli>(end - m_begin).count());
+            RuntimeTracer::addSpan(m_name, "execute", m_begin, end, frameTimestamp);
+        }
+        ~ExecuteMeasurementScope() {
+            if(m_trace)
+                RuntimeTracer::setThreadProcessObject(m_previousProcessObject);
+        }
+    private:
+        RuntimeMeasurementsManager::pointer m_manager;
+        bool m_measure;
+        bool m_trace;
+        std::string m_name;
+        std::string m_previousProcessObject;
+        std::chrono::steady_clock::time_point m_begin;
+};
+}
+
+void ProcessObject::executeIfNeeded(bool newInputData, int executeToken) {
     // Set streaming mode for output connections
     // Also remove dead output ports if any
     for(auto&& outputPorts : mOutputConnections) {
@@ -96,7 +183,7 @@ void ProcessObject::update(int executeToken) {
         return;
     // If this object is modified, or any parents has new data for this PO: Call execute
     if(mIsModified || newInputData) {
-        this->mRuntimeManager->startRegularTimer("execute");
+        ExecuteMeasurementScope measurementScope(this, mRuntimeManager);
         // set isModified to false before executing to avoid recursive update calls
         if(mIsModified) {
             reportInfo() << "EXECUTING " << getNameOfClass() << " because PO is modified." << reportEnd();
@@ -104,13 +191,25 @@ void ProcessObject::update(int executeToken) {
             reportInfo() << "EXECUTING " << getNameOfClass() << " because PO has new input data." << reportEnd();
         }
         mIsModified = false;
-        preExecute();
-        execute();
-        postExecute();
-        m_lastExecuteToken = executeToken;
-        if(this->mRuntimeManager->isEnabled())
-            this->waitToFinish();
-        this->mRuntimeManager->stopRegularTimer("execute");
+        {
+            CommandQueueScope queueScope(getMainDevice(), m_commandQueues);
+            preExecute();
+            execute();
+            postExecute();
+            m_lastExecuteToken = executeToken;
+            if(this->mRuntimeManager->isEnabled())
+                this->waitToFinish();
+        }
+        uint64_t frameTimestamp = 0;
+        if(measurementScope.isTracing()) {
+            for(auto&& lastProcessed : mLastProcessed) {
+                if(lastProcessed.second.first && lastProcessed.second.first->getCreationTimestamp() > 0) {
+                    frameTimestamp = lastProcessed.second.first->getCreationTimestamp();
+                    break;
+                }
+            }
+        }
+        measurementScope.stop(frameTimestamp);
     }
     // TODO need to clear m_frameData m_lastFrame
     //m_frameData.clear();
@@ -118,20 +217,39 @@ void ProcessObject::update(int executeToken) {
 }
 
 DataChannel::pointer ProcessObject::getOutputPort(uint portID) {
+    return getOutputPort(portID, DataChannelType::Default);
+}
+
+DataChannel::pointer ProcessObject::getOutputPort(uint portID, DataChannelType type) {
     validateOutputPortExists(portID);
+    if(type == DataChannelType::Default) {
+        if(isStreamer(this)) {
+            auto streamingMode = Config::getStreamingMode();
+            if(streamingMode == STREAMING_MODE_PROCESS_ALL_FRAMES) {
+                type = DataChannelType::Queued;
+            } else if(streamingMode == STREAMING_MODE_NEWEST_FRAME_ONLY) {
+                type = DataChannelType::NewestFrame;
+            } else {
+                throw Exception("Unsupported streaming mode");
+            }
+        } else {
+            type = DataChannelType::Static;
+        }
+    }
     // Create DataChannel, and it to list and return it
     DataChannel::pointer dataChannel;
-    if(isStreamer(this)) {
-        auto streamingMode = Config::getStreamingMode();
-        if(streamingMode == STREAMING_MODE_PROCESS_ALL_FRAMES) {
+    switch(type) {
+        case DataChannelType::Queued:
             dataChannel = QueuedDataChannel::New();
-        } else if(streamingMode == STREAMING_MODE_NEWEST_FRAME_ONLY) {
+            break;
+        case DataChannelType::NewestFrame:
             dataChannel = NewestFrameDataChannel::New();
-        } else {
-            throw Exception("Unsupported streaming mode");
-        }
-    } else {
-        dataChannel = StaticDataChannel::New();
+            break;
+        case DataChannelType::RingBuffer:
+            dataChannel = RingBufferDataChannel::New();
+            break;
+        default:
+            dataChannel = StaticDataChannel::New();
     }
     dataChannel->setProcessObject(std::static_pointer_cast<ProcessObject>(mPtr.lock()));
 
@@ -168,6 +286,12 @@ void ProcessObject::addOutputData(uint portID, DataObject::pointer data) {
     for(auto&& frameData : m_frameData)
         data->setFrameData(frameData.first, frameData.second);
 
+    // Data is added before it is filled in execute, thus mark it as unfinished before consumers can see it
+    if(m_executedByPipelineExecutor) {
+        std::lock_guard<std::mutex> lock(m_unfinishedOutputMutex);
+        m_unfinishedOutputData.insert(data);
+    }
+
     // Add it to all output connections, if any connections exist
     if(mOutputConnections.count(portID) > 0) {
         for(auto output : mOutputConnections.at(portID)) {
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <mutex>
 #include "FAST/Object.hpp"
 #include "FAST/Data/DataObject.hpp"
 #include "RuntimeMeasurement.hpp"
@@ -18,6 +19,7 @@ namespace fast {
 
 class OpenCLProgram;
 class ProcessObject;
+class PipelineExecutor;
 
 class FAST_EXPORT  ProcessObject : public Object {
     public:
@@ -48,7 +50,22 @@ class FAST_EXPORT  ProcessObject : public Object {
         void setDeviceCriteria(uint deviceNumber, const DeviceCriteria& criteria);
         ExecutionDevice::pointer getDevice(uint deviceNumber) const;
 
-        virtual DataChannel::pointer getOutputPort(uint portID = 0);
+        /**
+         * Create a connection to an output port, using the default type of data channel.
+         * Same as getOutputPort(portID, DataChannelType::Default).
+         * @param portID
+         */
+        DataChannel::pointer getOutputPort(uint portID = 0);
+        /**
+         * Create a connection to an output port, using the given type of data channel instead of the default.
+         * The default is StaticDataChannel for process objects, and the channel given by Config::getStreamingMode()
+         * for streamers. Use DataChannelType::RingBuffer for a lock-free channel which delivers every frame,
+         * when there is only one consumer on the connection.
+         * Subclasses which map output ports override this, so that the mapping applies to both forms.
+         * @param portID
+         * @param type
+         */
+        virtual DataChannel::pointer getOutputPort(uint portID, DataChannelType type);
         virtual DataChannel::pointer getInputPort(uint portID = 0);
         virtual void setInputConnection(DataChannel::pointer port);
         virtual void setInputConnection(uint portID, DataChannel::pointer port);
@@ -84,6 +101,12 @@ class FAST_EXPORT  ProcessObject : public Object {
 
         // An integer id which act as a token of when this PO last executed
         int m_lastExecuteToken = -1;
+        // Whether this PO is executed by a PipelineExecutor, which executes its parents on other threads
+        bool m_executedByPipelineExecutor = false;
+        // Output data added by the running execute, when executed by a PipelineExecutor.
+        // The executor doesn't execute consumers on this data until the execute has finished filling it.
+        std::unordered_set<DataObject::pointer> m_unfinishedOutputData;
+        std::mutex m_unfinishedOutputMutex;
 
         // Pure virtual method for executing the pipeline object
         virtual void execute()=0;
@@ -103,6 +126,21 @@ class FAST_EXPORT  ProcessObject : public Object {
 
         bool hasNewInputData(uint portID);
 
+        /**
+         * Check whether any of the input connections has data which this PO has not processed yet.
+         *
+         * @param requireStreamedData If false, a connection to a streamer which has not sent its last frame
+         *      always counts as new data, since execute will block until the next frame arrives.
+         *      If true, the data has to be available in the connection already.
+         */
+        bool hasUnprocessedInputData(bool requireStreamedData);
+
+        /**
+         * Execute this PO, without updating its parents, if it is modified or has new input data.
+         * The execute token is handled the same way as in update.
+         */
+        void executeIfNeeded(bool newInputData, int executeToken);
+
         virtual void waitToFinish() {};
 
 
@@ -134,6 +172,8 @@ class FAST_EXPORT  ProcessObject : public Object {
         std::unordered_map<uint, std::vector<uint> > mInputDevices;
         std::unordered_map<uint, ExecutionDevice::pointer> mDevices;
         std::unordered_map<uint, DeviceCriteria> mDeviceCriteria;
+        // Command queue of this process object on each device, used in multi queue mode
+        std::unordered_map<OpenCLDevice::pointer, cl::CommandQueue> m_commandQueues;
 
         // New pipeline
         std::unordered_map<uint, DataChannel::pointer> mInputConnections;
@@ -158,6 +198,7 @@ class FAST_EXPORT  ProcessObject : public Object {
         // Indicates whether this data object is the last frame in a stream, and if so, the name of the stream
         std::unordered_set<std::string> m_lastFrame;
 
+        friend class PipelineExecutor;
 
 };
 
@@ -1,5 +1,6 @@
 #include "RuntimeMeasurementManager.hpp"
 #include "Exception.hpp"
+#include "RuntimeTracer.hpp"
 
 namespace fast {
 
@@ -11,14 +12,24 @@ void RuntimeMeasurementsManager::disable() {
 	enabled = false;
 }
 
+static bool isProfilingEnabled(cl::CommandQueue queue) {
+	return (queue.getInfo<CL_QUEUE_PROPERTIES>() & CL_QUEUE_PROFILING_ENABLE) != 0;
+}
+
 void RuntimeMeasurementsManager::startCLTimer(std::string name, cl::CommandQueue queue) {
-	if (!enabled)
+	if (!enabled && !RuntimeTracer::isEnabled())
 		return;
 
-	if (queue.getInfo<CL_QUEUE_PROPERTIES>() != CL_QUEUE_PROFILING_ENABLE) {
-		throw Exception(
-				"Failed to get profiling info. Make sure that RuntimeMeasurementManager::enable() is called before the OpenCL context is created.",
-				__LINE__, __FILE__);
+	if (!isProfilingEnabled(queue)) {
+		if (enabled) {
+			throw Exception(
+					"Failed to get profiling info. Make sure that RuntimeMeasurementManager::enable() is called before the OpenCL context is created.",
+					__LINE__, __FILE__);
+		}
+		// Only tracing, which is often enabled after the context was created. Time the span on the host instead.
+		queue.finish();
+		startTimesCL[name] = std::chrono::steady_clock::now();
+		return;
 	}
 	cl::Event startEvent;
 #if !defined(CL_VERSION_1_2) || defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
@@ -28,14 +39,24 @@ void RuntimeMeasurementsManager::startCLTimer(std::string name, cl::CommandQueue
 	queue.enqueueMarkerWithWaitList(NULL, &startEvent);
 #endif
 	queue.finish();
-	startEvents.insert(std::make_pair(name, startEvent));
+	startEvents[name] = startEvent;
 }
 
 void RuntimeMeasurementsManager::stopCLTimer(std::string name, cl::CommandQueue queue) {
-	if (!enabled)
+	if (!enabled && !RuntimeTracer::isEnabled())
 		return;
 
-	if (queue.getInfo<CL_QUEUE_PROPERTIES>() != CL_QUEUE_PROFILING_ENABLE) {
+	auto startTime = startTimesCL.find(name);
+	if (startTime != startTimesCL.end()) {
+		queue.finish();
+		RuntimeTracer::addSpan(name, "OpenCL", startTime->second, std::chrono::steady_clock::now(), 0, true);
+		startTimesCL.erase(startTime);
+		return;
+	}
+	if (!isProfilingEnabled(queue)) {
+		// Tracing may have been enabled after the timer was started
+		if (!enabled)
+			return;
 		throw Exception(
 				"Failed to get profiling info. Make sure that RuntimeMeasurementManager::enable() is called before the OpenCL context is created.",
 				__LINE__, __FILE__);
@@ -43,6 +64,9 @@ void RuntimeMeasurementsManager::stopCLTimer(std::string name, cl::CommandQueue
 
 	// check that the startEvent actually exist
 	if (startEvents.count(name) == 0) {
+		// Tracing may have been enabled after the timer was started
+		if (!enabled)
+			return;
 		throw Exception("Unknown CL timer");
 	}
 	cl_ulong start, end;
@@ -54,48 +78,58 @@ void RuntimeMeasurementsManager::stopCLTimer(std::string name, cl::CommandQueue
 	queue.enqueueMarkerWithWaitList(NULL, &endEvent);
 #endif
 	queue.finish();
+	const auto hostEnd = std::chrono::steady_clock::now();
 	cl::Event startEvent = startEvents[name];
 	startEvent.getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START, &start);
 	endEvent.getProfilingInfo<cl_ulong>(CL_PROFILING_COMMAND_START, &end);
-	if (timings.count(name) == 0) {
-		// No timings with this name exists, create a new one
-		RuntimeMeasurement::pointer runtime(new RuntimeMeasurement(name));
-		runtime->addSample((end - start) * 1.0e-6);
-		timings[name] =  runtime;
-	} else {
-		timings[name]->addSample((end - start) * 1.0e-6);
+	if (enabled) {
+		if (timings.count(name) == 0) {
+			// No timings with this name exists, create a new one
+			RuntimeMeasurement::pointer runtime(new RuntimeMeasurement(name));
+			runtime->addSample((end - start) * 1.0e-6);
+			timings[name] =  runtime;
+		} else {
+			timings[name]->addSample((end - start) * 1.0e-6);
+		}
 	}
+	// The device clock is not related to the host clock, so the span is placed to end when the queue finished
+	RuntimeTracer::addSpan(name, "OpenCL", hostEnd - std::chrono::nanoseconds(end - start), hostEnd, 0, true);
 
 	// Remove the start event
 	startEvents.erase(name);
 }
 
 void RuntimeMeasurementsManager::startRegularTimer(std::string name) {
-	if (!enabled)
+	if (!enabled && !RuntimeTracer::isEnabled())
 		return;
 
-	startTimes[name] = std::chrono::system_clock::now();
+	startTimes[name] = std::chrono::steady_clock::now();
 }
 
 void RuntimeMeasurementsManager::stopRegularTimer(std::string name) {
-	if (!enabled)
+	if (!enabled && !RuntimeTracer::isEnabled())
 		return;
 
-	if(startTimes.count(name) == 0)
+	auto startTime = startTimes.find(name);
+	if(startTime == startTimes.end())
 	    return;
 
-	std::chrono::duration<double, std::milli> time = std::chrono::system_clock::now() - startTimes[name];
-    if (timings.count(name) == 0) {
-		// No timings with this name exists, create a new one
-		RuntimeMeasurement::pointer runtime(new RuntimeMeasurement(name));
-
-		runtime->addSample(time.count());
-		timings[name] =  runtime;
-	} else {
-		timings[name]->addSample(time.count());
+	const auto end = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::milli> time = end - startTime->second;
+	if (enabled) {
+		if (timings.count(name) == 0) {
+			// No timings with this name exists, create a new one
+			RuntimeMeasurement::pointer runtime(new RuntimeMeasurement(name));
+
+			runtime->addSample(time.count());
+			timings[name] =  runtime;
+		} else {
+			timings[name]->addSample(time.count());
+		}
 	}
+	RuntimeTracer::addSpan(name, "timer", startTime->second, end);
 
-    startTimes.erase(name);
+    startTimes.erase(startTime);
 }
 
 void RuntimeMeasurementsManager::startNumberedCLTimer(std::string name, cl::CommandQueue queue) {
@@ -41,7 +41,9 @@ private:
 	std::map<std::string, RuntimeMeasurement::pointer> timings;
 	std::map<std::string, unsigned int> numberings;
 	std::map<std::string, cl::Event> startEvents;
-	std::map<std::string, std::chrono::system_clock::time_point> startTimes;
+	std::map<std::string, std::chrono::steady_clock::time_point> startTimes;
+	// Start of CL timers on queues without profiling, which are only traced, timed on the host
+	std::map<std::string, std::chrono::steady_clock::time_point> startTimesCL;
 };
 
 } //namespace fast
@@ -0,0 +1,228 @@
+#include "RuntimeTracer.hpp"
+#include "Exception.hpp"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace fast {
+
+struct TraceSpan {
+    std::string name;
+    std::string category;
+    std::string processObject;
+    // Nanoseconds since the trace epoch
+    int64_t begin;
+    int64_t end;
+    uint64_t frameTimestamp;
+    bool device;
+};
+
+// Spans are stored in fixed size chunks which are never moved, so that they can be read while the owning thread
+// appends to them. The owning thread publishes a span by incrementing count.
+struct TraceChunk {
+    static constexpr int capacity = 1024;
+    TraceSpan spans[capacity];
+    std::atomic<int> count{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+struct ThreadTraceBuffer {
+    int threadIndex;
+    TraceChunk* first;
+    // Only used by the owning thread
+    TraceChunk* last;
+};
+
+static std::atomic<bool> g_tracingEnabled(false);
+
+// The registry is never deleted, since threads may record spans during static destruction
+static std::mutex& getRegistryMutex() {
+    static auto mutex = new std::mutex();
+    return *mutex;
+}
+
+static std::vector<ThreadTraceBuffer*>& getThreadBuffers() {
+    static auto buffers = new std::vector<ThreadTraceBuffer*>();
+    return *buffers;
+}
+
+static std::chrono::steady_clock::time_point getEpoch() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+static thread_local ThreadTraceBuffer* t_buffer = nullptr;
+static thread_local std::string t_processObject;
+
+static ThreadTraceBuffer* getThreadBuffer() {
+    if(t_buffer == nullptr) {
+        auto chunk = new TraceChunk();
+        std::lock_guard<std::mutex> lock(getRegistryMutex());
+        auto& buffers = getThreadBuffers();
+        t_buffer = new ThreadTraceBuffer{(int)buffers.size() + 1, chunk, chunk};
+        buffers.push_back(t_buffer);
+    }
+    return t_buffer;
+}
+
+void RuntimeTracer::enable() {
+    getEpoch();
+    g_tracingEnabled.store(true, std::memory_order_relaxed);
+}
+
+void RuntimeTracer::disable() {
+    g_tracingEnabled.store(false, std::memory_order_relaxed);
+}
+
+bool RuntimeTracer::isEnabled() {
+    return g_tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void RuntimeTracer::addSpan(const std::string& name, const std::string& category,
+        std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end,
+        uint64_t frameTimestamp, bool device) {
+    if(!isEnabled())
+        return;
+
+    auto buffer = getThreadBuffer();
+    TraceChunk* chunk = buffer->last;
+    int count = chunk->count.load(std::memory_order_relaxed);
+    if(count == TraceChunk::capacity) {
+        auto newChunk = new TraceChunk();
+        chunk->next.store(newChunk, std::memory_order_release);
+        buffer->last = newChunk;
+        chunk = newChunk;
+        count = 0;
+    }
+    TraceSpan& span = chunk->spans[count];
+    span.name = name;
+    span.category = category;
+    span.processObject = t_processObject;
+    span.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - getEpoch()).count();
+    span.end = std::chrono::duration_cast<std::chrono::nanoseconds>(end - getEpoch()).count();
+    span.frameTimestamp = frameTimestamp;
+    span.device = device;
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+std::string RuntimeTracer::setThreadProcessObject(const std::string& name) {
+    std::string previous = std::move(t_processObject);
+    t_processObject = name;
+    return previous;
+}
+
+static std::string escapeJSON(const std::string& str) {
+    std::ostringstream stream;
+    for(char c : str) {
+        switch(c) {
+            case '"':
+                stream << "\\\"";
+                break;
+            case '\\':
+                stream << "\\\\";
+                break;
+            case '\n':
+                stream << "\\n";
+                break;
+            case '\t':
+                stream << "\\t";
+                break;
+            default:
+                if((unsigned char)c < 0x20) {
+                    stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+                } else {
+                    stream << c;
+                }
+        }
+    }
+    return stream.str();
+}
+
+// Spans on the host and on OpenCL devices are shown as two processes in the trace
+static const int hostProcessID = 1;
+static const int deviceProcessID = 2;
+
+static void writeSpan(std::ostream& stream, const TraceSpan& span, int threadIndex) {
+    stream << ",\n{\"name\":\"" << escapeJSON(span.name) << "\",\"cat\":\"" << escapeJSON(span.category) << "\","
+           << "\"ph\":\"X\",\"ts\":" << span.begin*1e-3 << ",\"dur\":" << (span.end - span.begin)*1e-3 << ","
+           << "\"pid\":" << (span.device ? deviceProcessID : hostProcessID) << ",\"tid\":" << threadIndex
+           << ",\"args\":{";
+    bool first = true;
+    if(!span.processObject.empty()) {
+        stream << "\"processObject\":\"" << escapeJSON(span.processObject) << "\"";
+        first = false;
+    }
+    if(span.frameTimestamp > 0)
+        stream << (first ? "" : ",") << "\"frameTimestamp\":" << span.frameTimestamp;
+    stream << "}}";
+}
+
+static void writeMetadata(std::ostream& stream, const std::string& type, int processID, int threadIndex, const std::string& name) {
+    stream << "{\"name\":\"" << type << "\",\"ph\":\"M\",\"pid\":" << processID;
+    if(threadIndex > 0)
+        stream << ",\"tid\":" << threadIndex;
+    stream << ",\"args\":{\"name\":\"" << escapeJSON(name) << "\"}}";
+}
+
+std::string RuntimeTracer::getChromeTrace() {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(3);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    writeMetadata(stream, "process_name", hostProcessID, 0, "FAST");
+    stream << ",\n";
+    writeMetadata(stream, "process_name", deviceProcessID, 0, "OpenCL");
+
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    for(auto buffer : getThreadBuffers()) {
+        const std::string threadName = "Thread " + std::to_string(buffer->threadIndex);
+        stream << ",\n";
+        writeMetadata(stream, "thread_name", hostProcessID, buffer->threadIndex, threadName);
+        stream << ",\n";
+        writeMetadata(stream, "thread_name", deviceProcessID, buffer->threadIndex, "Queue of " + threadName);
+        for(TraceChunk* chunk = buffer->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const int count = chunk->count.load(std::memory_order_acquire);
+            for(int i = 0; i < count; ++i)
+                writeSpan(stream, chunk->spans[i], buffer->threadIndex);
+        }
+    }
+    stream << "\n]}\n";
+    return stream.str();
+}
+
+void RuntimeTracer::writeChromeTrace(std::string filename) {
+    std::ofstream file(filename.c_str());
+    if(!file.is_open())
+        throw Exception("Unable to open the file " + filename);
+    file << getChromeTrace();
+}
+
+std::size_t RuntimeTracer::getNumberOfSpans() {
+    std::size_t spans = 0;
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    for(auto buffer : getThreadBuffers()) {
+        for(TraceChunk* chunk = buffer->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+            spans += chunk->count.load(std::memory_order_acquire);
+    }
+    return spans;
+}
+
+void RuntimeTracer::clear() {
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    for(auto buffer : getThreadBuffers()) {
+        // Keep the first chunk, since the owning thread may still use the buffer
+        TraceChunk* chunk = buffer->first->next.exchange(nullptr);
+        while(chunk != nullptr) {
+            TraceChunk* next = chunk->next.load();
+            delete chunk;
+            chunk = next;
+        }
+        buffer->first->count = 0;
+        buffer->last = buffer->first;
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <FAST/Object.hpp>
+#include <chrono>
+#include <string>
+
+namespace fast {
+
+/**
+ * A purely static class which records a timeline of what every thread is doing, and writes it as a Chrome trace
+ * JSON file which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+ *
+ * When tracing is enabled, a span is recorded for every execute of every process object, with the frame timestamp
+ * of its input data, and for every timer of RuntimeMeasurementsManager, also for managers which are not enabled.
+ * Spans of OpenCL timers are shown on a separate OpenCL track for each thread, using the profiling info of the
+ * marker events. Since the device clock can't be related to the host clock in OpenCL 1.2, these spans are placed
+ * so that they end when the end marker was found to be complete on the host. Queues created before tracing was
+ * enabled usually have no profiling, and then the span is timed on the host by finishing the queue instead.
+ *
+ * Each thread records spans into its own buffer, without any locks. When tracing is disabled, the only overhead
+ * is checking an atomic flag.
+ */
+class FAST_EXPORT RuntimeTracer {
+    public:
+        /**
+         * Start recording spans
+         */
+        static void enable();
+        /**
+         * Stop recording spans. Spans already recorded are kept.
+         */
+        static void disable();
+        static bool isEnabled();
+        /**
+         * Record a span on the current thread. Does nothing if tracing is disabled.
+         * @param name
+         * @param category
+         * @param begin
+         * @param end
+         * @param frameTimestamp creation timestamp of the frame which was processed, 0 if unknown
+         * @param device true if this span was executed on an OpenCL device
+         */
+        static void addSpan(const std::string& name, const std::string& category,
+                std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end,
+                uint64_t frameTimestamp = 0, bool device = false);
+        /**
+         * Set the name of the process object which the current thread is executing. Spans recorded by this thread
+         * are attributed to this process object.
+         * @param name empty if the thread is not executing a process object
+         * @return the previous name
+         */
+        static std::string setThreadProcessObject(const std::string& name);
+        /**
+         * Write all recorded spans as a Chrome trace JSON file
+         * @param filename
+         */
+        static void writeChromeTrace(std::string filename);
+        /**
+         * @return Chrome trace JSON of all recorded spans
+         */
+        static std::string getChromeTrace();
+        /**
+         * @return number of spans recorded by all threads
+         */
+        static std::size_t getNumberOfSpans();
+        /**
+         * Delete all recorded spans. Must not be called while other threads are recording spans.
+         */
+        static void clear();
+};
+
+}
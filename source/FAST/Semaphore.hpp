@@ -21,12 +21,14 @@ freely, subject to the following restrictions:
    misrepresented as being the original software.
 3. This notice may not be removed or altered from any source distribution.
 */
+// Altered for FAST: Added timed waits to Semaphore and LightweightSemaphore
 
 #ifndef __CPP11OM_SEMAPHORE_H__
 #define __CPP11OM_SEMAPHORE_H__
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 
 
 #if defined(_WIN32)
@@ -63,6 +65,16 @@ public:
         WaitForSingleObject(m_hSema, INFINITE);
     }
 
+    bool tryWait()
+    {
+        return WaitForSingleObject(m_hSema, 0) == WAIT_OBJECT_0;
+    }
+
+    bool timedWait(std::uint64_t usecs)
+    {
+        return WaitForSingleObject(m_hSema, (DWORD)(usecs / 1000)) == WAIT_OBJECT_0;
+    }
+
     void signal(int count = 1)
     {
         ReleaseSemaphore(m_hSema, count, NULL);
@@ -103,6 +115,19 @@ public:
         semaphore_wait(m_sema);
     }
 
+    bool tryWait()
+    {
+        return timedWait(0);
+    }
+
+    bool timedWait(std::uint64_t usecs)
+    {
+        mach_timespec_t ts;
+        ts.tv_sec = (unsigned int)(usecs / 1000000);
+        ts.tv_nsec = (int)((usecs % 1000000) * 1000);
+        return semaphore_timedwait(m_sema, ts) == KERN_SUCCESS;
+    }
+
     void signal()
     {
         semaphore_signal(m_sema);
@@ -124,6 +149,8 @@ public:
 //---------------------------------------------------------
 
 #include <semaphore.h>
+#include <cerrno>
+#include <ctime>
 
 class Semaphore
 {
@@ -156,6 +183,39 @@ public:
         while (rc == -1 && errno == EINTR);
     }
 
+    bool tryWait()
+    {
+        int rc;
+        do
+        {
+            rc = sem_trywait(&m_sema);
+        }
+        while (rc == -1 && errno == EINTR);
+        return rc == 0;
+    }
+
+    bool timedWait(std::uint64_t usecs)
+    {
+        struct timespec ts;
+        const int usecsInSec = 1000000;
+        const int nsecsInSec = 1000000000;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += (time_t)(usecs / usecsInSec);
+        ts.tv_nsec += (long)(usecs % usecsInSec) * 1000;
+        if (ts.tv_nsec >= nsecsInSec)
+        {
+            ts.tv_nsec -= nsecsInSec;
+            ++ts.tv_sec;
+        }
+        int rc;
+        do
+        {
+            rc = sem_timedwait(&m_sema, &ts);
+        }
+        while (rc == -1 && errno == EINTR);
+        return rc == 0;
+    }
+
     void signal()
     {
         sem_post(&m_sema);
@@ -208,6 +268,34 @@ private:
         }
     }
 
+    bool waitWithPartialSpinning(std::int64_t timeoutUsecs)
+    {
+        int oldCount;
+        int spin = 10000;
+        while (spin--)
+        {
+            oldCount = m_count.load(std::memory_order_relaxed);
+            if ((oldCount > 0) && m_count.compare_exchange_strong(oldCount, oldCount - 1, std::memory_order_acquire))
+                return true;
+            std::atomic_signal_fence(std::memory_order_acquire);     // Prevent the compiler from collapsing the loop.
+        }
+        oldCount = m_count.fetch_sub(1, std::memory_order_acquire);
+        if (oldCount > 0)
+            return true;
+        if (timeoutUsecs > 0 && m_sema.timedWait((std::uint64_t)timeoutUsecs))
+            return true;
+        // Timed out. Undo the decrement, unless a signal arrived in the meantime, in which case the kernel
+        // semaphore has been signaled as well, and must be consumed.
+        while (true)
+        {
+            oldCount = m_count.load(std::memory_order_acquire);
+            if (oldCount >= 0 && m_sema.tryWait())
+                return true;
+            if (oldCount < 0 && m_count.compare_exchange_strong(oldCount, oldCount + 1, std::memory_order_relaxed))
+                return false;
+        }
+    }
+
 public:
     LightweightSemaphore(int initialCount = 0) : m_count(initialCount)
     {
@@ -226,6 +314,15 @@ public:
             waitWithPartialSpinning();
     }
 
+    /**
+     * Wait for at most the given number of microseconds
+     * @return false if timed out
+     */
+    bool wait(std::int64_t timeoutUsecs)
+    {
+        return tryWait() || waitWithPartialSpinning(timeoutUsecs);
+    }
+
     void signal(int count = 1)
     {
         int oldCount = m_count.fetch_add(count, std::memory_order_release);
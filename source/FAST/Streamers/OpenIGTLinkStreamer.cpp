@@ -29,7 +29,7 @@ void OpenIGTLinkStreamer::setConnectionPort(uint port) {
     mIsModified = true;
 }
 
-DataChannel::pointer OpenIGTLinkStreamer::getOutputPort(uint portID) {
+DataChannel::pointer OpenIGTLinkStreamer::getOutputPort(uint portID, DataChannelType type) {
 	if (mOutputPortDeviceNames.count("") == 0) {
 		portID = getNrOfOutputPorts();
 		createOutputPort<Image>(portID);
@@ -39,7 +39,7 @@ DataChannel::pointer OpenIGTLinkStreamer::getOutputPort(uint portID) {
 	else {
 		portID = mOutputPortDeviceNames[""];
 	}
-	return ProcessObject::getOutputPort(portID);
+	return ProcessObject::getOutputPort(portID, type);
 }
 
 uint OpenIGTLinkStreamer::getNrOfFrames() const {
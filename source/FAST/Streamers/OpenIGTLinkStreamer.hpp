@@ -28,11 +28,12 @@ class FAST_EXPORT OpenIGTLinkStreamer : public Streamer {
         bool hasReachedEnd();
         uint getNrOfFrames() const;
 
+		using ProcessObject::getOutputPort;
 		/**
 		 * Will select first image stream
 		 * @return
 		 */
-		DataChannel::pointer getOutputPort(uint portID = 0) override;
+		DataChannel::pointer getOutputPort(uint portID, DataChannelType type) override;
 
         template<class T>
         DataChannel::pointer getOutputPort(std::string deviceName);
@@ -83,7 +84,7 @@ DataChannel::pointer OpenIGTLinkStreamer::getOutputPort(std::string deviceName)
 	} else {
 		portID = mOutputPortDeviceNames[deviceName];
 	}
-    return ProcessObject::getOutputPort(portID);
+    return ProcessObject::getOutputPort(portID, DataChannelType::Default);
 }
 
 
@@ -0,0 +1,542 @@
+#include "StreamRecording.hpp"
+#include <FAST/Data/Image.hpp>
+#include <FAST/Data/Mesh.hpp>
+#include <FAST/SceneGraph.hpp>
+#include <FAST/AffineTransformation.hpp>
+#include <cstring>
+#include <zlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fast {
+
+// File layout. All values are little endian.
+static const char fileMagic[8] = {'F', 'A', 'S', 'T', 'R', 'E', 'C', '0'};
+static const char endMagic[8] = {'F', 'A', 'S', 'T', 'E', 'N', 'D', '0'};
+static const uint32_t formatVersion = 1;
+static const uint32_t chunkMagic = 0x4B4E4843; // CHNK
+static const uint32_t indexMagic = 0x58444E49; // INDX
+
+enum FrameType : uint32_t {
+    FRAME_IMAGE = 1,
+    FRAME_MESH = 2
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct ChunkHeader {
+    uint32_t magic;
+    uint32_t compression;
+    uint32_t nrOfFrames;
+    uint32_t reserved;
+    uint64_t uncompressedSize;
+    uint64_t storedSize;
+};
+
+struct FrameHeader {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t timestamp;
+    // Column major transformation matrix of the data object
+    float transform[16];
+};
+
+struct ImageHeader {
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t channels;
+    uint32_t dataType;
+    float spacing[3];
+    uint64_t dataSize;
+};
+
+struct MeshHeader {
+    uint32_t nrOfVertices;
+    uint32_t nrOfLines;
+    uint32_t nrOfTriangles;
+    uint32_t reserved;
+};
+
+// Mesh only stores position, normal and color of vertices, and the endpoints of lines and triangles
+struct MeshVertexRecord {
+    float position[3];
+    float normal[3];
+    float color[3];
+};
+
+struct MeshLineRecord {
+    uint32_t endpoints[2];
+};
+
+struct MeshTriangleRecord {
+    uint32_t endpoints[3];
+};
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t nrOfFrames;
+};
+
+struct Trailer {
+    uint64_t indexOffset;
+    char magic[8];
+};
+#pragma pack(pop)
+
+template <class T>
+static void append(std::vector<char>& buffer, const T& value) {
+    const char* bytes = (const char*)&value;
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <class T>
+static T read(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+StreamRecordingWriter::StreamRecordingWriter(std::string filename, StreamRecordingCompression compression, std::size_t chunkSize) {
+    m_file.open(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+    if(!m_file.is_open())
+        throw Exception("Unable to open stream recording " + filename + " for writing");
+    m_compression = compression;
+    m_chunkSize = chunkSize;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = formatVersion;
+    m_file.write((const char*)&header, sizeof(header));
+    m_bytesWritten = sizeof(header);
+}
+
+void StreamRecordingWriter::addFrame(DataObject::pointer data) {
+    if(m_closed)
+        throw Exception("Unable to add frame to a closed stream recording");
+
+    const std::size_t frameOffset = m_chunk.size();
+    FrameHeader frameHeader = {};
+    frameHeader.timestamp = data->getCreationTimestamp();
+    Affine3f transform = Affine3f::Identity();
+    if(auto spatialData = std::dynamic_pointer_cast<SpatialDataObject>(data))
+        transform = SceneGraph::getEigenAffineTransformationFromData(spatialData);
+    std::memcpy(frameHeader.transform, transform.data(), sizeof(frameHeader.transform));
+
+    if(auto image = std::dynamic_pointer_cast<Image>(data)) {
+        frameHeader.type = FRAME_IMAGE;
+        ImageHeader imageHeader = {};
+        imageHeader.width = image->getWidth();
+        imageHeader.height = image->getHeight();
+        imageHeader.depth = image->getDepth();
+        imageHeader.channels = image->getNrOfChannels();
+        imageHeader.dataType = image->getDataType();
+        for(int i = 0; i < 3; ++i)
+            imageHeader.spacing[i] = image->getSpacing()[i];
+        imageHeader.dataSize = (uint64_t)image->getNrOfVoxels()*getSizeOfDataType(image->getDataType(), image->getNrOfChannels());
+        append(m_chunk, frameHeader);
+        append(m_chunk, imageHeader);
+        auto access = image->getImageAccess(ACCESS_READ);
+        const char* pixels = (const char*)access->get();
+        m_chunk.insert(m_chunk.end(), pixels, pixels + imageHeader.dataSize);
+    } else if(auto mesh = std::dynamic_pointer_cast<Mesh>(data)) {
+        frameHeader.type = FRAME_MESH;
+        auto access = mesh->getMeshAccess(ACCESS_READ);
+        std::vector<MeshVertex> vertices = access->getVertices();
+        std::vector<MeshLine> lines = access->getLines();
+        std::vector<MeshTriangle> triangles = access->getTriangles();
+        MeshHeader meshHeader = {};
+        meshHeader.nrOfVertices = vertices.size();
+        meshHeader.nrOfLines = lines.size();
+        meshHeader.nrOfTriangles = triangles.size();
+        append(m_chunk, frameHeader);
+        append(m_chunk, meshHeader);
+        for(const MeshVertex& vertex : vertices) {
+            MeshVertexRecord record;
+            Eigen::Map<Vector3f>(record.position) = vertex.getPosition();
+            Eigen::Map<Vector3f>(record.normal) = vertex.getNormal();
+            Eigen::Map<Vector3f>(record.color) = vertex.getColor().asVector();
+            append(m_chunk, record);
+        }
+        for(MeshLine& line : lines) {
+            MeshLineRecord record;
+            record.endpoints[0] = line.getEndpoint1();
+            record.endpoints[1] = line.getEndpoint2();
+            append(m_chunk, record);
+        }
+        for(MeshTriangle& triangle : triangles) {
+            MeshTriangleRecord record;
+            record.endpoints[0] = triangle.getEndpoint1();
+            record.endpoints[1] = triangle.getEndpoint2();
+            record.endpoints[2] = triangle.getEndpoint3();
+            append(m_chunk, record);
+        }
+    } else {
+        throw Exception("Stream recordings can only contain Image and Mesh data objects");
+    }
+
+    // Chunk offset is set when the chunk is written
+    m_index.push_back({0, frameOffset, m_chunk.size() - frameOffset, frameHeader.timestamp});
+    ++m_framesInChunk;
+    if(m_chunk.size() >= m_chunkSize)
+        writeChunk();
+}
+
+void StreamRecordingWriter::writeChunk() {
+    if(m_framesInChunk == 0)
+        return;
+
+    const uint64_t chunkOffset = m_file.tellp();
+    ChunkHeader header = {};
+    header.magic = chunkMagic;
+    header.compression = (uint32_t)m_compression;
+    header.nrOfFrames = m_framesInChunk;
+    header.uncompressedSize = m_chunk.size();
+
+    const char* storedData = m_chunk.data();
+    std::vector<char> compressed;
+    if(m_compression == StreamRecordingCompression::ZLIB) {
+        uLongf compressedSize = compressBound(m_chunk.size());
+        compressed.resize(compressedSize);
+        // Fastest compression level, since recording usually happens while streaming
+        if(compress2((Bytef*)compressed.data(), &compressedSize, (const Bytef*)m_chunk.data(), m_chunk.size(), Z_BEST_SPEED) != Z_OK)
+            throw Exception("Unable to compress chunk of stream recording");
+        storedData = compressed.data();
+        header.storedSize = compressedSize;
+    } else {
+        header.storedSize = m_chunk.size();
+    }
+
+    m_file.write((const char*)&header, sizeof(header));
+    m_file.write(storedData, header.storedSize);
+    if(!m_file.good())
+        throw Exception("Unable to write chunk to stream recording");
+    m_bytesWritten += sizeof(header) + header.storedSize;
+
+    for(std::size_t i = m_index.size() - m_framesInChunk; i < m_index.size(); ++i)
+        m_index[i].chunkOffset = chunkOffset;
+    m_chunk.clear();
+    m_framesInChunk = 0;
+}
+
+void StreamRecordingWriter::close() {
+    if(m_closed)
+        return;
+    writeChunk();
+
+    const uint64_t indexOffset = m_file.tellp();
+    IndexHeader indexHeader = {indexMagic, 0, m_index.size()};
+    m_file.write((const char*)&indexHeader, sizeof(indexHeader));
+    m_file.write((const char*)m_index.data(), m_index.size()*sizeof(StreamRecordingIndexEntry));
+    Trailer trailer;
+    trailer.indexOffset = indexOffset;
+    std::memcpy(trailer.magic, endMagic, sizeof(endMagic));
+    m_file.write((const char*)&trailer, sizeof(trailer));
+    m_file.close();
+    m_bytesWritten += sizeof(indexHeader) + m_index.size()*sizeof(StreamRecordingIndexEntry) + sizeof(trailer);
+    m_closed = true;
+}
+
+uint64_t StreamRecordingWriter::getNrOfFrames() const {
+    return m_index.size();
+}
+
+uint64_t StreamRecordingWriter::getBytesWritten() const {
+    return m_bytesWritten;
+}
+
+StreamRecordingWriter::~StreamRecordingWriter() {
+    try {
+        close();
+    } catch(Exception& e) {
+        Reporter::error() << "Unable to close stream recording: " << e.what() << Reporter::end();
+    }
+}
+
+/**
+ * @return header of the chunk at the given offset, after checking that the chunk is within the file
+ */
+static ChunkHeader readChunkHeader(const char* data, uint64_t size, uint64_t offset, const std::string& filename) {
+    if(offset < sizeof(FileHeader) || size < sizeof(ChunkHeader) || offset > size - sizeof(ChunkHeader))
+        throw Exception("Corrupt chunk offset in stream recording " + filename);
+    const ChunkHeader header = read<ChunkHeader>(data + offset);
+    if(header.magic != chunkMagic || header.storedSize > size - offset - sizeof(ChunkHeader) ||
+            (header.compression == (uint32_t)StreamRecordingCompression::NONE && header.uncompressedSize != header.storedSize))
+        throw Exception("Corrupt chunk in stream recording " + filename);
+    return header;
+}
+
+StreamRecordingReader::StreamRecordingReader(std::string filename) {
+    m_filename = filename;
+#ifdef _WIN32
+    m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(m_fileHandle == INVALID_HANDLE_VALUE) {
+        m_fileHandle = nullptr;
+        throw FileNotFoundException(filename);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_fileHandle, &size);
+    m_size = size.QuadPart;
+    if(m_size > 0) {
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(m_mappingHandle != NULL)
+            m_data = (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if(file < 0)
+        throw FileNotFoundException(filename);
+    struct stat status;
+    fstat(file, &status);
+    m_size = status.st_size;
+    if(m_size > 0) {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, file, 0);
+        m_data = data == MAP_FAILED ? nullptr : (const char*)data;
+    }
+    ::close(file);
+#endif
+    // The destructor isn't called when the constructor throws, thus unmap the file here
+    try {
+        if(m_data == nullptr)
+            throw Exception("Unable to memory map stream recording " + filename);
+        if(m_size < sizeof(FileHeader) || std::memcmp(m_data, fileMagic, sizeof(fileMagic)) != 0)
+            throw Exception(filename + " is not a stream recording");
+        if(read<FileHeader>(m_data).version > formatVersion)
+            throw Exception("Stream recording " + filename + " was made with a newer version of FAST");
+
+        readIndex();
+    } catch(...) {
+        unmap();
+        throw;
+    }
+}
+
+void StreamRecordingReader::readIndex() {
+    if(m_size >= sizeof(FileHeader) + sizeof(IndexHeader) + sizeof(Trailer)) {
+        const Trailer trailer = read<Trailer>(m_data + m_size - sizeof(Trailer));
+        const uint64_t maxIndexOffset = m_size - sizeof(Trailer) - sizeof(IndexHeader);
+        if(std::memcmp(trailer.magic, endMagic, sizeof(endMagic)) == 0 && trailer.indexOffset >= sizeof(FileHeader) && trailer.indexOffset <= maxIndexOffset) {
+            const IndexHeader header = read<IndexHeader>(m_data + trailer.indexOffset);
+            // Compare the number of entries instead of the index size, which can overflow
+            const uint64_t indexSpace = maxIndexOffset - trailer.indexOffset;
+            if(header.magic == indexMagic && indexSpace % sizeof(StreamRecordingIndexEntry) == 0 &&
+                    header.nrOfFrames == indexSpace / sizeof(StreamRecordingIndexEntry)) {
+                m_index.resize(header.nrOfFrames);
+                std::memcpy(m_index.data(), m_data + trailer.indexOffset + sizeof(IndexHeader), header.nrOfFrames*sizeof(StreamRecordingIndexEntry));
+                // Every frame must be within its chunk, and every chunk before the index
+                for(const StreamRecordingIndexEntry& entry : m_index) {
+                    const ChunkHeader chunk = readChunkHeader(m_data, m_size, entry.chunkOffset, m_filename);
+                    if(entry.chunkOffset + sizeof(ChunkHeader) > trailer.indexOffset ||
+                            chunk.storedSize > trailer.indexOffset - entry.chunkOffset - sizeof(ChunkHeader) ||
+                            entry.frameOffset > chunk.uncompressedSize || entry.frameSize > chunk.uncompressedSize - entry.frameOffset ||
+                            entry.frameSize < sizeof(FrameHeader))
+                        throw Exception("Corrupt index in stream recording " + m_filename);
+                }
+                return;
+            }
+        }
+    }
+    Reporter::warning() << "Stream recording " << m_filename << " has no index, scanning chunks instead" << Reporter::end();
+    scanChunks();
+}
+
+void StreamRecordingReader::scanChunks() {
+    uint64_t offset = sizeof(FileHeader);
+    while(offset + sizeof(ChunkHeader) <= m_size) {
+        const ChunkHeader header = read<ChunkHeader>(m_data + offset);
+        // Stop at the index, or at an incomplete chunk at the end of the file
+        if(header.magic != chunkMagic || offset + sizeof(ChunkHeader) + header.storedSize > m_size)
+            break;
+        const uint64_t chunkSize = header.uncompressedSize;
+        if(header.compression == (uint32_t)StreamRecordingCompression::NONE && chunkSize != header.storedSize)
+            throw Exception("Corrupt chunk in stream recording " + m_filename);
+        std::shared_ptr<std::vector<char>> storage;
+        const char* chunk = getChunk(offset, storage);
+        uint64_t frameOffset = 0;
+        // Every read must be within the chunk. frameOffset is never larger than chunkSize, thus this can't overflow.
+        auto checkFrameSize = [&](uint64_t size) {
+            if(size > chunkSize - frameOffset)
+                throw Exception("Frame exceeds the end of its chunk in stream recording " + m_filename);
+        };
+        for(uint32_t i = 0; i < header.nrOfFrames; ++i) {
+            checkFrameSize(sizeof(FrameHeader));
+            const FrameHeader frameHeader = read<FrameHeader>(chunk + frameOffset);
+            uint64_t frameSize = sizeof(FrameHeader);
+            if(frameHeader.type == FRAME_IMAGE) {
+                checkFrameSize(sizeof(FrameHeader) + sizeof(ImageHeader));
+                const uint64_t dataSize = read<ImageHeader>(chunk + frameOffset + sizeof(FrameHeader)).dataSize;
+                checkFrameSize(dataSize);
+                frameSize += sizeof(ImageHeader) + dataSize;
+            } else if(frameHeader.type == FRAME_MESH) {
+                checkFrameSize(sizeof(FrameHeader) + sizeof(MeshHeader));
+                const MeshHeader meshHeader = read<MeshHeader>(chunk + frameOffset + sizeof(FrameHeader));
+                frameSize += sizeof(MeshHeader) + (uint64_t)meshHeader.nrOfVertices*sizeof(MeshVertexRecord) +
+                        (uint64_t)meshHeader.nrOfLines*sizeof(MeshLineRecord) + (uint64_t)meshHeader.nrOfTriangles*sizeof(MeshTriangleRecord);
+            } else {
+                throw Exception("Unknown frame type in stream recording " + m_filename);
+            }
+            checkFrameSize(frameSize);
+            m_index.push_back({offset, frameOffset, frameSize, frameHeader.timestamp});
+            frameOffset += frameSize;
+        }
+        offset += sizeof(ChunkHeader) + header.storedSize;
+    }
+}
+
+const char* StreamRecordingReader::getChunk(uint64_t offset, std::shared_ptr<std::vector<char>>& storage) {
+    const ChunkHeader header = readChunkHeader(m_data, m_size, offset, m_filename);
+    // Uncompressed chunks are read directly from the memory mapped file
+    if(header.compression == (uint32_t)StreamRecordingCompression::NONE)
+        return m_data + offset + sizeof(ChunkHeader);
+
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        for(const Chunk& chunk : m_cache) {
+            if(chunk.offset == offset) {
+                storage = chunk.data;
+                return storage->data();
+            }
+        }
+    }
+
+    if(header.compression != (uint32_t)StreamRecordingCompression::ZLIB)
+        throw Exception("Unknown compression in stream recording " + m_filename);
+    storage = std::make_shared<std::vector<char>>(header.uncompressedSize);
+    uLongf size = header.uncompressedSize;
+    if(uncompress((Bytef*)storage->data(), &size, (const Bytef*)(m_data + offset + sizeof(ChunkHeader)), header.storedSize) != Z_OK || size != header.uncompressedSize)
+        throw Exception("Unable to decompress chunk in stream recording " + m_filename);
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    // Keep a few chunks, so that threads reading ahead don't evict the chunk of each other
+    const int maxCachedChunks = 4;
+    if(m_cache.size() == maxCachedChunks)
+        m_cache.erase(m_cache.begin());
+    m_cache.push_back({offset, storage});
+    return storage->data();
+}
+
+uint64_t StreamRecordingReader::getNrOfFrames() const {
+    return m_index.size();
+}
+
+uint64_t StreamRecordingReader::getTimestamp(uint64_t frame) const {
+    return m_index.at(frame).timestamp;
+}
+
+DataObject::pointer StreamRecordingReader::getFrame(uint64_t frameNr) {
+    if(frameNr >= m_index.size())
+        throw OutOfBoundsException();
+    const StreamRecordingIndexEntry& entry = m_index[frameNr];
+    std::shared_ptr<std::vector<char>> storage;
+    // The index has been checked, thus the frame is within its chunk
+    const char* frame = getChunk(entry.chunkOffset, storage) + entry.frameOffset;
+    const FrameHeader frameHeader = read<FrameHeader>(frame);
+    const char* data = frame + sizeof(FrameHeader);
+    // Every read must be within the frame
+    auto checkFrameSize = [&](uint64_t size) {
+        if(size > entry.frameSize)
+            throw Exception("Corrupt frame " + std::to_string(frameNr) + " in stream recording " + m_filename);
+    };
+
+    SpatialDataObject::pointer output;
+    if(frameHeader.type == FRAME_IMAGE) {
+        checkFrameSize(sizeof(FrameHeader) + sizeof(ImageHeader));
+        const ImageHeader header = read<ImageHeader>(data);
+        data += sizeof(ImageHeader);
+        if(header.dataType > TYPE_SNORM_INT16 || header.channels < 1 || header.channels > 4)
+            throw Exception("Corrupt frame " + std::to_string(frameNr) + " in stream recording " + m_filename);
+        // Data size must match the image size. Multiply one dimension at a time, stopping before it can overflow.
+        uint64_t expectedSize = getSizeOfDataType((DataType)header.dataType, header.channels);
+        for(uint32_t size : {header.width, header.height, header.depth}) {
+            if(size == 0 || expectedSize > entry.frameSize / size)
+                throw Exception("Corrupt frame " + std::to_string(frameNr) + " in stream recording " + m_filename);
+            expectedSize *= size;
+        }
+        if(header.dataSize != expectedSize)
+            throw Exception("Corrupt frame " + std::to_string(frameNr) + " in stream recording " + m_filename);
+        checkFrameSize(sizeof(FrameHeader) + sizeof(ImageHeader) + header.dataSize);
+        auto image = Image::New();
+        if(header.depth > 1) {
+            image->create(header.width, header.height, header.depth, (DataType)header.dataType, header.channels, data);
+        } else {
+            image->create(header.width, header.height, (DataType)header.dataType, header.channels, data);
+        }
+        image->setSpacing(Vector3f(header.spacing[0], header.spacing[1], header.spacing[2]));
+        output = image;
+    } else if(frameHeader.type == FRAME_MESH) {
+        checkFrameSize(sizeof(FrameHeader) + sizeof(MeshHeader));
+        const MeshHeader header = read<MeshHeader>(data);
+        data += sizeof(MeshHeader);
+        checkFrameSize(sizeof(FrameHeader) + sizeof(MeshHeader) + (uint64_t)header.nrOfVertices*sizeof(MeshVertexRecord) +
+                (uint64_t)header.nrOfLines*sizeof(MeshLineRecord) + (uint64_t)header.nrOfTriangles*sizeof(MeshTriangleRecord));
+        std::vector<MeshVertex> vertices;
+        vertices.reserve(header.nrOfVertices);
+        for(uint32_t i = 0; i < header.nrOfVertices; ++i) {
+            const MeshVertexRecord record = read<MeshVertexRecord>(data);
+            data += sizeof(MeshVertexRecord);
+            vertices.push_back(MeshVertex(Vector3f(record.position), Vector3f(record.normal), Color(record.color[0], record.color[1], record.color[2])));
+        }
+        std::vector<MeshLine> lines;
+        lines.reserve(header.nrOfLines);
+        for(uint32_t i = 0; i < header.nrOfLines; ++i) {
+            const MeshLineRecord record = read<MeshLineRecord>(data);
+            data += sizeof(MeshLineRecord);
+            lines.push_back(MeshLine(record.endpoints[0], record.endpoints[1]));
+        }
+        std::vector<MeshTriangle> triangles;
+        triangles.reserve(header.nrOfTriangles);
+        for(uint32_t i = 0; i < header.nrOfTriangles; ++i) {
+            const MeshTriangleRecord record = read<MeshTriangleRecord>(data);
+            data += sizeof(MeshTriangleRecord);
+            triangles.push_back(MeshTriangle(record.endpoints[0], record.endpoints[1], record.endpoints[2]));
+        }
+        auto mesh = Mesh::New();
+        mesh->create(vertices, lines, triangles);
+        output = mesh;
+    } else {
+        throw Exception("Unknown frame type in stream recording " + m_filename);
+    }
+
+    Affine3f transform;
+    std::memcpy(transform.data(), frameHeader.transform, sizeof(frameHeader.transform));
+    auto T = AffineTransformation::New();
+    T->setTransform(transform);
+    output->getSceneGraphNode()->setTransformation(T);
+    output->setCreationTimestamp(frameHeader.timestamp);
+    return output;
+}
+
+StreamRecordingReader::~StreamRecordingReader() {
+    unmap();
+}
+
+void StreamRecordingReader::unmap() {
+#ifdef _WIN32
+    if(m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if(m_mappingHandle != nullptr)
+        CloseHandle(m_mappingHandle);
+    if(m_fileHandle != nullptr)
+        CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if(m_data != nullptr)
+        munmap((void*)m_data, m_size);
+#endif
+    m_data = nullptr;
+}
+
+}
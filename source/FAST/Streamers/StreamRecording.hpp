@@ -0,0 +1,121 @@
+#pragma once
+
+#include <FAST/Object.hpp>
+#include <FAST/Data/DataObject.hpp>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace fast {
+
+/**
+ * Compression used for the chunks of a stream recording
+ */
+enum class StreamRecordingCompression {
+    NONE = 0,
+    ZLIB = 1
+};
+
+/**
+ * Location of a frame in a stream recording
+ */
+struct StreamRecordingIndexEntry {
+    // Offset of the chunk header in the file
+    uint64_t chunkOffset;
+    // Offset and size of the frame in the uncompressed chunk
+    uint64_t frameOffset;
+    uint64_t frameSize;
+    uint64_t timestamp;
+};
+
+/**
+ * Writes a stream of Image and Mesh data objects to a single append-only file.
+ *
+ * The file starts with a header, followed by chunks of one or more frames. Frames are collected until
+ * the chunk size is reached, and the chunk is then optionally compressed as a whole and appended to the file.
+ * Each frame stores its metadata, timestamp and data. When the writer is closed, an index with the location and
+ * timestamp of every frame is written at the end, so that a reader can find any frame directly.
+ * A recording which wasn't closed properly has no index, but can still be read since the reader then rebuilds
+ * the index by scanning the chunks.
+ */
+class FAST_EXPORT StreamRecordingWriter {
+    public:
+        typedef std::shared_ptr<StreamRecordingWriter> pointer;
+        /**
+         * @param filename File to create
+         * @param compression Compression of each chunk
+         * @param chunkSize Minimum number of uncompressed bytes in each chunk. Frames are never split between chunks.
+         */
+        StreamRecordingWriter(std::string filename, StreamRecordingCompression compression = StreamRecordingCompression::ZLIB, std::size_t chunkSize = 4*1024*1024);
+        /**
+         * Append an Image or Mesh frame to the recording
+         */
+        void addFrame(DataObject::pointer data);
+        /**
+         * Write remaining frames and the index, and close the file. Called by the destructor.
+         */
+        void close();
+        uint64_t getNrOfFrames() const;
+        uint64_t getBytesWritten() const;
+        ~StreamRecordingWriter();
+    private:
+        void writeChunk();
+
+        std::ofstream m_file;
+        StreamRecordingCompression m_compression;
+        std::size_t m_chunkSize;
+        // Uncompressed frames of the current chunk
+        std::vector<char> m_chunk;
+        uint32_t m_framesInChunk = 0;
+        std::vector<StreamRecordingIndexEntry> m_index;
+        uint64_t m_bytesWritten = 0;
+        bool m_closed = false;
+};
+
+/**
+ * Reads frames from a stream recording made by StreamRecordingWriter.
+ *
+ * The file is memory mapped, and any frame can be read directly using the index. Only the chunk of the frame is
+ * decompressed. The most recently decompressed chunks are cached, since consecutive frames are usually in the
+ * same chunk.
+ *
+ * All methods are thread-safe.
+ */
+class FAST_EXPORT StreamRecordingReader {
+    public:
+        typedef std::shared_ptr<StreamRecordingReader> pointer;
+        explicit StreamRecordingReader(std::string filename);
+        uint64_t getNrOfFrames() const;
+        uint64_t getTimestamp(uint64_t frame) const;
+        /**
+         * @return Image or Mesh of the given frame
+         */
+        DataObject::pointer getFrame(uint64_t frame);
+        ~StreamRecordingReader();
+    private:
+        struct Chunk {
+            uint64_t offset;
+            std::shared_ptr<std::vector<char>> data;
+        };
+
+        void readIndex();
+        void scanChunks();
+        void unmap();
+        /**
+         * @return pointer to the uncompressed data of the chunk at the given offset
+         */
+        const char* getChunk(uint64_t offset, std::shared_ptr<std::vector<char>>& storage);
+
+        std::string m_filename;
+        const char* m_data = nullptr;
+        uint64_t m_size = 0;
+#ifdef _WIN32
+        void* m_fileHandle = nullptr;
+        void* m_mappingHandle = nullptr;
+#endif
+        std::vector<StreamRecordingIndexEntry> m_index;
+        std::mutex m_cacheMutex;
+        std::vector<Chunk> m_cache;
+};
+
+}
@@ -0,0 +1,162 @@
+#include "StreamRecordingStreamer.hpp"
+#include <chrono>
+#include <deque>
+#include <future>
+
+namespace fast {
+
+StreamRecordingStreamer::StreamRecordingStreamer() {
+    createOutputPort<DataObject>(0);
+    createStringAttribute("filename", "Filename", "Stream recording to stream", "");
+    createBooleanAttribute("loop", "Loop", "Loop streaming", false);
+    m_seekFrame = -1;
+    m_currentFrame = 0;
+}
+
+void StreamRecordingStreamer::loadAttributes() {
+    setFilename(getStringAttribute("filename"));
+    if(getBooleanAttribute("loop")) {
+        enableLooping();
+    } else {
+        disableLooping();
+    }
+}
+
+void StreamRecordingStreamer::setFilename(std::string filename) {
+    if(filename != m_filename)
+        m_reader.reset();
+    m_filename = filename;
+    setModified(true);
+}
+
+void StreamRecordingStreamer::enableLooping() {
+    m_loop = true;
+}
+
+void StreamRecordingStreamer::disableLooping() {
+    m_loop = false;
+}
+
+void StreamRecordingStreamer::setUseTimestamp(bool use) {
+    m_useTimestamp = use;
+}
+
+void StreamRecordingStreamer::setPrefetchFrames(int frames) {
+    if(frames < 0)
+        throw Exception("Number of prefetch frames can't be negative in StreamRecordingStreamer");
+    m_prefetchFrames = frames;
+}
+
+void StreamRecordingStreamer::seek(uint64_t frame) {
+    if(frame >= getNrOfFrames())
+        throw OutOfBoundsException();
+    m_seekFrame = frame;
+}
+
+uint64_t StreamRecordingStreamer::getNrOfFrames() {
+    return getReader()->getNrOfFrames();
+}
+
+uint64_t StreamRecordingStreamer::getCurrentFrameIndex() const {
+    return m_currentFrame;
+}
+
+StreamRecordingReader::pointer StreamRecordingStreamer::getReader() {
+    if(!m_reader) {
+        if(m_filename.empty())
+            throw Exception("No filename was given to the StreamRecordingStreamer");
+        m_reader = std::make_shared<StreamRecordingReader>(m_filename);
+    }
+    return m_reader;
+}
+
+void StreamRecordingStreamer::execute() {
+    if(getNrOfFrames() == 0)
+        throw Exception("Stream recording " + m_filename + " has no frames");
+
+    startStream();
+    waitForFirstFrame();
+}
+
+void StreamRecordingStreamer::generateStream() {
+    auto reader = m_reader;
+    const uint64_t nrOfFrames = reader->getNrOfFrames();
+    // Frames being read in the background, starting with the next frame to send
+    std::deque<std::pair<uint64_t, std::future<DataObject::pointer>>> prefetched;
+    // Timestamp and time of the first frame after start, seek or restart, used to pace the stream
+    uint64_t startTimestamp = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    bool restarted = true;
+
+    uint64_t frameNr = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_stopMutex);
+            if(m_stop) {
+                m_streamIsStarted = false;
+                m_firstFrameIsInserted = false;
+                break;
+            }
+        }
+        const int64_t seekFrame = m_seekFrame.exchange(-1);
+        if(seekFrame >= 0) {
+            frameNr = seekFrame;
+            prefetched.clear();
+            restarted = true;
+        }
+        if(frameNr == nrOfFrames) {
+            if(!m_loop)
+                break;
+            frameNr = 0;
+            restarted = true;
+        }
+
+        DataObject::pointer frame;
+        if(m_prefetchFrames == 0) {
+            frame = reader->getFrame(frameNr);
+        } else {
+            uint64_t next = prefetched.empty() ? frameNr : prefetched.back().first + 1;
+            while(prefetched.size() <= m_prefetchFrames) {
+                if(next == nrOfFrames) {
+                    if(!m_loop)
+                        break;
+                    next = 0;
+                }
+                prefetched.emplace_back(next, std::async(std::launch::async, [reader, next]() {
+                    return reader->getFrame(next);
+                }));
+                ++next;
+            }
+            frame = prefetched.front().second.get();
+            prefetched.pop_front();
+        }
+
+        const uint64_t timestamp = frame->getCreationTimestamp();
+        if(m_useTimestamp && timestamp != 0) {
+            if(restarted || timestamp < startTimestamp) {
+                startTimestamp = timestamp;
+                startTime = std::chrono::high_resolution_clock::now();
+            } else {
+                std::this_thread::sleep_until(startTime + std::chrono::milliseconds(timestamp - startTimestamp));
+            }
+        }
+        restarted = false;
+
+        if(frameNr == nrOfFrames - 1 && !m_loop)
+            frame->setLastFrame(getNameOfClass());
+        try {
+            addOutputData(0, frame);
+        } catch(ThreadStopped &e) {
+            break;
+        }
+        m_currentFrame = frameNr;
+        frameAdded();
+        ++frameNr;
+    }
+}
+
+StreamRecordingStreamer::~StreamRecordingStreamer() {
+    stop();
+}
+
+}
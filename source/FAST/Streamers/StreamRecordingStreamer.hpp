@@ -0,0 +1,60 @@
+#pragma once
+
+#include <FAST/Streamers/Streamer.hpp>
+#include <FAST/Streamers/StreamRecording.hpp>
+#include <atomic>
+
+namespace fast {
+
+/**
+ * Streams the Image and Mesh frames of a stream recording made with StreamRecordingExporter.
+ *
+ * Frames are paced by their timestamps, and a few frames ahead of the current frame are read and decompressed
+ * in the background. Since the recording has an index, seeking to any frame is done directly without reading
+ * the frames before it.
+ */
+class FAST_EXPORT StreamRecordingStreamer : public Streamer {
+    FAST_OBJECT(StreamRecordingStreamer)
+    public:
+        void setFilename(std::string filename);
+        void enableLooping();
+        void disableLooping();
+        /**
+         * Enable or disable the use of timestamps to pace the stream. Default true.
+         * @param use
+         */
+        void setUseTimestamp(bool use);
+        /**
+         * Set number of frames to read ahead of the current frame. Default is 4.
+         * @param frames
+         */
+        void setPrefetchFrames(int frames);
+        /**
+         * Continue streaming from the given frame
+         * @param frame
+         */
+        void seek(uint64_t frame);
+        uint64_t getNrOfFrames();
+        /**
+         * @return index of the last frame sent
+         */
+        uint64_t getCurrentFrameIndex() const;
+        void loadAttributes() override;
+        ~StreamRecordingStreamer() override;
+    private:
+        StreamRecordingStreamer();
+        void execute() override;
+        void generateStream() override;
+        StreamRecordingReader::pointer getReader();
+
+        std::string m_filename;
+        StreamRecordingReader::pointer m_reader;
+        bool m_loop = false;
+        bool m_useTimestamp = true;
+        int m_prefetchFrames = 4;
+        // Frame requested by seek, or -1
+        std::atomic<int64_t> m_seekFrame;
+        std::atomic<uint64_t> m_currentFrame;
+};
+
+}
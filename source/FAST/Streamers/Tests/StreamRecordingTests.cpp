@@ -0,0 +1,259 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Streamers/StreamRecording.hpp"
+#include "FAST/Streamers/StreamRecordingStreamer.hpp"
+#include "FAST/Exporters/StreamRecordingExporter.hpp"
+#include "FAST/Data/Image.hpp"
+#include "FAST/Data/Mesh.hpp"
+#include "FAST/SceneGraph.hpp"
+#include "FAST/AffineTransformation.hpp"
+#include <cstring>
+#include <fstream>
+
+using namespace fast;
+
+static std::string getRecordingFilename(std::string name) {
+    createDirectories(Config::getTestDataPath() + "temp/StreamRecordingTest");
+    return Config::getTestDataPath() + "temp/StreamRecordingTest/" + name + ".fastrec";
+}
+
+static Image::pointer createFrame(int frameNr) {
+    auto data = make_uninitialized_unique<ushort[]>(64*32);
+    for(int i = 0; i < 64*32; ++i)
+        data[i] = (ushort)(frameNr*100 + i);
+    auto image = Image::New();
+    image->create(64, 32, TYPE_UINT16, 1, std::move(data));
+    image->setSpacing(Vector3f(0.5f, 0.25f, 1.0f));
+    image->setCreationTimestamp(1000 + frameNr*10);
+    return image;
+}
+
+static void checkFrame(DataObject::pointer data, int frameNr) {
+    auto image = std::dynamic_pointer_cast<Image>(data);
+    REQUIRE(image);
+    CHECK(image->getWidth() == 64);
+    CHECK(image->getHeight() == 32);
+    CHECK(image->getDimensions() == 2);
+    CHECK(image->getDataType() == TYPE_UINT16);
+    CHECK(image->getSpacing().x() == Approx(0.5f));
+    CHECK(image->getSpacing().y() == Approx(0.25f));
+    CHECK(image->getCreationTimestamp() == 1000 + frameNr*10);
+    auto access = image->getImageAccess(ACCESS_READ);
+    auto pixels = (ushort*)access->get();
+    CHECK(pixels[0] == (ushort)(frameNr*100));
+    CHECK(pixels[64*32 - 1] == (ushort)(frameNr*100 + 64*32 - 1));
+}
+
+TEST_CASE("Stream recording with images and meshes can be read in any order", "[fast][StreamRecording]") {
+    std::string filename = getRecordingFilename("mixed");
+    {
+        // Small chunks, so that frames are spread over several chunks
+        StreamRecordingWriter writer(filename, StreamRecordingCompression::ZLIB, 10000);
+        for(int i = 0; i < 10; ++i) {
+            auto image = createFrame(i);
+            Affine3f transform = Affine3f::Identity();
+            transform.translate(Vector3f(i, 2, 3));
+            auto T = AffineTransformation::New();
+            T->setTransform(transform);
+            image->getSceneGraphNode()->setTransformation(T);
+            writer.addFrame(image);
+        }
+        std::vector<MeshVertex> vertices = {
+                MeshVertex(Vector3f(1, 2, 3), Vector3f(0, 0, 1), Color::Blue()),
+                MeshVertex(Vector3f(4, 5, 6)),
+                MeshVertex(Vector3f(7, 8, 9)),
+        };
+        auto mesh = Mesh::New();
+        mesh->create(vertices, {MeshLine(0, 1)}, {MeshTriangle(0, 1, 2)});
+        mesh->setCreationTimestamp(2000);
+        writer.addFrame(mesh);
+        CHECK(writer.getNrOfFrames() == 11);
+    }
+
+    StreamRecordingReader reader(filename);
+    REQUIRE(reader.getNrOfFrames() == 11);
+    CHECK(reader.getTimestamp(10) == 2000);
+    for(int i : {7, 0, 9, 3, 4}) {
+        auto frame = reader.getFrame(i);
+        checkFrame(frame, i);
+        Affine3f transform = SceneGraph::getEigenAffineTransformationFromData(std::dynamic_pointer_cast<Image>(frame));
+        CHECK(transform.translation().x() == Approx(i));
+        CHECK(transform.translation().z() == Approx(3));
+    }
+
+    auto mesh = std::dynamic_pointer_cast<Mesh>(reader.getFrame(10));
+    REQUIRE(mesh);
+    CHECK(mesh->getCreationTimestamp() == 2000);
+    auto access = mesh->getMeshAccess(ACCESS_READ);
+    auto vertices = access->getVertices();
+    REQUIRE(vertices.size() == 3);
+    CHECK(vertices[0].getPosition().z() == Approx(3));
+    CHECK(vertices[0].getNormal().z() == Approx(1));
+    CHECK(vertices[0].getColor().asVector().isApprox(Color::Blue().asVector()));
+    CHECK(vertices[2].getPosition().x() == Approx(7));
+    auto lines = access->getLines();
+    REQUIRE(lines.size() == 1);
+    CHECK(lines[0].getEndpoint2() == 1);
+    auto triangles = access->getTriangles();
+    REQUIRE(triangles.size() == 1);
+    CHECK(triangles[0].getEndpoint3() == 2);
+
+    CHECK_THROWS_AS(reader.getFrame(11), OutOfBoundsException);
+}
+
+TEST_CASE("Stream recording which was not closed can be read", "[fast][StreamRecording]") {
+    std::string filename = getRecordingFilename("unclosed");
+    {
+        // Two frames in each chunk
+        StreamRecordingWriter writer(filename, StreamRecordingCompression::NONE, 8000);
+        for(int i = 0; i < 10; ++i)
+            writer.addFrame(createFrame(i));
+    }
+    // Remove the index, and the end of the last chunk, as if recording was interrupted
+    std::vector<char> data;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    const std::size_t frameSize = 64*32*2 + 120;
+    {
+        // The last chunk has frames 8 and 9, cut in frame 9
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        std::size_t indexSize = 16 + 10*32 + 16;
+        file.write(data.data(), data.size() - indexSize - frameSize/2);
+    }
+
+    StreamRecordingReader reader(filename);
+    REQUIRE(reader.getNrOfFrames() == 8);
+    for(int i = 0; i < 8; ++i)
+        checkFrame(reader.getFrame(i), i);
+}
+
+TEST_CASE("Stream recording with a corrupt chunk is rejected when scanning chunks", "[fast][StreamRecording]") {
+    std::string filename = getRecordingFilename("corrupt");
+    {
+        // Two frames in each chunk
+        StreamRecordingWriter writer(filename, StreamRecordingCompression::NONE, 8000);
+        for(int i = 0; i < 4; ++i)
+            writer.addFrame(createFrame(i));
+    }
+    std::vector<char> data;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // Remove the index, so that the chunks are scanned
+    const std::size_t indexSize = 16 + 4*32 + 16;
+    data.resize(data.size() - indexSize);
+    auto writeCorrupted = [&](std::size_t offset, const void* value, std::size_t size) {
+        std::vector<char> corrupted = data;
+        std::memcpy(corrupted.data() + offset, value, size);
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write(corrupted.data(), corrupted.size());
+    };
+    const std::size_t fileHeaderSize = 16;
+    const std::size_t chunkHeaderSize = 32;
+    const std::size_t frameSize = 64*32*2 + 120;
+
+    SECTION("Image data size larger than the chunk") {
+        // Data size of the second frame of the first chunk
+        const uint64_t dataSize = 0xFFFFFFFFFFFFFF00ull;
+        writeCorrupted(fileHeaderSize + chunkHeaderSize + frameSize + 80 + 32, &dataSize, sizeof(dataSize));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+    SECTION("More frames than fit in the chunk") {
+        const uint32_t nrOfFrames = 3;
+        writeCorrupted(fileHeaderSize + 8, &nrOfFrames, sizeof(nrOfFrames));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+    SECTION("Uncompressed size different from stored size") {
+        const uint64_t uncompressedSize = 4*frameSize;
+        writeCorrupted(fileHeaderSize + 16, &uncompressedSize, sizeof(uncompressedSize));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+}
+
+TEST_CASE("Stream recording with a corrupt index or image header is rejected", "[fast][StreamRecording]") {
+    std::string filename = getRecordingFilename("corruptindex");
+    {
+        // Two frames in each chunk
+        StreamRecordingWriter writer(filename, StreamRecordingCompression::NONE, 8000);
+        for(int i = 0; i < 4; ++i)
+            writer.addFrame(createFrame(i));
+    }
+    std::vector<char> data;
+    {
+        std::ifstream file(filename, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    auto writeCorrupted = [&](std::size_t offset, const void* value, std::size_t size) {
+        std::vector<char> corrupted = data;
+        std::memcpy(corrupted.data() + offset, value, size);
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write(corrupted.data(), corrupted.size());
+    };
+    const std::size_t fileHeaderSize = 16;
+    const std::size_t chunkHeaderSize = 32;
+    const std::size_t frameSize = 64*32*2 + 120;
+    // Index entries of chunk offset, frame offset, frame size and timestamp, followed by the trailer
+    const std::size_t indexEntriesOffset = data.size() - 16 - 4*32;
+
+    SECTION("Chunk offset outside the file") {
+        const uint64_t chunkOffset = data.size() + 1000;
+        writeCorrupted(indexEntriesOffset + 32, &chunkOffset, sizeof(chunkOffset));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+    SECTION("Frame offset outside the chunk") {
+        const uint64_t frameOffset = 0xFFFFFFFFFFFFFF00ull;
+        writeCorrupted(indexEntriesOffset + 32 + 8, &frameOffset, sizeof(frameOffset));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+    SECTION("Frame size larger than the chunk") {
+        const uint64_t size = 3*frameSize;
+        writeCorrupted(indexEntriesOffset + 16, &size, sizeof(size));
+        CHECK_THROWS(StreamRecordingReader{filename});
+    }
+    SECTION("Image size different from data size") {
+        // Width of the first frame
+        const uint32_t width = 65;
+        writeCorrupted(fileHeaderSize + chunkHeaderSize + 80, &width, sizeof(width));
+        StreamRecordingReader reader(filename);
+        CHECK_THROWS(reader.getFrame(0));
+        checkFrame(reader.getFrame(1), 1);
+    }
+}
+
+TEST_CASE("StreamRecordingExporter and StreamRecordingStreamer", "[fast][StreamRecording]") {
+    std::string filename = getRecordingFilename("exporter");
+    auto exporter = StreamRecordingExporter::New();
+    exporter->setFilename(filename);
+    exporter->setChunkSize(20000);
+    for(int i = 0; i < 20; ++i) {
+        auto frame = createFrame(i);
+        if(i == 19)
+            frame->setLastFrame("test");
+        exporter->setInputData(frame);
+        exporter->update();
+    }
+    CHECK(exporter->getFrameCounter() == 20);
+    CHECK(exporter->getBytesWritten() > 0);
+
+    auto streamer = StreamRecordingStreamer::New();
+    streamer->setFilename(filename);
+    streamer->setUseTimestamp(false);
+    streamer->setPrefetchFrames(3);
+    CHECK(streamer->getNrOfFrames() == 20);
+    auto port = streamer->getOutputPort();
+    streamer->update();
+    int frameNr = 0;
+    while(true) {
+        auto frame = port->getNextFrame();
+        checkFrame(frame, frameNr);
+        ++frameNr;
+        if(frame->isLastFrame())
+            break;
+    }
+    CHECK(frameNr == 20);
+    CHECK_THROWS_AS(streamer->seek(20), OutOfBoundsException);
+    // Wait for the streamer thread to finish
+    streamer->stop();
+}
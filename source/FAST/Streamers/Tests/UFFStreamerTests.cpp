@@ -0,0 +1,160 @@
+#include "FAST/Testing.hpp"
+#include "FAST/Streamers/UFFStreamer.hpp"
+#include "FAST/Data/Image.hpp"
+#include <chrono>
+#define H5_BUILT_AS_DYNAMIC_LIB
+#include <H5Cpp.h>
+
+using namespace fast;
+
+static void writeStringAttribute(H5::Group& group, std::string name, std::string value) {
+    H5::StrType type(H5::PredType::C_S1, value.size());
+    auto attribute = group.createAttribute(name, type, H5::DataSpace(H5S_SCALAR));
+    attribute.write(type, value);
+}
+
+static void writeAxis(H5::Group& group, std::string name, int size, float step) {
+    hsize_t dims[2] = {1, (hsize_t)size};
+    auto dataset = group.createDataSet(name, H5::PredType::NATIVE_FLOAT, H5::DataSpace(2, dims));
+    std::vector<float> axis(size);
+    for(int i = 0; i < size; ++i)
+        axis[i] = i*step;
+    dataset.write(axis.data(), H5::PredType::NATIVE_FLOAT);
+}
+
+/**
+ * IQ sample of a frame, stored in column major order as in UFF files
+ */
+static void getIQSample(int frameNr, int x, int y, float& real, float& imag) {
+    real = (float)((x*7 + y*3 + frameNr) % 101) + 0.5f;
+    imag = (float)((x*5 + y*11 + frameNr*2) % 89) - 40.0f;
+}
+
+/**
+ * Create a UFF file with beamformed IQ data
+ */
+static std::string createUFFFile(std::string name, int width, int height, int frames) {
+    createDirectories(Config::getTestDataPath() + "temp/UFFStreamerTest");
+    std::string filename = Config::getTestDataPath() + "temp/UFFStreamerTest/" + name + ".uff";
+    H5::H5File file(filename, H5F_ACC_TRUNC);
+    auto group = file.createGroup("beamformed_data");
+    writeStringAttribute(group, "class", "uff.beamformed_data");
+    auto scanGroup = group.createGroup("scan");
+    writeStringAttribute(scanGroup, "class", "uff.linear_scan");
+    writeAxis(scanGroup, "x_axis", width, 0.0003f);
+    writeAxis(scanGroup, "z_axis", height, 0.0001f);
+
+    auto dataGroup = group.createGroup("data");
+    hsize_t dims[4] = {(hsize_t)frames, 1, 1, (hsize_t)(width*height)};
+    H5::DataSpace dataspace(4, dims);
+    auto realDataset = dataGroup.createDataSet("real", H5::PredType::NATIVE_FLOAT, dataspace);
+    auto imagDataset = dataGroup.createDataSet("imag", H5::PredType::NATIVE_FLOAT, dataspace);
+    std::vector<float> real((std::size_t)frames*width*height);
+    std::vector<float> imag(real.size());
+    for(int frameNr = 0; frameNr < frames; ++frameNr) {
+        for(int x = 0; x < width; ++x) {
+            for(int y = 0; y < height; ++y) {
+                const std::size_t pos = (std::size_t)frameNr*width*height + y + x*height;
+                getIQSample(frameNr, x, y, real[pos], imag[pos]);
+            }
+        }
+    }
+    realDataset.write(real.data(), H5::PredType::NATIVE_FLOAT);
+    imagDataset.write(imag.data(), H5::PredType::NATIVE_FLOAT);
+    return filename;
+}
+
+static std::vector<Image::pointer> streamAllFrames(UFFStreamer::pointer streamer) {
+    std::vector<Image::pointer> frames;
+    auto port = streamer->getOutputPort();
+    streamer->update();
+    while(true) {
+        auto image = port->getNextFrame<Image>();
+        frames.push_back(image);
+        if(image->isLastFrame())
+            break;
+    }
+    // Wait for the streamer thread to finish
+    streamer->stop();
+    return frames;
+}
+
+TEST_CASE("UFFStreamer envelope detection of IQ data", "[fast][UFFStreamer]") {
+    const int width = 70;
+    const int height = 130;
+    auto streamer = UFFStreamer::New();
+    streamer->setFilename(createUFFFile("envelope", width, height, 3));
+    auto frames = streamAllFrames(streamer);
+    REQUIRE(frames.size() == 3);
+    for(int frameNr = 0; frameNr < 3; ++frameNr) {
+        auto image = frames[frameNr];
+        REQUIRE(image->getWidth() == width);
+        REQUIRE(image->getHeight() == height);
+        REQUIRE(image->getDataType() == TYPE_FLOAT);
+        auto access = image->getImageAccess(ACCESS_READ);
+        auto data = (float*)access->get();
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                float real, imag;
+                getIQSample(frameNr, x, y, real, imag);
+                REQUIRE(data[x + y*width] == Approx(std::sqrt(real*real + imag*imag)));
+            }
+        }
+    }
+}
+
+TEST_CASE("UFFStreamer log compression of IQ data", "[fast][UFFStreamer]") {
+    const int width = 70;
+    const int height = 130;
+    const float dynamicRange = 40.0f;
+    const float gain = 5.0f;
+    auto streamer = UFFStreamer::New();
+    streamer->setFilename(createUFFFile("logcompression", width, height, 2));
+    streamer->setLogCompression(true);
+    streamer->setDynamicRange(dynamicRange);
+    streamer->setGain(gain);
+    auto frames = streamAllFrames(streamer);
+    REQUIRE(frames.size() == 2);
+    for(int frameNr = 0; frameNr < 2; ++frameNr) {
+        auto image = frames[frameNr];
+        REQUIRE(image->getDataType() == TYPE_UINT8);
+        CHECK(image->getSpacing().x() == Approx(0.3f));
+        CHECK(image->getSpacing().y() == Approx(0.1f));
+
+        float maximum = 0.0f;
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                float real, imag;
+                getIQSample(frameNr, x, y, real, imag);
+                maximum = std::max(maximum, std::sqrt(real*real + imag*imag));
+            }
+        }
+        auto access = image->getImageAccess(ACCESS_READ);
+        auto data = (uchar*)access->get();
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                float real, imag;
+                getIQSample(frameNr, x, y, real, imag);
+                const float decibels = 20.0f*std::log10(std::sqrt(real*real + imag*imag) / maximum);
+                const float expected = std::min(std::max((decibels + dynamicRange + gain)*255.0f/dynamicRange, 0.0f), 255.0f);
+                REQUIRE(std::abs((float)data[x + y*width] - expected) <= 1.0f);
+            }
+        }
+    }
+}
+
+TEST_CASE("UFFStreamer benchmark", "[fast][UFFStreamer][benchmark][.]") {
+    const int frameCount = 30;
+    std::string filename = createUFFFile("benchmark", 256, 2048, frameCount);
+    for(bool logCompression : {false, true}) {
+        auto streamer = UFFStreamer::New();
+        streamer->setFilename(filename);
+        streamer->setLogCompression(logCompression);
+        auto start = std::chrono::high_resolution_clock::now();
+        auto frames = streamAllFrames(streamer);
+        std::chrono::duration<double> runtime = std::chrono::high_resolution_clock::now() - start;
+        CHECK(frames.size() == frameCount);
+        std::cout << "UFFStreamer " << (logCompression ? "with" : "without") << " log compression: " <<
+            frameCount / runtime.count() << " frames/s" << std::endl;
+    }
+}
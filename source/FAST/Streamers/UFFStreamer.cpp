@@ -1,5 +1,7 @@
 #include "UFFStreamer.hpp"
 #include <FAST/Data/Image.hpp>
+#include <future>
+#include <limits>
 #define H5_BUILT_AS_DYNAMIC_LIB
 #include <H5Cpp.h>
 
@@ -12,12 +14,18 @@ namespace fast {
         createStringAttribute("filename", "Filename", "File to stream UFF data from", "");
         createStringAttribute("name", "Group name", "Name of which beamformed_data group to stream from", "");
         createBooleanAttribute("loop", "Loop", "Loop recordin", false);
+        createBooleanAttribute("log-compression", "Log compression", "Log compress IQ data to UINT8 images", false);
+        createFloatAttribute("dynamic-range", "Dynamic range", "Dynamic range in dB of log compressed images", 60.0f);
+        createFloatAttribute("gain", "Gain", "Gain in dB of log compressed images", 0.0f);
     }
 
     void UFFStreamer::loadAttributes() {
         setFilename(getStringAttribute("filename"));
         setLooping(getBooleanAttribute("loop"));
         setName(getStringAttribute("name"));
+        setLogCompression(getBooleanAttribute("log-compression"));
+        setDynamicRange(getFloatAttribute("dynamic-range"));
+        setGain(getFloatAttribute("gain"));
     }
 
     void UFFStreamer::setLooping(bool loop) {
@@ -34,6 +42,80 @@ namespace fast {
         setModified(true);
     }
 
+    UFFStreamer::~UFFStreamer() {
+        stop();
+    }
+
+    void UFFStreamer::setLogCompression(bool enable) {
+        m_logCompression = enable;
+    }
+
+    void UFFStreamer::setDynamicRange(float dynamicRange) {
+        if(dynamicRange <= 0)
+            throw Exception("Dynamic range must be > 0 in UFFStreamer");
+        m_dynamicRange = dynamicRange;
+    }
+
+    void UFFStreamer::setGain(float gain) {
+        m_gain = gain;
+    }
+
+    /**
+     * Envelope detection of IQ data stored in column major order. The envelope, or the envelope in dB if
+     * logarithmic is true, is stored in row major order in output. The data is processed in tiles, so that both
+     * the input and output of a tile stay in cache while transposing.
+     * @return maximum output value
+     */
+    static float detectEnvelope(const float* real, const float* imag, int width, int height, bool logarithmic, float* output) {
+        const int tileSize = 64;
+        const int tilesX = (width + tileSize - 1) / tileSize;
+        const int tilesY = (height + tileSize - 1) / tileSize;
+        float maximum = std::numeric_limits<float>::lowest();
+        #pragma omp parallel
+        {
+            float threadMaximum = std::numeric_limits<float>::lowest();
+            #pragma omp for
+            for(int tile = 0; tile < tilesX*tilesY; ++tile) {
+                const int startX = (tile % tilesX)*tileSize;
+                const int startY = (tile / tilesX)*tileSize;
+                const int endX = std::min(startX + tileSize, width);
+                const int endY = std::min(startY + tileSize, height);
+                for(int x = startX; x < endX; ++x) {
+                    const float* re = &real[x*height];
+                    const float* im = &imag[x*height];
+                    if(logarithmic) {
+                        // 20*log10(sqrt(power)) = 10*log10(power). Tiny offset avoids log of 0.
+                        for(int y = startY; y < endY; ++y) {
+                            const float value = 10.0f*std::log10(re[y]*re[y] + im[y]*im[y] + 1e-30f);
+                            output[x + y*width] = value;
+                            threadMaximum = std::max(threadMaximum, value);
+                        }
+                    } else {
+                        for(int y = startY; y < endY; ++y) {
+                            const float value = std::sqrt(re[y]*re[y] + im[y]*im[y]);
+                            output[x + y*width] = value;
+                            threadMaximum = std::max(threadMaximum, value);
+                        }
+                    }
+                }
+            }
+            #pragma omp critical
+            maximum = std::max(maximum, threadMaximum);
+        }
+        return maximum;
+    }
+
+    /**
+     * Map dB values to UINT8, with the maximum value plus gain as 255 and dynamic range dB below as 0
+     */
+    static void compressDynamicRange(const float* decibels, std::size_t size, float maximum, float dynamicRange, float gain, uchar* output) {
+        const float scale = 255.0f / dynamicRange;
+        const float offset = dynamicRange - maximum + gain;
+        #pragma omp parallel for
+        for(int64_t i = 0; i < (int64_t)size; ++i)
+            output[i] = (uchar)std::min(std::max((decibels[i] + offset)*scale, 0.0f), 255.0f);
+    }
+
     static std::string readStringAttribute(const H5::Attribute& att) {        
         std::string result;
         att.read(att.getDataType(), result);
@@ -171,42 +253,61 @@ namespace fast {
 
             H5::DataSpace memspace(4, blockSize);
 
-            while (true) {
-                for (int frameNr = 0; frameNr < frameCount; ++frameNr) {
-                    reportInfo() << "Extracting frame " << frameNr << " in UFF file" << reportEnd();
-                    // Extract 1 frame
-                    auto imaginary = std::make_unique<float[]>(width * height);
-                    auto real = std::make_unique<float[]>(width * height);
-                    offset[0] = frameNr;
-                    imagDataspace.selectHyperslab(H5S_SELECT_SET, count, offset, NULL, blockSize);
-                    imagDataset.read(imaginary.get(), H5::PredType::NATIVE_FLOAT, memspace, imagDataspace);
-                    realDataspace.selectHyperslab(H5S_SELECT_SET, count, offset, NULL, blockSize);
-                    realDataset.read(real.get(), H5::PredType::NATIVE_FLOAT, memspace, realDataspace);
-
-                    // TODO start env
-                    auto image_data = std::make_unique<float[]>(width * height);
-                    for (int y = 0; y < height; ++y) {
-                        for (int x = 0; x < width; ++x) {
+            struct IQFrame {
+                std::unique_ptr<float[]> real;
+                std::unique_ptr<float[]> imaginary;
+            };
+            // Only one frame is read at a time, thus HDF5 is never used by more than one thread
+            auto readFrame = [&](int frameNr) {
+                reportInfo() << "Extracting frame " << frameNr << " in UFF file" << reportEnd();
+                IQFrame frame;
+                frame.imaginary = make_uninitialized_unique<float[]>(width * height);
+                frame.real = make_uninitialized_unique<float[]>(width * height);
+                offset[0] = frameNr;
+                imagDataspace.selectHyperslab(H5S_SELECT_SET, count, offset, NULL, blockSize);
+                imagDataset.read(frame.imaginary.get(), H5::PredType::NATIVE_FLOAT, memspace, imagDataspace);
+                realDataspace.selectHyperslab(H5S_SELECT_SET, count, offset, NULL, blockSize);
+                realDataset.read(frame.real.get(), H5::PredType::NATIVE_FLOAT, memspace, realDataspace);
+                return frame;
+            };
+
+            // Read the next frame while the current frame is processed
+            auto nextFrame = std::async(std::launch::async, readFrame, 0);
+            int frameNr = 0;
+            while(nextFrame.valid()) {
+                {
+                    std::unique_lock<std::mutex> lock(m_stopMutex);
+                    if(m_stop)
+                        break;
+                }
+                IQFrame frame = nextFrame.get();
+                if(frameNr + 1 < frameCount) {
+                    nextFrame = std::async(std::launch::async, readFrame, frameNr + 1);
+                    ++frameNr;
+                } else if(m_loop) {
+                    nextFrame = std::async(std::launch::async, readFrame, 0);
+                    frameNr = 0;
+                }
 
-                            int pos = y + x * height;
-                            image_data[x + y * width] = std::sqrt(imaginary[pos] * imaginary[pos] + real[pos] * real[pos]);
-                        }
-                    }
-                    // TODO end env
-                    auto image = Image::New();
-                    image->create(width, height, DataType::TYPE_FLOAT, 1, std::move(image_data));
-                    //image->setSpacing(spacing);
-                    //std::cout << image->calculateMaximumIntensity() << " " << image->calculateMinimumIntensity() << std::endl;
+                auto envelope = make_uninitialized_unique<float[]>(width * height);
+                const float maximum = detectEnvelope(frame.real.get(), frame.imaginary.get(), width, height, m_logCompression, envelope.get());
+                auto image = Image::New();
+                if(m_logCompression) {
+                    auto image_data = make_uninitialized_unique<uchar[]>(width * height);
+                    compressDynamicRange(envelope.get(), width * height, maximum, m_dynamicRange, m_gain, image_data.get());
+                    image->create(width, height, DataType::TYPE_UINT8, 1, std::move(image_data));
+                } else {
+                    image->create(width, height, DataType::TYPE_FLOAT, 1, std::move(envelope));
+                }
+                image->setSpacing(spacing);
+                if(!nextFrame.valid())
+                    image->setLastFrame(getNameOfClass());
 
-                    try {
-                        addOutputData(0, image);
-                        frameAdded();
-                    }
-                    catch (ThreadStopped & e) {
-                        break;
-                    }
+                try {
+                    addOutputData(0, image);
+                    frameAdded();
                 }
-                if (!m_loop) {
+                catch (ThreadStopped & e) {
                     break;
                 }
             }
@@ -4,6 +4,12 @@
 
 namespace fast {
 
+/**
+ * Streams beamformed images from an ultrasound file format (UFF) file.
+ *
+ * For IQ data, envelope detection, conversion from column major to row major order and optional log compression
+ * are done in a single multi-threaded pass, while the next frame is read from the file in the background.
+ */
 class FAST_EXPORT UFFStreamer : public Streamer {
 	FAST_OBJECT(UFFStreamer)
 public:
@@ -13,11 +19,30 @@ public:
 	void setLooping(bool loop);
 	// Set name of which HDF5 group to stream
 	void setName(std::string name);
+	/**
+	 * Log compress IQ data, and output UINT8 images instead of the float envelope. Default false.
+	 * @param enable
+	 */
+	void setLogCompression(bool enable);
+	/**
+	 * Set dynamic range in dB of log compressed images. Default is 60 dB.
+	 * @param dynamicRange
+	 */
+	void setDynamicRange(float dynamicRange);
+	/**
+	 * Set gain in dB of log compressed images. Default is 0 dB.
+	 * @param gain
+	 */
+	void setGain(float gain);
 	void loadAttributes() override;
+	~UFFStreamer() override;
 protected:
 	void generateStream() override;
 	std::string m_filename;
 	std::string m_name;
 	bool m_loop;
+	bool m_logCompression = false;
+	float m_dynamicRange = 60.0f;
+	float m_gain = 0.0f;
 };
 }
\ No newline at end of file
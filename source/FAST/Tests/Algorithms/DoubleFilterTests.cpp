@@ -2,6 +2,9 @@
 #include "FAST/Importers/ImageFileImporter.hpp"
 #include "DoubleFilter.hpp"
 #include "FAST/Data/Image.hpp"
+#include "FAST/DeviceManager.hpp"
+#include <thread>
+#include <chrono>
 
 using namespace fast;
 
@@ -64,3 +67,88 @@ TEST_CASE("DoubleFilter on Host", "[fast][DoubleFilter]") {
     }
     CHECK(success == true);
 }
+
+/**
+ * Double the input with one DoubleFilter, and then double its output with a branch of DoubleFilters for each
+ * branch length. Each branch is updated by its own thread, and the branches only share the output of the first filter.
+ * @return output of each branch
+ */
+static std::vector<Image::pointer> doubleInBranches(OpenCLDevice::pointer device, Image::pointer input, std::vector<int> branchLengths) {
+    auto first = DoubleFilter::New();
+    first->setMainDevice(device);
+    first->setInputData(input);
+    auto firstOutput = first->updateAndGetOutputData<Image>();
+
+    std::vector<Image::pointer> results(branchLengths.size());
+    std::vector<std::thread> threads;
+    for(int branch = 0; branch < branchLengths.size(); ++branch) {
+        std::vector<DoubleFilter::pointer> filters;
+        for(int i = 0; i < branchLengths[branch]; ++i) {
+            auto filter = DoubleFilter::New();
+            filter->setMainDevice(device);
+            if(i == 0) {
+                filter->setInputData(firstOutput);
+            } else {
+                filter->setInputConnection(filters.back()->getOutputPort());
+            }
+            filters.push_back(filter);
+        }
+        threads.emplace_back([&results, branch, filters]() {
+            results[branch] = filters.back()->updateAndGetOutputData<Image>();
+        });
+    }
+    for(auto&& thread : threads)
+        thread.join();
+    return results;
+}
+
+static Image::pointer createConstantImage(int size, float value) {
+    auto data = std::make_unique<float[]>(size*size);
+    std::fill(data.get(), data.get() + size*size, value);
+    auto image = Image::New();
+    image->create(size, size, TYPE_FLOAT, 1, std::move(data));
+    return image;
+}
+
+TEST_CASE("DoubleFilters on separate command queues wait for the data of each other", "[fast][DoubleFilter]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    device->setMultiQueueMode(true);
+    const int size = 1024;
+    // The branches run at the same time on their own queues, and read the output of the first filter, which was
+    // written on another queue. The host reads of the results must wait for the queues of the branches.
+    auto results = doubleInBranches(device, createConstantImage(size, 1.0f), {4, 3});
+    device->setMultiQueueMode(false);
+
+    const std::vector<float> expected = {32.0f, 16.0f};
+    for(int branch = 0; branch < 2; ++branch) {
+        auto access = results[branch]->getImageAccess(ACCESS_READ);
+        const float* data = (const float*)access->get();
+        int wrong = 0;
+        for(int i = 0; i < size*size; ++i) {
+            if(data[i] != expected[branch])
+                ++wrong;
+        }
+        CHECK(wrong == 0);
+    }
+}
+
+TEST_CASE("Benchmark DoubleFilter branches on one and on separate command queues", "[fast][DoubleFilter][benchmark][.]") {
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    auto input = createConstantImage(4096, 1.0f);
+    for(bool multiQueue : {false, true}) {
+        device->setMultiQueueMode(multiQueue);
+        // Warm up, so that program compilation and memory allocation is not measured
+        doubleInBranches(device, input, {2, 2});
+        const int repeats = 10;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int i = 0; i < repeats; ++i) {
+            auto results = doubleInBranches(device, input, {8, 8, 8, 8});
+            // Wait for all branches
+            for(auto&& result : results)
+                result->getImageAccess(ACCESS_READ);
+        }
+        std::chrono::duration<double, std::milli> runtime = std::chrono::high_resolution_clock::now() - start;
+        std::cout << (multiQueue ? "Separate command queues: " : "One command queue: ") << runtime.count() / repeats << " ms per pipeline" << std::endl;
+    }
+    device->setMultiQueueMode(false);
+}
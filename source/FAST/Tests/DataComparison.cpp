@@ -49,6 +49,23 @@ void* allocateRandomData(unsigned int nrOfVoxels, DataType type) {
         return (void*)data;
     }
         break;
+    case TYPE_UNORM_INT16:
+    {
+        // Full range, to check that no values are lost when normalized
+        ushort* data = new ushort[nrOfVoxels];
+        for(unsigned int i = 0; i < nrOfVoxels; i++)
+            data[i] = rand() % 65536;
+        return (void*)data;
+    }
+        break;
+    case TYPE_SNORM_INT16:
+    {
+        short* data = new short[nrOfVoxels];
+        for(unsigned int i = 0; i < nrOfVoxels; i++)
+            data[i] = rand() % 65536 - 32768;
+        return (void*)data;
+    }
+        break;
     }
     return NULL;
 }
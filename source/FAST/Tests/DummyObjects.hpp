@@ -6,6 +6,7 @@
 #include "FAST/Streamers/Streamer.hpp"
 #include <unordered_map>
 #include <thread>
+#include <atomic>
 
 namespace fast {
 
@@ -45,18 +46,32 @@ class DummyProcessObject : public ProcessObject {
         bool hasExecuted() { return mHasExecuted; };
         void setHasExecuted(bool value) { mHasExecuted = value; };
         void updateDataTimestamp() { getOutputData<DummyDataObject>(0)->updateModifiedTimestamp(); };
+        void setSleepTime(uint milliseconds) { mSleepTime = milliseconds; };
+        // Number of DummyProcessObjects executing right now, and the largest number seen at the same time
+        inline static std::atomic<int> executing{0};
+        inline static std::atomic<int> maxExecuting{0};
     private:
         DummyProcessObject() : mHasExecuted(false) {
             createInputPort<DummyDataObject>(0);
             createOutputPort<DummyDataObject>(0);
         };
         void execute() {
+            const int running = ++executing;
+            // Decrement the counter also when execute throws, e.g. on missing input
+            struct ExecutingGuard {
+                ~ExecutingGuard() { --executing; }
+            } guard;
+            int max = maxExecuting;
+            while(running > max && !maxExecuting.compare_exchange_weak(max, running));
             mHasExecuted = true;
             DummyDataObject::pointer input = getInputData<DummyDataObject>(0);
             DummyDataObject::pointer output = getOutputData<DummyDataObject>(0);
+            if(mSleepTime > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(mSleepTime));
             output->create(input->getID());
         };
         bool mHasExecuted;
+        uint mSleepTime = 0;
 };
 
 
@@ -72,6 +87,21 @@ class DummyProcessObject2 : public ProcessObject {
 
 };
 
+// Sink which stores the ID of every data object it receives
+class DummyFrameCollector : public ProcessObject {
+    FAST_OBJECT(DummyFrameCollector)
+    public:
+        std::vector<uint> getIDs() const { return mIDs; };
+    private:
+        DummyFrameCollector() {
+            createInputPort<DummyDataObject>(0);
+        };
+        void execute() {
+            mIDs.push_back(getInputData<DummyDataObject>(0)->getID());
+        };
+        std::vector<uint> mIDs;
+};
+
 class DummyStreamer : public Streamer {
     FAST_OBJECT(DummyStreamer)
     public:
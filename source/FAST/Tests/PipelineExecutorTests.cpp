@@ -0,0 +1,105 @@
+#include <FAST/Testing.hpp>
+#include <FAST/PipelineExecutor.hpp>
+#include "DummyObjects.hpp"
+
+using namespace fast;
+
+TEST_CASE("Pipeline executor processes all frames of a stream in order", "[fast][PipelineExecutor]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    const int frames = 20;
+    auto streamer = DummyStreamer::New();
+    streamer->setSleepTime(5);
+    streamer->setTotalFrames(frames);
+
+    auto po1 = DummyProcessObject::New();
+    po1->setInputConnection(streamer->getOutputPort());
+
+    auto po2 = DummyProcessObject::New();
+    po2->setInputConnection(po1->getOutputPort());
+
+    auto collector = DummyFrameCollector::New();
+    collector->setInputConnection(po2->getOutputPort());
+
+    auto executor = PipelineExecutor::New();
+    executor->addProcessObject(collector);
+    executor->start();
+    executor->join();
+    CHECK(!executor->isRunning());
+
+    auto IDs = collector->getIDs();
+    REQUIRE(IDs.size() == frames);
+    for(int i = 0; i < frames; ++i)
+        CHECK(IDs[i] == i);
+}
+
+TEST_CASE("Pipeline executor overlaps stages on consecutive frames", "[fast][PipelineExecutor]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    const int frames = 10;
+    auto streamer = DummyStreamer::New();
+    streamer->setSleepTime(1);
+    streamer->setTotalFrames(frames);
+
+    // Stages slower than the streamer, thus the second stage processes frame k while the first processes frame k+1
+    auto po1 = DummyProcessObject::New();
+    po1->setInputConnection(streamer->getOutputPort());
+    po1->setSleepTime(20);
+
+    auto po2 = DummyProcessObject::New();
+    po2->setInputConnection(po1->getOutputPort());
+    po2->setSleepTime(20);
+
+    auto collector = DummyFrameCollector::New();
+    collector->setInputConnection(po2->getOutputPort());
+
+    DummyProcessObject::executing = 0;
+    DummyProcessObject::maxExecuting = 0;
+    auto executor = PipelineExecutor::New();
+    executor->addProcessObject(collector);
+    executor->start();
+    executor->join();
+
+    auto IDs = collector->getIDs();
+    REQUIRE(IDs.size() == frames);
+    for(int i = 0; i < frames; ++i)
+        CHECK(IDs[i] == i);
+    CHECK(DummyProcessObject::maxExecuting == 2);
+}
+
+TEST_CASE("Pipeline executor with one static and one streamed input", "[fast][PipelineExecutor]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    const int frames = 10;
+    auto streamer = DummyStreamer::New();
+    streamer->setSleepTime(5);
+    streamer->setTotalFrames(frames);
+
+    auto importer = DummyImporter::New();
+
+    auto po = DummyProcessObject2::New();
+    po->setInputConnection(0, streamer->getOutputPort());
+    po->setInputConnection(1, importer->getOutputPort());
+
+    auto collector = DummyFrameCollector::New();
+    collector->setInputConnection(po->getOutputPort());
+
+    auto executor = PipelineExecutor::New();
+    executor->setNumberOfThreads(2);
+    executor->addProcessObject(collector);
+    executor->start();
+    executor->join();
+
+    auto IDs = collector->getIDs();
+    REQUIRE(IDs.size() == frames);
+    for(int i = 0; i < frames; ++i)
+        CHECK(IDs[i] == i);
+    CHECK(po->getStaticDataID() == 0);
+}
+
+TEST_CASE("Pipeline executor rethrows exceptions from process objects", "[fast][PipelineExecutor]") {
+    auto po = DummyProcessObject::New();
+    po->setIsModified(); // Missing input will throw in execute
+
+    auto executor = PipelineExecutor::New();
+    executor->addProcessObject(po);
+    executor->start();
+    CHECK_THROWS(executor->join());
+}
@@ -1,5 +1,9 @@
 #include "catch.hpp"
 #include "DummyObjects.hpp"
+#include <FAST/DataChannels/RingBufferDataChannel.hpp>
+#include <FAST/RuntimeTracer.hpp>
+#include <FAST/DeviceManager.hpp>
+#include <thread>
 
 namespace fast {
 
@@ -579,4 +583,152 @@ TEST_CASE("Trying to set input connection to self throws exception", "[ProcessOb
     CHECK_THROWS(po->setInputConnection(po->getOutputPort()));
 }
 
+TEST_CASE("Simple pipeline with stream through ring buffer data channel", "[ProcessObject][fast][RingBufferDataChannel]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    auto streamer = DummyStreamer::New();
+    streamer->setSleepTime(10);
+    streamer->setTotalFrames(20);
+
+    auto po = DummyProcessObject::New();
+    auto streamerPort = streamer->getOutputPort(0, DataChannelType::RingBuffer);
+    CHECK(std::dynamic_pointer_cast<RingBufferDataChannel>(streamerPort));
+    po->setInputConnection(streamerPort);
+
+    auto port = po->getOutputPort(0, DataChannelType::RingBuffer);
+    port->setMaximumNumberOfFrames(1);
+
+    bool lastFrame = false;
+    int timestep = 0;
+    while(!lastFrame) {
+        po->update();
+        auto image = port->getNextFrame<DummyDataObject>();
+        lastFrame = image->isLastFrame();
+        CHECK(image->getID() == timestep);
+        timestep++;
+    }
+    CHECK(timestep == 20);
+    CHECK(streamerPort->getStatistics().framesRetrieved == 20);
+    CHECK(port->getStatistics().framesAdded == 20);
+    CHECK(port->getStatistics().framesRetrieved == 20);
+}
+
+TEST_CASE("Ring buffer data channel records occupancy and blocking", "[ProcessObject][fast][RingBufferDataChannel]") {
+    auto channel = RingBufferDataChannel::New();
+    channel->setMaximumNumberOfFrames(3);
+
+    // Slow consumer: the producer fills the channel and has to wait
+    std::thread producer([channel]() {
+        for(int i = 0; i < 10; ++i) {
+            auto data = DummyDataObject::New();
+            data->create(i);
+            channel->addFrame(data);
+        }
+    });
+    for(int i = 0; i < 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CHECK(channel->getNextFrame<DummyDataObject>()->getID() == i);
+    }
+    producer.join();
+    CHECK(channel->getSize() == 0);
+
+    auto statistics = channel->getStatistics();
+    CHECK(statistics.framesAdded == 10);
+    CHECK(statistics.framesRetrieved == 10);
+    CHECK(statistics.maxOccupancy == 3);
+    CHECK(statistics.meanOccupancy > 1.0f);
+    CHECK(statistics.meanOccupancy <= 3.0f);
+    CHECK(statistics.producerBlockTime > 0);
+
+    // Slow producer: the consumer has to wait
+    channel->resetStatistics();
+    std::thread producer2([channel]() {
+        for(int i = 0; i < 5; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            auto data = DummyDataObject::New();
+            data->create(i);
+            channel->addFrame(data);
+        }
+    });
+    for(int i = 0; i < 5; ++i)
+        CHECK(channel->getNextFrame<DummyDataObject>()->getID() == i);
+    producer2.join();
+    statistics = channel->getStatistics();
+    CHECK(statistics.maxOccupancy == 1);
+    CHECK(statistics.producerBlockTime == 0);
+    CHECK(statistics.consumerWaitTime > 10);
+
+    // Timed wait on an empty channel times out
+    CHECK(channel->getNextFrame<DummyDataObject>(std::chrono::milliseconds(1)) == nullptr);
+}
+
+TEST_CASE("Stopping ring buffer data channel unblocks consumer", "[ProcessObject][fast][RingBufferDataChannel]") {
+    auto channel = RingBufferDataChannel::New();
+    std::thread stopper([channel]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        channel->stop();
+    });
+    CHECK_THROWS_AS(channel->getNextFrame(), ThreadStopped);
+    stopper.join();
+}
+
+TEST_CASE("Runtime tracer records spans of executes and timers", "[ProcessObject][fast][RuntimeTracer]") {
+    Config::setStreamingMode(STREAMING_MODE_PROCESS_ALL_FRAMES);
+    RuntimeTracer::clear();
+    auto streamer = DummyStreamer::New();
+    streamer->setSleepTime(1);
+    streamer->setTotalFrames(5);
+
+    auto po = DummyProcessObject::New();
+    po->setInputConnection(streamer->getOutputPort());
+    auto port = po->getOutputPort();
+
+    // Nothing is recorded while tracing is disabled
+    po->update();
+    port->getNextFrame();
+    CHECK(RuntimeTracer::getNumberOfSpans() == 0);
+
+    RuntimeTracer::enable();
+    for(int i = 1; i < 5; ++i) {
+        po->update();
+        port->getNextFrame();
+    }
+    auto manager = po->getAllRuntimes();
+    manager->startRegularTimer("custom timer");
+    manager->stopRegularTimer("custom timer");
+    RuntimeTracer::disable();
+
+    CHECK(RuntimeTracer::getNumberOfSpans() >= 5);
+    // The runtime manager itself is not enabled, so no runtimes are aggregated
+    CHECK(po->getRuntime()->getSamples() == 0);
+
+    const std::string trace = RuntimeTracer::getChromeTrace();
+    CHECK(trace.find("\"traceEvents\"") != std::string::npos);
+    CHECK(trace.find("\"name\":\"DummyProcessObject\",\"cat\":\"execute\"") != std::string::npos);
+    CHECK(trace.find("\"name\":\"custom timer\",\"cat\":\"timer\"") != std::string::npos);
+
+    RuntimeTracer::clear();
+    CHECK(RuntimeTracer::getNumberOfSpans() == 0);
+}
+
+TEST_CASE("Runtime tracer records OpenCL timers on queues without profiling", "[ProcessObject][fast][RuntimeTracer]") {
+    RuntimeTracer::clear();
+    auto device = DeviceManager::getInstance()->getOneOpenCLDevice();
+    // Tracing is often enabled after the OpenCL context was created, and then queues have no profiling
+    cl::CommandQueue queue(device->getContext(), device->getDevice());
+    auto manager = RuntimeMeasurementsManager::New();
+
+    RuntimeTracer::enable();
+    CHECK_NOTHROW(manager->startCLTimer("kernel", queue));
+    CHECK_NOTHROW(manager->stopCLTimer("kernel", queue));
+    RuntimeTracer::disable();
+
+    CHECK(RuntimeTracer::getNumberOfSpans() == 1);
+    CHECK(RuntimeTracer::getChromeTrace().find("\"name\":\"kernel\",\"cat\":\"OpenCL\"") != std::string::npos);
+    RuntimeTracer::clear();
+
+    // Runtime measurements still need profiling
+    manager->enable();
+    CHECK_THROWS(manager->startCLTimer("kernel", queue));
+}
+
 }
@@ -1,6 +1,8 @@
 #include "ComputationThread.hpp"
 #include "SimpleWindow.hpp"
 #include "View.hpp"
+#include "FAST/PipelineExecutor.hpp"
+#include "FAST/Config.hpp"
 #include <QGLContext>
 
 namespace fast {
@@ -37,27 +39,31 @@ void ComputationThread::run() {
     QGLContext* mainGLContext = Window::getMainGLContext();
     mainGLContext->makeCurrent();
 
-    uint executeToken = 0;
-    while(true) {
-        {
-            std::unique_lock<std::mutex> lock(mUpdateThreadMutex); // this locks the mutex
-            if(mStop)
-                break;
-        }
-        try {
-            for(auto po : m_processObjects)
-                po->update(executeToken);
-            for(View *view : mViews) {
-                view->updateRenderersInput(executeToken);
+    if(Config::getExecutionMode() == EXECUTION_MODE_PARALLEL) {
+        runParallel();
+    } else {
+        uint executeToken = 0;
+        while(true) {
+            {
+                std::unique_lock<std::mutex> lock(mUpdateThreadMutex); // this locks the mutex
+                if(mStop)
+                    break;
             }
-            for(View *view : mViews) {
-                view->updateRenderers();
+            try {
+                for(auto po : m_processObjects)
+                    po->update(executeToken);
+                for(View *view : mViews) {
+                    view->updateRenderersInput(executeToken);
+                }
+                for(View *view : mViews) {
+                    view->updateRenderers();
+                }
+            } catch(ThreadStopped &e) {
+                reportInfo() << "Thread stopped exception occured in ComputationThread, exiting.." << reportEnd();
+                break;
             }
-        } catch(ThreadStopped &e) {
-            reportInfo() << "Thread stopped exception occured in ComputationThread, exiting.." << reportEnd();
-            break;
+            ++executeToken;
         }
-        ++executeToken;
     }
 
     // Move GL context back to main thread
@@ -73,9 +79,41 @@ void ComputationThread::run() {
     mUpdateThreadConditionVariable.notify_one();
 }
 
+void ComputationThread::runParallel() {
+    // Schedule all process objects and renderers on a thread pool instead of updating them every tick.
+    // The renderers consume the data, and will therefore block the pipeline until it is rendered.
+    m_executor = PipelineExecutor::New();
+    for(auto po : m_processObjects)
+        m_executor->addProcessObject(po);
+    for(View *view : mViews) {
+        for(auto renderer : view->mNonVolumeRenderers)
+            m_executor->addProcessObject(renderer);
+        for(auto renderer : view->mVolumeRenderers)
+            m_executor->addProcessObject(renderer);
+    }
+    m_executor->start();
+
+    // Wait until stop is called
+    {
+        std::unique_lock<std::mutex> lock(mUpdateThreadMutex);
+        while(!mStop)
+            mUpdateThreadConditionVariable.wait(lock);
+    }
+
+    try {
+        m_executor->stop();
+        m_executor->join();
+    } catch(Exception &e) {
+        reportError() << "Exception occured in PipelineExecutor: " << e.what() << reportEnd();
+    }
+    m_executor.reset();
+}
+
 void ComputationThread::stop() {
     std::unique_lock<std::mutex> lock(mUpdateThreadMutex); // this locks the mutex
     mStop = true;
+    // Wake up the computation thread if it is waiting for the parallel pipeline executor
+    mUpdateThreadConditionVariable.notify_all();
     // This is run in the main thread
     reportInfo() << "Stopping pipelines and waking any blocking threads..." << Reporter::end();
     for(View* view : mViews) {
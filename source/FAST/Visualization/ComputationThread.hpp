@@ -12,6 +12,7 @@ namespace fast {
 
 class View;
 class ProcessObject;
+class PipelineExecutor;
 
 class FAST_EXPORT  ComputationThread : public QObject, public Object {
     Q_OBJECT
@@ -28,6 +29,10 @@ class FAST_EXPORT  ComputationThread : public QObject, public Object {
     signals:
         void finished();
     private:
+        /**
+         * Used when execution mode is EXECUTION_MODE_PARALLEL
+         */
+        void runParallel();
 
         bool mIsRunning;
         std::condition_variable mUpdateThreadConditionVariable;
@@ -37,6 +42,7 @@ class FAST_EXPORT  ComputationThread : public QObject, public Object {
 
         std::vector<View*> mViews;
         std::vector<SharedPointer<ProcessObject>> m_processObjects;
+        SharedPointer<PipelineExecutor> m_executor;
 
         bool mStop = false;
 };
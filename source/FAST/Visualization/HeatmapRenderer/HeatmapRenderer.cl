@@ -6,8 +6,11 @@ __kernel void renderToTexture(
         __constant float* colors,
         __private float minConfidence,
         __private float maxOpacity,
-        __private int channels
+        __private int channels,
+        __private int inputOffset
 ) {
+    // The tensor may be a view of a batch, starting at an offset in the buffer
+    inputTensor += inputOffset;
     const int2 position = {get_global_id(0), get_global_id(1)};
 
     float4 color = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -174,6 +174,7 @@ void HeatmapRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, f
         kernel.setArg(3, mMinConfidence);
         kernel.setArg(4, mMaxOpacity);
         kernel.setArg(5, input->getShape()[2]);
+        kernel.setArg(6, (int)input->getOpenCLBufferOffset());
 
         queue.enqueueNDRangeKernel(
             kernel,
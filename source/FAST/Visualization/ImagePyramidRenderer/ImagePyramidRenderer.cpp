@@ -4,9 +4,8 @@
 #include "FAST/Utility.hpp"
 #include "FAST/SceneGraph.hpp"
 #include <FAST/Data/ImagePyramid.hpp>
-#include <QGLContext>
-#include <FAST/Visualization/Window.hpp>
 #include <FAST/Visualization/View.hpp>
+#include <algorithm>
 #if defined(__APPLE__) || defined(__MACOSX)
 #include <OpenCL/cl_gl.h>
 #include <OpenGL/gl.h>
@@ -24,17 +23,42 @@
 
 namespace fast {
 
+// Maximum time spent on uploading tiles to textures each frame, in milliseconds
+static const double uploadTimeBudget = 10.0;
+
+/**
+ * Tiles are identified by their level and x, y position packed into a single integer
+ */
+static inline uint64_t getTileKey(int level, int tile_x, int tile_y) {
+    return ((uint64_t)level << 48) | ((uint64_t)tile_x << 24) | (uint64_t)tile_y;
+}
+
+static inline double getMilliseconds(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
 void ImagePyramidRenderer::clearPyramid() {
     // Clear buffer. Useful when processing a new image
-    mTexturesToRender.clear();
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Textures have to be deleted in the rendering thread
+    m_clearCache = true;
     mDataToRender.clear();
+    {
+        std::lock_guard<std::mutex> queueLock(m_tileQueueMutex);
+        m_tileQueue.clear();
+        m_loadedTiles.clear();
+    }
 }
 
 ImagePyramidRenderer::~ImagePyramidRenderer() {
-    m_stop = true;
-    m_queueEmptyCondition.notify_one();
-    m_bufferThread->join();
-    reportInfo() << "Buffer thread in ImagePyramidRenderer stopped" << reportEnd();
+    {
+        std::lock_guard<std::mutex> lock(m_tileQueueMutex);
+        m_stop = true;
+    }
+    m_queueEmptyCondition.notify_all();
+    for(auto& thread : m_loaderThreads)
+        thread.join();
+    reportInfo() << "Loader threads in ImagePyramidRenderer stopped" << reportEnd();
 }
 
 ImagePyramidRenderer::ImagePyramidRenderer() : Renderer() {
@@ -46,8 +70,11 @@ ImagePyramidRenderer::ImagePyramidRenderer() : Renderer() {
     mWindow = -1;
     mLevel = -1;
     m_currentLevel = -1;
+    m_nrOfLoaderThreads = std::max(1, std::min(4, (int)std::thread::hardware_concurrency()));
     createFloatAttribute("window", "Intensity window", "Intensity window", -1);
     createFloatAttribute("level", "Intensity level", "Intensity level", -1);
+    createIntegerAttribute("max-texture-memory", "Maximum texture memory", "Maximum memory used by tile textures in MB", 512);
+    createIntegerAttribute("loader-threads", "Loader threads", "Number of threads used to load tiles", m_nrOfLoaderThreads);
     createShaderProgram({
                                 Config::getKernelSourcePath() + "/Visualization/ImagePyramidRenderer/ImagePyramidRenderer.vert",
                                 Config::getKernelSourcePath() + "/Visualization/ImagePyramidRenderer/ImagePyramidRenderer.frag",
@@ -73,115 +100,161 @@ float ImagePyramidRenderer::getIntensityWindow() {
     return mWindow;
 }
 
+void ImagePyramidRenderer::setMaximumTextureMemory(int megabytes) {
+    if(megabytes <= 0)
+        throw Exception("Maximum texture memory has to be above 0.");
+    m_maximumMemoryUsage = (std::size_t)megabytes*1024*1024;
+}
+
+void ImagePyramidRenderer::setNrOfLoaderThreads(int threads) {
+    if(threads <= 0)
+        throw Exception("Number of loader threads has to be above 0.");
+    if(!m_loaderThreads.empty())
+        throw Exception("Number of loader threads must be set before rendering starts.");
+    m_nrOfLoaderThreads = threads;
+}
+
 void ImagePyramidRenderer::loadAttributes() {
     mWindow = getFloatAttribute("window");
     mLevel = (getFloatAttribute("level"));
+    setMaximumTextureMemory(getIntegerAttribute("max-texture-memory"));
+    setNrOfLoaderThreads(getIntegerAttribute("loader-threads"));
 }
 
-void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, float zNear, float zFar, bool mode2D) {
-    if(mDataToRender.empty())
-        return;
-
-    if(!m_bufferThread) {
-        // Create thread to load patches
-#ifdef WIN32
-        // Create a GL context for the thread which is sharing with the context of the view
-        auto context = new QGLContext(View::getGLFormat(), m_view);
-        context->create(m_view->context());
-
-        if(!context->isValid())
-            throw Exception("The custom Qt GL context is invalid!");
-
-        if(!context->isSharing())
-            throw Exception("The custom Qt GL context is not sharing!");
-
-        context->makeCurrent();
-        auto nativeContextHandle = wglGetCurrentContext();
-        context->doneCurrent();
-        m_view->context()->makeCurrent();
-        auto dc = wglGetCurrentDC();
-        
-        m_bufferThread = std::make_unique<std::thread>([this, dc, nativeContextHandle]() {
-            wglMakeCurrent(dc, nativeContextHandle);
-#else
-        m_bufferThread = std::make_unique<std::thread>([this]() {
-            // Create a GL context for the thread which is sharing with the context of the view
-            auto context = new QGLContext(View::getGLFormat(), m_view);
-            context->create(m_view->context());
-            if(!context->isValid())
-                throw Exception("The custom Qt GL context is invalid!");
-
-            if(!context->isSharing())
-                throw Exception("The custom Qt GL context is not sharing!");
-            context->makeCurrent();
-#endif
-            uint64_t memoryUsage = 0;
-            while(true) {
-                std::string tileID;
-                {
-                    std::unique_lock<std::mutex> lock(m_tileQueueMutex);
-                    // If queue is empty, we wait here
-                    while(m_tileQueue.empty() && !m_stop) {
-                        m_queueEmptyCondition.wait(lock);
-                    }
-                    if(m_stop)
-                        break;
-
-                    // Get next item on queue
-                    tileID = m_tileQueue.back();
-                    m_tileQueue.pop_back();
-                }
+void ImagePyramidRenderer::loadTiles() {
+    while(true) {
+        TileRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_tileQueueMutex);
+            // If queue is empty, we wait here
+            while(m_tileQueue.empty() && !m_stop) {
+                m_queueEmptyCondition.wait(lock);
+            }
+            if(m_stop)
+                break;
 
-                // Check if tile has been processed before
-                if(mTexturesToRender.count(tileID) > 0)
-                    continue;
+            // Get tile with highest priority
+            request = m_tileQueue.front();
+            m_tileQueue.pop_front();
+            m_loading.insert(request.key);
+        }
 
-                //std::cout << "Loading tile " << tileID << " queue size: " << m_tileQueue.size() << std::endl;
-
-                // Create texture
-                auto parts = split(tileID, "_");
-                if(parts.size() != 3)
-                    throw Exception("incorrect tile format");
-
-                int level = std::stoi(parts[0]);
-                int tile_x = std::stoi(parts[1]);
-                int tile_y = std::stoi(parts[2]);
-                //std::cout << "Creating texture for tile " << tile_x << " " << tile_y << " at level " << level << std::endl;
-                ImagePyramidPatch tile;
-                {
-                    auto access = m_input->getAccess(ACCESS_READ);
-                    tile = access->getPatch(level, tile_x, tile_y);
-                }
-                // Copy data from CPU to GL texture
-                GLuint textureID;
-                glGenTextures(1, &textureID);
-                glBindTexture(GL_TEXTURE_2D, textureID);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-                // TODO Why is this needed:
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-                // WSI data from openslide is stored as ARGB, need to handle this here: BGRA and reverse
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_COMPRESSED_RGBA, tile.width, tile.height, 0, GL_BGRA, GL_UNSIGNED_BYTE,
-                             tile.data.get());
-                GLint compressedImageSize = 0;
-                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedImageSize);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glFinish();
+        auto start = std::chrono::high_resolution_clock::now();
+        LoadedTile tile;
+        tile.request = request;
+        try {
+            auto access = request.input->getAccess(ACCESS_READ);
+            tile.patch = access->getPatch(request.level, request.x, request.y);
+        } catch(Exception& e) {
+            reportError() << "Unable to load tile in ImagePyramidRenderer: " << e.what() << reportEnd();
+            std::lock_guard<std::mutex> lock(m_tileQueueMutex);
+            m_loading.erase(request.key);
+            continue;
+        }
+        tile.decodeTime = getMilliseconds(start);
 
-                {
-                    std::lock_guard<std::mutex> lock(m_tileQueueMutex);
-					mTexturesToRender[tileID] = textureID;
-                }
-                memoryUsage += compressedImageSize;
-                //std::cout << "Texture cache in ImagePyramidRenderer using " << (float)memoryUsage / (1024 * 1024) << " MB" << std::endl;
-            }
-        });
+        std::lock_guard<std::mutex> lock(m_tileQueueMutex);
+        m_loading.erase(request.key);
+        // Tiles of levels finer than the current one won't be drawn, so they are cancelled
+        if(request.input == m_input && request.level >= m_currentLevel)
+            m_loadedTiles.push_back(std::move(tile));
     }
+}
+
+void ImagePyramidRenderer::uploadTile(LoadedTile& tile) {
+    const int level = tile.request.level;
+    const ImagePyramidPatch& patch = tile.patch;
+    const auto& input = tile.request.input;
+    const float scale = (float)input->getFullWidth()/input->getLevelWidth(level);
+
+    Tile texture;
+    glGenTextures(1, &texture.texture);
+    glBindTexture(GL_TEXTURE_2D, texture.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    // TODO Why is this needed:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // WSI data from openslide is stored as ARGB, need to handle this here: BGRA and reverse.
+    // Uncompressed format, since compressing in the driver is too slow for the rendering thread.
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, patch.width, patch.height, 0, GL_BGRA, GL_UNSIGNED_BYTE,
+                 patch.data.get());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture.bytes = (std::size_t)patch.width*patch.height*4;
+
+    // Create VAO
+    glGenVertexArrays(1, &texture.VAO);
+    glBindVertexArray(texture.VAO);
+
+    // Create VBO
+    float vertices[] = {
+            // vertex: x, y, z; tex coordinates: x, y
+            patch.offsetX * scale, (patch.offsetY + patch.height) * scale, (float)-level, 0.0f, 1.0f,
+            (patch.offsetX + patch.width) * scale, (patch.offsetY + patch.height) * scale, (float)-level, 1.0f, 1.0f,
+            (patch.offsetX + patch.width) * scale, patch.offsetY * scale, (float)-level, 1.0f, 0.0f,
+            patch.offsetX * scale, patch.offsetY * scale, (float)-level, 0.0f, 0.0f,
+    };
+    glGenBuffers(1, &texture.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, texture.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) (3 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // Create EBO
+    uint indices[] = {  // note that we start from 0!
+            0, 1, 3,   // first triangle
+            1, 2, 3    // second triangle
+    };
+    glGenBuffers(1, &texture.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, texture.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    // New tiles are placed first in the least recently used list
+    texture.lastUsed = m_frame;
+    m_leastRecentlyUsed.push_front(tile.request.key);
+    texture.position = m_leastRecentlyUsed.begin();
+    m_tiles[tile.request.key] = texture;
+    m_memoryUsage += texture.bytes;
+}
+
+void ImagePyramidRenderer::deleteTile(uint64_t key) {
+    Tile& tile = m_tiles.at(key);
+    glDeleteTextures(1, &tile.texture);
+    glDeleteVertexArrays(1, &tile.VAO);
+    glDeleteBuffers(1, &tile.VBO);
+    glDeleteBuffers(1, &tile.EBO);
+    m_memoryUsage -= tile.bytes;
+    m_leastRecentlyUsed.erase(tile.position);
+    m_tiles.erase(key);
+}
+
+void ImagePyramidRenderer::deleteAllTiles() {
+    while(!m_leastRecentlyUsed.empty())
+        deleteTile(m_leastRecentlyUsed.back());
+    m_requestTime.clear();
+}
+
+void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, float zNear, float zFar, bool mode2D) {
     std::lock_guard<std::mutex> lock(mMutex);
+    if(m_clearCache) {
+        deleteAllTiles();
+        m_clearCache = false;
+    }
+    if(mDataToRender.empty())
+        return;
+
+    if(m_loaderThreads.empty()) {
+        // Create threads to load tiles
+        for(int i = 0; i < m_nrOfLoaderThreads; ++i)
+            m_loaderThreads.push_back(std::thread(&ImagePyramidRenderer::loadTiles, this));
+    }
+    ++m_frame;
 
     Vector4f bottom_left = (perspectiveMatrix*viewingMatrix).inverse()*Vector4f(-1,-1,0,1);
     Vector4f top_right = (perspectiveMatrix*viewingMatrix).inverse()*Vector4f(1,1,0,1);
@@ -193,18 +266,21 @@ void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatr
     int offset_y = top_right.y();
     //std::cout << "Offset x:" << offset_x << std::endl;
     //std::cout << "Offset y:" << offset_y << std::endl;
+    const Vector2f viewCenter(offset_x + width*0.5f, offset_y + height*0.5f);
 
-    m_input = std::static_pointer_cast<ImagePyramid>(mDataToRender[0]);
+    auto input = std::static_pointer_cast<ImagePyramid>(mDataToRender[0]);
+    if(m_input && m_input != input)
+        deleteAllTiles();
     // Determine which level to use
     // If nr of pixels in viewport is larger than the current width and height of view, than increase the magnification
-    int fullWidth = m_input->getFullWidth();
-    int fullHeight = m_input->getFullHeight();
+    int fullWidth = input->getFullWidth();
+    int fullHeight = input->getFullHeight();
     int levelToUse = 0;
-    int level = m_input->getNrOfLevels();
+    int level = input->getNrOfLevels();
     do {
         level = level - 1;
-        int levelWidth = m_input->getLevelWidth(level);
-        int levelHeight = m_input->getLevelHeight(level);
+        int levelWidth = input->getLevelWidth(level);
+        int levelHeight = input->getLevelHeight(level);
 
         // Percentage of full WSI shown currently
         float percentageShownX = (float)width / fullWidth;
@@ -219,13 +295,47 @@ void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatr
             continue;
         }
     } while(level > 0);
-    if(m_currentLevel != levelToUse && m_currentLevel != -1) {
-        // Level change, clear queue
-        std::lock_guard<std::mutex> lock(m_tileQueueMutex);
-        m_tileQueue.clear();
-        //std::cout << "Queue cleared!" << std::endl;
+    {
+        std::lock_guard<std::mutex> queueLock(m_tileQueueMutex);
+        if(m_input != input) {
+            // Tiles are cached by level and position only, thus tiles of the previous input must not be uploaded
+            m_tileQueue.clear();
+            m_loadedTiles.erase(std::remove_if(m_loadedTiles.begin(), m_loadedTiles.end(), [&input](const LoadedTile& tile) {
+                return tile.request.input != input;
+            }), m_loadedTiles.end());
+        }
+        m_input = input;
+        if(m_currentLevel != levelToUse && m_currentLevel != -1) {
+            // Level change, cancel loading and uploading of tiles which are no longer needed
+            m_tileQueue.clear();
+            m_loadedTiles.erase(std::remove_if(m_loadedTiles.begin(), m_loadedTiles.end(), [levelToUse](const LoadedTile& tile) {
+                return tile.request.level < levelToUse;
+            }), m_loadedTiles.end());
+        }
+        m_currentLevel = levelToUse;
+    }
+
+    // Upload loaded tiles to textures, limited by a time budget so that the frame rate is kept
+    const bool measure = mRuntimeManager->isEnabled();
+    auto uploadStart = std::chrono::high_resolution_clock::now();
+    while(getMilliseconds(uploadStart) < uploadTimeBudget) {
+        LoadedTile tile;
+        {
+            std::lock_guard<std::mutex> queueLock(m_tileQueueMutex);
+            if(m_loadedTiles.empty())
+                break;
+            tile = std::move(m_loadedTiles.front());
+            m_loadedTiles.pop_front();
+        }
+        if(m_tiles.count(tile.request.key) > 0 || tile.request.input != input)
+            continue;
+        auto start = std::chrono::high_resolution_clock::now();
+        uploadTile(tile);
+        if(measure) {
+            mRuntimeManager->getTiming("tile_upload")->addSample(getMilliseconds(start));
+            mRuntimeManager->getTiming("tile_decode")->addSample(tile.decodeTime);
+        }
     }
-    m_currentLevel = levelToUse;
 
     activateShader();
 
@@ -243,26 +353,27 @@ void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatr
     transformLoc = glGetUniformLocation(getShaderProgram(), "viewTransform");
     glUniformMatrix4fv(transformLoc, 1, GL_FALSE, viewingMatrix.data());
 
-    for(int level = m_input->getNrOfLevels()-1; level >= levelToUse; level--) {
-        const int levelWidth = m_input->getLevelWidth(level);
-        const int levelHeight = m_input->getLevelHeight(level);
-        const int mTiles = m_input->getLevelPatches(level);
+    // Missing tiles with their priority. Coarse levels are loaded first, since they cover a larger area,
+    // and then tiles closest to the center of the view.
+    std::vector<std::pair<std::pair<int, float>, TileRequest>> missingTiles;
+    std::unordered_map<uint64_t, std::chrono::high_resolution_clock::time_point> requestTime;
+    int hits = 0;
+    for(int level = input->getNrOfLevels()-1; level >= levelToUse; level--) {
+        const int levelWidth = input->getLevelWidth(level);
+        const int levelHeight = input->getLevelHeight(level);
+        const int tilesX = input->getLevelTilesX(level);
+        const int tilesY = input->getLevelTilesY(level);
+        const int levelTileWidth = input->getLevelTileWidth(level);
+        const int levelTileHeight = input->getLevelTileHeight(level);
         const float mCurrentTileScale = (float)fullWidth/levelWidth;
 
-        for(int tile_x = 0; tile_x < mTiles; ++tile_x) {
-            for(int tile_y = 0; tile_y < mTiles; ++tile_y) {
-                const std::string tileString =
-                        std::to_string(level) + "_" + std::to_string(tile_x) + "_" + std::to_string(tile_y);
+        for(int tile_x = 0; tile_x < tilesX; ++tile_x) {
+            for(int tile_y = 0; tile_y < tilesY; ++tile_y) {
+                int tile_offset_x = tile_x * levelTileWidth;
+                int tile_offset_y = tile_y * levelTileHeight;
 
-                int tile_offset_x = tile_x * (int) std::floor((float) levelWidth / mTiles);
-                int tile_offset_y = tile_y * (int) std::floor((float) levelHeight / mTiles);
-
-                int tile_width = std::floor(((float) levelWidth / mTiles));
-                if(tile_x == mTiles - 1)
-                    tile_width = levelWidth - tile_offset_x;
-                int tile_height = std::floor((float) levelHeight / mTiles);
-                if(tile_y == mTiles - 1)
-                    tile_height = levelHeight - tile_offset_y;
+                int tile_width = std::min(levelTileWidth, levelWidth - tile_offset_x);
+                int tile_height = std::min(levelTileHeight, levelHeight - tile_offset_y);
 
                 // Only process visible patches
                 // Fully contained and partly
@@ -290,93 +401,70 @@ void ImagePyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatr
                     continue;
 
                 // Is patch in cache?
-                bool textureReady = false;
-                uint textureID;
-                {
-					std::lock_guard<std::mutex> lock(m_tileQueueMutex);
-                    textureReady = mTexturesToRender.count(tileString) > 0;
-                }
-                if(!textureReady) {
+                const uint64_t key = getTileKey(level, tile_x, tile_y);
+                auto cached = m_tiles.find(key);
+                if(cached == m_tiles.end()) {
                     // Add to queue if not in cache
-                    {
-                        std::lock_guard<std::mutex> lock(m_tileQueueMutex);
-                        // Remove any duplicates first
-                        m_tileQueue.remove(tileString); // O(n) time complexity..
-						m_tileQueue.push_back(tileString);
-                        //std::cout << "Added tile " << tileString << " to queue" << std::endl;
-                    }
-                    m_queueEmptyCondition.notify_one();
+                    const Vector2f tileCenter(
+                            (tile_offset_x + tile_width*0.5f) * mCurrentTileScale,
+                            (tile_offset_y + tile_height*0.5f) * mCurrentTileScale
+                    );
+                    missingTiles.push_back({{-level, (tileCenter - viewCenter).squaredNorm()}, {key, level, tile_x, tile_y, input}});
+                    requestTime[key] = m_requestTime.count(key) > 0 ? m_requestTime[key] : std::chrono::high_resolution_clock::now();
                     continue;
-                } else {
-                    textureID = mTexturesToRender[tileString];
                 }
+                ++hits;
+                Tile& tile = cached->second;
+                if(m_requestTime.count(key) > 0) {
+                    // First time this tile is drawn
+                    if(measure)
+                        mRuntimeManager->getTiming("tile_latency")->addSample(getMilliseconds(m_requestTime[key]));
+                    m_requestTime.erase(key);
+                }
+                // Move tile first in the least recently used list
+                tile.lastUsed = m_frame;
+                m_leastRecentlyUsed.splice(m_leastRecentlyUsed.begin(), m_leastRecentlyUsed, tile.position);
 
-                // Delete old VAO
-                if(mVAO.count(tileString) > 0)
-                    glDeleteVertexArrays(1, &mVAO[tileString]);
-                // Create VAO
-                uint VAO_ID;
-                glGenVertexArrays(1, &VAO_ID);
-                mVAO[tileString] = VAO_ID;
-                glBindVertexArray(VAO_ID);
-
-                // Create VBO
-                // Get width and height in mm
-                //std::cout << "Creating vertices for " << tile_x << " " << tile_y << std::endl;
-                //std::cout << "Tile position: " << tile_offset_x*mCurrentTileScale << " " << tile_offset_x*mCurrentTileScale + tile_width*mCurrentTileScale << std::endl;
-                //std::cout << "Tile position: " << tile_offset_y*mCurrentTileScale << " " << tile_offset_y*mCurrentTileScale + tile_height*mCurrentTileScale << std::endl;
-                float vertices[] = {
-                        // vertex: x, y, z; tex coordinates: x, y
-                        tile_offset_x * mCurrentTileScale, (tile_offset_y + tile_height) * mCurrentTileScale, -level,
-                        0.0f, 1.0f,
-                        (tile_offset_x + tile_width) * mCurrentTileScale,
-                        (tile_offset_y + tile_height) * mCurrentTileScale, -level, 1.0f, 1.0f,
-                        (tile_offset_x + tile_width) * mCurrentTileScale, tile_offset_y * mCurrentTileScale, -level, 1.0f,
-                        0.0f,
-                        tile_offset_x * mCurrentTileScale, tile_offset_y * mCurrentTileScale, -level, 0.0f, 0.0f,
-                };
-                // Delete old VBO
-                if(mVBO.count(tileString) > 0)
-                    glDeleteBuffers(1, &mVBO[tileString]);
-                uint VBO;
-                glGenBuffers(1, &VBO);
-                mVBO[tileString] = VBO;
-                glBindBuffer(GL_ARRAY_BUFFER, VBO);
-                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) 0);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *) (3 * sizeof(float)));
-                glEnableVertexAttribArray(0);
-                glEnableVertexAttribArray(1);
-
-                // Delete old EBO
-                if(mEBO.count(tileString) > 0)
-                    glDeleteBuffers(1, &mEBO[tileString]);
-                // Create EBO
-                uint EBO;
-                glGenBuffers(1, &EBO);
-                mEBO[tileString] = EBO;
-                uint indices[] = {  // note that we start from 0!
-                        0, 1, 3,   // first triangle
-                        1, 2, 3    // second triangle
-                };
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-                glBindVertexArray(0);
-
-                if(mTexturesToRender.count(tileString) == 0)
-                    throw Exception("ERROR! Texture doesn't exist");
-
-                //std::cout << "drawing " << tileString << std::endl;
-                glBindTexture(GL_TEXTURE_2D, textureID);
-                glBindVertexArray(mVAO[tileString]);
+                glBindTexture(GL_TEXTURE_2D, tile.texture);
+                glBindVertexArray(tile.VAO);
                 glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
                 glBindTexture(GL_TEXTURE_2D, 0);
                 glBindVertexArray(0);
-                glFinish();
             }
         }
     }
     deactivateShader();
+    m_requestTime = std::move(requestTime);
+    if(measure) {
+        mRuntimeManager->getTiming("tile_cache_hits")->addSample(hits);
+        mRuntimeManager->getTiming("tile_cache_misses")->addSample(missingTiles.size());
+    }
+
+    // Replace the queue with the tiles missing in this frame, thus tiles which are no longer visible are not loaded
+    std::sort(missingTiles.begin(), missingTiles.end(), [](const std::pair<std::pair<int, float>, TileRequest>& a, const std::pair<std::pair<int, float>, TileRequest>& b) {
+        return a.first < b.first;
+    });
+    {
+        std::lock_guard<std::mutex> queueLock(m_tileQueueMutex);
+        std::unordered_set<uint64_t> loaded;
+        for(const LoadedTile& tile : m_loadedTiles)
+            loaded.insert(tile.request.key);
+        m_tileQueue.clear();
+        for(const auto& missing : missingTiles) {
+            const uint64_t key = missing.second.key;
+            if(m_loading.count(key) == 0 && loaded.count(key) == 0)
+                m_tileQueue.push_back(missing.second);
+        }
+    }
+    m_queueEmptyCondition.notify_all();
+
+    // Remove least recently used tiles until the cache is within its budget. Tiles visible in this frame are kept.
+    while(m_memoryUsage > m_maximumMemoryUsage && !m_leastRecentlyUsed.empty()) {
+        const uint64_t key = m_leastRecentlyUsed.back();
+        if(m_tiles.at(key).lastUsed == m_frame)
+            break;
+        deleteTile(key);
+    }
 }
 
 void ImagePyramidRenderer::drawTextures(Matrix4f &perspectiveMatrix, Matrix4f &viewingMatrix, bool mode2D) {
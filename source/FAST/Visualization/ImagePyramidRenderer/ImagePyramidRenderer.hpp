@@ -1,13 +1,27 @@
 #pragma once
 
 #include <FAST/Visualization/Renderer.hpp>
+#include <FAST/Data/Access/ImagePyramidAccess.hpp>
+#include <chrono>
 #include <deque>
+#include <list>
 #include <thread>
 
 namespace fast {
 
 class ImagePyramid;
 
+/**
+ * Renders an ImagePyramid, e.g. a whole slide image.
+ *
+ * Visible tiles are decoded by a pool of loader threads, with tiles closest to the center of the view first,
+ * and uploaded to OpenGL textures by the rendering thread. The textures are kept in a least recently used cache
+ * with a fixed memory budget.
+ *
+ * The runtime measurements tile_cache_hits and tile_cache_misses get one sample per frame with the number of
+ * visible tiles found and not found in the cache. tile_decode, tile_upload and tile_latency measure the time
+ * to decode a tile, to upload it to a texture, and from the tile was first requested until it was drawn.
+ */
 class FAST_EXPORT ImagePyramidRenderer : public Renderer {
     FAST_OBJECT(ImagePyramidRenderer)
     public:
@@ -16,27 +30,76 @@ class FAST_EXPORT ImagePyramidRenderer : public Renderer {
         float getIntensityLevel();
         void setIntensityWindow(float window);
         float getIntensityWindow();
+        /**
+         * Set maximum amount of memory used by tile textures. Default is 512 MB.
+         * Least recently used tiles are removed when the cache is full.
+         * @param megabytes
+         */
+        void setMaximumTextureMemory(int megabytes);
+        /**
+         * Set number of threads used to load tiles. Must be set before rendering starts.
+         * Default is 4, or the number of cores if fewer.
+         * @param threads
+         */
+        void setNrOfLoaderThreads(int threads);
         ~ImagePyramidRenderer() override;
         void clearPyramid();
     private:
         ImagePyramidRenderer();
         void draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, float zNear, float zFar, bool mode2D);
 
-        std::unordered_map<std::string, uint> mTexturesToRender;
-        std::unordered_map<uint, SharedPointer<ImagePyramid>> mImageUsed;
-        std::unordered_map<std::string, uint> mVAO;
-        std::unordered_map<std::string, uint> mVBO;
-        std::unordered_map<std::string, uint> mEBO;
+        struct Tile {
+            uint texture;
+            uint VAO;
+            uint VBO;
+            uint EBO;
+            std::size_t bytes;
+            // Last frame this tile was visible
+            uint64_t lastUsed;
+            // Position in the least recently used list
+            std::list<uint64_t>::iterator position;
+        };
+        struct TileRequest {
+            uint64_t key;
+            int level;
+            int x;
+            int y;
+            SharedPointer<ImagePyramid> input;
+        };
+        struct LoadedTile {
+            TileRequest request;
+            ImagePyramidPatch patch;
+            double decodeTime;
+        };
 
-        // Queue of tiles to be loaded
-        std::list<std::string> m_tileQueue; // LIFO queue
-        // Buffer to process queue
-        std::unique_ptr<std::thread> m_bufferThread;
+        void loadTiles();
+        void uploadTile(LoadedTile& tile);
+        void deleteTile(uint64_t key);
+        void deleteAllTiles();
+
+        // Texture cache, and keys of the tiles with most recently used first
+        std::unordered_map<uint64_t, Tile> m_tiles;
+        std::list<uint64_t> m_leastRecentlyUsed;
+        std::size_t m_memoryUsage = 0;
+        std::size_t m_maximumMemoryUsage = (std::size_t)512*1024*1024;
+        uint64_t m_frame = 0;
+        // Time each missing tile was first requested
+        std::unordered_map<uint64_t, std::chrono::high_resolution_clock::time_point> m_requestTime;
+        bool m_clearCache = false;
+
+        // Queue of tiles to be loaded, sorted by priority
+        std::deque<TileRequest> m_tileQueue;
+        // Tiles which are currently being loaded
+        std::unordered_set<uint64_t> m_loading;
+        // Tiles which have been loaded, and are waiting to be uploaded to textures
+        std::deque<LoadedTile> m_loadedTiles;
+        // Threads which process the queue
+        std::vector<std::thread> m_loaderThreads;
+        int m_nrOfLoaderThreads;
         // Condition variable to wait if queue is empty
         std::condition_variable m_queueEmptyCondition;
         std::mutex m_tileQueueMutex;
         bool m_stop = false;
-        std::unordered_set<std::string> m_loaded;
 
         int m_currentLevel = -1;
 
@@ -51,4 +114,4 @@ class FAST_EXPORT ImagePyramidRenderer : public Renderer {
         void drawTextures(Matrix4f &perspectiveMatrix, Matrix4f &viewingMatrix, bool mode2D);
 };
 
-}
\ No newline at end of file
+}
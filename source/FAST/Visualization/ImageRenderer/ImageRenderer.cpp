@@ -24,13 +24,13 @@ namespace fast {
 
 ImageRenderer::ImageRenderer() : Renderer() {
     createInputPort<Image>(0, false);
-    createOpenCLProgram(Config::getKernelSourcePath() + "/Visualization/ImageRenderer/ImageRenderer.cl", "3D");
     createOpenCLProgram(Config::getKernelSourcePath() + "/Visualization/ImageRenderer/ImageRenderer2D.cl", "2D");
     mIsModified = true;
     mWindow = -1;
     mLevel = -1;
     createFloatAttribute("window", "Intensity window", "Intensity window", -1);
     createFloatAttribute("level", "Intensity level", "Intensity level", -1);
+    createStringAttribute("texture-format", "Texture format", "Format of textures uploaded to OpenGL: float, rgba8 or r16", "rgba8");
     createShaderProgram({
         Config::getKernelSourcePath() + "/Visualization/ImageRenderer/ImageRenderer.vert",
         Config::getKernelSourcePath() + "/Visualization/ImageRenderer/ImageRenderer.frag",
@@ -59,6 +59,24 @@ void ImageRenderer::deleteAllTextures() {
         glDeleteTextures(1, &texture.second);
     }
     mTexturesToRender.clear();
+    for(auto& buffers : mPixelBuffers) {
+        for(auto& buffer : buffers.second) {
+            // The pixel buffer may still be mapped and written to by OpenCL
+            if(buffer.pending)
+                buffer.readEvent.wait();
+            glDeleteBuffers(1, &buffer.pbo);
+        }
+    }
+    mPixelBuffers.clear();
+    mPBOIndex.clear();
+    mImageRequested.clear();
+    mImageUsed.clear();
+    mDataTimestamp.clear();
+    mVAOSize.clear();
+    mTextureSize.clear();
+    mTextureFormat.clear();
+    mTextureBuffer.clear();
+    mTextureBufferSize.clear();
 }
 
 void ImageRenderer::setIntensityLevel(float level) {
@@ -79,9 +97,45 @@ float ImageRenderer::getIntensityWindow() {
     return mWindow;
 }
 
+void ImageRenderer::setTextureFormat(TextureFormat format) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFormat = format;
+    // Force textures to be recreated with the new format on next draw
+    mDataTimestamp.clear();
+}
+
+ImageRenderer::TextureFormat ImageRenderer::getTextureFormat() const {
+    return mFormat;
+}
+
 void ImageRenderer::loadAttributes() {
     mWindow = getFloatAttribute("window");
     mLevel = (getFloatAttribute("level"));
+    const std::string format = getStringAttribute("texture-format");
+    if(format == "float") {
+        mFormat = TextureFormat::FLOAT;
+    } else if(format == "rgba8") {
+        mFormat = TextureFormat::RGBA8;
+    } else if(format == "r16") {
+        mFormat = TextureFormat::R16;
+    } else {
+        throw Exception("Unknown texture format " + format + " in ImageRenderer, must be float, rgba8 or r16");
+    }
+}
+
+/**
+ * Size in bytes of one pixel in a texture
+ */
+static std::size_t getPixelSize(ImageRenderer::TextureFormat format) {
+    switch(format) {
+        case ImageRenderer::TextureFormat::FLOAT:
+            return 4*sizeof(float);
+        case ImageRenderer::TextureFormat::RGBA8:
+            return 4*sizeof(uchar);
+        case ImageRenderer::TextureFormat::R16:
+            return sizeof(ushort);
+    }
+    throw Exception("Unknown texture format in ImageRenderer");
 }
 
 void ImageRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, float zNear, float zFar, bool mode2D) {
@@ -94,11 +148,24 @@ void ImageRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, flo
         if(input->getDimensions() != 2)
             throw Exception("ImageRenderer only supports 2D images. Use ImageSlicer to extract a 2D slice from a 3D image.");
 
-        // Check if a texture has already been created for this image
-        if (mTexturesToRender.count(inputNr) > 0 && mImageUsed[inputNr] == input && mDataTimestamp[inputNr] == input->getTimestamp())
-            continue; // If it has already been created, skip it
-
-        // If it has not been created, create the texture
+        if(mPixelBuffers.count(inputNr) == 0) {
+            auto& buffers = mPixelBuffers[inputNr];
+            for(auto& buffer : buffers)
+                glGenBuffers(1, &buffer.pbo);
+            mPBOIndex[inputNr] = 0;
+        }
+        auto& buffers = mPixelBuffers[inputNr];
+        const int index = mPBOIndex[inputNr];
+
+        // Check if this image has already been read into a pixel buffer
+        if(mImageRequested.count(inputNr) > 0 && mImageRequested[inputNr] == input && mDataTimestamp.count(inputNr) > 0 && mDataTimestamp[inputNr] == input->getTimestamp()) {
+            // No new frame, upload frames which are still in flight, oldest first
+            if(buffers[index].pending)
+                uploadPixelBuffer(inputNr, buffers[index]);
+            if(buffers[1 - index].pending)
+                uploadPixelBuffer(inputNr, buffers[1 - index]);
+            continue;
+        }
 
         // Determine level and window
         float window = mWindow;
@@ -111,121 +178,148 @@ void ImageRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f viewingMatrix, flo
             level = getDefaultIntensityLevel(input->getDataType());
         }
 
+        TextureFormat format = mFormat;
+        if(format == TextureFormat::R16 && input->getNrOfChannels() != 1)
+            format = TextureFormat::RGBA8;
+        const Vector2i size(input->getWidth(), input->getHeight());
+        const std::size_t bytes = (std::size_t)size.x()*size.y()*getPixelSize(format);
+
         OpenCLDevice::pointer device = std::dynamic_pointer_cast<OpenCLDevice>(getMainDevice());
 
         OpenCLImageAccess::pointer access = input->getOpenCLImageAccess(ACCESS_READ, device);
         cl::Image2D *clImage = access->get2DImage();
 
-        mKernel = cl::Kernel(getOpenCLProgram(device, "3D"), "renderToTexture");
-        // Run kernel to fill the texture
-        cl::CommandQueue queue = device->getCommandQueue();
-
-        if(mTexturesToRender.count(inputNr) > 0) {
-            // If texture has correct size, we don't need to make a new one
-            int w, h;
-            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
-            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
-            //if(w != input->getWidth() && h != input->getHeight()) {
-                // Delete old texture
-                glDeleteTextures(1, &mTexturesToRender[inputNr]);
-                mTexturesToRender.erase(inputNr);
-                glDeleteVertexArrays(1, &mVAO[inputNr]);
-                mVAO.erase(inputNr);
-            //}
+        std::string kernelName = "renderToBufferUint8";
+        if(format == TextureFormat::FLOAT) {
+            kernelName = "renderToBufferFloat";
+        } else if(format == TextureFormat::R16) {
+            kernelName = "renderToBufferUint16";
         }
+        mKernel = cl::Kernel(getOpenCLProgram(device, "2D"), kernelName.c_str());
+        cl::CommandQueue queue = device->getCommandQueue();
 
-        cl::Image2D image;
-        cl::ImageGL imageGL;
-        std::vector<cl::Memory> v;
-        GLuint textureID;
-        if(DeviceManager::isGLInteropEnabled() && false) {
-            // Create OpenGL texture
-            glGenTextures(1, &textureID);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            // TODO Why is this needed:
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, input->getWidth(), input->getHeight(), 0, GL_RGBA, GL_FLOAT, nullptr);
-
-            // Create CL-GL image
-            imageGL = cl::ImageGL(
-                    device->getContext(),
-                    CL_MEM_READ_WRITE,
-                    GL_TEXTURE_2D,
-                    0,
-                    textureID
-            );
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glFinish();     // Make sure everything is ready for CL to take over the texture
-            v.push_back(imageGL);
-            queue.enqueueAcquireGLObjects(&v);
-            mKernel.setArg(1, imageGL);
-        } else {
-            image = cl::Image2D(
-                    device->getContext(),
-                    CL_MEM_READ_WRITE,
-                    cl::ImageFormat(CL_RGBA, CL_FLOAT),
-                    input->getWidth(), input->getHeight()
-            );
-            mKernel.setArg(1, image);
+        // Reuse the OpenCL buffer from the previous frame if it is large enough.
+        // The queue is in order, so the kernel doesn't overwrite the buffer before the previous read has finished.
+        if(mTextureBuffer.count(inputNr) == 0 || mTextureBufferSize[inputNr] < bytes) {
+            mTextureBuffer[inputNr] = cl::Buffer(device->getContext(), CL_MEM_WRITE_ONLY, bytes);
+            mTextureBufferSize[inputNr] = bytes;
         }
 
+        // Run kernel to fill the texture
         mKernel.setArg(0, *clImage);
+        mKernel.setArg(1, mTextureBuffer[inputNr]);
         mKernel.setArg(2, level);
         mKernel.setArg(3, window);
         queue.enqueueNDRangeKernel(
                 mKernel,
                 cl::NullRange,
-                cl::NDRange(input->getWidth(), input->getHeight()),
+                cl::NDRange(size.x(), size.y()),
                 cl::NullRange
         );
 
-        if(DeviceManager::isGLInteropEnabled() && false) {
-            queue.enqueueReleaseGLObjects(&v);
-            queue.finish(); // This is needed, otherwise seg fault can occur when doing GL stuff with this texture
+        // The pixel buffer of this frame may still hold a frame which hasn't been uploaded
+        auto& upload = buffers[index];
+        if(upload.pending)
+            uploadPixelBuffer(inputNr, upload);
+
+        // Read the CL buffer into the pixel buffer without blocking. Giving glBufferData a null pointer orphans
+        // the old storage, so mapping the buffer doesn't have to wait for a previous upload to finish.
+        // The buffer stays mapped until the read has finished.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* pixelBuffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if(pixelBuffer == nullptr)
+            throw Exception("Unable to map pixel buffer object in ImageRenderer");
+        queue.enqueueReadBuffer(mTextureBuffer[inputNr], CL_FALSE, 0, bytes, pixelBuffer, nullptr, &upload.readEvent);
+        queue.flush();
+        upload.pending = true;
+        upload.image = input;
+        upload.size = size;
+        upload.format = format;
+        mPBOIndex[inputNr] = 1 - index;
+        mImageRequested[inputNr] = input;
+        mDataTimestamp[inputNr] = input->getTimestamp();
+
+        // Upload the previous frame, which has had a whole frame to finish its transfer
+        if(buffers[1 - index].pending)
+            uploadPixelBuffer(inputNr, buffers[1 - index]);
+    }
+
+    drawTextures(perspectiveMatrix, viewingMatrix, mode2D);
+
+}
+
+void ImageRenderer::uploadPixelBuffer(uint inputNr, PixelBufferUpload& upload) {
+    upload.readEvent.wait();
+    upload.pending = false;
+    const Vector2i size = upload.size;
+    const TextureFormat format = upload.format;
+
+    // Only create a new texture if size or format has changed
+    if(mTexturesToRender.count(inputNr) == 0 || mTextureSize[inputNr] != size || mTextureFormat[inputNr] != format) {
+        if(mTexturesToRender.count(inputNr) > 0)
+            glDeleteTextures(1, &mTexturesToRender[inputNr]);
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        // TODO Why is this needed:
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        if(format == TextureFormat::FLOAT) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, size.x(), size.y(), 0, GL_RGBA, GL_FLOAT, nullptr);
+        } else if(format == TextureFormat::RGBA8) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x(), size.y(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
         } else {
-            // Copy data from CL image to CPU
-            auto data = make_uninitialized_unique<float[]>(input->getWidth() * input->getHeight() * 4);
-            queue.finish();
-            queue.enqueueReadImage(
-                    image,
-                    CL_TRUE,
-                    createOrigoRegion(),
-                    createRegion(input->getWidth(), input->getHeight(), 1),
-                    0, 0,
-                    data.get()
-            );
-            // Copy data from CPU to GL texture
-            glGenTextures(1, &textureID);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            // TODO Why is this needed:
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, input->getWidth(), input->getHeight(), 0, GL_RGBA, GL_FLOAT, data.get());
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glFinish();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, size.x(), size.y(), 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+            // Let the shader see the single channel as a gray RGBA color
+            GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
         }
-
+        glBindTexture(GL_TEXTURE_2D, 0);
         mTexturesToRender[inputNr] = textureID;
-        mImageUsed[inputNr] = input;
-        mDataTimestamp[inputNr] = input->getTimestamp();
+        mTextureSize[inputNr] = size;
+        mTextureFormat[inputNr] = format;
     }
 
-    drawTextures(perspectiveMatrix, viewingMatrix, mode2D);
+    // Upload from the pixel buffer to the texture. This is asynchronous, thus no glFinish is needed.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.pbo);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindTexture(GL_TEXTURE_2D, mTexturesToRender[inputNr]);
+    if(format == TextureFormat::FLOAT) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x(), size.y(), GL_RGBA, GL_FLOAT, nullptr);
+    } else if(format == TextureFormat::RGBA8) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x(), size.y(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        // Rows of 16 bit pixels are not necessarily 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x(), size.y(), GL_RED, GL_UNSIGNED_SHORT, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
+    mImageUsed[inputNr] = upload.image;
+    upload.image.reset();
 }
 
 void ImageRenderer::drawTextures(Matrix4f &perspectiveMatrix, Matrix4f &viewingMatrix, bool mode2D) {
 
-    for(auto it : mDataToRender) {
-        auto input = std::static_pointer_cast<Image>(it.second);
+    // The texture may lag one frame behind the input, thus use the image the texture was made from
+    for(auto it : mImageUsed) {
+        auto input = it.second;
         uint inputNr = it.first;
+        // Get width and height in mm
+        float width = input->getWidth();// * input->getSpacing().x();
+        float height = input->getHeight();// * input->getSpacing().y();
+        // Keep VAO if the image size hasn't changed
+        const Vector2i size(input->getWidth(), input->getHeight());
+        if(mVAO.count(inputNr) > 0 && mVAOSize.count(inputNr) > 0 && mVAOSize[inputNr] == size)
+            continue;
         // Delete old VAO
         if(mVAO.count(inputNr) > 0)
             glDeleteVertexArrays(1, &mVAO[inputNr]);
@@ -233,12 +327,10 @@ void ImageRenderer::drawTextures(Matrix4f &perspectiveMatrix, Matrix4f &viewingM
         uint VAO_ID;
         glGenVertexArrays(1, &VAO_ID);
         mVAO[inputNr] = VAO_ID;
+        mVAOSize[inputNr] = size;
         glBindVertexArray(VAO_ID);
 
         // Create VBO
-        // Get width and height in mm
-        float width = input->getWidth();// * input->getSpacing().x();
-        float height = input->getHeight();// * input->getSpacing().y();
         float vertices[] = {
                 // vertex: x, y, z; tex coordinates: x, y
                 0.0f, height, 0.0f, 0.0f, 0.0f,
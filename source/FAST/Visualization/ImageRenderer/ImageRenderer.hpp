@@ -2,17 +2,33 @@
 
 #include "FAST/Visualization/Renderer.hpp"
 #include "FAST/Data/Image.hpp"
+#include <array>
 
 namespace fast {
 
 class FAST_EXPORT  ImageRenderer : public Renderer {
     FAST_OBJECT(ImageRenderer)
     public:
+        /**
+         * Format of the textures which are uploaded to OpenGL
+         */
+        enum class TextureFormat {
+                FLOAT = 0, // RGBA 32 bit float, 16 bytes per pixel
+                RGBA8, // RGBA 8 bit normalized, 4 bytes per pixel
+                R16 // Single channel 16 bit normalized, 2 bytes per pixel. Multi-channel images use RGBA8 instead.
+        };
         void loadAttributes() override;
         void setIntensityLevel(float level);
         float getIntensityLevel();
         void setIntensityWindow(float window);
         float getIntensityWindow();
+        /**
+         * Set format of the textures used to render the images. Default is RGBA8.
+         * The compact formats reduce the amount of data transferred from OpenCL to OpenGL for each frame.
+         * @param format
+         */
+        void setTextureFormat(TextureFormat format);
+        TextureFormat getTextureFormat() const;
         ~ImageRenderer();
     protected:
         ImageRenderer();
@@ -23,20 +39,64 @@ class FAST_EXPORT  ImageRenderer : public Renderer {
         std::unordered_map<uint, uint> mTexturesToRender;
         std::unordered_map<uint, Image::pointer> mImageUsed;
         /**
-         * Timestamp used to generate texture
+         * Timestamp of the image last read into a pixel buffer object
          */
         std::unordered_map<uint, uint64_t> mDataTimestamp;
         std::unordered_map<uint, uint> mVAO;
         std::unordered_map<uint, uint> mVBO;
         std::unordered_map<uint, uint> mEBO;
+        /**
+         * Size of the vertices in each VAO
+         */
+        std::unordered_map<uint, Vector2i> mVAOSize;
+        /**
+         * Textures are kept and updated as long as size and format of the input doesn't change
+         */
+        std::unordered_map<uint, Vector2i> mTextureSize;
+        std::unordered_map<uint, TextureFormat> mTextureFormat;
+        /**
+         * A pixel buffer object and the transfer of a frame into it
+         */
+        struct PixelBufferUpload {
+            uint pbo = 0;
+            /**
+             * Non-blocking read from the OpenCL buffer into the mapped pixel buffer object
+             */
+            cl::Event readEvent;
+            bool pending = false;
+            Image::pointer image;
+            Vector2i size;
+            TextureFormat format;
+        };
+        /**
+         * Two pixel buffer objects per input, used every other frame. A new frame is read from OpenCL into one of
+         * them without blocking, while the texture is uploaded from the other one, which holds the previous frame.
+         * Thus the transfer of a frame overlaps with rendering the next frame.
+         */
+        std::unordered_map<uint, std::array<PixelBufferUpload, 2>> mPixelBuffers;
+        std::unordered_map<uint, int> mPBOIndex;
+        /**
+         * Image which was last read into a pixel buffer object. mImageUsed is the image shown in the texture.
+         */
+        std::unordered_map<uint, Image::pointer> mImageRequested;
+        /**
+         * OpenCL buffers the textures are rendered to before they are copied to the pixel buffer objects
+         */
+        std::unordered_map<uint, cl::Buffer> mTextureBuffer;
+        std::unordered_map<uint, std::size_t> mTextureBufferSize;
 
         cl::Kernel mKernel;
 
         // Level and window intensities
         float mWindow;
         float mLevel;
+        TextureFormat mFormat = TextureFormat::RGBA8;
 
         void drawTextures(Matrix4f &perspectiveMatrix, Matrix4f &viewingMatrix, bool mode2D);
+        /**
+         * Wait for the read into the pixel buffer object to finish, and upload it to the texture of the input
+         */
+        void uploadPixelBuffer(uint inputNr, PixelBufferUpload& upload);
 };
 
 }
\ No newline at end of file
@@ -122,3 +122,63 @@ __kernel void render3Dimage(
         vstore4(value, linearPosition, PBOwrite);
     }  
 }
+
+__constant sampler_t nearestSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP | CLK_FILTER_NEAREST;
+
+/**
+ * Read a pixel and apply level and window. Single channel images are replicated to RGB.
+ */
+float4 getWindowedPixel(image2d_t image, int2 position, float level, float window) {
+    float4 value = readPixelAsFloat(image, nearestSampler, convert_float2(position) + 0.5f);
+    if(get_image_channel_order(image) == CLK_R) {
+        value.y = value.x;
+        value.z = value.x;
+    }
+
+    value = (value - level + window/2) / window;
+    value = clamp(value, 0.0f, 1.0f);
+    value.w = 1.0f;
+    return value;
+}
+
+/**
+ * The renderToBuffer kernels write a texture in the layout expected by glTexSubImage2D, with the rows flipped
+ * since OpenGL textures start at the bottom.
+ */
+__kernel void renderToBufferFloat(
+        __read_only image2d_t image,
+        __global float* texture,
+        __private float level,
+        __private float window
+        ) {
+    const int2 position = {get_global_id(0), get_global_id(1)};
+    const int linearPosition = position.x + (get_global_size(1) - 1 - position.y)*get_global_size(0);
+
+    vstore4(getWindowedPixel(image, position, level, window), linearPosition, texture);
+}
+
+__kernel void renderToBufferUint8(
+        __read_only image2d_t image,
+        __global uchar* texture,
+        __private float level,
+        __private float window
+        ) {
+    const int2 position = {get_global_id(0), get_global_id(1)};
+    const int linearPosition = position.x + (get_global_size(1) - 1 - position.y)*get_global_size(0);
+
+    const float4 value = getWindowedPixel(image, position, level, window);
+    vstore4(convert_uchar4_sat_rte(value*255.0f), linearPosition, texture);
+}
+
+__kernel void renderToBufferUint16(
+        __read_only image2d_t image,
+        __global ushort* texture,
+        __private float level,
+        __private float window
+        ) {
+    const int2 position = {get_global_id(0), get_global_id(1)};
+    const int linearPosition = position.x + (get_global_size(1) - 1 - position.y)*get_global_size(0);
+
+    const float4 value = getWindowedPixel(image, position, level, window);
+    texture[linearPosition] = convert_ushort_sat_rte(value.x*65535.0f);
+}
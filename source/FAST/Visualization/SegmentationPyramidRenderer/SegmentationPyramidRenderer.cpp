@@ -183,25 +183,26 @@ void SegmentationPyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f view
                     m_tileQueue.pop_back();
                 }
 
-                // Check if tile has been processed before
+                auto parts = split(tileID, "_");
+                if(parts.size() != 3)
+                    throw Exception("incorrect tile format");
+
+                int level = std::stoi(parts[0]);
+                int tile_x = std::stoi(parts[1]);
+                int tile_y = std::stoi(parts[2]);
+
+                // Check if tile has been processed before, if so only upload it again if it has changed
                 bool dirtyPatch = false;
                 if(mTexturesToRender.count(tileID) > 0) {
-                    if(m_input->getDirtyPatches().count(tileID) == 0) {
+                    if(!m_input->isDirtyPatch(level, tile_x, tile_y)) {
                         continue;
                     } else {
                         dirtyPatch = true;
                     }
                 }
                 // Create texture
-                auto parts = split(tileID, "_");
-                if(parts.size() != 3)
-                    throw Exception("incorrect tile format");
-
-                int level = std::stoi(parts[0]);
-                int tile_x = std::stoi(parts[1]);
-                int tile_y = std::stoi(parts[2]);
-                //std::cout << "Segmentation creating texture for tile " << tile_x << " " << tile_y << " at level " << level << std::endl;
-                
+                // Clear dirty flag before reading, so that any writes during the upload marks it as dirty again
+                m_input->clearDirtyPatch(level, tile_x, tile_y);
                 Image::pointer patch;
                 {
                     auto access = m_input->getAccess(ACCESS_READ);
@@ -298,7 +299,6 @@ void SegmentationPyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f view
                         mTexturesToRender[tileID] = textureID;
                         glDeleteTextures(1, &oldTextureID);
                     }
-                    m_input->clearDirtyPatches({tileID});
                 } else {
 					std::lock_guard<std::mutex> lock(m_texturesToRenderMutex);
 					mTexturesToRender[tileID] = textureID;
@@ -395,23 +395,22 @@ void SegmentationPyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f view
     //for(int level = m_input->getNrOfLevels()-1; level >= levelToUse; level--) {
         const int levelWidth = m_input->getLevelWidth(level);
         const int levelHeight = m_input->getLevelHeight(level);
-        const int mTiles = m_input->getLevelPatches(level);
+        const int tilesX = m_input->getLevelTilesX(level);
+        const int tilesY = m_input->getLevelTilesY(level);
+        const int levelTileWidth = m_input->getLevelTileWidth(level);
+        const int levelTileHeight = m_input->getLevelTileHeight(level);
         const float mCurrentTileScale = (float)fullWidth/levelWidth;
 
-        for(int tile_x = 0; tile_x < mTiles; ++tile_x) {
-            for(int tile_y = 0; tile_y < mTiles; ++tile_y) {
+        for(int tile_x = 0; tile_x < tilesX; ++tile_x) {
+            for(int tile_y = 0; tile_y < tilesY; ++tile_y) {
                 const std::string tileString =
                         std::to_string(level) + "_" + std::to_string(tile_x) + "_" + std::to_string(tile_y);
 
-                int tile_offset_x = tile_x * (int) std::floor((float) levelWidth / mTiles);
-                int tile_offset_y = tile_y * (int) std::floor((float) levelHeight / mTiles);
+                int tile_offset_x = tile_x * levelTileWidth;
+                int tile_offset_y = tile_y * levelTileHeight;
 
-                int tile_width = std::floor(((float) levelWidth / mTiles));
-                if(tile_x == mTiles - 1)
-                    tile_width = levelWidth - tile_offset_x;
-                int tile_height = std::floor((float) levelHeight / mTiles);
-                if(tile_y == mTiles - 1)
-                    tile_height = levelHeight - tile_offset_y;
+                int tile_width = std::min(levelTileWidth, levelWidth - tile_offset_x);
+                int tile_height = std::min(levelTileHeight, levelHeight - tile_offset_y);
                 tile_width *= spacing.x();
                 tile_height *= spacing.y();
                 tile_offset_x *= spacing.x();
@@ -444,7 +443,7 @@ void SegmentationPyramidRenderer::draw(Matrix4f perspectiveMatrix, Matrix4f view
 
                 // Is patch in cache?
 				std::unique_lock<std::mutex> lock(m_texturesToRenderMutex);
-                if(mTexturesToRender.count(tileString) == 0 || m_input->isDirtyPatch(tileString)) {
+                if(mTexturesToRender.count(tileString) == 0 || m_input->isDirtyPatch(level, tile_x, tile_y)) {
                     // Add to queue if not in cache or is dirty patch
                     {
                         std::lock_guard<std::mutex> lock(m_tileQueueMutex);